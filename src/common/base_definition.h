@@ -122,6 +122,7 @@ typedef struct
 {
     HDDLVAFunctionID vaFunctionID;
     uint32_t size;
+    uint32_t requestId;     // Matches a reply to its request, 0 if not pipelined
 }HDDLVAData;
 
 typedef struct
@@ -323,6 +324,7 @@ typedef struct
     VABufferType type;
     unsigned int size;
     unsigned int numElement;
+    VABufferID bufId;       // Assigned by the host, VA_INVALID_ID to have the target pick it
 }HDDLVACreateBufferTX;
 
 typedef struct
@@ -716,6 +718,8 @@ typedef struct
     VABufferInfo bufInfo;
 }HDDLVAReleaseBufferHandleRX;
 
+// A request with both channels 0 asks the target to pick the pair, it is named from the
+// target side in both directions
 typedef struct
 {
     HDDLVAData vaData;
@@ -727,8 +731,24 @@ typedef struct
 {
     HDDLVAData vaData;
     VAStatus ret;
+    uint16_t channelTX;
+    uint16_t channelRX;
 }HDDLDynamicChannelRX;
 
+// Reply of an HDDLTransferBatch, the header is followed by callCount results in call order
+typedef struct
+{
+    HDDLVAData vaData;
+    uint32_t callCount;
+}HDDLTransferBatchRX;
+
+// One call of a batch, followed by the size bytes of its own reply
+typedef struct
+{
+    VAStatus ret;
+    uint32_t size;
+}HDDLTransferBatchResult;
+
 #endif
 
 //EOF
@@ -26,7 +26,7 @@
 //! \file    gen_comm.c
 //! \brief   General interface for different communication
 //! \details Provide connecting option for communcation depend on its API.
-//!          Available communcation method, such as XLINK, TCP
+//!          Available communcation method, such as XLINK, TCP, SHM
 //!
 
 #include "gen_comm.h"
@@ -37,6 +37,187 @@
 #define SVE_INPUT_SLEEP_INTERVAL 1000000
 #endif  // ifdef SVE_HOOK
 
+// Reply of a pipelined COMM_READ_PARTIAL submission which has not been handed to the caller
+// yet. The caller fetches it with Comm_Read/Comm_ReadSafe right after the submission returns,
+// exactly like it would read the rest of the message from the transport.
+typedef struct
+{
+    HDDLShimCommContext *ctx;
+    uint8_t *data;
+    uint32_t size;
+    uint32_t offset;
+}HDDLShimPipelineStash;
+
+static __thread HDDLShimPipelineStash pipelineStash;
+
+static void Comm_PipelineStashSet (HDDLShimCommContext *ctx, void *data, uint32_t size)
+{
+    // A caller that bailed out before reading the rest of its previous reply
+    HDDLMemoryMgr_FreeMemory (pipelineStash.data);
+
+    pipelineStash.ctx = data ? ctx : NULL;
+    pipelineStash.data = data;
+    pipelineStash.size = size;
+    pipelineStash.offset = 0;
+}
+
+static CommStatus Comm_PipelineStashRead (int size, void *payload)
+{
+    CommStatus commStatus = COMM_STATUS_SUCCESS;
+
+    if (size < 0 || pipelineStash.offset + size > pipelineStash.size)
+    {
+        SHIM_ERROR_MESSAGE ("Read of %d bytes beyond the %u bytes reply", size,
+            pipelineStash.size - pipelineStash.offset);
+        commStatus = COMM_STATUS_FAILED;
+    }
+    else
+    {
+        HDDLMemoryMgr_Memcpy (payload, pipelineStash.data + pipelineStash.offset, size, size);
+        pipelineStash.offset += size;
+    }
+
+    if (commStatus != COMM_STATUS_SUCCESS || pipelineStash.offset == pipelineStash.size)
+    {
+        Comm_PipelineStashSet (NULL, NULL, 0);
+    }
+
+    return commStatus;
+}
+
+// Bulk pair the last COMM_READ_PARTIAL call of the thread went out on. Its caller reads the
+// rest of the reply through the context it submitted on, Comm_Read, Comm_ReadSafe and
+// Comm_FragmentSize follow the call there.
+typedef struct
+{
+    HDDLShimCommContext *ctx;
+    HDDLShimCommContext *bulkCtx;
+}HDDLShimPartialRoute;
+
+static __thread HDDLShimPartialRoute partialRoute;
+
+static inline HDDLShimCommContext *Comm_PartialRoute (HDDLShimCommContext *ctx)
+{
+    return (ctx != NULL && partialRoute.ctx == ctx) ? partialRoute.bulkCtx : ctx;
+}
+
+// Load of the accelerators the host talks to, shared by all displays of the process
+static HDDLShimDeviceLoad gDeviceLoad[MAX_DEVICE_LIST_SIZE];
+static uint32_t gNumDeviceLoad = 0;
+static pthread_mutex_t gDeviceLoadMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Batched calls which failed after their caller went on, kept until the caller asks with
+// Comm_BatchTakeStatus. A batch may be answered on another thread or channel than the one
+// its caller asks on, so they are kept for the whole process.
+static HDDLShimBatchFailure gBatchFailure[BATCH_FAILURE_SLOTS];
+static uint32_t gBatchFailureCount = 0;
+static pthread_mutex_t gBatchFailureMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Called with gDeviceLoadMutex held
+static HDDLShimDeviceLoad *Comm_FindDeviceLoad (uint32_t swDeviceId)
+{
+    for (uint32_t i = 0; i < gNumDeviceLoad; i++)
+    {
+        if (gDeviceLoad[i].swDeviceId == swDeviceId)
+        {
+            return &gDeviceLoad[i];
+        }
+    }
+
+    if (gNumDeviceLoad == MAX_DEVICE_LIST_SIZE)
+    {
+        return NULL;
+    }
+
+    gDeviceLoad[gNumDeviceLoad].swDeviceId = swDeviceId;
+
+    return &gDeviceLoad[gNumDeviceLoad++];
+}
+
+HDDLShimDeviceLoad *Comm_GetDeviceLoad (uint32_t swDeviceId)
+{
+    HDDLShimDeviceLoad *load;
+
+    HDDLThreadMgr_LockMutex (&gDeviceLoadMutex);
+    load = Comm_FindDeviceLoad (swDeviceId);
+    HDDLThreadMgr_UnlockMutex (&gDeviceLoadMutex);
+
+    return load;
+}
+
+// Open VAContexts first, they are what keeps a device busy. Displays which have not created
+// their contexts yet, traffic and round trip time tell apart devices running as many.
+static bool Comm_IsLessLoaded (HDDLShimDeviceLoad *load, HDDLShimDeviceLoad *than)
+{
+    if (load->uiNumContext != than->uiNumContext)
+    {
+        return load->uiNumContext < than->uiNumContext;
+    }
+
+    if (load->uiNumDisplay != than->uiNumDisplay)
+    {
+        return load->uiNumDisplay < than->uiNumDisplay;
+    }
+
+    if (__atomic_load_n (&load->inFlightBytes, __ATOMIC_RELAXED) !=
+        __atomic_load_n (&than->inFlightBytes, __ATOMIC_RELAXED))
+    {
+        return __atomic_load_n (&load->inFlightBytes, __ATOMIC_RELAXED) <
+            __atomic_load_n (&than->inFlightBytes, __ATOMIC_RELAXED);
+    }
+
+    return __atomic_load_n (&load->latency, __ATOMIC_RELAXED) <
+        __atomic_load_n (&than->latency, __ATOMIC_RELAXED);
+}
+
+CommStatus Comm_PickDevice (uint32_t *swDeviceId)
+{
+    uint32_t swDeviceIdList[MAX_DEVICE_LIST_SIZE];
+    uint32_t numDevices = 0;
+    HDDLShimDeviceLoad *best = NULL;
+    HDDLShimDeviceLoad *load;
+
+    if (XLink_GetDeviceList (swDeviceIdList, &numDevices) != X_LINK_SUCCESS || numDevices == 0)
+    {
+        SHIM_ERROR_MESSAGE ("No device to pick from");
+        return COMM_STATUS_FAILED;
+    }
+
+    HDDLThreadMgr_LockMutex (&gDeviceLoadMutex);
+
+    for (uint32_t i = 0; i < numDevices; i++)
+    {
+        load = Comm_FindDeviceLoad (swDeviceIdList[i]);
+        if (load != NULL && (best == NULL || Comm_IsLessLoaded (load, best)))
+        {
+            best = load;
+        }
+    }
+
+    *swDeviceId = best ? best->swDeviceId : swDeviceIdList[0];
+
+    HDDLThreadMgr_UnlockMutex (&gDeviceLoadMutex);
+
+    SHIM_NORMAL_MESSAGE ("Picked device %u out of %u", *swDeviceId, numDevices);
+
+    return COMM_STATUS_SUCCESS;
+}
+
+void Comm_UpdateDeviceLoad (HDDLShimCommContext *ctx, int32_t displays, int32_t contexts)
+{
+    HDDLShimDeviceLoad *load = ctx->deviceLoad;
+
+    if (load == NULL)
+    {
+        return;
+    }
+
+    HDDLThreadMgr_LockMutex (&gDeviceLoadMutex);
+    load->uiNumDisplay += displays;
+    load->uiNumContext += contexts;
+    HDDLThreadMgr_UnlockMutex (&gDeviceLoadMutex);
+}
+
 CommStatus Comm_ContextInitFromConfig (HDDLShimCommContext **ctx)
 {
     FILE *file;
@@ -46,6 +227,8 @@ CommStatus Comm_ContextInitFromConfig (HDDLShimCommContext **ctx)
     char *mode = NULL;
     char *configParam = NULL;
     char *env = NULL;
+    char *controlEnv = getenv ("BYPASS_CONTROL_CHANNEL");
+    char *deviceEnv = getenv ("BYPASS_DEVICE_BALANCE");
     char *path = NULL;
     struct stat tmp;
     CommStatus commStatus = COMM_STATUS_SUCCESS;
@@ -93,6 +276,7 @@ CommStatus Comm_ContextInitFromConfig (HDDLShimCommContext **ctx)
     {
         uint16_t channelTX = 0;
         uint16_t channelRX = 0;
+        uint32_t swDeviceId = 0;
 
         while (fgets (line, sizeof (line), file) != NULL)
         {
@@ -114,6 +298,26 @@ CommStatus Comm_ContextInitFromConfig (HDDLShimCommContext **ctx)
 	    }
         }
 
+        // Every display goes to the accelerator with the least work from this process
+        if (deviceEnv != NULL && atoi (deviceEnv) != 0)
+        {
+            Comm_PickDevice (&swDeviceId);
+        }
+
+        // The target hands out the channels instead of the config file naming them
+        if (controlEnv != NULL && atoi (controlEnv) != 0)
+        {
+            if (Comm_RequestChannelPair (COMM_MODE_XLINK, swDeviceId, &channelTX,
+                &channelRX) != COMM_STATUS_SUCCESS)
+            {
+                SHIM_ERROR_MESSAGE ("Failed to get XLINK channels from the target");
+                fclose (file);
+                return COMM_STATUS_FAILED;
+            }
+
+            (*ctx)->autoChannel = true;
+        }
+
         if (channelTX == 0 || channelRX == 0)
         {
             SHIM_ERROR_MESSAGE ("XLINK CHANNELTX / CHANNELRX not specified");
@@ -130,11 +334,12 @@ CommStatus Comm_ContextInitFromConfig (HDDLShimCommContext **ctx)
             fclose (file);
             return COMM_STATUS_FAILED;
         }
+
+        (*ctx)->xLinkCtx->swDeviceId = swDeviceId;
     }
     else if (strncmp (mode, "TCP", 3) == 0)
     {
-	//TODO: To uncomment out once able to release TCP support
-        /*uint16_t portTX = 0;
+        uint16_t portTX = 0;
         uint16_t portRX = 0;
         struct hostent *server = NULL;
 
@@ -187,9 +392,49 @@ CommStatus Comm_ContextInitFromConfig (HDDLShimCommContext **ctx)
             SHIM_ERROR_MESSAGE ("%s: tcpCtx NULL value", __func__);
             fclose (file);
             return COMM_STATUS_FAILED;
-        }*/
-        SHIM_ERROR_MESSAGE ("Unsupported Communication mode");
-	return COMM_STATUS_FAILED;
+        }
+    }
+    else if (strncmp (mode, "SHM", 3) == 0)
+    {
+        uint16_t channelTX = 0;
+        uint16_t channelRX = 0;
+
+        while (fgets (line, sizeof (line), file) != NULL)
+        {
+            sscanf (line, "%15s %128s", firstInput, lastInput);
+            configParam = strndup (firstInput, 15);
+
+            if (configParam != NULL)
+            {
+                if (strncmp (configParam, "CHANNELTX", 9) == 0)
+                {
+                    channelTX = (int)strtol (lastInput, (char **)NULL, 16);
+                }
+                else if (strncmp (configParam, "CHANNELRX", 9) == 0)
+                {
+                    channelRX = (int)strtol (lastInput, (char **)NULL, 16);
+                }
+
+                free (configParam);
+            }
+        }
+
+        if (channelTX == 0 || channelRX == 0)
+        {
+            SHIM_ERROR_MESSAGE ("SHM CHANNELTX / CHANNELRX not specified");
+            fclose (file);
+            return COMM_STATUS_FAILED;
+        }
+
+        (*ctx)->commMode = COMM_MODE_SHM;
+        (*ctx)->shmCtx = Shm_ContextInit (channelTX, channelRX);
+
+        if ( (*ctx)->shmCtx == NULL)
+        {
+            SHIM_ERROR_MESSAGE ("%s: shmCtx NULL value", __func__);
+            fclose (file);
+            return COMM_STATUS_FAILED;
+        }
     }
     else if (strncmp (mode, "UNITE", 5) == 0)
     {
@@ -225,12 +470,18 @@ CommStatus Comm_ContextInit (HDDLShimCommContext **ctx, ShimThreadParams *thread
     {
         (*ctx)->xLinkCtx = XLink_ContextInit (threadParams->tx, threadParams->rx);
         SHIM_CHK_NULL ( (*ctx)->xLinkCtx, "", COMM_STATUS_FAILED);
+        (*ctx)->xLinkCtx->swDeviceId = threadParams->swDeviceId;
     }
     else if ( (*ctx)->commMode == COMM_MODE_TCP)
     {
         (*ctx)->tcpCtx = TCP_ContextInit (threadParams->tx, threadParams->rx, NULL);
         SHIM_CHK_NULL ( (*ctx)->tcpCtx, "", COMM_STATUS_FAILED);
     }
+    else if ( (*ctx)->commMode == COMM_MODE_SHM)
+    {
+        (*ctx)->shmCtx = Shm_ContextInit (threadParams->tx, threadParams->rx);
+        SHIM_CHK_NULL ( (*ctx)->shmCtx, "", COMM_STATUS_FAILED);
+    }
     else if ( (*ctx)->commMode == COMM_MODE_UNITE)
     {
 	(*ctx)->uniteCtx = Unite_ContextInit (threadParams->tx, threadParams->rx,
@@ -251,6 +502,15 @@ CommStatus Comm_DynamicContextInit (HDDLShimCommContext **ctx, HDDLShimCommConte
     if ( (*ctx)->commMode == COMM_MODE_XLINK)
     {
         (*ctx)->xLinkCtx = XLink_ContextInit (*tx, *rx);
+        if ( (*ctx)->xLinkCtx == NULL)
+        {
+            commStatus = COMM_STATUS_FAILED;
+        }
+        else
+        {
+            // The target serving the main channel is on that device only
+            (*ctx)->xLinkCtx->swDeviceId = mainCtx->xLinkCtx->xLinkHandler.sw_device_id;
+        }
     }
     else if ( (*ctx)->commMode == COMM_MODE_TCP)
     {
@@ -259,14 +519,110 @@ CommStatus Comm_DynamicContextInit (HDDLShimCommContext **ctx, HDDLShimCommConte
         //     (char *)&mainCtx->tcpCtx->addressTX.sin_addr.s_addr,
         //    strlen ((char *)&mainCtx->tcpCtx->addressTX.sin_addr.s_addr));
     }
+    else if ( (*ctx)->commMode == COMM_MODE_SHM)
+    {
+        (*ctx)->shmCtx = Shm_ContextInit (*tx, *rx);
+    }
     else if ( (*ctx)->commMode == COMM_MODE_UNITE)
     {
-        // TODO: fill in later
+        // HDDLUnite hands out the channels, the target learns them from the caller
+        (*ctx)->uniteCtx = Unite_DynamicContextInit (mainCtx->uniteCtx, *tx, *rx);
+        if ( (*ctx)->uniteCtx == NULL)
+        {
+            commStatus = COMM_STATUS_FAILED;
+        }
+        else
+        {
+            *tx = (*ctx)->uniteCtx->xLinkCtx->xLinkChannelTX;
+            *rx = (*ctx)->uniteCtx->xLinkCtx->xLinkChannelRX;
+        }
     }
 
     return commStatus;
 }
 
+CommStatus Comm_RequestChannelPair (CommMode commMode, uint32_t swDeviceId, uint16_t *tx,
+    uint16_t *rx)
+{
+    HDDLShimCommContext *ctx;
+    ShimThreadParams threadParams;
+    HDDLDynamicChannelTX vaDataTX;
+    HDDLDynamicChannelRX vaDataRX;
+    CommStatus commStatus;
+    uint32_t retryCount = 0;
+
+    SHIM_CHK_NOT_EQUAL (commMode, COMM_MODE_XLINK, "Control channel is XLINK only",
+        COMM_STATUS_FAILED);
+
+    ctx = (HDDLShimCommContext *)HDDLMemoryMgr_AllocAndZeroMemory (
+        sizeof (HDDLShimCommContext));
+    SHIM_CHK_NULL (ctx, "Failed to allocate control context", COMM_STATUS_FAILED);
+
+    HDDLMemoryMgr_ZeroMemory (&threadParams, sizeof (threadParams));
+    threadParams.commMode = commMode;
+    threadParams.tx = XLINK_CONTROL_CHANNEL_TX;
+    threadParams.rx = XLINK_CONTROL_CHANNEL_RX;
+    threadParams.swDeviceId = swDeviceId;
+
+    if (Comm_ContextInit (&ctx, &threadParams) != COMM_STATUS_SUCCESS ||
+        Comm_Initialize (ctx, HOST) != COMM_STATUS_SUCCESS)
+    {
+        SHIM_ERROR_MESSAGE ("Failed to initialize control channel");
+        XLink_ContextDestroy (ctx->xLinkCtx);
+        HDDLMemoryMgr_FreeMemory (ctx);
+        return COMM_STATUS_FAILED;
+    }
+
+    // Another host process may be holding the control channel for its own request
+    while ( (commStatus = Comm_Connect (ctx, HOST)) != COMM_STATUS_SUCCESS &&
+        ++retryCount < CONTROL_CONNECT_RETRY)
+    {
+        usleep (CONTROL_CONNECT_RETRY_INTERVAL);
+    }
+
+    // A failed connect closes whatever channel it opened
+    if (commStatus != COMM_STATUS_SUCCESS)
+    {
+        SHIM_ERROR_MESSAGE ("Failed to connect control channel");
+        XLink_ContextDestroy (ctx->xLinkCtx);
+        HDDLMemoryMgr_FreeMemory (ctx);
+        return COMM_STATUS_FAILED;
+    }
+
+    // Both channels 0, the target picks a free pair and opens its side before it replies
+    HDDLMemoryMgr_ZeroMemory (&vaDataTX, sizeof (vaDataTX));
+    vaDataTX.vaData.vaFunctionID = HDDLDynamicChannelID;
+    vaDataTX.vaData.size = sizeof (HDDLDynamicChannelTX);
+
+    commStatus = Comm_Write (ctx, sizeof (HDDLDynamicChannelTX), &vaDataTX);
+    if (commStatus == COMM_STATUS_SUCCESS)
+    {
+        commStatus = Comm_Read (ctx, sizeof (HDDLDynamicChannelRX), &vaDataRX);
+    }
+
+    // One request per connection, the target waits for the next host right away
+    Comm_Disconnect (ctx, HOST);
+    HDDLMemoryMgr_FreeMemory (ctx);
+
+    SHIM_CHK_ERROR (commStatus, "Failed to request channel pair", COMM_STATUS_FAILED);
+
+    if ( (vaDataRX.vaData.vaFunctionID != HDDLDynamicChannelID) ||
+        (vaDataRX.vaData.size != sizeof (HDDLDynamicChannelRX)) ||
+        (vaDataRX.ret != VA_STATUS_SUCCESS))
+    {
+        SHIM_ERROR_MESSAGE ("Target has no channel pair to hand out");
+        return COMM_STATUS_FAILED;
+    }
+
+    // The reply names the channels from the target side
+    *tx = vaDataRX.channelRX;
+    *rx = vaDataRX.channelTX;
+
+    SHIM_NORMAL_MESSAGE ("Target handed out channel TX %x RX %x", *tx, *rx);
+
+    return COMM_STATUS_SUCCESS;
+}
+
 CommStatus Comm_Initialize (HDDLShimCommContext *ctx, int flag)
 {
     CommStatus commStatus = COMM_STATUS_UNKNOWN;
@@ -289,6 +645,15 @@ CommStatus Comm_Initialize (HDDLShimCommContext *ctx, int flag)
         else
             commStatus = COMM_STATUS_FAILED;
     }
+    else if (IS_SHM_MODE (ctx))
+    {
+        ShmStatus shmStatus = Shm_Initialize (ctx->shmCtx, flag);
+
+        if (shmStatus == SHM_SUCCESS)
+            commStatus = COMM_STATUS_SUCCESS;
+        else
+            commStatus = COMM_STATUS_FAILED;
+    }
     else if (IS_UNITE_MODE (ctx))
     {
         commStatus = Unite_Initialize (ctx->uniteCtx, flag);
@@ -326,15 +691,68 @@ CommStatus Comm_Connect (HDDLShimCommContext *ctx, int flag)
             commStatus = COMM_STATUS_SUCCESS;
         }
     }
+    else if (IS_SHM_MODE (ctx))
+    {
+        // Host already handed the shared memory over during Shm_Initialize
+        if (flag == TARGET)
+        {
+            ShmStatus shmStatus = Shm_Connect (ctx->shmCtx);
+
+            if (shmStatus == SHM_SUCCESS)
+                commStatus = COMM_STATUS_SUCCESS;
+            else
+                commStatus = COMM_STATUS_FAILED;
+        }
+        else
+        {
+            commStatus = COMM_STATUS_SUCCESS;
+        }
+    }
     else if (IS_UNITE_MODE (ctx))
     {
         commStatus = Unite_Connect (ctx->uniteCtx);
     }
 
+    // The host's traffic on the channel counts towards the load of its device
+    if (commStatus == COMM_STATUS_SUCCESS && flag == HOST)
+    {
+        if (IS_XLINK_MODE (ctx))
+        {
+            ctx->deviceLoad = Comm_GetDeviceLoad (ctx->xLinkCtx->xLinkHandler.sw_device_id);
+        }
+        else if (IS_UNITE_MODE (ctx))
+        {
+            ctx->deviceLoad = Comm_GetDeviceLoad (
+                ctx->uniteCtx->xLinkCtx->xLinkHandler.sw_device_id);
+        }
+    }
+
     return commStatus;
 }
 
+static uint32_t Comm_IovSize (struct iovec *iov, int iovCount)
+{
+    uint32_t size = 0;
+
+    for (int i = 0; i < iovCount; i++)
+    {
+        size += iov[i].iov_len;
+    }
+
+    return size;
+}
+
 CommStatus Comm_Write (HDDLShimCommContext *ctx, int size, void *payload)
+{
+    struct iovec iov;
+
+    iov.iov_base = payload;
+    iov.iov_len = size;
+
+    return Comm_WriteV (ctx, &iov, 1);
+}
+
+CommStatus Comm_WriteV (HDDLShimCommContext *ctx, struct iovec *iov, int iovCount)
 {
     SHIM_PROFILE_START ();
 
@@ -342,7 +760,7 @@ CommStatus Comm_Write (HDDLShimCommContext *ctx, int size, void *payload)
 
     if (IS_XLINK_MODE (ctx))
     {
-        XLinkStatus xlinkStatus = XLink_Write (ctx->xLinkCtx, size, payload);
+        XLinkStatus xlinkStatus = XLink_WriteV (ctx->xLinkCtx, iov, iovCount);
 
         if (xlinkStatus == X_LINK_SUCCESS)
             commStatus = COMM_STATUS_SUCCESS;
@@ -351,32 +769,90 @@ CommStatus Comm_Write (HDDLShimCommContext *ctx, int size, void *payload)
     }
     else if (IS_TCP_MODE (ctx))
     {
-        TCPStatus tcpStatus = TCP_Write (ctx->tcpCtx, size, payload);
+        TCPStatus tcpStatus = TCP_WriteV (ctx->tcpCtx, iov, iovCount);
 
         if (tcpStatus == TCP_SUCCESS)
             commStatus = COMM_STATUS_SUCCESS;
         else
             commStatus = COMM_STATUS_FAILED;
     }
+    else if (IS_SHM_MODE (ctx))
+    {
+        ShmStatus shmStatus = Shm_WriteV (ctx->shmCtx, iov, iovCount);
+
+        if (shmStatus == SHM_SUCCESS)
+            commStatus = COMM_STATUS_SUCCESS;
+        else
+            commStatus = COMM_STATUS_FAILED;
+    }
     else if (IS_UNITE_MODE (ctx))
     {
-        commStatus = Unite_Write (ctx->uniteCtx, size, payload);
+        commStatus = Unite_WriteV (ctx->uniteCtx, iov, iovCount);
     }
 
-    SHIM_NORMAL_MESSAGE ("write size: %d", size);
+    SHIM_NORMAL_MESSAGE ("write size: %u", Comm_IovSize (iov, iovCount));
 
     SHIM_PROFILE_END ();
 
     return commStatus;
 }
 
+CommStatus Comm_WriteSafe (HDDLShimCommContext *ctx, int size, void *payload)
+{
+    struct iovec iov;
+
+    iov.iov_base = payload;
+    iov.iov_len = size;
+
+    return Comm_WriteSafeV (ctx, &iov, 1);
+}
+
+static pthread_mutex_t *Comm_TransportMutex (HDDLShimCommContext *ctx)
+{
+    pthread_mutex_t *mutex = NULL;
+
+    if (IS_XLINK_MODE (ctx))
+        mutex = &ctx->xLinkCtx->xLinkMutex;
+    else if (IS_TCP_MODE (ctx))
+        mutex = &ctx->tcpCtx->tcpMutex;
+    else if (IS_SHM_MODE (ctx))
+        mutex = &ctx->shmCtx->shmMutex;
+    else if (IS_UNITE_MODE (ctx))
+        mutex = &ctx->uniteCtx->xLinkCtx->xLinkMutex;
+
+    return mutex;
+}
+
+CommStatus Comm_WriteSafeV (HDDLShimCommContext *ctx, struct iovec *iov, int iovCount)
+{
+    CommStatus commStatus = COMM_STATUS_UNKNOWN;
+    pthread_mutex_t *mutex = Comm_TransportMutex (ctx);
+
+    SHIM_CHK_NULL (mutex, "Invalid communication mode", COMM_STATUS_FAILED);
+
+    HDDLThreadMgr_LockMutex (mutex);
+
+    commStatus = Comm_WriteV (ctx, iov, iovCount);
+
+    HDDLThreadMgr_UnlockMutex (mutex);
+
+    return commStatus;
+}
+
 CommStatus Comm_Read (HDDLShimCommContext *ctx, int size, void *payload)
 {
     SHIM_PROFILE_START ();
 
     CommStatus commStatus = COMM_STATUS_UNKNOWN;
 
-    if (IS_XLINK_MODE (ctx))
+    ctx = Comm_PartialRoute (ctx);
+
+    // The receiver thread already took the reply off the transport
+    if (pipelineStash.ctx == ctx)
+    {
+        commStatus = Comm_PipelineStashRead (size, payload);
+    }
+    else if (IS_XLINK_MODE (ctx))
     {
         XLinkStatus xlinkStatus = XLink_Read (ctx->xLinkCtx, size, payload);
 
@@ -396,6 +872,17 @@ CommStatus Comm_Read (HDDLShimCommContext *ctx, int size, void *payload)
         else
             commStatus = COMM_STATUS_FAILED;
     }
+    else if (IS_SHM_MODE (ctx))
+    {
+        ShmStatus shmStatus = Shm_Read (ctx->shmCtx, size, payload);
+
+        if (shmStatus == SHM_SUCCESS)
+            commStatus = COMM_STATUS_SUCCESS;
+        else if (shmStatus == SHM_EOF)
+            commStatus = COMM_STATUS_EOF;
+        else
+            commStatus = COMM_STATUS_FAILED;
+    }
     else if (IS_UNITE_MODE (ctx))
     {
         commStatus = Unite_Read (ctx->uniteCtx, size, payload);
@@ -414,9 +901,15 @@ CommStatus Comm_ReadSafe (HDDLShimCommContext *ctx, int size, void *payload)
 
     CommStatus commStatus = COMM_STATUS_UNKNOWN;
 
-    if (IS_XLINK_MODE (ctx))
-    {
-        HDDLThreadMgr_LockMutex (&ctx->xLinkCtx->xLinkMutex);
+    ctx = Comm_PartialRoute (ctx);
+
+    if (pipelineStash.ctx == ctx)
+    {
+        commStatus = Comm_PipelineStashRead (size, payload);
+    }
+    else if (IS_XLINK_MODE (ctx))
+    {
+        HDDLThreadMgr_LockMutex (&ctx->xLinkCtx->xLinkMutex);
 
         XLinkStatus xlinkStatus = XLink_Read (ctx->xLinkCtx, size, payload);
 
@@ -427,6 +920,36 @@ CommStatus Comm_ReadSafe (HDDLShimCommContext *ctx, int size, void *payload)
         else
             commStatus = COMM_STATUS_FAILED;
     }
+    else if (IS_TCP_MODE (ctx))
+    {
+        HDDLThreadMgr_LockMutex (&ctx->tcpCtx->tcpMutex);
+
+        TCPStatus tcpStatus = TCP_Read (ctx->tcpCtx, size, payload);
+
+        HDDLThreadMgr_UnlockMutex (&ctx->tcpCtx->tcpMutex);
+
+        if (tcpStatus == TCP_SUCCESS)
+            commStatus = COMM_STATUS_SUCCESS;
+        else if (tcpStatus == TCP_EOF)
+            commStatus = COMM_STATUS_EOF;
+        else
+            commStatus = COMM_STATUS_FAILED;
+    }
+    else if (IS_SHM_MODE (ctx))
+    {
+        HDDLThreadMgr_LockMutex (&ctx->shmCtx->shmMutex);
+
+        ShmStatus shmStatus = Shm_Read (ctx->shmCtx, size, payload);
+
+        HDDLThreadMgr_UnlockMutex (&ctx->shmCtx->shmMutex);
+
+        if (shmStatus == SHM_SUCCESS)
+            commStatus = COMM_STATUS_SUCCESS;
+        else if (shmStatus == SHM_EOF)
+            commStatus = COMM_STATUS_EOF;
+        else
+            commStatus = COMM_STATUS_FAILED;
+    }
     else if (IS_UNITE_MODE (ctx))
     {
 	HDDLThreadMgr_LockMutex (&ctx->uniteCtx->xLinkCtx->xLinkMutex);
@@ -469,6 +992,17 @@ CommStatus Comm_Peek (HDDLShimCommContext *ctx, uint32_t *size, void *payload)
         else
             commStatus = COMM_STATUS_FAILED;
     }
+    else if (IS_SHM_MODE (ctx))
+    {
+        ShmStatus shmStatus = Shm_Peek (ctx->shmCtx, size, payload);
+
+        if (shmStatus == SHM_SUCCESS)
+            commStatus = COMM_STATUS_SUCCESS;
+        else if (shmStatus == SHM_CONNECTION_CLOSED)
+            commStatus = COMM_STATUS_CONNECTION_CLOSED;
+        else
+            commStatus = COMM_STATUS_FAILED;
+    }
     else if (IS_UNITE_MODE (ctx))
     {
         commStatus = Unite_Peek (ctx->uniteCtx, size, payload);
@@ -481,8 +1015,368 @@ CommStatus Comm_Peek (HDDLShimCommContext *ctx, uint32_t *size, void *payload)
     return commStatus;
 }
 
+void Comm_ReleasePayload (HDDLShimCommContext *ctx, void *payload, uint32_t size)
+{
+    if (IS_XLINK_MODE (ctx))
+    {
+        XLink_ReleasePayload (ctx->xLinkCtx, payload, size);
+    }
+    else if (IS_UNITE_MODE (ctx))
+    {
+        Unite_ReleasePayload (ctx->uniteCtx, payload, size);
+    }
+    else
+    {
+        HDDLMemoryMgr_FreeMemory (payload);
+    }
+}
+
+// XLink and Unite: the first fragment straight from the xlink receive buffer, or a copy in a
+// pool buffer when zero copy reads are turned off
+static CommStatus Comm_XLinkFirstFragment (HDDLShimCommContext *ctx, uint32_t *size,
+    void **payload, bool *borrowed)
+{
+    HDDLShimXLinkContext *xLinkCtx = IS_XLINK_MODE (ctx) ? ctx->xLinkCtx :
+        ctx->uniteCtx->xLinkCtx;
+    CommStatus commStatus;
+
+    *borrowed = xLinkCtx->zeroCopyRead;
+
+    if (!*borrowed)
+    {
+        return Comm_Peek (ctx, size, payload);
+    }
+
+    if (IS_XLINK_MODE (ctx))
+    {
+        commStatus = (XLink_Borrow (xLinkCtx, size, payload) == X_LINK_SUCCESS) ?
+            COMM_STATUS_SUCCESS : COMM_STATUS_FAILED;
+    }
+    else
+    {
+        commStatus = Unite_Borrow (ctx->uniteCtx, size, payload);
+    }
+
+    return commStatus;
+}
+
+CommStatus Comm_BorrowMessage (HDDLShimCommContext *ctx, HDDLShimCommMessage *message)
+{
+    SHIM_PROFILE_START ();
+
+    CommStatus commStatus = COMM_STATUS_UNKNOWN;
+    HDDLVAData vaData;
+    uint32_t size = sizeof (HDDLVAData);
+
+    message->payload = NULL;
+    message->size = 0;
+    message->borrowed = false;
+    message->poolSize = 0;
+    message->owner = ctx;
+
+    if (IS_TCP_MODE (ctx) || IS_SHM_MODE (ctx))
+    {
+        commStatus = Comm_Peek (ctx, &size, &vaData);
+        if (commStatus != COMM_STATUS_SUCCESS)
+        {
+            return commStatus;
+        }
+
+        if (vaData.size < sizeof (HDDLVAData))
+        {
+            SHIM_ERROR_MESSAGE ("Invalid message size %u", vaData.size);
+            return COMM_STATUS_FAILED;
+        }
+
+        message->size = vaData.size;
+
+        if (IS_TCP_MODE (ctx))
+        {
+            TCPStatus tcpStatus = TCP_Borrow (ctx->tcpCtx, message->size, &message->payload);
+
+            if (tcpStatus == TCP_SUCCESS)
+                commStatus = COMM_STATUS_SUCCESS;
+            else if (tcpStatus == TCP_EOF)
+                commStatus = COMM_STATUS_EOF;
+            else
+                commStatus = COMM_STATUS_FAILED;
+
+            message->borrowed = true;
+        }
+        else if (message->size <= ctx->shmCtx->readRing->size)
+        {
+            ShmStatus shmStatus = Shm_Borrow (ctx->shmCtx, message->size, &message->payload);
+
+            if (shmStatus == SHM_SUCCESS)
+                commStatus = COMM_STATUS_SUCCESS;
+            else if (shmStatus == SHM_CONNECTION_CLOSED)
+                commStatus = COMM_STATUS_CONNECTION_CLOSED;
+            else
+                commStatus = COMM_STATUS_FAILED;
+
+            message->borrowed = true;
+        }
+        else
+        {
+            // Streamed through the ring in pieces, there is nothing to lend out
+            message->payload = HDDLMemoryMgr_AllocMemory (message->size);
+            SHIM_CHK_NULL (message->payload, "Failed to allocate message", COMM_STATUS_FAILED);
+
+            commStatus = Comm_Read (ctx, message->size, message->payload);
+        }
+
+        if (commStatus != COMM_STATUS_SUCCESS)
+        {
+            if (!message->borrowed)
+            {
+                HDDLMemoryMgr_FreeMemory (message->payload);
+            }
+
+            message->payload = NULL;
+            message->borrowed = false;
+        }
+    }
+    else if (IS_XLINK_MODE (ctx) || IS_UNITE_MODE (ctx))
+    {
+        void *fragment = NULL;
+        bool borrowed = false;
+
+        commStatus = Comm_XLinkFirstFragment (ctx, &size, &fragment, &borrowed);
+        if (commStatus != COMM_STATUS_SUCCESS)
+        {
+            return commStatus;
+        }
+
+        message->payload = fragment;
+        message->size = size;
+        message->borrowed = borrowed;
+        message->poolSize = borrowed ? 0 : size;
+
+        if (size < sizeof (HDDLVAData))
+        {
+            SHIM_ERROR_MESSAGE ("Invalid message size %u", size);
+            Comm_ReleaseMessage (ctx, message);
+            return COMM_STATUS_FAILED;
+        }
+
+        // Larger messages come in several fragments and are put together in a buffer of ours
+        if ( ( (HDDLVAData *)fragment)->size > size)
+        {
+            HDDLShimCommMessage first = *message;
+
+            message->size = ( (HDDLVAData *)fragment)->size;
+            message->payload = HDDLMemoryMgr_AllocMemory (message->size);
+            message->borrowed = false;
+            message->poolSize = 0;
+
+            if (message->payload == NULL)
+            {
+                SHIM_ERROR_MESSAGE ("Failed to allocate message");
+                Comm_ReleaseMessage (ctx, &first);
+                return COMM_STATUS_FAILED;
+            }
+
+            HDDLMemoryMgr_Memcpy (message->payload, first.payload, message->size, first.size);
+            Comm_ReleaseMessage (ctx, &first);
+
+            commStatus = Comm_Read (ctx, message->size - size, (uint8_t *)message->payload + size);
+            if (commStatus != COMM_STATUS_SUCCESS)
+            {
+                Comm_ReleaseMessage (ctx, message);
+            }
+        }
+        else
+        {
+            message->size = ( (HDDLVAData *)fragment)->size;
+        }
+    }
+
+    SHIM_PROFILE_END ();
+
+    return commStatus;
+}
+
+CommStatus Comm_DetachMessage (HDDLShimCommContext *ctx, HDDLShimCommMessage *message)
+{
+    void *payload;
+
+    // Borrowed xlink buffers are released by address, anything else has to be given back
+    // before the next message can be read
+    if (!message->borrowed || IS_XLINK_MODE (ctx) || IS_UNITE_MODE (ctx))
+    {
+        return COMM_STATUS_SUCCESS;
+    }
+
+    payload = HDDLMemoryMgr_AllocMemory (message->size);
+    SHIM_CHK_NULL (payload, "Failed to allocate message", COMM_STATUS_FAILED);
+
+    HDDLMemoryMgr_Memcpy (payload, message->payload, message->size, message->size);
+    Comm_ReleaseMessage (ctx, message);
+
+    message->payload = payload;
+    message->borrowed = false;
+    message->poolSize = 0;
+
+    return COMM_STATUS_SUCCESS;
+}
+
+void Comm_ReleaseMessage (HDDLShimCommContext *ctx, HDDLShimCommMessage *message)
+{
+    if (message->payload == NULL)
+    {
+        return;
+    }
+
+    // Replies of bulk calls go back to the bulk pair
+    if (message->owner != NULL)
+    {
+        ctx = message->owner;
+    }
+
+    if (!message->borrowed)
+    {
+        if (message->poolSize)
+        {
+            Comm_ReleasePayload (ctx, message->payload, message->poolSize);
+        }
+        else
+        {
+            HDDLMemoryMgr_FreeMemory (message->payload);
+        }
+    }
+    else if (IS_XLINK_MODE (ctx))
+    {
+        XLink_ReleaseBorrowed (ctx->xLinkCtx, message->payload);
+    }
+    else if (IS_UNITE_MODE (ctx))
+    {
+        Unite_ReleaseBorrowed (ctx->uniteCtx, message->payload);
+    }
+    else if (IS_TCP_MODE (ctx))
+    {
+        TCP_ReleaseBorrowed (ctx->tcpCtx);
+    }
+    else if (IS_SHM_MODE (ctx))
+    {
+        Shm_ReleaseBorrowed (ctx->shmCtx, message->size);
+    }
+
+    message->payload = NULL;
+}
+
 CommStatus Comm_Submission (HDDLShimCommContext *ctx, HDDLVAFunctionID functionId,
     CommReadOp readOp, int inSize, void *inPayload, int outSize, void **outPayload)
+{
+    struct iovec iov;
+
+    iov.iov_base = inPayload;
+    iov.iov_len = inSize;
+
+    return Comm_SubmissionV (ctx, functionId, readOp, &iov, 1, outSize, outPayload);
+}
+
+#define FUNCTION_INFO(id, txSize, flags, route) [id] = { #id, txSize, flags, route }
+
+#define CONTROL COMM_ROUTE_CONTROL
+#define BULK COMM_ROUTE_BULK
+#define REPLY FUNCTION_REPLY
+#define ANSWERED (FUNCTION_REPLY | FUNCTION_ANSWERED)
+
+// Every call the host sends. Calls moving frame or image data go out on the bulk pair of the
+// context, so that small calls such as vaSyncSurface do not queue up behind them. Calls which
+// wait for the accelerator or move a whole surface are FUNCTION_ASYNC.
+static const HDDLShimFunctionInfo gFunctionInfo[HDDLVAMaxFunctionID] = {
+    FUNCTION_INFO (HDDLVAMedia_DriverInit, sizeof (HDDLVAMedia_DriverInitTX), REPLY, CONTROL),
+    FUNCTION_INFO (HDDLVATerminate, sizeof (HDDLVATerminateTX), REPLY, CONTROL),
+    FUNCTION_INFO (HDDLVAQueryConfigProfiles, sizeof (HDDLVAQueryConfigProfilesTX), REPLY,
+        CONTROL),
+    FUNCTION_INFO (HDDLVAQueryConfigEntrypoints, sizeof (HDDLVAQueryConfigEntrypointsTX), REPLY,
+        CONTROL),
+    FUNCTION_INFO (HDDLVAGetConfigAttributes, sizeof (HDDLVAGetConfigAttributesTX), REPLY,
+        CONTROL),
+    FUNCTION_INFO (HDDLVACreateConfig, sizeof (HDDLVACreateConfigTX), REPLY, CONTROL),
+    FUNCTION_INFO (HDDLVADestroyConfig, sizeof (HDDLVADestroyConfigTX), REPLY, CONTROL),
+    FUNCTION_INFO (HDDLVAQueryConfigAttributes, sizeof (HDDLVAQueryConfigAttributesTX), REPLY,
+        CONTROL),
+    FUNCTION_INFO (HDDLVACreateSurfaces, sizeof (HDDLVACreateSurfacesTX), ANSWERED, CONTROL),
+    FUNCTION_INFO (HDDLVADestroySurfaces, sizeof (HDDLVADestroySurfacesTX), REPLY, CONTROL),
+    FUNCTION_INFO (HDDLVACreateContext, sizeof (HDDLVACreateContextTX), REPLY, CONTROL),
+    FUNCTION_INFO (HDDLVADestroyContext, sizeof (HDDLVADestroyContextTX),
+        FUNCTION_DESTROY_FINAL, CONTROL),
+    FUNCTION_INFO (HDDLVACreateBuffer, sizeof (HDDLVACreateBufferTX), ANSWERED, BULK),
+    FUNCTION_INFO (HDDLVABufferSetNumElements, sizeof (HDDLVABufferSetNumElementsTX), REPLY,
+        CONTROL),
+    FUNCTION_INFO (HDDLVAMapBuffer, sizeof (HDDLVAMapBufferTX), REPLY | FUNCTION_ASYNC, BULK),
+    FUNCTION_INFO (HDDLVAUnmapBuffer, sizeof (HDDLVAUnmapBufferTX), REPLY, BULK),
+    FUNCTION_INFO (HDDLVADestroyBuffer, sizeof (HDDLVADestroyBufferTX), FUNCTION_DESTROY_START,
+        CONTROL),
+    FUNCTION_INFO (HDDLVABeginPicture, sizeof (HDDLVABeginPictureTX), FUNCTION_FRAME_START,
+        CONTROL),
+    FUNCTION_INFO (HDDLVARenderPicture, sizeof (HDDLVARenderPictureTX), 0, CONTROL),
+    FUNCTION_INFO (HDDLVAEndPicture, sizeof (HDDLVAEndPictureTX), FUNCTION_FRAME_END, CONTROL),
+    FUNCTION_INFO (HDDLVASyncSurface, sizeof (HDDLVASyncSurfaceTX), REPLY | FUNCTION_ASYNC,
+        CONTROL),
+    FUNCTION_INFO (HDDLVAQuerySurfaceStatus, sizeof (HDDLVAQuerySurfaceStatusTX), REPLY,
+        CONTROL),
+    FUNCTION_INFO (HDDLVAQuerySurfaceError, 0, REPLY, CONTROL),
+    FUNCTION_INFO (HDDLVAPutSurface, 0, REPLY, CONTROL),
+    FUNCTION_INFO (HDDLVAQueryImageFormats, sizeof (HDDLVAQueryImageFormatsTX), REPLY, CONTROL),
+    FUNCTION_INFO (HDDLVACreateImage, sizeof (HDDLVACreateImageTX), REPLY, CONTROL),
+    FUNCTION_INFO (HDDLVADeriveImage, sizeof (HDDLVADeriveImageTX), REPLY, CONTROL),
+    FUNCTION_INFO (HDDLVADestroyImage, sizeof (HDDLVADestroyImageTX), REPLY, CONTROL),
+    FUNCTION_INFO (HDDLVASetImagePalette, 0, REPLY, CONTROL),
+    FUNCTION_INFO (HDDLVAGetImage, sizeof (HDDLVAGetImageTX), REPLY | FUNCTION_ASYNC, BULK),
+    FUNCTION_INFO (HDDLVAPutImage, sizeof (HDDLVAPutImageTX), REPLY, BULK),
+    FUNCTION_INFO (HDDLVAQuerySubpictureFormats, 0, REPLY, CONTROL),
+    FUNCTION_INFO (HDDLVACreateSubpicture, 0, REPLY, CONTROL),
+    FUNCTION_INFO (HDDLVADestroySubpicture, 0, REPLY, CONTROL),
+    FUNCTION_INFO (HDDLVASetSubpictureImage, 0, REPLY, CONTROL),
+    FUNCTION_INFO (HDDLVASetSubpictureChromakey, 0, REPLY, CONTROL),
+    FUNCTION_INFO (HDDLVASetSubpictureGlobalAlpha, 0, REPLY, CONTROL),
+    FUNCTION_INFO (HDDLVAAssociateSubpicture, 0, REPLY, CONTROL),
+    FUNCTION_INFO (HDDLVADeassociateSubpicture, 0, REPLY, CONTROL),
+    FUNCTION_INFO (HDDLVAQueryDisplayAttributes, sizeof (HDDLVAQueryDisplayAttributesTX), REPLY,
+        CONTROL),
+    FUNCTION_INFO (HDDLVAGetDisplayAttributes, sizeof (HDDLVAGetDisplayAttributesTX), REPLY,
+        CONTROL),
+    FUNCTION_INFO (HDDLVASetDisplayAttributes, sizeof (HDDLVASetDisplayAttributesTX), REPLY,
+        CONTROL),
+    FUNCTION_INFO (HDDLVALockSurface, 0, REPLY, CONTROL),
+    FUNCTION_INFO (HDDLVAUnlockSurface, 0, REPLY, CONTROL),
+    FUNCTION_INFO (HDDLVAGetSurfaceAttributes, 0, REPLY, CONTROL),
+    FUNCTION_INFO (HDDLVAQuerySurfaceAttributes, sizeof (HDDLVAQuerySurfaceAttributesTX), REPLY,
+        CONTROL),
+    FUNCTION_INFO (HDDLVACreateSurfaces2, sizeof (HDDLVACreateSurfaces2TX), ANSWERED, CONTROL),
+    FUNCTION_INFO (HDDLVAAcquireBufferHandle, sizeof (HDDLVAAcquireBufferHandleTX), REPLY,
+        CONTROL),
+    FUNCTION_INFO (HDDLVAReleaseBufferHandle, sizeof (HDDLVAReleaseBufferHandleTX), REPLY,
+        CONTROL),
+    FUNCTION_INFO (HDDLVAExportSurfaceHandle, sizeof (HDDLVAExportSurfaceHandleTX), REPLY,
+        CONTROL),
+    FUNCTION_INFO (HDDLVACreateBuffer2, sizeof (HDDLVACreateBuffer2TX), ANSWERED, CONTROL),
+    FUNCTION_INFO (HDDLDynamicChannelID, sizeof (HDDLDynamicChannelTX), REPLY, CONTROL),
+    FUNCTION_INFO (HDDLTransferBatch, sizeof (HDDLVAData), 0, BULK),
+};
+
+#undef CONTROL
+#undef BULK
+#undef REPLY
+#undef ANSWERED
+
+static const HDDLShimFunctionInfo gUnknownFunction = { "unknown", 0, 0, COMM_ROUTE_CONTROL };
+
+const HDDLShimFunctionInfo *Comm_GetFunctionInfo (HDDLVAFunctionID functionId)
+{
+    if (functionId >= HDDLVAMaxFunctionID || gFunctionInfo[functionId].name == NULL)
+    {
+        return &gUnknownFunction;
+    }
+
+    return &gFunctionInfo[functionId];
+}
+
+CommStatus Comm_SubmissionV (HDDLShimCommContext *ctx, HDDLVAFunctionID functionId,
+    CommReadOp readOp, struct iovec *iov, int iovCount, int outSize, void **outPayload)
 {
     SHIM_PROFILE_START ();
 
@@ -490,12 +1384,12 @@ CommStatus Comm_Submission (HDDLShimCommContext *ctx, HDDLVAFunctionID functionI
 
     if (IS_BATCH (ctx))
     {
-        commStatus = Comm_BatchSubmission (ctx, functionId, readOp, inSize, inPayload, outSize,
+        commStatus = Comm_BatchSubmissionV (ctx, functionId, readOp, iov, iovCount, outSize,
             outPayload);
     }
     else
     {
-        commStatus = Comm_SingleSubmission (ctx, readOp, inSize, inPayload, outSize, outPayload);
+        commStatus = Comm_SingleSubmissionV (ctx, readOp, iov, iovCount, outSize, outPayload);
     }
 
     SHIM_PROFILE_END ();
@@ -503,227 +1397,1293 @@ CommStatus Comm_Submission (HDDLShimCommContext *ctx, HDDLVAFunctionID functionI
     return commStatus;
 }
 
-CommStatus Comm_BatchFlush (HDDLShimCommContext *ctx, int outSize, void **outPayload,
-    HDDLShimBatchPayloadOp payloadOp)
+// Start an empty batch, only the header is reserved for batch function and size
+// identification before flush
+static void Comm_BatchReset (HDDLShimBatchPayload *batchPayload)
 {
-    CommStatus commStatus = COMM_STATUS_UNKNOWN;
-    HDDLShimBatchPayload *batchPayload = ctx->batchPayload;
-    HDDLVAData batchHeader;
+    batchPayload->current = batchPayload->first;
+    batchPayload->current->used = sizeof (HDDLVAData);
+    batchPayload->offset = sizeof (HDDLVAData);
+    batchPayload->batchState = BATCH_OFF;
+    batchPayload->callCount = 0;
+}
 
-    // Append batch header to the begining of the payload data which reserved earlier during
-    // Comm_BatchInit function
-    batchHeader.vaFunctionID = HDDLTransferBatch;
-    batchHeader.size = batchPayload->offset;
+static void Comm_BatchFree (HDDLShimBatchPayload *batchPayload)
+{
+    HDDLShimBatchSegment *segment;
 
-    HDDLMemoryMgr_Memcpy (batchPayload->data, &batchHeader, sizeof (batchPayload->data),
-	sizeof (HDDLVAData));
+    if (batchPayload == NULL)
+    {
+        return;
+    }
 
-    batchPayload->batchState = BATCH_OFF;
+    HDDLMemoryMgr_FreeMemory (batchPayload->calls);
 
-    commStatus = Comm_SingleSubmission (ctx, COMM_READ_FULL, batchPayload->offset,
-        batchPayload->data, outSize, outPayload);
+    while (batchPayload->first != NULL)
+    {
+        segment = batchPayload->first;
+        batchPayload->first = segment->next;
+        HDDLMemoryMgr_FreeMemory (segment);
+    }
 
-    if (payloadOp == PAYLOAD_FREE)
+    HDDLMemoryMgr_FreeMemory (batchPayload);
+}
+
+static HDDLShimBatchSegment *Comm_BatchNewSegment (uint32_t size)
+{
+    uint32_t capacity = size > BATCH_SEGMENT_SIZE ? size : BATCH_SEGMENT_SIZE;
+    HDDLShimBatchSegment *segment = HDDLMemoryMgr_AllocMemory (
+        sizeof (HDDLShimBatchSegment) + capacity);
+    SHIM_CHK_NULL (segment, "Failed to allocate batch segment", NULL);
+
+    segment->next = NULL;
+    segment->capacity = capacity;
+    segment->used = 0;
+
+    return segment;
+}
+
+// Copy into the batch, moving on to the spare segments left by earlier batches before new
+// ones are chained in
+static CommStatus Comm_BatchCopy (HDDLShimBatchPayload *batchPayload, void *data, uint32_t size)
+{
+    HDDLShimBatchSegment *segment;
+    uint32_t copySize;
+
+    while (size > 0)
     {
-        HDDLMemoryMgr_FreeMemory (batchPayload);
-        ctx->batchPayload = NULL;
+        segment = batchPayload->current;
+
+        if (segment->used == segment->capacity)
+        {
+            if (segment->next == NULL)
+            {
+                segment->next = Comm_BatchNewSegment (size);
+                SHIM_CHK_NULL (segment->next, "Failed to grow batch", COMM_STATUS_FAILED);
+            }
+
+            segment = segment->next;
+            segment->used = 0;
+            batchPayload->current = segment;
+        }
+
+        copySize = segment->capacity - segment->used;
+        copySize = copySize < size ? copySize : size;
+
+        HDDLMemoryMgr_Memcpy (segment->data + segment->used, data, copySize, copySize);
+
+        segment->used += copySize;
+        batchPayload->offset += copySize;
+        data = (char *)data + copySize;
+        size -= copySize;
+    }
+
+    return COMM_STATUS_SUCCESS;
+}
+
+// Keep the failure of a batched call for its caller, the first one of each thread counts
+static void Comm_BatchDeferStatus (HDDLShimBatchCall *call)
+{
+    HDDLShimBatchFailure *slot = NULL;
+
+    HDDLThreadMgr_LockMutex (&gBatchFailureMutex);
+
+    for (int i = 0; i < BATCH_FAILURE_SLOTS; i++)
+    {
+        if (gBatchFailure[i].threadId == call->threadId)
+        {
+            HDDLThreadMgr_UnlockMutex (&gBatchFailureMutex);
+            return;
+        }
+
+        if (gBatchFailure[i].threadId == 0 && slot == NULL)
+        {
+            slot = &gBatchFailure[i];
+        }
     }
-    else if (payloadOp == PAYLOAD_RESET)
+
+    if (slot != NULL)
     {
-	HDDLMemoryMgr_ZeroMemory (batchPayload, sizeof (HDDLShimBatchPayload));
-        // Reserve the header for batch function and size identification before flush
-        batchPayload->offset += sizeof (HDDLVAData);
+        slot->threadId = call->threadId;
+        slot->functionId = call->functionId;
+        slot->status = call->status;
+        __atomic_add_fetch (&gBatchFailureCount, 1, __ATOMIC_RELEASE);
     }
 
-    return commStatus;
+    HDDLThreadMgr_UnlockMutex (&gBatchFailureMutex);
+
+    if (slot == NULL)
+    {
+        SHIM_ERROR_MESSAGE ("No room to keep the status of batched %s for thread %lu",
+            Comm_GetFunctionInfo (call->functionId)->name, call->threadId);
+    }
+}
+
+VAStatus Comm_BatchTakeStatus ()
+{
+    uint64_t threadId = syscall (SYS_gettid);
+    VAStatus status = VA_STATUS_SUCCESS;
+
+    if (__atomic_load_n (&gBatchFailureCount, __ATOMIC_ACQUIRE) == 0)
+    {
+        return status;
+    }
+
+    HDDLThreadMgr_LockMutex (&gBatchFailureMutex);
+
+    for (int i = 0; i < BATCH_FAILURE_SLOTS; i++)
+    {
+        if (gBatchFailure[i].threadId == threadId)
+        {
+            status = gBatchFailure[i].status;
+            gBatchFailure[i].threadId = 0;
+            __atomic_sub_fetch (&gBatchFailureCount, 1, __ATOMIC_RELEASE);
+            break;
+        }
+    }
+
+    HDDLThreadMgr_UnlockMutex (&gBatchFailureMutex);
+
+    return status;
 }
 
-CommStatus Comm_BatchAppend (HDDLShimCommContext* ctx, HDDLShimBatchPayload *batchPayload,
-    int inSize, void *inPayload, int outSize, void** outPayload)
-{
-    CommStatus commStatus = COMM_STATUS_SUCCESS;
-    if (batchPayload->offset + inSize >= DATA_MAX_SEND_SIZE)
+// Walk the results of a batch reply and record the status of each call. Earlier calls were
+// answered with a zeroed reply when they were batched, their failures are kept for their
+// callers. The last call answers the caller who flushed, if any.
+static CommStatus Comm_BatchAnswer (HDDLShimBatchPayload *batchPayload,
+    HDDLShimCommMessage *reply, int outSize, void **outPayload)
+{
+    HDDLTransferBatchRX *batchRX = (HDDLTransferBatchRX *)reply->payload;
+    HDDLTransferBatchResult *result;
+    HDDLVAData *vaData;
+    uint32_t offset = sizeof (HDDLTransferBatchRX);
+
+    if (reply->size < sizeof (HDDLTransferBatchRX) ||
+        batchRX->vaData.vaFunctionID != HDDLTransferBatch ||
+        batchRX->callCount != batchPayload->callCount)
+    {
+        SHIM_ERROR_MESSAGE ("Batch reply does not match the %u batched calls",
+            batchPayload->callCount);
+        return COMM_STATUS_FAILED;
+    }
+
+    for (uint32_t i = 0; i < batchRX->callCount; i++)
+    {
+        if (reply->size - offset < sizeof (HDDLTransferBatchResult))
+        {
+            SHIM_ERROR_MESSAGE ("Batch reply truncated at call %u", i);
+            return COMM_STATUS_FAILED;
+        }
+
+        result = (HDDLTransferBatchResult *) ( (char *)reply->payload + offset);
+        offset += sizeof (HDDLTransferBatchResult);
+
+        if (reply->size - offset < result->size)
+        {
+            SHIM_ERROR_MESSAGE ("Batch reply truncated at call %u", i);
+            return COMM_STATUS_FAILED;
+        }
+
+        vaData = (HDDLVAData *)(result + 1);
+        batchPayload->calls[i].status = result->ret;
+
+        if (i + 1 == batchRX->callCount && outPayload != NULL)
+        {
+            if (result->size < sizeof (HDDLVAData) || result->size > outSize)
+            {
+                SHIM_ERROR_MESSAGE ("Batched function reply of %u bytes, %d expected",
+                    result->size, outSize);
+                return COMM_STATUS_FAILED;
+            }
+
+            HDDLMemoryMgr_Memcpy (outPayload, vaData, outSize, result->size);
+        }
+        else if (result->ret != VA_STATUS_SUCCESS)
+        {
+            SHIM_ERROR_MESSAGE ("Batched %s failed with status %d",
+                Comm_GetFunctionInfo (batchPayload->calls[i].functionId)->name, result->ret);
+            Comm_BatchDeferStatus (&batchPayload->calls[i]);
+        }
+
+        offset += result->size;
+    }
+
+    return COMM_STATUS_SUCCESS;
+}
+
+// Send the batch and hand its reply out, the batch is empty again afterwards. outPayload may
+// be NULL when nobody waits for the answer of the last call.
+static CommStatus Comm_BatchSend (HDDLShimCommContext *ctx, HDDLShimBatchPayload *batchPayload,
+    int outSize, void **outPayload)
+{
+    CommStatus commStatus = COMM_STATUS_UNKNOWN;
+    HDDLShimCommMessage reply;
+    HDDLShimBatchSegment *segment;
+    HDDLVAData *batchHeader = (HDDLVAData *)batchPayload->first->data;
+    int segmentCount = 1;
+
+    for (segment = batchPayload->first; segment != batchPayload->current;
+        segment = segment->next)
+    {
+        segmentCount++;
+    }
+
+    struct iovec iov[segmentCount];
+
+    // Fill in the batch header reserved at the begining of the first segment, the segments
+    // go out together as one HDDLTransferBatch message
+    batchHeader->vaFunctionID = HDDLTransferBatch;
+    batchHeader->size = batchPayload->offset;
+    batchHeader->requestId = 0;
+
+    segment = batchPayload->first;
+    for (int i = 0; i < segmentCount; i++)
+    {
+        iov[i].iov_base = segment->data;
+        iov[i].iov_len = segment->used;
+        segment = segment->next;
+    }
+
+    batchPayload->batchState = BATCH_OFF;
+
+    // The results are unpacked straight from the received message
+    commStatus = Comm_SingleSubmissionV (ctx, COMM_READ_BORROW, iov, segmentCount, 0,
+        (void **)&reply);
+    if (commStatus == COMM_STATUS_SUCCESS)
+    {
+        commStatus = Comm_BatchAnswer (batchPayload, &reply, outSize, outPayload);
+        Comm_ReleaseMessage (ctx, &reply);
+    }
+
+    Comm_BatchReset (batchPayload);
+
+    return commStatus;
+}
+
+// Send the batch of the context, called with batchMutex held while coalescing. A batch the
+// flusher is sending goes first.
+static CommStatus Comm_BatchFlush (HDDLShimCommContext *ctx, int outSize, void **outPayload,
+    HDDLShimBatchPayloadOp payloadOp)
+{
+    CommStatus commStatus;
+    HDDLShimBatchPayload *batchPayload = ctx->batchPayload;
+
+    if (ctx->coalesce != NULL)
+    {
+        HDDLThreadMgr_LockMutex (&ctx->coalesce->sendMutex);
+    }
+
+    commStatus = Comm_BatchSend (ctx, batchPayload, outSize, outPayload);
+
+    if (ctx->coalesce != NULL)
+    {
+        HDDLThreadMgr_UnlockMutex (&ctx->coalesce->sendMutex);
+    }
+
+    if (payloadOp == PAYLOAD_FREE)
+    {
+        Comm_BatchFree (ctx->batchSpare);
+        ctx->batchSpare = batchPayload;
+        ctx->batchPayload = NULL;
+    }
+
+    return commStatus;
+}
+
+CommStatus Comm_BatchAppend (HDDLShimCommContext* ctx, HDDLShimBatchPayload *batchPayload,
+    struct iovec *iov, int iovCount, int outSize, void** outPayload)
+{
+    CommStatus commStatus = COMM_STATUS_SUCCESS;
+    HDDLShimBatchSegment *segment = batchPayload->current;
+    uint32_t used = segment->used;
+    uint32_t offset = batchPayload->offset;
+
+    // Gather straight into the batch, this is the only copy of the caller buffers. The batch
+    // grows as needed, so every call goes into it however large.
+    for (int i = 0; i < iovCount && commStatus == COMM_STATUS_SUCCESS; i++)
+    {
+        commStatus = Comm_BatchCopy (batchPayload, iov[i].iov_base, iov[i].iov_len);
+    }
+
+    // Leave no partial call behind in the batch
+    if (commStatus != COMM_STATUS_SUCCESS)
+    {
+        batchPayload->current = segment;
+        segment->used = used;
+        batchPayload->offset = offset;
+        return commStatus;
+    }
+
+    if (batchPayload->callCount == batchPayload->callCapacity)
+    {
+        uint32_t capacity = batchPayload->callCapacity ? batchPayload->callCapacity * 2 :
+            BATCH_COALESCE_MAX_CALLS;
+        HDDLShimBatchCall *calls = HDDLMemoryMgr_ReallocMemory (batchPayload->calls,
+            capacity * sizeof (HDDLShimBatchCall));
+
+        if (calls == NULL)
+        {
+            SHIM_ERROR_MESSAGE ("Failed to grow batch call list");
+            batchPayload->current = segment;
+            segment->used = used;
+            batchPayload->offset = offset;
+            return COMM_STATUS_FAILED;
+        }
+
+        batchPayload->calls = calls;
+        batchPayload->callCapacity = capacity;
+    }
+
+    if (batchPayload->callCount == 0)
+    {
+        clock_gettime (CLOCK_MONOTONIC, &batchPayload->started);
+    }
+
+    batchPayload->calls[batchPayload->callCount].functionId =
+        ( (HDDLVAData *)iov[0].iov_base)->vaFunctionID;
+    batchPayload->calls[batchPayload->callCount].threadId = syscall (SYS_gettid);
+    batchPayload->calls[batchPayload->callCount].status = VA_STATUS_SUCCESS;
+    batchPayload->callCount++;
+
+    return commStatus;
+}
+
+HDDLShimBatchPayload *Comm_BatchInit (HDDLShimCommContext *ctx)
+{
+    HDDLShimBatchPayload *batchPayload = ctx->batchSpare;
+
+    if (batchPayload != NULL)
+    {
+        ctx->batchSpare = NULL;
+    }
+    else
+    {
+        batchPayload = HDDLMemoryMgr_AllocAndZeroMemory (sizeof (HDDLShimBatchPayload));
+        SHIM_CHK_NULL (batchPayload, "Failed to allocate batch", NULL);
+
+        batchPayload->first = Comm_BatchNewSegment (BATCH_SEGMENT_SIZE);
+        if (batchPayload->first == NULL)
+        {
+            HDDLMemoryMgr_FreeMemory (batchPayload);
+            return NULL;
+        }
+    }
+
+    Comm_BatchReset (batchPayload);
+
+    return batchPayload;
+}
+
+void Comm_BatchDestroy (HDDLShimCommContext *ctx)
+{
+    Comm_BatchFree (ctx->batchPayload);
+    Comm_BatchFree (ctx->batchSpare);
+
+    ctx->batchPayload = NULL;
+    ctx->batchSpare = NULL;
+}
+
+// Deadline of a batch held back for coalescing
+static void Comm_BatchDue (HDDLShimCommContext *ctx, struct timespec *due)
+{
+    uint64_t nsec = ctx->batchPayload->started.tv_nsec +
+        (uint64_t)ctx->coalesce->deadline * 1000;
+
+    due->tv_sec = ctx->batchPayload->started.tv_sec + nsec / 1000000000;
+    due->tv_nsec = nsec % 1000000000;
+}
+
+static bool Comm_BatchIsDue (HDDLShimCommContext *ctx)
+{
+    struct timespec due;
+    struct timespec now;
+
+    Comm_BatchDue (ctx, &due);
+    clock_gettime (CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec > due.tv_sec || (now.tv_sec == due.tv_sec && now.tv_nsec >= due.tv_nsec);
+}
+
+// Send the batch held back for coalescing while nobody waits for its reply
+static CommStatus Comm_BatchFlushCoalesced (HDDLShimCommContext *ctx)
+{
+    CommStatus commStatus;
+
+    commStatus = Comm_BatchFlush (ctx, 0, NULL, PAYLOAD_FREE);
+    if (commStatus != COMM_STATUS_SUCCESS)
+    {
+        SHIM_ERROR_MESSAGE ("Failed to send coalesced batch with comm status %d", commStatus);
+    }
+
+    return commStatus;
+}
+
+// A frame or a call which needs no reply went into the batch while coalescing. The batch goes
+// out with this call once it is large or old enough, otherwise it is held back.
+static CommStatus Comm_BatchCoalesce (HDDLShimCommContext *ctx, int outSize, void **outPayload)
+{
+    HDDLShimBatchPayload *batchPayload = ctx->batchPayload;
+
+    if (batchPayload->offset >= BATCH_COALESCE_MAX_SIZE ||
+        batchPayload->callCount >= BATCH_COALESCE_MAX_CALLS || Comm_BatchIsDue (ctx))
+    {
+        return Comm_BatchFlush (ctx, outSize, outPayload, PAYLOAD_FREE);
+    }
+
+    batchPayload->batchState = BATCH_COALESCE;
+    HDDLThreadMgr_CondBroadcastThread (&ctx->coalesce->batchCond);
+
+    return COMM_STATUS_SUCCESS;
+}
+
+// Take the batch held back past its deadline off the context and send it without batchMutex,
+// so callers go on filling the next batch meanwhile. Called and returns with batchMutex held.
+static void Comm_BatchFlushDetached (HDDLShimCommContext *ctx)
+{
+    HDDLShimBatchCoalesce *coalesce = ctx->coalesce;
+    HDDLShimBatchPayload *batchPayload = ctx->batchPayload;
+    CommStatus commStatus;
+
+    ctx->batchPayload = NULL;
+
+    // Taken before batchMutex is dropped, whatever is sent after this batch waits for it
+    HDDLThreadMgr_LockMutex (&coalesce->sendMutex);
+    HDDLThreadMgr_UnlockMutex (&coalesce->batchMutex);
+
+    commStatus = Comm_BatchSend (ctx, batchPayload, 0, NULL);
+    if (commStatus != COMM_STATUS_SUCCESS)
+    {
+        SHIM_ERROR_MESSAGE ("Failed to send coalesced batch with comm status %d", commStatus);
+    }
+
+    HDDLThreadMgr_UnlockMutex (&coalesce->sendMutex);
+    HDDLThreadMgr_LockMutex (&coalesce->batchMutex);
+
+    Comm_BatchFree (ctx->batchSpare);
+    ctx->batchSpare = batchPayload;
+}
+
+static void *Comm_BatchFlusher (void *arg)
+{
+    HDDLShimCommContext *ctx = (HDDLShimCommContext *)arg;
+    HDDLShimBatchCoalesce *coalesce = ctx->coalesce;
+    struct timespec due;
+
+    HDDLThreadMgr_LockMutex (&coalesce->batchMutex);
+
+    while (!coalesce->stop)
+    {
+        if (ctx->batchPayload == NULL || ctx->batchPayload->batchState != BATCH_COALESCE)
+        {
+            HDDLThreadMgr_CondWaitThread (&coalesce->batchCond, &coalesce->batchMutex);
+        }
+        else if (!Comm_BatchIsDue (ctx))
+        {
+            Comm_BatchDue (ctx, &due);
+            HDDLThreadMgr_CondTimedWaitThread (&coalesce->batchCond, &coalesce->batchMutex,
+                &due);
+        }
+        else
+        {
+            Comm_BatchFlushDetached (ctx);
+        }
+    }
+
+    HDDLThreadMgr_UnlockMutex (&coalesce->batchMutex);
+
+    return NULL;
+}
+
+CommStatus Comm_BatchCoalesceStart (HDDLShimCommContext *ctx, uint32_t deadline)
+{
+    HDDLShimBatchCoalesce *coalesce;
+
+    coalesce = (HDDLShimBatchCoalesce *)HDDLMemoryMgr_AllocAndZeroMemory (
+        sizeof (HDDLShimBatchCoalesce));
+    SHIM_CHK_NULL (coalesce, "Failed to allocate batch coalescing", COMM_STATUS_FAILED);
+
+    coalesce->deadline = deadline;
+    HDDLThreadMgr_InitMutex (&coalesce->batchMutex);
+    HDDLThreadMgr_InitMutex (&coalesce->sendMutex);
+    HDDLThreadMgr_InitMonotonicCond (&coalesce->batchCond);
+
+    ctx->coalesce = coalesce;
+
+    if (HDDLThreadMgr_CreateThread (&coalesce->flusherThread, NULL, Comm_BatchFlusher,
+        (void *)ctx) != 0)
+    {
+        SHIM_ERROR_MESSAGE ("Failed to create batch flusher thread");
+        ctx->coalesce = NULL;
+
+        HDDLThreadMgr_DestroyCond (&coalesce->batchCond);
+        HDDLThreadMgr_DestroyMutex (&coalesce->sendMutex);
+        HDDLThreadMgr_DestroyMutex (&coalesce->batchMutex);
+        HDDLMemoryMgr_FreeMemory (coalesce);
+        return COMM_STATUS_FAILED;
+    }
+
+    return COMM_STATUS_SUCCESS;
+}
+
+void Comm_BatchCoalesceStop (HDDLShimCommContext *ctx)
+{
+    HDDLShimBatchCoalesce *coalesce = ctx->coalesce;
+
+    if (coalesce == NULL)
+    {
+        return;
+    }
+
+    HDDLThreadMgr_LockMutex (&coalesce->batchMutex);
+    coalesce->stop = true;
+    HDDLThreadMgr_CondBroadcastThread (&coalesce->batchCond);
+    HDDLThreadMgr_UnlockMutex (&coalesce->batchMutex);
+
+    HDDLThreadMgr_JoinThread (coalesce->flusherThread, NULL);
+
+    // Nothing held back may be lost
+    if (ctx->batchPayload != NULL && ctx->batchPayload->batchState == BATCH_COALESCE)
+    {
+        Comm_BatchFlushCoalesced (ctx);
+    }
+
+    ctx->coalesce = NULL;
+
+    HDDLThreadMgr_DestroyCond (&coalesce->batchCond);
+    HDDLThreadMgr_DestroyMutex (&coalesce->sendMutex);
+    HDDLThreadMgr_DestroyMutex (&coalesce->batchMutex);
+    HDDLMemoryMgr_FreeMemory (coalesce);
+}
+
+// When we are batching the VAAPI call and sent over to accelerator, we should only
+// expect COMM_READ_FULL operations. The only exception is when batch mode is turn on,
+// but the current VAAPI call operation cannot be batched (e.g. not within per frame
+// batching, or not within vaDestroyBuffer batching).
+CommStatus Comm_BatchSubmission (HDDLShimCommContext *ctx, HDDLVAFunctionID functionId,
+    CommReadOp readOp, int inSize, void *inPayload, int outSize, void **outPayload)
+{
+    struct iovec iov;
+
+    iov.iov_base = inPayload;
+    iov.iov_len = inSize;
+
+    return Comm_BatchSubmissionV (ctx, functionId, readOp, &iov, 1, outSize, outPayload);
+}
+
+// Put the call into the batch where it belongs. Calls which cannot be batched are left to the
+// caller with batched set to false, to be sent after the batch lock is dropped.
+static CommStatus Comm_BatchAdd (HDDLShimCommContext *ctx, HDDLVAFunctionID functionId,
+    CommReadOp readOp, struct iovec *iov, int iovCount, int outSize, void **outPayload,
+    bool *batched)
+{
+    CommStatus commStatus = COMM_STATUS_SUCCESS;
+    HDDLShimBatchPayload *batchPayload = ctx->batchPayload;
+    bool answered = FUNCTION_HAS (functionId, FUNCTION_ANSWERED) && readOp == COMM_READ_FULL;
+    bool waits = FUNCTION_HAS (functionId, FUNCTION_REPLY) && !answered &&
+        readOp != COMM_READ_NONE;
+
+    *batched = true;
+
+    // Frames held back go out first whenever an answer might depend on them: calls from other
+    // threads, and calls which are lent their reply
+    if (batchPayload && batchPayload->batchState == BATCH_COALESCE &&
+        (ctx->batchThreadId != syscall (SYS_gettid) || readOp == COMM_READ_BORROW))
+    {
+        commStatus = Comm_BatchFlushCoalesced (ctx);
+        SHIM_CHK_ERROR(commStatus, "Error to BatchFlush", commStatus);
+
+        batchPayload = NULL;
+    }
+
+    // Batched replies are copied into the caller buffer, there is nothing to lend out
+    if (readOp == COMM_READ_BORROW)
+    {
+        *batched = false;
+        return commStatus;
+    }
+
+    if (readOp == COMM_READ_FULL || readOp == COMM_READ_NONE)
+    {
+	HDDLMemoryMgr_ZeroMemory (outPayload, outSize);
+
+        ( (HDDLVAData *)outPayload)->vaFunctionID = functionId;
+        ( (HDDLVAData *)outPayload)->size = outSize;
+    }
+
+    // Begining of per frame batching
+    if (FUNCTION_HAS (functionId, FUNCTION_FRAME_START) &&
+        ctx->batchThreadId == syscall (SYS_gettid))
+    {
+        if (batchPayload)
+        {
+            // Flush the batched vaDestroyBuffer calls to accelerator before we start performing
+            // per frame batching
+            if (batchPayload->batchState == BATCH_DESTROY_BUFFER)
+            {
+                commStatus = Comm_BatchFlush (ctx, 0, NULL, PAYLOAD_RESET);
+                SHIM_CHK_ERROR(commStatus, "Error to BatchFlush", commStatus);
+            }
+        }
+        else
+        {
+            batchPayload = Comm_BatchInit (ctx);
+
+	    SHIM_CHK_NULL (batchPayload, "batchPayload returned NULL", COMM_STATUS_FAILED);
+        }
+
+        commStatus = Comm_BatchAppend (ctx, batchPayload, iov, iovCount, outSize, outPayload);
+
+        batchPayload->batchState = BATCH_PER_FRAME;
+        ctx->batchThreadId = syscall (SYS_gettid);
+        ctx->batchPayload = batchPayload;
+
+    }
+    else
+    {
+        if (batchPayload && ctx->batchThreadId == syscall (SYS_gettid))
+        {
+            if (batchPayload->batchState == BATCH_PER_FRAME && waits)
+            {
+                // The batch reply has no answer for the caller, the call goes out on its own
+                // after the calls batched before it
+                if (batchPayload->callCount > 0)
+                {
+                    commStatus = Comm_BatchFlush (ctx, 0, NULL, PAYLOAD_RESET);
+                    SHIM_CHK_ERROR(commStatus, "Error to BatchFlush", commStatus);
+                }
+
+                batchPayload->batchState = BATCH_PER_FRAME;
+                *batched = false;
+            }
+            else if (batchPayload->batchState == BATCH_PER_FRAME)
+            {
+                commStatus = Comm_BatchAppend (ctx, batchPayload, iov, iovCount, outSize, outPayload);
+                SHIM_CHK_ERROR(commStatus, "Error to BatchAppend", commStatus);
+
+                // The frame goes on once the caller has its answer
+                if (answered)
+                {
+                    commStatus = Comm_BatchFlush (ctx, outSize, outPayload, PAYLOAD_RESET);
+                    batchPayload->batchState = BATCH_PER_FRAME;
+                }
+                else if (FUNCTION_HAS (functionId, FUNCTION_FRAME_END))
+                {
+                    if (ctx->coalesce != NULL)
+                    {
+                        commStatus = Comm_BatchCoalesce (ctx, outSize, outPayload);
+                    }
+                    else
+                    {
+                        commStatus = Comm_BatchFlush (ctx, outSize, outPayload, PAYLOAD_FREE);
+                    }
+                }
+            }
+            else if (batchPayload->batchState == BATCH_DESTROY_BUFFER)
+            {
+                if (FUNCTION_HAS (functionId, FUNCTION_DESTROY_START | FUNCTION_ANSWERED |
+                    FUNCTION_DESTROY_FINAL))
+                {
+                    commStatus = Comm_BatchAppend (ctx, batchPayload, iov, iovCount, outSize, outPayload);
+                    SHIM_CHK_ERROR(commStatus, "Error to BatchAppend", commStatus);
+
+                    // Flush the batched vaDestroyBuffer function calls to accelerator under two
+                    // conditions:
+                    //  1) with a call waiting for its answer, e.g. vaCreateBuffer, which also keeps
+                    //     the buffer creation sequence on accelerator in order
+                    //  2) with vaDestroyContext
+                    if (FUNCTION_HAS (functionId, FUNCTION_ANSWERED | FUNCTION_DESTROY_FINAL))
+                    {
+                        commStatus = Comm_BatchFlush (ctx, outSize, outPayload, PAYLOAD_FREE);
+                    }
+                }
+                else
+                {
+                    *batched = false;
+                }
+            }
+            else if (batchPayload->batchState == BATCH_COALESCE)
+            {
+                // Buffers may be released or created along with the frames held back, and a
+                // call waiting for its answer takes them out with it. Anything else could
+                // depend on the frames being done.
+                if (FUNCTION_HAS (functionId, FUNCTION_DESTROY_START) || readOp == COMM_READ_NONE)
+                {
+                    commStatus = Comm_BatchAppend (ctx, batchPayload, iov, iovCount, outSize,
+                        outPayload);
+                    SHIM_CHK_ERROR(commStatus, "Error to BatchAppend", commStatus);
+
+                    commStatus = Comm_BatchCoalesce (ctx, outSize, outPayload);
+                }
+                else if (answered)
+                {
+                    commStatus = Comm_BatchAppend (ctx, batchPayload, iov, iovCount, outSize,
+                        outPayload);
+                    SHIM_CHK_ERROR(commStatus, "Error to BatchAppend", commStatus);
+
+                    commStatus = Comm_BatchFlush (ctx, outSize, outPayload, PAYLOAD_FREE);
+                }
+                else
+                {
+                    commStatus = Comm_BatchFlushCoalesced (ctx);
+                    SHIM_CHK_ERROR(commStatus, "Error to BatchFlush", commStatus);
+
+                    *batched = false;
+                }
+            }
+            else if (batchPayload->batchState == BATCH_OFF)
+            {
+                *batched = false;
+            }
+        }
+        else
+        {
+            // Begining of vaDestroyBuffer batching
+            if (FUNCTION_HAS (functionId, FUNCTION_DESTROY_START))
+            {
+                batchPayload = Comm_BatchInit (ctx);
+
+                SHIM_CHK_NULL (batchPayload, "batchPayload returned NULL", COMM_STATUS_FAILED);
+
+                commStatus = Comm_BatchAppend (ctx, batchPayload, iov, iovCount, outSize, outPayload);
+
+                batchPayload->batchState = BATCH_DESTROY_BUFFER;
+                ctx->batchThreadId = syscall (SYS_gettid);
+                ctx->batchPayload = batchPayload;
+            }
+            else
+            {
+                *batched = false;
+            }
+        }
+    }
+
+    return commStatus;
+}
+
+CommStatus Comm_BatchSubmissionV (HDDLShimCommContext *ctx, HDDLVAFunctionID functionId,
+    CommReadOp readOp, struct iovec *iov, int iovCount, int outSize, void **outPayload)
+{
+    CommStatus commStatus;
+    bool batched;
+
+    // The flusher thread sends frames held back for coalescing behind the caller's back
+    if (ctx->coalesce != NULL)
+    {
+        HDDLThreadMgr_LockMutex (&ctx->coalesce->batchMutex);
+    }
+
+    commStatus = Comm_BatchAdd (ctx, functionId, readOp, iov, iovCount, outSize, outPayload,
+        &batched);
+
+    if (ctx->coalesce != NULL)
+    {
+        // A call sent on its own must not overtake a batch the flusher is sending
+        if (!batched)
+        {
+            HDDLThreadMgr_LockMutex (&ctx->coalesce->sendMutex);
+            HDDLThreadMgr_UnlockMutex (&ctx->coalesce->sendMutex);
+        }
+
+        HDDLThreadMgr_UnlockMutex (&ctx->coalesce->batchMutex);
+    }
+
+    if (commStatus == COMM_STATUS_SUCCESS && !batched)
+    {
+        commStatus = Comm_SingleSubmissionV (ctx, readOp, iov, iovCount, outSize, outPayload);
+    }
+
+    return commStatus;
+}
+
+static HDDLShimPendingRequest *Comm_PipelineFind (HDDLShimPipeline *pipeline,
+    uint32_t requestId)
+{
+    HDDLShimPendingRequest *request = &pipeline->pending[PENDING_SLOT (requestId)];
+
+    if (requestId == 0 || request->requestId != requestId || request->done)
+    {
+        return NULL;
+    }
+
+    return request;
+}
+
+// Hand the slot of a finished request back, called with pendingMutex held
+static void Comm_PipelineReleaseSlot (HDDLShimPipeline *pipeline,
+    HDDLShimPendingRequest *request)
+{
+    request->requestId = 0;
+    pipeline->freeSlots[pipeline->freeCount++] = request - pipeline->pending;
+    HDDLThreadMgr_CondBroadcastThread (&pipeline->slotCond);
+}
+
+// Fail every caller still waiting, called with pendingMutex held once the receiver is gone
+static void Comm_PipelineFailPending (HDDLShimPipeline *pipeline)
+{
+    HDDLShimPendingRequest *request;
+
+    pipeline->receiverStopped = true;
+    pipeline->detached = 0;
+
+    for (int i = 0; i < MAX_PENDING_REQUEST; i++)
+    {
+        request = &pipeline->pending[i];
+
+        if (request->requestId != 0 && !request->done)
+        {
+            request->status = COMM_STATUS_FAILED;
+            request->done = true;
+            HDDLThreadMgr_CondBroadcastThread (&request->cond);
+        }
+    }
+
+    HDDLThreadMgr_CondBroadcastThread (&pipeline->slotCond);
+}
+
+// Nobody waits for the reply of a COMM_READ_NONE request, a failure can only be logged. Every
+// such reply starts with the VAStatus of the call. Called with pendingMutex held.
+static void Comm_PipelineRetire (HDDLShimPipeline *pipeline, HDDLShimPendingRequest *request,
+    void *reply, uint32_t size)
+{
+    HDDLVAData *vaData = (HDDLVAData *)reply;
+
+    if (size >= sizeof (HDDLVAData) + sizeof (VAStatus) &&
+        *(VAStatus *)(vaData + 1) != VA_STATUS_SUCCESS)
+    {
+        SHIM_ERROR_MESSAGE ("Function %d failed with status %d after its caller went on",
+            vaData->vaFunctionID, *(VAStatus *)(vaData + 1));
+    }
+
+    pipeline->detached--;
+    Comm_PipelineReleaseSlot (pipeline, request);
+}
+
+// Take the next reply off the transport. A COMM_READ_FULL reply lands straight in the waiting
+// caller buffer, a COMM_READ_BORROW reply is handed over whole and anything else is kept in
+// message (and remainder for replies XLink delivers in more than one fragment) until the
+// caller picks it up.
+static CommStatus Comm_PipelineReceive (HDDLShimCommContext *ctx, HDDLVAData *vaData)
+{
+    HDDLShimPipeline *pipeline = ctx->pipeline;
+    HDDLShimPendingRequest *request;
+    HDDLShimCommMessage received;
+    CommStatus commStatus;
+    void *message = NULL;
+    void *remainder = NULL;
+    uint32_t messageSize = 0;
+    uint32_t remainderSize = 0;
+
+    received.payload = NULL;
+
+    if (IS_TCP_MODE (ctx) || IS_SHM_MODE (ctx))
+    {
+        void *peekData = vaData;
+
+        messageSize = sizeof (HDDLVAData);
+        commStatus = Comm_Peek (ctx, &messageSize, peekData);
+        SHIM_CHK_ERROR (commStatus, "Failed to peek pipelined reply", commStatus);
+
+        if (vaData->size < sizeof (HDDLVAData))
+        {
+            SHIM_ERROR_MESSAGE ("Invalid reply size %u", vaData->size);
+            return COMM_STATUS_FAILED;
+        }
+
+        HDDLThreadMgr_LockMutex (&pipeline->pendingMutex);
+        request = Comm_PipelineFind (pipeline, vaData->requestId);
+        HDDLThreadMgr_UnlockMutex (&pipeline->pendingMutex);
+
+        // The caller is blocked until done is set, its buffer can be filled without the lock
+        if (request && request->readOp == COMM_READ_FULL && vaData->size <= request->outSize)
+        {
+            commStatus = Comm_Read (ctx, vaData->size, request->outPayload);
+            SHIM_CHK_ERROR (commStatus, "Failed to read pipelined reply", commStatus);
+        }
+        else
+        {
+            messageSize = vaData->size;
+            message = HDDLMemoryMgr_AllocMemory (messageSize);
+            SHIM_CHK_NULL (message, "Failed to allocate pipelined reply", COMM_STATUS_FAILED);
+
+            commStatus = Comm_Read (ctx, messageSize, message);
+            if (commStatus != COMM_STATUS_SUCCESS)
+            {
+                HDDLMemoryMgr_FreeMemory (message);
+                return commStatus;
+            }
+        }
+    }
+    else
+    {
+        // XLink messages stay in the receive buffer until the reply has been copied out or,
+        // for COMM_READ_BORROW, until the caller is done with it
+        commStatus = Comm_BorrowMessage (ctx, &received);
+        SHIM_CHK_ERROR (commStatus, "Failed to receive pipelined reply", commStatus);
+
+        *vaData = *(HDDLVAData *)received.payload;
+    }
+
+    HDDLThreadMgr_LockMutex (&pipeline->pendingMutex);
+
+    request = Comm_PipelineFind (pipeline, vaData->requestId);
+    if (request == NULL)
+    {
+        HDDLThreadMgr_UnlockMutex (&pipeline->pendingMutex);
+        SHIM_ERROR_MESSAGE ("Dropping reply %u of function %d without a pending request",
+            vaData->requestId, vaData->vaFunctionID);
+        HDDLMemoryMgr_FreeMemory (message);
+        Comm_ReleaseMessage (ctx, &received);
+        return COMM_STATUS_SUCCESS;
+    }
+
+    request->status = COMM_STATUS_SUCCESS;
+
+    if (request->readOp == COMM_READ_NONE)
+    {
+        Comm_PipelineRetire (pipeline, request, received.payload ? received.payload : message,
+            received.payload ? received.size : messageSize);
+        HDDLThreadMgr_UnlockMutex (&pipeline->pendingMutex);
+
+        HDDLMemoryMgr_FreeMemory (message);
+        Comm_ReleaseMessage (ctx, &received);
+        return COMM_STATUS_SUCCESS;
+    }
+
+    if (received.payload != NULL && request->readOp != COMM_READ_BORROW)
+    {
+        // Split the reply the way a peek followed by reads would have delivered it
+        messageSize = received.size < Comm_FragmentSize (ctx) ? received.size :
+            Comm_FragmentSize (ctx);
+        remainderSize = received.size - messageSize;
+
+        if (request->readOp == COMM_READ_FULL)
+        {
+            uint32_t copySize = received.size < request->outSize ? received.size :
+                request->outSize;
+
+            HDDLMemoryMgr_Memcpy (request->outPayload, received.payload, request->outSize,
+                copySize);
+        }
+        else
+        {
+            message = HDDLMemoryMgr_AllocMemory (messageSize);
+            remainder = remainderSize ? HDDLMemoryMgr_AllocMemory (remainderSize) : NULL;
+
+            if (message == NULL || (remainderSize && remainder == NULL))
+            {
+                SHIM_ERROR_MESSAGE ("Failed to allocate pipelined reply");
+                HDDLMemoryMgr_FreeMemory (message);
+                HDDLMemoryMgr_FreeMemory (remainder);
+                message = NULL;
+                remainder = NULL;
+                request->status = COMM_STATUS_FAILED;
+            }
+            else
+            {
+                HDDLMemoryMgr_Memcpy (message, received.payload, messageSize, messageSize);
+
+                if (remainder != NULL)
+                {
+                    HDDLMemoryMgr_Memcpy (remainder, (uint8_t *)received.payload + messageSize,
+                        remainderSize, remainderSize);
+                }
+            }
+
+            request->message = message;
+            request->messageSize = messageSize;
+            request->remainder = remainder;
+            request->remainderSize = remainderSize;
+        }
+
+        Comm_ReleaseMessage (ctx, &received);
+    }
+    else if (request->readOp == COMM_READ_BORROW)
+    {
+        if (received.payload == NULL)
+        {
+            received.payload = message;
+            received.size = messageSize;
+            received.borrowed = false;
+            received.poolSize = 0;
+            received.owner = ctx;
+        }
+
+        request->received = received;
+    }
+    else if (request->readOp == COMM_READ_FULL && message != NULL)
+    {
+        uint32_t copySize = messageSize < request->outSize ? messageSize : request->outSize;
+
+        HDDLMemoryMgr_Memcpy (request->outPayload, message, request->outSize, copySize);
+        HDDLMemoryMgr_FreeMemory (message);
+    }
+    else
+    {
+        request->message = message;
+        request->messageSize = messageSize;
+    }
+
+    request->done = true;
+    HDDLThreadMgr_CondBroadcastThread (&request->cond);
+
+    HDDLThreadMgr_UnlockMutex (&pipeline->pendingMutex);
+
+    return COMM_STATUS_SUCCESS;
+}
+
+static void *Comm_PipelineReceiver (void *arg)
+{
+    HDDLShimCommContext *ctx = (HDDLShimCommContext *)arg;
+    HDDLShimPipeline *pipeline = ctx->pipeline;
+    CommStatus commStatus = COMM_STATUS_SUCCESS;
+    HDDLVAData vaData;
+
+    while (commStatus == COMM_STATUS_SUCCESS)
+    {
+        commStatus = Comm_PipelineReceive (ctx, &vaData);
+
+        // The target drops the connection after answering vaTerminate
+        if (commStatus == COMM_STATUS_SUCCESS && vaData.vaFunctionID == HDDLVATerminate)
+        {
+            break;
+        }
+    }
+
+    HDDLThreadMgr_LockMutex (&pipeline->pendingMutex);
+
+    // Comm_PipelineStop closing the channel is no error
+    if (commStatus != COMM_STATUS_SUCCESS && !pipeline->stopping)
+    {
+        SHIM_ERROR_MESSAGE ("Pipeline receiver stopped with comm status %d", commStatus);
+    }
+
+    Comm_PipelineFailPending (pipeline);
+    HDDLThreadMgr_UnlockMutex (&pipeline->pendingMutex);
+
+    return NULL;
+}
+
+static CommStatus Comm_PipelineSubmission (HDDLShimCommContext *ctx, CommReadOp readOp,
+    struct iovec *iov, int iovCount, int outSize, void **outPayload)
+{
+    HDDLShimPipeline *pipeline = ctx->pipeline;
+    HDDLShimPendingRequest *request;
+    CommStatus commStatus;
+    uint32_t requestId;
+
+    uint32_t slot;
+
+    HDDLThreadMgr_LockMutex (&pipeline->pendingMutex);
+
+    // Only waits when every slot is in use, whichever request finishes first frees one
+    while (pipeline->freeCount == 0 && !pipeline->receiverStopped)
+    {
+        HDDLThreadMgr_CondWaitThread (&pipeline->slotCond, &pipeline->pendingMutex);
+    }
+
+    if (pipeline->receiverStopped)
+    {
+        HDDLThreadMgr_UnlockMutex (&pipeline->pendingMutex);
+        SHIM_ERROR_MESSAGE ("Pipeline receiver is not running");
+        return COMM_STATUS_FAILED;
+    }
+
+    slot = pipeline->freeSlots[--pipeline->freeCount];
+    request = &pipeline->pending[slot];
+
+    // The reply finds its slot from the id, the sequence tells a late reply from the one
+    // expected now. Request id 0 is left for callers which are not pipelined.
+    do
+    {
+        requestId = (++pipeline->nextSequence << PENDING_SEQUENCE_SHIFT) | slot;
+    } while (requestId == 0);
+
+    request->requestId = requestId;
+    request->done = false;
+    request->status = COMM_STATUS_UNKNOWN;
+    request->readOp = readOp;
+    request->outSize = outSize;
+    request->outPayload = (readOp == COMM_READ_FULL) ? (void *)outPayload : NULL;
+    request->message = NULL;
+    request->remainder = NULL;
+    request->received.payload = NULL;
+
+    if (readOp == COMM_READ_NONE)
+    {
+        pipeline->detached++;
+    }
+
+    HDDLThreadMgr_UnlockMutex (&pipeline->pendingMutex);
+
+    ( (HDDLVAData *)iov[0].iov_base)->requestId = requestId;
+
+    commStatus = Comm_WriteSafeV (ctx, iov, iovCount);
+
+    // The receiver retires the request once its reply shows up, the caller goes on with a
+    // zeroed reply
+    if (readOp == COMM_READ_NONE && commStatus == COMM_STATUS_SUCCESS)
+    {
+        HDDLMemoryMgr_ZeroMemory (outPayload, outSize);
+        ( (HDDLVAData *)outPayload)->vaFunctionID =
+            ( (HDDLVAData *)iov[0].iov_base)->vaFunctionID;
+        ( (HDDLVAData *)outPayload)->size = outSize;
+
+        return commStatus;
+    }
+
+    HDDLThreadMgr_LockMutex (&pipeline->pendingMutex);
+
+    if (commStatus == COMM_STATUS_SUCCESS)
+    {
+        while (!request->done)
+        {
+            HDDLThreadMgr_CondWaitThread (&request->cond, &pipeline->pendingMutex);
+        }
+
+        commStatus = request->status;
+    }
+
+    void *message = request->message;
+    uint32_t messageSize = request->messageSize;
+    void *remainder = request->remainder;
+    uint32_t remainderSize = request->remainderSize;
+    HDDLShimCommMessage received = request->received;
+
+    // Only a request which failed to go out gets here with COMM_READ_NONE
+    if (readOp == COMM_READ_NONE && !pipeline->receiverStopped)
     {
-        HDDLVAData batchHeader;
+        pipeline->detached--;
+    }
 
-        // Append batch header to the begining of the payload data which reserved earlier during
-        // Comm_BatchInit function
-        batchHeader.vaFunctionID = HDDLTransferBatch;
-        batchHeader.size = batchPayload->offset;
+    Comm_PipelineReleaseSlot (pipeline, request);
 
-	HDDLMemoryMgr_Memcpy (batchPayload->data, &batchHeader, sizeof (batchPayload->data),
-            sizeof (HDDLVAData));
+    HDDLThreadMgr_UnlockMutex (&pipeline->pendingMutex);
 
-        HDDLVAData save = *(HDDLVAData*)(outPayload);
-        commStatus = Comm_SingleSubmission (ctx, COMM_READ_FULL, batchPayload->offset,
-            batchPayload->data, outSize, outPayload);
+    if (commStatus != COMM_STATUS_SUCCESS || readOp != COMM_READ_PARTIAL)
+    {
+        HDDLMemoryMgr_FreeMemory (message);
+        HDDLMemoryMgr_FreeMemory (remainder);
 
-        // restore functionId & size
-        *(HDDLVAData*)(outPayload) = save;
+        if (commStatus == COMM_STATUS_SUCCESS && readOp == COMM_READ_BORROW)
+        {
+            *(HDDLShimCommMessage *)outPayload = received;
+        }
+        else
+        {
+            Comm_ReleaseMessage (ctx, &received);
+        }
 
-	HDDLMemoryMgr_ZeroMemory (batchPayload, sizeof (HDDLShimBatchPayload));
-        // Reserve the header for batch function and size identification before flush
-        batchPayload->offset += sizeof(HDDLVAData);
+        return commStatus;
     }
 
-    if (batchPayload->offset + inSize >= DATA_MAX_SEND_SIZE)
+    // Hand the reply over the same way a peek would: TCP/SHM callers get the header in their
+    // buffer and read the whole message afterwards, XLink callers own the first fragment and
+    // read the remainder afterwards.
+    if (IS_TCP_MODE (ctx) || IS_SHM_MODE (ctx))
+    {
+        HDDLMemoryMgr_Memcpy (*outPayload, message, outSize, outSize);
+        Comm_PipelineStashSet (ctx, message, messageSize);
+    }
+    else
     {
-        return Comm_SingleSubmission (ctx, COMM_READ_FULL, inSize,
-            inPayload, outSize, outPayload);
+        *outPayload = message;
+        Comm_PipelineStashSet (ctx, remainder, remainderSize);
     }
 
-    HDDLMemoryMgr_Memcpy ( (void *) (batchPayload->data + batchPayload->offset), inPayload,
-	sizeof (batchPayload->data), inSize);
-    batchPayload->offset += inSize;
-    return commStatus;
+    return COMM_STATUS_SUCCESS;
 }
 
-HDDLShimBatchPayload *Comm_BatchInit ()
+// Wait for the answers of the COMM_READ_NONE requests sent so far, whatever comes next on
+// another channel pair is not served before them
+static void Comm_PipelineDrain (HDDLShimCommContext *ctx)
 {
-    // TODO: Currently the max payload data that can be sent is being set to DATA_MAX_SEND_SIZE.
-    // We might need to be able to expand the size when the limit has been reached though very
-    // unlikely that batch mode data will exceed DATA_MAX_SEND_SIZE.
-    HDDLShimBatchPayload *batchPayload = HDDLMemoryMgr_AllocAndZeroMemory (
-        sizeof (HDDLShimBatchPayload));
+    HDDLShimPipeline *pipeline = ctx->pipeline;
 
-    // Reserve the header for batch function and size identification before flush
-    if (batchPayload != NULL)
+    if (pipeline == NULL)
     {
-        batchPayload->offset += sizeof (HDDLVAData);
+        return;
     }
 
-    return batchPayload;
-}
-
-// When we are batching the VAAPI call and sent over to accelerator, we should only
-// expect COMM_READ_FULL operations. The only exception is when batch mode is turn on,
-// but the current VAAPI call operation cannot be batched (e.g. not within per frame
-// batching, or not within vaDestroyBuffer batching).
-CommStatus Comm_BatchSubmission (HDDLShimCommContext *ctx, HDDLVAFunctionID functionId,
-    CommReadOp readOp, int inSize, void *inPayload, int outSize, void **outPayload)
-{
-    CommStatus commStatus = COMM_STATUS_SUCCESS;
-    HDDLShimBatchPayload *batchPayload = ctx->batchPayload;
+    HDDLThreadMgr_LockMutex (&pipeline->pendingMutex);
 
-    if (readOp == COMM_READ_FULL)
+    while (pipeline->detached > 0 && !pipeline->receiverStopped)
     {
-	HDDLMemoryMgr_ZeroMemory (outPayload, outSize);
-
-        ( (HDDLVAData *)outPayload)->vaFunctionID = functionId;
-        ( (HDDLVAData *)outPayload)->size = outSize;
+        HDDLThreadMgr_CondWaitThread (&pipeline->slotCond, &pipeline->pendingMutex);
     }
 
-    // Begining of per frame batching
-    if (functionId == BATCH_FRAME_START_FUNC && ctx->batchThreadId == syscall (SYS_gettid))
-    {
-        if (batchPayload)
-        {
-            // Flush the batched vaDestroyBuffer calls to accelerator before we start performing
-            // per frame batching
-            if (batchPayload->batchState == BATCH_DESTROY_BUFFER)
-            {
-                commStatus = Comm_BatchFlush (ctx, outSize, outPayload, PAYLOAD_RESET);
-                SHIM_CHK_ERROR(commStatus, "Error to BatchFlush", commStatus);
+    HDDLThreadMgr_UnlockMutex (&pipeline->pendingMutex);
+}
 
-                // restore functionId & size
-                ((HDDLVAData*)outPayload)->vaFunctionID = functionId;
-                ((HDDLVAData*)outPayload)->size = outSize;
-            }
-        }
-        else
-        {
-            batchPayload = Comm_BatchInit ();
+static CommStatus Comm_BorrowSubmission (HDDLShimCommContext *ctx, struct iovec *iov,
+    int iovCount, HDDLShimCommMessage *message)
+{
+    CommStatus commStatus;
+    pthread_mutex_t *mutex = Comm_TransportMutex (ctx);
 
-	    SHIM_CHK_NULL (batchPayload, "batchPayload returned NULL", COMM_STATUS_FAILED);
-        }
+    SHIM_CHK_NULL (mutex, "Invalid communication mode", COMM_STATUS_FAILED);
 
-        commStatus = Comm_BatchAppend (ctx, batchPayload, inSize, inPayload, outSize, outPayload);
+    HDDLThreadMgr_LockMutex (mutex);
 
-        batchPayload->batchState = BATCH_PER_FRAME;
-        ctx->batchThreadId = syscall (SYS_gettid);
-        ctx->batchPayload = batchPayload;
+    commStatus = Comm_WriteV (ctx, iov, iovCount);
 
-    }
-    else
+    if (commStatus == COMM_STATUS_SUCCESS)
     {
-        if (batchPayload && ctx->batchThreadId == syscall (SYS_gettid))
-        {
-            if (batchPayload->batchState == BATCH_PER_FRAME)
-            {
-                commStatus = Comm_BatchAppend (ctx, batchPayload, inSize, inPayload, outSize, outPayload);
-                SHIM_CHK_ERROR(commStatus, "Error to BatchAppend", commStatus);
-
-                if (functionId == BATCH_FRAME_END_FUNC)
-                {
-                    commStatus = Comm_BatchFlush (ctx, outSize, outPayload, PAYLOAD_FREE);
-                }
-            }
-            else if (batchPayload->batchState == BATCH_DESTROY_BUFFER)
-            {
-                if (functionId == BATCH_DESTROY_START_FUNC ||
-                    functionId == BATCH_DESTROY_END_FUNC || functionId == BATCH_DESTROY_FINAL_FUNC)
-                {
-                    commStatus = Comm_BatchAppend (ctx, batchPayload, inSize, inPayload, outSize, outPayload);
-                    SHIM_CHK_ERROR(commStatus, "Error to BatchAppend", commStatus);
+        commStatus = Comm_BorrowMessage (ctx, message);
+    }
 
-                    // Flush the batched vaDestroyBuffer function calls to accelerator under two
-                    // conditions:
-                    //  1) before calling vaCreateBuffer to avoid the possibility of messing up the
-                    //     buffer creation sequence on accelerator
-                    //  2) before calling vaDestroyContext
-                    if (functionId == BATCH_DESTROY_END_FUNC ||
-                        functionId == BATCH_DESTROY_FINAL_FUNC)
-                    {
-                        commStatus = Comm_BatchFlush (ctx, outSize, outPayload, PAYLOAD_FREE);
-                    }
-                }
-                else
-                {
-                    commStatus = Comm_SingleSubmission (ctx, readOp, inSize, inPayload, outSize,
-                        outPayload);
-                }
-            }
-            else if (batchPayload->batchState == BATCH_OFF)
-            {
-                commStatus = Comm_SingleSubmission (ctx, readOp, inSize, inPayload, outSize,
-                    outPayload);
-            }
-        }
-        else
+    // The next caller reads its reply as soon as the lock is dropped
+    if (commStatus == COMM_STATUS_SUCCESS)
+    {
+        commStatus = Comm_DetachMessage (ctx, message);
+        if (commStatus != COMM_STATUS_SUCCESS)
         {
-            // Begining of vaDestroyBuffer batching
-            if (functionId == BATCH_DESTROY_START_FUNC)
-            {
-                batchPayload = Comm_BatchInit ();
-
-                SHIM_CHK_NULL (batchPayload, "batchPayload returned NULL", COMM_STATUS_FAILED);
-
-                commStatus = Comm_BatchAppend (ctx, batchPayload, inSize, inPayload, outSize, outPayload);
-
-                batchPayload->batchState = BATCH_DESTROY_BUFFER;
-                ctx->batchThreadId = syscall (SYS_gettid);
-                ctx->batchPayload = batchPayload;
-            }
-            else
-            {
-                commStatus = Comm_SingleSubmission (ctx, readOp, inSize, inPayload, outSize,
-                    outPayload);
-            }
+            Comm_ReleaseMessage (ctx, message);
         }
     }
 
+    HDDLThreadMgr_UnlockMutex (mutex);
+
     return commStatus;
 }
 
 CommStatus Comm_SingleSubmission (HDDLShimCommContext *ctx, CommReadOp readOp, int inSize,
     void *inPayload, int outSize, void **outPayload)
+{
+    struct iovec iov;
+
+    iov.iov_base = inPayload;
+    iov.iov_len = inSize;
+
+    return Comm_SingleSubmissionV (ctx, readOp, &iov, 1, outSize, outPayload);
+}
+
+static CommStatus Comm_SubmitV (HDDLShimCommContext *ctx, CommReadOp readOp,
+    struct iovec *iov, int iovCount, int outSize, void **outPayload)
 {
     CommStatus commStatus = COMM_STATUS_SUCCESS;
 
+    if (IS_PIPELINE (ctx))
+    {
+        return Comm_PipelineSubmission (ctx, readOp, iov, iovCount, outSize, outPayload);
+    }
+
+    ( (HDDLVAData *)iov[0].iov_base)->requestId = 0;
+
+    if (readOp == COMM_READ_BORROW)
+    {
+        return Comm_BorrowSubmission (ctx, iov, iovCount, (HDDLShimCommMessage *)outPayload);
+    }
+
+    // Without pipelining the reply has to come off the channel before anyone else's
+    if (readOp == COMM_READ_NONE)
+    {
+        readOp = COMM_READ_FULL;
+    }
+
     if (IS_XLINK_MODE (ctx))
     {
         HDDLThreadMgr_LockMutex (&ctx->xLinkCtx->xLinkMutex);
-        XLinkStatus xlinkStatus = XLink_Write (ctx->xLinkCtx, inSize, inPayload);
+        XLinkStatus xlinkStatus = XLink_WriteV (ctx->xLinkCtx, iov, iovCount);
 
         if (xlinkStatus != X_LINK_SUCCESS)
         {
@@ -750,10 +2710,14 @@ CommStatus Comm_SingleSubmission (HDDLShimCommContext *ctx, CommReadOp readOp, i
     }
     else if (IS_TCP_MODE (ctx))
     {
-        TCPStatus tcpStatus = TCP_Write (ctx->tcpCtx, inSize, inPayload);
+        HDDLThreadMgr_LockMutex (&ctx->tcpCtx->tcpMutex);
+        TCPStatus tcpStatus = TCP_WriteV (ctx->tcpCtx, iov, iovCount);
 
         if (tcpStatus != TCP_SUCCESS)
+        {
+            HDDLThreadMgr_UnlockMutex (&ctx->tcpCtx->tcpMutex);
             return COMM_STATUS_FAILED;
+        }
 
         if (readOp == COMM_READ_FULL)
         {
@@ -764,13 +2728,40 @@ CommStatus Comm_SingleSubmission (HDDLShimCommContext *ctx, CommReadOp readOp, i
             tcpStatus = TCP_Peek (ctx->tcpCtx, (uint32_t *)&outSize, (void *)*outPayload);
         }
 
+        HDDLThreadMgr_UnlockMutex (&ctx->tcpCtx->tcpMutex);
+
 	if (tcpStatus != TCP_SUCCESS)
             commStatus = COMM_STATUS_FAILED;
     }
+    else if (IS_SHM_MODE (ctx))
+    {
+        HDDLThreadMgr_LockMutex (&ctx->shmCtx->shmMutex);
+        ShmStatus shmStatus = Shm_WriteV (ctx->shmCtx, iov, iovCount);
+
+        if (shmStatus != SHM_SUCCESS)
+        {
+            HDDLThreadMgr_UnlockMutex (&ctx->shmCtx->shmMutex);
+            return COMM_STATUS_FAILED;
+        }
+
+        if (readOp == COMM_READ_FULL)
+        {
+            shmStatus = Shm_Read (ctx->shmCtx, outSize, outPayload);
+        }
+        else
+        {
+            shmStatus = Shm_Peek (ctx->shmCtx, (uint32_t *)&outSize, (void *)*outPayload);
+        }
+
+        HDDLThreadMgr_UnlockMutex (&ctx->shmCtx->shmMutex);
+
+        if (shmStatus != SHM_SUCCESS)
+            commStatus = COMM_STATUS_FAILED;
+    }
     else if (IS_UNITE_MODE (ctx))
     {
         HDDLThreadMgr_LockMutex (&ctx->uniteCtx->xLinkCtx->xLinkMutex);
-        commStatus = Unite_Write (ctx->uniteCtx, inSize, inPayload);
+        commStatus = Unite_WriteV (ctx->uniteCtx, iov, iovCount);
 
         if (commStatus != COMM_STATUS_SUCCESS)
         {
@@ -796,7 +2787,71 @@ CommStatus Comm_SingleSubmission (HDDLShimCommContext *ctx, CommReadOp readOp, i
         HDDLThreadMgr_UnlockMutex (&ctx->uniteCtx->xLinkCtx->xLinkMutex);
     }
 
-    SHIM_NORMAL_MESSAGE ("Message submission write size: %d  read size: %d", inSize, outSize);
+    SHIM_NORMAL_MESSAGE ("Message submission write size: %u  read size: %d",
+        Comm_IovSize (iov, iovCount), outSize);
+
+    return commStatus;
+}
+
+static HDDLShimCommContext *Comm_RouteSubmission (HDDLShimCommContext *ctx, CommReadOp readOp,
+    HDDLVAFunctionID functionId)
+{
+    partialRoute.ctx = NULL;
+
+    if (Comm_GetFunctionInfo (functionId)->route == COMM_ROUTE_BULK)
+    {
+        if (readOp == COMM_READ_PARTIAL)
+        {
+            partialRoute.ctx = ctx;
+            partialRoute.bulkCtx = ctx->bulkCtx;
+        }
+
+        Comm_PipelineDrain (ctx);
+        return ctx->bulkCtx;
+    }
+
+    // A buffer created without waiting has to exist before the next call uses it
+    Comm_PipelineDrain (ctx->bulkCtx);
+    return ctx;
+}
+
+CommStatus Comm_SingleSubmissionV (HDDLShimCommContext *ctx, CommReadOp readOp,
+    struct iovec *iov, int iovCount, int outSize, void **outPayload)
+{
+    HDDLShimDeviceLoad *load;
+    struct timespec start, end;
+    CommStatus commStatus;
+    uint64_t size;
+    uint64_t latency;
+
+    if (ctx->bulkCtx != NULL)
+    {
+        ctx = Comm_RouteSubmission (ctx, readOp, ( (HDDLVAData *)iov[0].iov_base)->vaFunctionID);
+    }
+
+    load = ctx->deviceLoad;
+
+    if (load == NULL)
+    {
+        return Comm_SubmitV (ctx, readOp, iov, iovCount, outSize, outPayload);
+    }
+
+    size = Comm_IovSize (iov, iovCount);
+    __atomic_add_fetch (&load->inFlightBytes, size, __ATOMIC_RELAXED);
+    clock_gettime (CLOCK_MONOTONIC, &start);
+
+    commStatus = Comm_SubmitV (ctx, readOp, iov, iovCount, outSize, outPayload);
+
+    clock_gettime (CLOCK_MONOTONIC, &end);
+    __atomic_sub_fetch (&load->inFlightBytes, size, __ATOMIC_RELAXED);
+
+    // Without a reply to wait for there is no round trip to count
+    if (commStatus == COMM_STATUS_SUCCESS && readOp != COMM_READ_NONE)
+    {
+        latency = (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000;
+        latency = (__atomic_load_n (&load->latency, __ATOMIC_RELAXED) * 7 + latency) / 8;
+        __atomic_store_n (&load->latency, latency, __ATOMIC_RELAXED);
+    }
 
     return commStatus;
 }
@@ -805,6 +2860,8 @@ CommStatus Comm_Disconnect (HDDLShimCommContext *ctx, int flag)
 {
     CommStatus commStatus = COMM_STATUS_UNKNOWN;
 
+    Comm_PipelineStop (ctx);
+
     if (IS_XLINK_MODE (ctx))
     {
         XLinkStatus xlinkStatus = XLink_Disconnect (ctx->xLinkCtx, flag);
@@ -823,6 +2880,15 @@ CommStatus Comm_Disconnect (HDDLShimCommContext *ctx, int flag)
         else
             commStatus = COMM_STATUS_FAILED;
     }
+    else if (IS_SHM_MODE (ctx))
+    {
+        ShmStatus shmStatus = Shm_Disconnect (ctx->shmCtx, flag);
+
+        if (shmStatus == SHM_SUCCESS)
+            commStatus = COMM_STATUS_SUCCESS;
+        else
+            commStatus = COMM_STATUS_FAILED;
+    }
     else if (IS_UNITE_MODE (ctx))
     {
         commStatus = Unite_Disconnect (ctx->uniteCtx, flag);
@@ -831,6 +2897,16 @@ CommStatus Comm_Disconnect (HDDLShimCommContext *ctx, int flag)
     return commStatus;
 }
 
+int Comm_GetPollFd (HDDLShimCommContext *ctx, bool listen)
+{
+    if (IS_TCP_MODE (ctx))
+    {
+        return TCP_GetPollSocket (ctx->tcpCtx, listen);
+    }
+
+    return -1;
+}
+
 CommStatus Comm_Reconnect (HDDLShimCommContext *ctx)
 {
     CommStatus commStatus = COMM_STATUS_UNKNOWN;
@@ -844,6 +2920,15 @@ CommStatus Comm_Reconnect (HDDLShimCommContext *ctx)
         else
             commStatus = COMM_STATUS_FAILED;
     }
+    else if (IS_SHM_MODE (ctx))
+    {
+        ShmStatus shmStatus = Shm_Reconnect (ctx->shmCtx);
+
+        if (shmStatus == SHM_SUCCESS)
+            commStatus = COMM_STATUS_SUCCESS;
+        else
+            commStatus = COMM_STATUS_FAILED;
+    }
     else if (IS_XLINK_MODE (ctx))
     {
         XLinkStatus xlinkStatus = XLink_Disconnect (ctx->xLinkCtx, TARGET);
@@ -866,6 +2951,106 @@ CommStatus Comm_Reconnect (HDDLShimCommContext *ctx)
     return commStatus;
 }
 
+// Make a read blocked on the channel return, nothing can be read from it afterwards
+static void Comm_Shutdown (HDDLShimCommContext *ctx)
+{
+    if (IS_XLINK_MODE (ctx))
+    {
+        XLink_Shutdown (ctx->xLinkCtx);
+    }
+    else if (IS_UNITE_MODE (ctx))
+    {
+        XLink_Shutdown (ctx->uniteCtx->xLinkCtx);
+    }
+    else if (IS_TCP_MODE (ctx))
+    {
+        TCP_Shutdown (ctx->tcpCtx);
+    }
+    else if (IS_SHM_MODE (ctx))
+    {
+        Shm_Shutdown (ctx->shmCtx);
+    }
+}
+
+CommStatus Comm_PipelineStart (HDDLShimCommContext *ctx)
+{
+    HDDLShimPipeline *pipeline;
+
+    pipeline = (HDDLShimPipeline *)HDDLMemoryMgr_AllocAndZeroMemory (sizeof (HDDLShimPipeline));
+    SHIM_CHK_NULL (pipeline, "Failed to allocate pipeline", COMM_STATUS_FAILED);
+
+    HDDLThreadMgr_InitMutex (&pipeline->pendingMutex);
+    HDDLThreadMgr_InitCond (&pipeline->slotCond);
+
+    for (int i = 0; i < MAX_PENDING_REQUEST; i++)
+    {
+        HDDLThreadMgr_InitCond (&pipeline->pending[i].cond);
+        pipeline->freeSlots[i] = i;
+    }
+
+    pipeline->freeCount = MAX_PENDING_REQUEST;
+    ctx->pipeline = pipeline;
+
+    if (HDDLThreadMgr_CreateThread (&pipeline->receiverThread, NULL, Comm_PipelineReceiver,
+        (void *)ctx) != 0)
+    {
+        SHIM_ERROR_MESSAGE ("Failed to create pipeline receiver thread");
+        ctx->pipeline = NULL;
+
+        for (int i = 0; i < MAX_PENDING_REQUEST; i++)
+        {
+            HDDLThreadMgr_DestroyCond (&pipeline->pending[i].cond);
+        }
+
+        HDDLThreadMgr_DestroyCond (&pipeline->slotCond);
+        HDDLThreadMgr_DestroyMutex (&pipeline->pendingMutex);
+        HDDLMemoryMgr_FreeMemory (pipeline);
+        return COMM_STATUS_FAILED;
+    }
+
+    return COMM_STATUS_SUCCESS;
+}
+
+void Comm_PipelineStop (HDDLShimCommContext *ctx)
+{
+    HDDLShimPipeline *pipeline = ctx->pipeline;
+    bool stopped;
+
+    if (pipeline == NULL)
+    {
+        return;
+    }
+
+    HDDLThreadMgr_LockMutex (&pipeline->pendingMutex);
+    stopped = pipeline->receiverStopped;
+    pipeline->stopping = true;
+    HDDLThreadMgr_UnlockMutex (&pipeline->pendingMutex);
+
+    // Still blocked on the transport when tearing down without vaTerminate, closing the
+    // channel under it makes the read fail and the receiver return
+    if (!stopped)
+    {
+        Comm_Shutdown (ctx);
+    }
+
+    HDDLThreadMgr_JoinThread (pipeline->receiverThread, NULL);
+
+    HDDLThreadMgr_LockMutex (&pipeline->pendingMutex);
+    Comm_PipelineFailPending (pipeline);
+    HDDLThreadMgr_UnlockMutex (&pipeline->pendingMutex);
+
+    ctx->pipeline = NULL;
+
+    for (int i = 0; i < MAX_PENDING_REQUEST; i++)
+    {
+        HDDLThreadMgr_DestroyCond (&pipeline->pending[i].cond);
+    }
+
+    HDDLThreadMgr_DestroyCond (&pipeline->slotCond);
+    HDDLThreadMgr_DestroyMutex (&pipeline->pendingMutex);
+    HDDLMemoryMgr_FreeMemory (pipeline);
+}
+
 void Comm_ProcessCommMode (CommMode *commMode, char *mode)
 {
     if (strncmp (mode, "unite", 5) == 0)
@@ -878,9 +3063,11 @@ void Comm_ProcessCommMode (CommMode *commMode, char *mode)
     }
     else if (strncmp (mode, "tcp", 3) == 0)
     {
-	//TODO: To uncomment out once able to release TCP support
-        //*commMode = COMM_MODE_TCP;
-	SHIM_ERROR_MESSAGE ("* Invalid communication mode");
+        *commMode = COMM_MODE_TCP;
+    }
+    else if (strncmp (mode, "shm", 3) == 0)
+    {
+        *commMode = COMM_MODE_SHM;
     }
     else
     {
@@ -897,7 +3084,7 @@ void Comm_GetCommMode (CommMode *commMode)
 
     while (*commMode == COMM_MODE_UNKNOWN)
     {
-        printf ("Please select communication mode (unite / xlink):\n");
+        printf ("Please select communication mode (unite / xlink / tcp / shm):\n");
 
         if (scanf ("%5s", input))
         {
@@ -912,9 +3099,11 @@ void Comm_GetCommMode (CommMode *commMode)
             }
             else if (strncmp (mode, "tcp", 3) == 0)
             {
-		//TODO: To uncomment out once able to release TCP support
-                //*commMode = COMM_MODE_TCP;
-		SHIM_ERROR_MESSAGE ("* Invalid communication mode");
+                *commMode = COMM_MODE_TCP;
+            }
+            else if (strncmp (mode, "shm", 3) == 0)
+            {
+                *commMode = COMM_MODE_SHM;
             }
 	    else if (strncmp (mode, "unite", 5) == 0)
 	    {
@@ -944,19 +3133,41 @@ CommStatus Comm_GetLastChannel (HDDLShimCommContext *ctx, uint16_t *lastChannel)
     }
     else if (IS_TCP_MODE (ctx))
     {
-        // TODO: fill in later
-        // tx = ntohs (ctx->tcpCtx->addressTX.sin_port);
-        // rx = ntohs (ctx->tcpCtx->addressRX.sin_port);
+        tx = ntohs (ctx->tcpCtx->addressTX.sin_port);
+        rx = ntohs (ctx->tcpCtx->addressRX.sin_port);
+    }
+    else if (IS_SHM_MODE (ctx))
+    {
+        tx = ctx->shmCtx->channelTX;
+        rx = ctx->shmCtx->channelRX;
     }
     else if (IS_UNITE_MODE (ctx))
     {
-        // TODO: fill in later
+        tx = ctx->uniteCtx->xLinkCtx->xLinkChannelTX;
+        rx = ctx->uniteCtx->xLinkCtx->xLinkChannelRX;
     }
 
     *lastChannel = tx > rx ? tx : rx;
     return commStatus;
 }
 
+uint32_t Comm_FragmentSize (HDDLShimCommContext *ctx)
+{
+    ctx = Comm_PartialRoute (ctx);
+
+    if (IS_XLINK_MODE (ctx))
+    {
+        return ctx->xLinkCtx->fragmentSize;
+    }
+    else if (IS_UNITE_MODE (ctx))
+    {
+        return ctx->uniteCtx->xLinkCtx->fragmentSize;
+    }
+
+    // TCP and SHM deliver every message in one piece
+    return UINT32_MAX;
+}
+
 void Comm_MutexDestroy (HDDLShimCommContext *ctx)
 {
     if (IS_TCP_MODE (ctx))
@@ -967,6 +3178,10 @@ void Comm_MutexDestroy (HDDLShimCommContext *ctx)
     {
         HDDLThreadMgr_DestroyMutex (&ctx->xLinkCtx->xLinkMutex);
     }
+    else if (IS_SHM_MODE (ctx))
+    {
+        HDDLThreadMgr_DestroyMutex (&ctx->shmCtx->shmMutex);
+    }
     else if (IS_UNITE_MODE (ctx))
     {
         HDDLThreadMgr_DestroyMutex (&ctx->uniteCtx->xLinkCtx->xLinkMutex);
@@ -989,6 +3204,17 @@ void Comm_CloseSocket (HDDLShimCommContext *ctx, int flag)
 	    close (ctx->tcpCtx->serverRX);
 	}
     }
+    else if (IS_SHM_MODE (ctx))
+    {
+        if (flag == HOST)
+        {
+            close (ctx->shmCtx->clientSocket);
+        }
+        else if (flag == TARGET)
+        {
+            close (ctx->shmCtx->serverSocket);
+        }
+    }
 }
 
 void Comm_GetNewCommChannel (CommMode commMode, uint16_t *tx, uint16_t *rx)
@@ -998,7 +3224,8 @@ void Comm_GetNewCommChannel (CommMode commMode, uint16_t *tx, uint16_t *rx)
     int newChannel = -1;
     bool inputChannel = false;
     char read[10] = {};
-    char *modeName = (commMode == COMM_MODE_XLINK) ? "XLink channel" : "TCP port";
+    char *modeName = (commMode == COMM_MODE_XLINK) ? "XLink channel" :
+        (commMode == COMM_MODE_SHM) ? "SHM channel" : "TCP port";
 
     while (inputChannel != true)
     {
@@ -1007,7 +3234,7 @@ void Comm_GetNewCommChannel (CommMode commMode, uint16_t *tx, uint16_t *rx)
 
         if (scanf ("%9s", read))
         {
-            if (commMode == COMM_MODE_XLINK)
+            if (commMode == COMM_MODE_XLINK || commMode == COMM_MODE_SHM)
             {
                 newChannel = (int)strtol (read, (char **)NULL, 16);
             }
@@ -1039,7 +3266,7 @@ void Comm_GetNewCommChannel (CommMode commMode, uint16_t *tx, uint16_t *rx)
         printf ("Please insert new %s(RX) to be used:\n", modeName);
         if (scanf ("%9s", read))
         {
-            if (commMode == COMM_MODE_XLINK)
+            if (commMode == COMM_MODE_XLINK || commMode == COMM_MODE_SHM)
             {
                 newChannel = (int)strtol (read, (char **)NULL, 16);
             }
@@ -1083,7 +3310,7 @@ void Comm_GetNewCommChannel (CommMode commMode, uint16_t *tx, uint16_t *rx)
         const char* rxStr;
 
         // Get tx or rx based on mode
-        if (commMode == COMM_MODE_XLINK)
+        if (commMode == COMM_MODE_XLINK || commMode == COMM_MODE_SHM)
         {
                 printf ("XLINK mode\n");
                 txStr = "CHANNELTX ";
@@ -1105,7 +3332,7 @@ void Comm_GetNewCommChannel (CommMode commMode, uint16_t *tx, uint16_t *rx)
                 {
                     chunk[ strnlen (chunk, sizeof (chunk)) - 1 ] = '\0';
 
-                    if (commMode == COMM_MODE_XLINK)
+                    if (commMode == COMM_MODE_XLINK || commMode == COMM_MODE_SHM)
                     {
                         *tx = (uint16_t)strtol (&chunk[strnlen (txStr, RX_TX_MAX_STRLEN)],
 		            (char **)NULL, 16);
@@ -1119,7 +3346,7 @@ void Comm_GetNewCommChannel (CommMode commMode, uint16_t *tx, uint16_t *rx)
                 {
                     chunk[ strnlen (chunk, sizeof (chunk)) - 1 ] = '\0';
 
-                    if (commMode == COMM_MODE_XLINK)
+                    if (commMode == COMM_MODE_XLINK || commMode == COMM_MODE_SHM)
                     {
                         *rx = (uint16_t)strtol (&chunk[strnlen (rxStr, RX_TX_MAX_STRLEN)],
 		            (char **)NULL, 16);
@@ -26,7 +26,7 @@
 //! \file    gen_comm.h
 //! \brief   General interface for different communication
 //! \details Provide connecting option for communcation depend on its API
-//!          Available communcation method, such as XLINK, TCP
+//!          Available communcation method, such as XLINK, TCP, SHM
 //!
 
 #ifndef __GEN_COMM_H__
@@ -35,12 +35,13 @@
 #include "hddl_va_shim_common.h"
 #include "xlink/xlink_pcie.h"
 #include "tcp/tcp.h"
+#include "shm/shm.h"
 #include "unite/unite.h"
 
 typedef enum
 {
-    PAYLOAD_FREE,
-    PAYLOAD_RESET
+    PAYLOAD_FREE,   // Batching is over, the arena is kept for the next batch
+    PAYLOAD_RESET   // Batching goes on with an empty batch
 }HDDLShimBatchPayloadOp;
 
 //!
@@ -65,6 +66,35 @@ CommStatus Comm_ContextInit (HDDLShimCommContext **ctx, ShimThreadParams *thread
 CommStatus Comm_DynamicContextInit (HDDLShimCommContext **ctx, HDDLShimCommContext *mainCtx,
     uint16_t *lastChannel, uint16_t *tx, uint16_t *rx);
 
+//!
+//! \brief   Load record of a device, created on first use
+//! \return  HDDLShimDeviceLoad *
+//!          Return the record, NULL if too many devices
+//!
+HDDLShimDeviceLoad *Comm_GetDeviceLoad (uint32_t swDeviceId);
+
+//!
+//! \brief   Pick the least loaded of the PCIe devices for a new display
+//! \return  CommStatus
+//!          Return COMM_STATUS_SUCCESS if success, else fail
+//!
+CommStatus Comm_PickDevice (uint32_t *swDeviceId);
+
+//!
+//! \brief   Count displays and VAContexts opened or closed over the channel to its device
+//! \return  void
+//!          Return nothing
+//!
+void Comm_UpdateDeviceLoad (HDDLShimCommContext *ctx, int32_t displays, int32_t contexts);
+
+//!
+//! \brief   Ask the target for a free channel pair over the control channel
+//! \return  CommStatus
+//!          Return COMM_STATUS_SUCCESS if success, else fail
+//!
+CommStatus Comm_RequestChannelPair (CommMode commMode, uint32_t swDeviceId, uint16_t *tx,
+    uint16_t *rx);
+
 //!
 //! \brief   Communication initialization
 //! \return  CommStatus
@@ -86,6 +116,27 @@ CommStatus Comm_Connect (HDDLShimCommContext *ctx, int flag);
 //!
 CommStatus Comm_Write (HDDLShimCommContext *ctx, int size, void *payload);
 
+//!
+//! \brief   Communication write operation gathering the payload from several buffers
+//! \return  CommStatus
+//!          Return COMM_STATUS_SUCCESS if success, else fail
+//!
+CommStatus Comm_WriteV (HDDLShimCommContext *ctx, struct iovec *iov, int iovCount);
+
+//!
+//! \brief   Communication safe write operation with mutex lock and unlock
+//! \return  CommStatus
+//!          Return COMM_STATUS_SUCCESS if success, else fail
+//!
+CommStatus Comm_WriteSafe (HDDLShimCommContext *ctx, int size, void *payload);
+
+//!
+//! \brief   Communication safe gathering write operation with mutex lock and unlock
+//! \return  CommStatus
+//!          Return COMM_STATUS_SUCCESS if success, else fail
+//!
+CommStatus Comm_WriteSafeV (HDDLShimCommContext *ctx, struct iovec *iov, int iovCount);
+
 //!
 //! \brief   Communication read operation
 //! \return  CommStatus
@@ -107,6 +158,38 @@ CommStatus Comm_ReadSafe (HDDLShimCommContext *ctx, int size, void *payload);
 //!
 CommStatus Comm_Peek (HDDLShimCommContext *ctx, uint32_t *size, void *payload);
 
+//!
+//! \brief   Release a message buffer which Comm_Peek allocated (XLink and Unite) or which the
+//!          caller allocated for the message (TCP and SHM). size is the message size.
+//! \return  void
+//!          Return nothing
+//!
+void Comm_ReleasePayload (HDDLShimCommContext *ctx, void *payload, uint32_t size);
+
+//!
+//! \brief   Receive a whole message without copying it where the transport allows: XLink
+//!          and SHM lend out their own receive buffer, TCP a buffer kept per channel. The
+//!          message has to be given back with Comm_ReleaseMessage.
+//! \return  CommStatus
+//!          Return COMM_STATUS_SUCCESS if success, else fail
+//!
+CommStatus Comm_BorrowMessage (HDDLShimCommContext *ctx, HDDLShimCommMessage *message);
+
+//!
+//! \brief   Make a borrowed message independent of the channel. TCP and SHM only lend out one
+//!          message at a time, so one kept beyond the next read is copied out.
+//! \return  CommStatus
+//!          Return COMM_STATUS_SUCCESS if success, else fail
+//!
+CommStatus Comm_DetachMessage (HDDLShimCommContext *ctx, HDDLShimCommMessage *message);
+
+//!
+//! \brief   Give a message obtained with Comm_BorrowMessage back
+//! \return  void
+//!          Return nothing
+//!
+void Comm_ReleaseMessage (HDDLShimCommContext *ctx, HDDLShimCommMessage *message);
+
 //!
 //! \brief   Communication write and read operations
 //! \return  CommStatus
@@ -115,6 +198,16 @@ CommStatus Comm_Peek (HDDLShimCommContext *ctx, uint32_t *size, void *payload);
 CommStatus Comm_Submission (HDDLShimCommContext *ctx, HDDLVAFunctionID functionId,
     CommReadOp readOp, int inSize, void *inPayload, int outSize, void **outPayload);
 
+//!
+//! \brief   Communication write and read operations with the request given as a list of
+//!          buffers, the first one starting with the HDDLVAData header. The buffers are only
+//!          gathered where the transport cannot write them as they are.
+//! \return  CommStatus
+//!          Return COMM_STATUS_SUCCESS if success, else fail
+//!
+CommStatus Comm_SubmissionV (HDDLShimCommContext *ctx, HDDLVAFunctionID functionId,
+    CommReadOp readOp, struct iovec *iov, int iovCount, int outSize, void **outPayload);
+
 //!
 //! \brief   Communication write and read operations in batch
 //! \return  CommStatus
@@ -123,6 +216,46 @@ CommStatus Comm_Submission (HDDLShimCommContext *ctx, HDDLVAFunctionID functionI
 CommStatus Comm_BatchSubmission (HDDLShimCommContext *ctx, HDDLVAFunctionID functionId,
     CommReadOp readOp, int inSize, void *inPayload, int outSize, void **outPayload);
 
+//!
+//! \brief   Communication write and read operations in batch with the request given as a list
+//!          of buffers
+//! \return  CommStatus
+//!          Return COMM_STATUS_SUCCESS if success, else fail
+//!
+CommStatus Comm_BatchSubmissionV (HDDLShimCommContext *ctx, HDDLVAFunctionID functionId,
+    CommReadOp readOp, struct iovec *iov, int iovCount, int outSize, void **outPayload);
+
+//!
+//! \brief   Keep batching across frames. Calls which need no reply are held back until the
+//!          batch is large enough, holds enough calls or its first call is deadline
+//!          microseconds old, or until a call needs an answer from the target.
+//! \return  CommStatus
+//!          Return COMM_STATUS_SUCCESS if success, else fail
+//!
+CommStatus Comm_BatchCoalesceStart (HDDLShimCommContext *ctx, uint32_t deadline);
+
+//!
+//! \brief   Send whatever is held back and stop batching across frames
+//! \return  void
+//!          Return nothing
+//!
+void Comm_BatchCoalesceStop (HDDLShimCommContext *ctx);
+
+//!
+//! \brief   Status of the first batched call of the calling thread which failed after the
+//!          thread went on with a zeroed reply, cleared once taken
+//! \return  VAStatus
+//!          Return VA_STATUS_SUCCESS if there is none, else the status of the failed call
+//!
+VAStatus Comm_BatchTakeStatus ();
+
+//!
+//! \brief   Free the batch arenas of a communication context
+//! \return  void
+//!          Return nothing
+//!
+void Comm_BatchDestroy (HDDLShimCommContext *ctx);
+
 //!
 //! \brief   Single communcation write and read operation
 //! \return  CommStatus
@@ -131,6 +264,15 @@ CommStatus Comm_BatchSubmission (HDDLShimCommContext *ctx, HDDLVAFunctionID func
 CommStatus Comm_SingleSubmission (HDDLShimCommContext *ctx, CommReadOp readOp, int inSize,
     void *inPayload, int outSize, void **outPayload);
 
+//!
+//! \brief   Single communcation write and read operation with the request given as a list of
+//!          buffers
+//! \return  CommStatus
+//!          Return COMM_STATUS_SUCCESS if success, else fail
+//!
+CommStatus Comm_SingleSubmissionV (HDDLShimCommContext *ctx, CommReadOp readOp,
+    struct iovec *iov, int iovCount, int outSize, void **outPayload);
+
 //!
 //! \brief   Communication disconnection
 //! \return  CommStatus
@@ -138,6 +280,24 @@ CommStatus Comm_SingleSubmission (HDDLShimCommContext *ctx, CommReadOp readOp, i
 //!
 CommStatus Comm_Disconnect (HDDLShimCommContext *ctx, int flag);
 
+//!
+//! \brief   Name, request size, batching flags and route of a call, shared by host and target
+//! \return  const HDDLShimFunctionInfo *
+//!          Return the entry of functionId, an entry without flags for unknown IDs
+//!
+const HDDLShimFunctionInfo *Comm_GetFunctionInfo (HDDLVAFunctionID functionId);
+
+#define FUNCTION_HAS(id, flag) ( (Comm_GetFunctionInfo (id)->flags & (flag)) != 0)
+
+//!
+//! \brief   File descriptor which becomes readable once the next message is there, or with
+//!          listen once the next host connects. Only TCP has one, the SHM doorbell is a
+//!          futex and XLink has no descriptors.
+//! \return  int
+//!          Return the descriptor, -1 if the transport has none
+//!
+int Comm_GetPollFd (HDDLShimCommContext *ctx, bool listen);
+
 //!
 //! \brief   Communication reconnect, only needed on TARGET side
 //! \return  CommStatus
@@ -145,6 +305,20 @@ CommStatus Comm_Disconnect (HDDLShimCommContext *ctx, int flag);
 //!
 CommStatus Comm_Reconnect (HDDLShimCommContext *ctx);
 
+//!
+//! \brief   Start the reply receiver so several requests can be in flight on the channel
+//! \return  CommStatus
+//!          Return COMM_STATUS_SUCCESS if success, else fail
+//!
+CommStatus Comm_PipelineStart (HDDLShimCommContext *ctx);
+
+//!
+//! \brief   Stop the reply receiver and fail every request still waiting for a reply
+//! \return  void
+//!          Return nothing
+//!
+void Comm_PipelineStop (HDDLShimCommContext *ctx);
+
 //!
 //! \brief   Get Communication Mode from starting parameter
 //! \return  void
@@ -173,6 +347,15 @@ void Comm_GetNewCommChannel (CommMode commMode, uint16_t *tx, uint16_t *rx);
 //!
 CommStatus Comm_GetLastChannel (HDDLShimCommContext *ctx, uint16_t *lastChannel);
 
+//!
+//! \brief   Size of the first part of a message a COMM_READ_PARTIAL XLink/Unite caller
+//!          receives, the rest is read afterwards
+//! \return  uint32_t
+//!          Return the fragment size agreed on with the peer, UINT32_MAX if the transport
+//!          does not split messages
+//!
+uint32_t Comm_FragmentSize (HDDLShimCommContext *ctx);
+
 //!
 //! \brief   Destroy Mutex for each CommMode
 //! \return  void
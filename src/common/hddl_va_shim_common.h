@@ -71,9 +71,31 @@
 
 #define MIN_XLINK_CHANNEL_ID 0x400
 #define MAX_XLINK_CHANNEL_ID 0xFFF
+// Well-known pair a host asks the target for the channels of a new session on, named from
+// the host side. The target hands out the pairs above it.
+#define XLINK_CONTROL_CHANNEL_TX MIN_XLINK_CHANNEL_ID
+#define XLINK_CONTROL_CHANNEL_RX (MIN_XLINK_CHANNEL_ID + 1)
+#define XLINK_FIRST_AUTO_CHANNEL_ID (MIN_XLINK_CHANNEL_ID + 2)
+#define CONTROL_CONNECT_RETRY 100
+#define CONTROL_CONNECT_RETRY_INTERVAL 10000
 
 #define DATA_FRAGMENT_SIZE 4 * 1024 * 1024
 #define DATA_MAX_SEND_SIZE 3 * 1024 * 1024
+// Bounds of the xlink fragment size agreed on at connect, DATA_MAX_SEND_SIZE by default
+#define MIN_XLINK_FRAGMENT_SIZE (64 * 1024)
+#define MAX_XLINK_FRAGMENT_SIZE (16 * 1024 * 1024)
+// Fragments a xlink channel queues, so a write does not wait for the last one to be released
+#define XLINK_FRAGMENTS_IN_FLIGHT 2
+#define XLINK_HANDSHAKE_MAGIC 0x46524147
+// Smallest segment a batch arena grows by
+#define BATCH_SEGMENT_SIZE (256 * 1024)
+// A coalesced batch goes out once it holds this much or this many calls
+#define BATCH_COALESCE_MAX_SIZE (1024 * 1024)
+#define BATCH_COALESCE_MAX_CALLS 256
+// Threads which may have a failed batched call not yet returned to them at the same time
+#define BATCH_FAILURE_SLOTS 16
+// Initial size of a batch reply on target, it grows with the results
+#define BATCH_REPLY_SIZE (4 * 1024)
 #define DEFAULT_XLINK_PATH "/tmp/xlink_mock"
 #define OPEN_CHANNEL_TIMEOUT 50000
 #define OPERATION_TYPE RXB_TXB
@@ -104,23 +126,66 @@
 
 #define DEFAULT_TCP_HOST "127.0.0.1"
 #define SocketAddress struct sockaddr
+#define TCP_LISTEN_BACKLOG 8
+#define TCP_CONNECT_RETRY 100
+#define TCP_CONNECT_RETRY_INTERVAL 100000
+#define TCP_SOCKET_BUFFER_SIZE (4 * 1024 * 1024)
+#define TCP_ZEROCOPY_THRESHOLD (64 * 1024)
+
+#define SHM_SOCKET_NAME "hddl_bypass_shm"
+#define SHM_RING_SIZE 32 * 1024 * 1024
+#define SHM_CACHE_LINE_SIZE 64
+#define SHM_SPIN_COUNT 1000
+#define SHM_WAIT_TIMEOUT 100000000
+#define SHM_CONNECT_RETRY 100
+#define SHM_CONNECT_RETRY_INTERVAL 100000
+#define SHM_IN_PLACE_THRESHOLD 64 * 1024
+
+#define MAX_PENDING_REQUEST 64
+
+// Pipelined request ids carry the pending slot in their low bits, MAX_PENDING_REQUEST is a
+// power of two
+#define PENDING_SLOT(requestId) ((requestId) & (MAX_PENDING_REQUEST - 1))
+#define PENDING_SEQUENCE_SHIFT 6
 
 #define HEAP_INCREMENTAL_SIZE 8
 
+// Comm contexts bound to a VAContextID are kept in the context heap under this pid, which no
+// process has, with the VAContextID as tid
+#define VA_CONTEXT_COMM_PID 0
+
+// Upper bound of BYPASS_CHANNEL_POOL, every pair takes two of the channels XLINK has
+#define MAX_CHANNEL_POOL_SIZE 32
+
+// Target worker pools, see BYPASS_WORKER_THREADS and BYPASS_CHANNEL_THREADS
+#define DEFAULT_WORKER_THREADS 4
+#define DEFAULT_CHANNEL_THREADS 64
+#define MAX_POOL_THREADS 256
+
+// Buffer IDs handed out by the host, the driver on target never uses the top bit
+#define HOST_BUFFER_ID_FLAG 0x80000000
+#define IS_HOST_BUFFER_ID(id) (((id) & HOST_BUFFER_ID_FLAG) && (id) != VA_INVALID_ID)
+#define ID_TABLE_INITIAL_SIZE 256
+
 #define WORKLOAD_ID_NONE -1
 #define QUERY_FROM_UNITE -1
 
 #define IS_BATCH(ctx) ((ctx)->doBatch)
+#define IS_PIPELINE(ctx) ((ctx)->pipeline != NULL)
 #define COMM_MODE(ctx) ((ctx)->commMode)
 #define IS_TCP_MODE(ctx) ((ctx)->commMode==COMM_MODE_TCP)
 #define IS_XLINK_MODE(ctx) ((ctx)->commMode==COMM_MODE_XLINK)
 #define IS_UNITE_MODE(ctx) ((ctx)->commMode==COMM_MODE_UNITE)
+#define IS_SHM_MODE(ctx) ((ctx)->commMode==COMM_MODE_SHM)
 
-#define BATCH_FRAME_START_FUNC HDDLVABeginPicture
-#define BATCH_FRAME_END_FUNC HDDLVAEndPicture
-#define BATCH_DESTROY_START_FUNC HDDLVADestroyBuffer
-#define BATCH_DESTROY_END_FUNC HDDLVACreateBuffer
-#define BATCH_DESTROY_FINAL_FUNC HDDLVADestroyContext
+// How batching, routing and the target treat a call, see Comm_GetFunctionInfo
+#define FUNCTION_FRAME_START    (1 << 0)    // Starts the per frame batch
+#define FUNCTION_FRAME_END      (1 << 1)    // Sends the per frame batch off
+#define FUNCTION_DESTROY_START  (1 << 2)    // Starts a batch of destroy calls between frames
+#define FUNCTION_DESTROY_FINAL  (1 << 3)    // Sends the batched destroy calls off
+#define FUNCTION_REPLY          (1 << 4)    // Caller waits for the answer, kept out of batches
+#define FUNCTION_ANSWERED       (1 << 5)    // Joins anyway, gets its answer from the batch reply
+#define FUNCTION_ASYNC          (1 << 6)    // Served on a worker when the host pipelines
 
 #define HDDLVABUFFER_NODE_LIST_SIZE 128
 
@@ -146,7 +211,8 @@ typedef enum
     COMM_MODE_TCP,               // 0
     COMM_MODE_XLINK,             // 1
     COMM_MODE_UNITE,             // 2
-    COMM_MODE_UNKNOWN            // 3
+    COMM_MODE_SHM,               // 3
+    COMM_MODE_UNKNOWN            // 4
 }CommMode;
 typedef CommMode CommMode;
 
@@ -160,25 +226,57 @@ typedef enum
 }TCPError_t;
 typedef TCPError_t TCPStatus;
 
+typedef enum
+{
+    SHM_SUCCESS,           //0
+    SHM_FAILED,            //1
+    SHM_EOF,               //2
+    SHM_CONNECTION_CLOSED, //3
+    SHM_UNKNOWN            //4
+}ShmError_t;
+typedef ShmError_t ShmStatus;
+
 typedef enum
 {
     COMM_READ_FULL,    // To use Comm_Read function
-    COMM_READ_PARTIAL  // To use Comm_Peak function
+    COMM_READ_PARTIAL, // To use Comm_Peak function
+    COMM_READ_BORROW,  // To use Comm_BorrowMessage function
+    COMM_READ_NONE     // The caller does not wait for the reply, it may get a zeroed one
 }CommReadOp;
 
+// Channel pair a call goes out on when its comm context has a bulk pair. This is the priority
+// class of the call: the target serves each pair on a listener of its own, so control calls
+// never wait behind a bulk transfer. Within a pair calls keep their order, and there is no
+// queue to reorder them by priority.
+typedef enum
+{
+    COMM_ROUTE_CONTROL,
+    COMM_ROUTE_BULK
+}CommChannelRoute;
+
+typedef struct _FUNCTION_INFO
+{
+    const char *name;
+    uint32_t txSize;            // Fixed part of the request, 0 if the target does not serve it
+    uint32_t flags;
+    CommChannelRoute route;     // Priority class
+}HDDLShimFunctionInfo;
+
 typedef enum xlink_error XLinkStatus;
 
 typedef enum
 {
     BATCH_OFF,
     BATCH_PER_FRAME,
-    BATCH_DESTROY_BUFFER
+    BATCH_DESTROY_BUFFER,
+    BATCH_COALESCE          // Frames kept back to go out together with the next ones
 }HDDLShimBatchState;
 
 typedef enum
 {
     MAIN_COMM_CONTEXT,
-    DYNAMIC_COMM_CONTEXT
+    DYNAMIC_COMM_CONTEXT,
+    BULK_COMM_CONTEXT               // Dynamic, carries the bulk calls of another context
 }HDDLShimCommContextNew;
 
 // Categorize buffer-related information in vaBuffer
@@ -196,8 +294,34 @@ typedef struct _HDDL_VA_BUFFER
 
     bool bMapped;
     int32_t iRefCount;
+
+    // Held across the round trip of vaMapBuffer and vaUnmapBuffer instead of the heap lock
+    pthread_mutex_t bufMutex;
+    int32_t iUseCount;      // Threads that looked the buffer up and still use it
+    bool bReleased;         // Out of the heap while in use, freed by the last user
 }HDDLVABuffer;
 
+// Maps IDs to values with open addressing. Finds heap elements by ID on host, and the buffers
+// host buffer IDs stand for and the buffers kept mapped on target.
+typedef struct _ID_ENTRY
+{
+    uint64_t key;
+    union
+    {
+        uint32_t value;
+        void *pointer;
+    };
+    bool used;
+}HDDLShimIdEntry;
+
+typedef struct _ID_TABLE
+{
+    HDDLShimIdEntry *entries;
+    uint32_t capacity;      // Power of two
+    uint32_t count;
+    pthread_mutex_t tableMutex;
+}HDDLShimIdTable;
+
 // Allow control entire heap
 typedef struct _HDDL_VA_HEAP
 {
@@ -205,6 +329,11 @@ typedef struct _HDDL_VA_HEAP
     uint32_t uiElementSize;
     uint32_t uiElementCount;
     void *pFirstFreeElement;
+    // ID of every element in use to its position. The heap cannot hand out generation-checked
+    // handles instead: image IDs and answered buffer IDs come from the driver on target, comm
+    // contexts are keyed by pid and tid, and only unanswered buffers get host IDs, from
+    // HDDLVAShim_NewBufferId, which do not repeat until its counter wraps
+    HDDLShimIdTable *index;
 }HDDLVAHeap;
 
 // Control heap element for vaBuffer
@@ -231,14 +360,77 @@ typedef struct _REMOTE_FD_NODE
 typedef struct xlink_handle xLinkHandler_t;
 typedef uint16_t xLinkChannelId_t;
 
+// Recycled buffers, one free list per size class. The largest class holds a whole xlink
+// message, free buffers keep the link to the next one in their first bytes.
+#define BUFFER_POOL_CLASS_COUNT 4
+
+// What a pool recycles, decides how many free buffers each of its classes keeps
+typedef enum
+{
+    BUFFER_POOL_RECEIVE,    // Received messages
+    BUFFER_POOL_SHADOW,     // Host copies of VA buffers, recreated with the same sizes every frame
+    BUFFER_POOL_KIND_COUNT
+}HDDLShimBufferPoolKind;
+
+typedef struct _BUFFER_POOL_CLASS
+{
+    void *pFirstFree;
+    uint32_t freeCount;
+}HDDLShimBufferClass;
+
+typedef struct _BUFFER_POOL
+{
+    HDDLShimBufferClass sizeClass[BUFFER_POOL_CLASS_COUNT];
+    size_t classSize[BUFFER_POOL_CLASS_COUNT];     // Capacity of the buffers of each class
+    HDDLShimBufferPoolKind kind;
+    pthread_mutex_t poolMutex;
+}HDDLShimBufferPool;
+
+// Bump allocator for memory released all at once. Allocations that do not fit the block come
+// from the heap until the next reset, which grows the block to cover them next time. A block
+// that stayed at most a quarter used for ARENA_SHRINK_RESETS resets shrinks back again.
+#define ARENA_ALIGNMENT 16
+#define ARENA_MAX_BLOCK_SIZE (4 * 1024 * 1024)
+#define ARENA_SHRINK_RESETS 64
+
+typedef struct _ARENA_CHUNK
+{
+    struct _ARENA_CHUNK *next;
+}HDDLShimArenaChunk;
+
+typedef struct _ARENA
+{
+    uint8_t *block;
+    size_t capacity;
+    size_t used;
+    size_t demand;                  // Bytes asked for since the last reset
+    size_t minCapacity;             // Capacity the arena was created with
+    size_t peak;                    // Largest demand since the block last changed size
+    uint32_t resets;                // Resets since the block last changed size
+    HDDLShimArenaChunk *overflow;   // Heap allocations to free on reset
+}HDDLShimArena;
+
 typedef struct _XLINK_CONTEXT
 {
     xLinkChannelId_t xLinkChannelTX;
     xLinkChannelId_t xLinkChannelRX;
     xLinkHandler_t xLinkHandler;    // handler hold payload content
     pthread_mutex_t xLinkMutex;
+    HDDLShimBufferPool rxPool;      // XLink_Peek buffers, shared by the Unite context
+    bool zeroCopyRead;              // Hand out xlink receive buffers instead of copying
+    uint32_t fragmentSize;          // Largest xlink message, agreed on with the peer
+    uint8_t *gather;                // fragmentSize bytes to gather fragments spanning iovecs
+    uint32_t swDeviceId;            // Device to open on, 0 for the first PCIe device
+    bool rxClosed;                  // RX channel already closed by XLink_Shutdown
 }HDDLShimXLinkContext;
 
+// Sent by both ends of a xlink channel pair once it is open, each proposing a fragment size
+typedef struct _XLINK_HANDSHAKE
+{
+    uint32_t magic;
+    uint32_t fragmentSize;
+}HDDLShimXLinkHandshake;
+
 // Hold payload for TCP/IP communication
 typedef struct _TCP_CONTEXT
 {
@@ -249,8 +441,52 @@ typedef struct _TCP_CONTEXT
     struct sockaddr_in addressTX;
     struct sockaddr_in addressRX;
     pthread_mutex_t tcpMutex;
+
+    // HOST or TARGET, decides which connected socket is used for each direction
+    int flag;
+
+    // MSG_ZEROCOPY bookkeeping for the write socket
+    bool zeroCopy;
+    uint32_t zeroCopySent;
+    uint32_t zeroCopyDone;
+
+    // Receive buffer lent out by TCP_Borrow, kept for the next message
+    uint8_t *rxBuffer;
+    uint32_t rxBufferSize;
 }HDDLShimTCPContext;
 
+// Single producer single consumer byte ring living in the shared memory control page.
+// head is only advanced by the producer and tail only by the consumer, the sequence words
+// are the futex doorbells for the opposite side.
+typedef struct _SHM_RING
+{
+    uint32_t head __attribute__ ( (aligned (SHM_CACHE_LINE_SIZE)));
+    uint32_t dataSeq;
+    uint32_t dataWaiters;
+    uint32_t tail __attribute__ ( (aligned (SHM_CACHE_LINE_SIZE)));
+    uint32_t spaceSeq;
+    uint32_t spaceWaiters;
+    uint32_t size __attribute__ ( (aligned (SHM_CACHE_LINE_SIZE)));
+}HDDLShimShmRing;
+
+// Hold payload for shared memory communication with a target on the same machine
+typedef struct _SHM_CONTEXT
+{
+    uint16_t channelTX;
+    uint16_t channelRX;
+    int flag;
+    int memFd;
+    int serverSocket;   // listening socket on target only
+    int clientSocket;   // carries the memfd, peer is gone once it hangs up
+    void *mapAddr;
+    size_t mapSize;
+    HDDLShimShmRing *writeRing;
+    HDDLShimShmRing *readRing;
+    uint8_t *writeData;
+    uint8_t *readData;
+    pthread_mutex_t shmMutex;
+}HDDLShimShmContext;
+
 typedef struct _UNITE_CONTEXT
 {
     HDDLShimXLinkContext *xLinkCtx;
@@ -261,13 +497,145 @@ typedef struct _UNITE_CONTEXT
     HDDLVABufferNode HDDLVABufferNodeList[HDDLVABUFFER_NODE_LIST_SIZE];
 }HDDLShimUniteContext;
 
+// One piece of a batch arena, a batch goes out as the used part of its segments in order
+typedef struct _BATCH_SEGMENT
+{
+    struct _BATCH_SEGMENT *next;
+    uint32_t capacity;
+    uint32_t used;
+    char data[];
+}HDDLShimBatchSegment;
+
+// One call of a batch, its caller went on with a zeroed reply unless it flushed the batch
+typedef struct _BATCH_CALL
+{
+    HDDLVAFunctionID functionId;
+    uint64_t threadId;              // Caller, the status is returned to it later on
+    VAStatus status;                // Filled in from the batch reply
+}HDDLShimBatchCall;
+
+// Failed batched call not yet returned to the thread which made it
+typedef struct _BATCH_FAILURE
+{
+    uint64_t threadId;              // 0 marks a free slot
+    HDDLVAFunctionID functionId;
+    VAStatus status;
+}HDDLShimBatchFailure;
+
 typedef struct
 {
-    char data[DATA_MAX_SEND_SIZE];
-    uint32_t offset;
+    HDDLShimBatchSegment *first;    // Starts with the batch header
+    HDDLShimBatchSegment *current;  // Segment being appended to, later ones are spare
+    uint32_t offset;                // Batch size so far, header included
     HDDLShimBatchState batchState;
+    uint32_t callCount;
+    HDDLShimBatchCall *calls;       // callCount of callCapacity in use
+    uint32_t callCapacity;
+    struct timespec started;        // First call of the batch, CLOCK_MONOTONIC
 }HDDLShimBatchPayload;
 
+// Cross-frame batch coalescing, host only
+typedef struct _BATCH_COALESCE
+{
+    uint32_t deadline;              // Longest a call may be held back, in microseconds
+    bool stop;
+    pthread_t flusherThread;        // Sends frames held back past the deadline
+    pthread_mutex_t batchMutex;     // Guards the batch of the context while coalescing
+    pthread_mutex_t sendMutex;      // Held while a batch is on its way, keeps batches in order
+    pthread_cond_t batchCond;
+}HDDLShimBatchCoalesce;
+
+// Whole message handed out by Comm_BorrowMessage, given back with Comm_ReleaseMessage
+typedef struct _COMM_MESSAGE
+{
+    void *payload;
+    uint32_t size;
+    bool borrowed;      // payload still lives in the transport receive buffer
+    uint32_t poolSize;  // size payload was taken from the receive pool for, 0 if plain heap
+    struct _COMM_CONTEXT *owner;    // channel the message came in on
+}HDDLShimCommMessage;
+
+// One outstanding request of a pipelined channel, requestId 0 marks a free slot
+typedef struct _PENDING_REQUEST
+{
+    uint32_t requestId;
+    bool done;
+    CommStatus status;
+    CommReadOp readOp;
+
+    // Caller buffer for COMM_READ_FULL, the receiver reads the reply straight into it
+    int outSize;
+    void *outPayload;
+
+    // Reply received on behalf of a COMM_READ_PARTIAL caller
+    void *message;
+    uint32_t messageSize;
+    void *remainder;
+    uint32_t remainderSize;
+
+    // Reply received on behalf of a COMM_READ_BORROW caller
+    HDDLShimCommMessage received;
+
+    pthread_cond_t cond;
+}HDDLShimPendingRequest;
+
+// Host side state to keep several requests in flight on one channel. Callers only hold the
+// transport mutex while writing, the receiver thread routes every reply to its caller.
+typedef struct _PIPELINE
+{
+    pthread_t receiverThread;
+    bool receiverStopped;
+    bool stopping;                  // Comm_PipelineStop closed the channel under the receiver
+    uint32_t nextSequence;
+    uint32_t detached;              // COMM_READ_NONE requests not answered yet
+    pthread_mutex_t pendingMutex;
+    pthread_cond_t slotCond;
+    uint32_t freeSlots[MAX_PENDING_REQUEST];   // Stack of the slots not in use
+    uint32_t freeCount;
+    HDDLShimPendingRequest pending[MAX_PENDING_REQUEST];
+}HDDLShimPipeline;
+
+// Call queued on a worker of a thread pool
+typedef struct _THREAD_POOL_TASK
+{
+    void *(*routine) (void *);
+    void *arg;
+    struct _THREAD_POOL_TASK *next;
+}HDDLShimThreadPoolTask;
+
+typedef struct _THREAD_POOL_WORKER
+{
+    pthread_t thread;
+    pthread_cond_t cond;
+    int32_t cpu;                    // Core the worker runs on, -1 if not pinned
+    HDDLShimThreadPoolTask *head;
+    HDDLShimThreadPoolTask *tail;
+    uint32_t queueDepth;            // Tasks queued on the worker, the running one included
+    uint32_t maxQueueDepth;
+    uint64_t completed;
+    struct _THREAD_POOL *pool;
+}HDDLShimThreadPoolWorker;
+
+// Fixed set of workers with a queue each. A task goes to the worker with the shortest queue,
+// a worker out of tasks takes the ones still waiting behind another worker.
+typedef struct _THREAD_POOL
+{
+    pthread_mutex_t mutex;
+    bool stopping;
+    uint32_t numWorkers;
+    HDDLShimThreadPoolWorker *workers;
+}HDDLShimThreadPool;
+
+// What the host has running on one accelerator, new displays go to the least loaded one
+typedef struct _DEVICE_LOAD
+{
+    uint32_t swDeviceId;
+    uint32_t uiNumDisplay;
+    uint32_t uiNumContext;          // VAContexts
+    uint64_t inFlightBytes;         // Sent and not answered yet
+    uint64_t latency;               // Round trip in us, moving average
+}HDDLShimDeviceLoad;
+
 typedef struct _SHIM_THREAD_PARAMS
 {
     CommMode commMode;
@@ -278,6 +646,10 @@ typedef struct _SHIM_THREAD_PARAMS
     VADisplay vaDpy;
     uint32_t vaDrmFd;
     VAProfile profile;
+    HDDLShimIdTable *idTable;
+    HDDLShimIdTable *mapTable;
+    HDDLShimIdTable *frameTable;
+    bool autoChannel;               // tx and rx were handed out by the target
 }ShimThreadParams;
 
 typedef struct _COMM_CONTEXT
@@ -286,6 +658,7 @@ typedef struct _COMM_CONTEXT
     {
         HDDLShimXLinkContext *xLinkCtx; // Ctx for XLINK comm
         HDDLShimTCPContext *tcpCtx;     // Ctx for TCP/IP comm
+        HDDLShimShmContext *shmCtx;     // Ctx for shared memory comm
         HDDLShimUniteContext *uniteCtx;
     };
     CommMode  commMode;
@@ -296,11 +669,28 @@ typedef struct _COMM_CONTEXT
     VADisplay vaDpy;
     uint32_t vaDrmFd;
     VAProfile profile;
+    HDDLShimIdTable *idTable;           // Shared by all channels of the display
+    HDDLShimIdTable *mapTable;          // Buffers kept mapped, shared like idTable
+    HDDLShimIdTable *frameTable;        // Arena of every buffer with frame data, shared too
 
     // Variables for batching operations
     bool doBatch;
     HDDLShimBatchPayload *batchPayload;
+    HDDLShimBatchPayload *batchSpare;   // Arena of the last batch, reused by the next one
     uint64_t batchThreadId;
+    HDDLShimBatchCoalesce *coalesce;
+
+    // Out of order request/response, host only
+    HDDLShimPipeline *pipeline;
+
+    // Channel pair handed out by the target, given back when the session ends
+    bool autoChannel;
+
+    // Device the channel is on, host only. NULL for TCP and SHM.
+    HDDLShimDeviceLoad *deviceLoad;
+
+    // Second channel pair for the calls moving frame data, host only
+    struct _COMM_CONTEXT *bulkCtx;
 }HDDLShimCommContext;
 
 typedef struct _HDDL_COMM_CONTEXT_ELEMENT
@@ -314,6 +704,12 @@ typedef struct _HDDL_VA_SHIM_DRIVER_CONTEXT
     // Communication context for Host and Target
     HDDLShimCommContext *mainCommCtx;
     uint16_t lastChannel;
+    uint64_t serial;                // Unique in the process, keys the per-thread comm context
+    bool bindContextChannel;        // Each VAContextID gets a channel pair of its own
+
+    // Channel pairs opened at init, handed out to new threads and contexts
+    HDDLShimCommContext **channelPool;
+    uint32_t uiChannelPoolCount;
 
     // Used for context reference count
     uint32_t uiRefCount;
@@ -325,9 +721,17 @@ typedef struct _HDDL_VA_SHIM_DRIVER_CONTEXT
     uint32_t uiNumImage;
     HDDLVAHeap *contextHeap;
     uint32_t uiNumContext;
+    uint32_t uiNumVAContext;        // Counted towards the load of the device
+
+    // Next buffer ID handed out without asking the target
+    uint32_t nextBufferId;
+
+    // HDDLVABuffer structs and their data, kept for the buffers of the next frame
+    HDDLShimBufferPool shadowPool;
 
-    // Mutex to protect shared resource among multiple context
-    pthread_mutex_t bufferMutex;
+    // Mutex to protect shared resource among multiple context. Buffer lookups share bufferLock,
+    // only adding and removing buffers takes it exclusively.
+    pthread_rwlock_t bufferLock;
     pthread_mutex_t imageMutex;
     pthread_mutex_t contextMutex;
 }HDDLVAShimDriverContext;
@@ -30,10 +30,25 @@
 
 #include "memory_manager.h"
 #include "debug_manager.h"
+#include "thread_manager.h"
 #include <sys/syscall.h>
 
 int32_t memAllocCounter = 0; // Counter to check memory leaks
 
+// Capacity of each buffer pool size class and how many free buffers it keeps around. Replies
+// such as vaSyncSurface fit the first class, surfaces and bitstreams end up in the last one,
+// which a receive pool resizes to the fragment size its channel agreed on.
+// A decoder creates a picture parameter, IQ matrix and one parameter buffer per slice every
+// frame, all of the first two classes. Shadow buffers of the last class are slice data and are
+// not recycled, their sizes vary too much to be worth a whole xlink message each.
+static const size_t gPoolClassSize[BUFFER_POOL_CLASS_COUNT] = {
+    256, 4 * 1024, 64 * 1024, DATA_MAX_SEND_SIZE
+};
+static const uint32_t gPoolClassMaxFree[BUFFER_POOL_KIND_COUNT][BUFFER_POOL_CLASS_COUNT] = {
+    { 16, 16, 8, 4 },       // BUFFER_POOL_RECEIVE
+    { 256, 64, 16, 0 }      // BUFFER_POOL_SHADOW
+};
+
 void *HDDLMemoryMgr_AllocMemory (size_t size)
 {
     void *ptr;
@@ -171,31 +186,81 @@ void HDDLMemoryMgr_FreeMemory (void *ptr)
     }
 }
 
-HDDLVABufferElement *HDDLMemoryMgr_AllocBufferHeap (HDDLVAHeap *bufferHeap)
+// Key of a comm context in the context heap index, Linux pids and tids fit 32 bits
+#define COMM_CONTEXT_KEY(pid, tid) ( ( (uint64_t)(pid) << 32) | (uint32_t)(tid))
+
+// Double the heap, or give it its first elements. Only called with no element left on the free
+// list, so no free list link points into the old heap when it moves.
+static void *HDDLMemoryMgr_GrowHeap (HDDLVAHeap *heap, uint32_t *growCount)
+{
+    void *newHeapBase;
+
+    *growCount = heap->uiElementCount ? heap->uiElementCount : HEAP_INCREMENTAL_SIZE;
+
+    newHeapBase = HDDLMemoryMgr_ReallocMemory (heap->pHeapBase,
+        (heap->uiElementCount + *growCount) * heap->uiElementSize);
+    SHIM_CHK_NULL (newHeapBase, "nullptr newheapbase", NULL);
+
+    heap->pHeapBase = newHeapBase;
+
+    return newHeapBase;
+}
+
+// Record where the element taken for id sits, or put it back if the index cannot grow
+static bool HDDLMemoryMgr_IndexElement (HDDLVAHeap *heap, uint64_t id, void *element,
+    void **nextFree)
+{
+    uint32_t position = ( (char *)element - (char *)heap->pHeapBase) / heap->uiElementSize;
+
+    if (!HDDLMemoryMgr_AddId (heap->index, id, position))
+    {
+        *nextFree = heap->pFirstFreeElement;
+        heap->pFirstFreeElement = element;
+        return false;
+    }
+
+    return true;
+}
+
+// Position of the element in use for id, or the element count if there is none
+static uint32_t HDDLMemoryMgr_FindElement (HDDLVAHeap *heap, uint64_t id)
+{
+    uint32_t position;
+
+    if (heap->index == NULL)
+    {
+        return heap->uiElementCount;
+    }
+
+    position = HDDLMemoryMgr_LookupId (heap->index, id);
+
+    return (position == VA_INVALID_ID) ? heap->uiElementCount : position;
+}
+
+HDDLVABufferElement *HDDLMemoryMgr_AllocBufferHeap (HDDLVAHeap *bufferHeap, VABufferID bufId)
 {
     HDDLVABufferElement *bufferHeapBase;
     HDDLVABufferElement *bufferElement;
+    uint32_t growCount;
     void *empty = NULL;
 
     if (bufferHeap->pFirstFreeElement == NULL)
     {
-        void *newHeapBase = HDDLMemoryMgr_ReallocMemory (bufferHeap->pHeapBase,
-            (bufferHeap->uiElementCount + HEAP_INCREMENTAL_SIZE) * sizeof (HDDLVABufferElement));
-        SHIM_CHK_NULL (newHeapBase, "nullptr newheapbase", empty);
+        bufferHeapBase = HDDLMemoryMgr_GrowHeap (bufferHeap, &growCount);
+        SHIM_CHK_NULL (bufferHeapBase, "nullptr newheapbase", empty);
 
-        bufferHeap->pHeapBase = newHeapBase;
-        bufferHeapBase = (HDDLVABufferElement *)bufferHeap->pHeapBase;
         bufferHeap->pFirstFreeElement = (void*) (&bufferHeapBase[bufferHeap->uiElementCount]);
 
-        for (int32_t i = 0; i < (HEAP_INCREMENTAL_SIZE); i++)
+        for (int32_t i = 0; i < growCount; i++)
         {
             // move to next element
             bufferElement = &bufferHeapBase[bufferHeap->uiElementCount + i];
             // set next-to-free element. Return null if last element.
-            bufferElement->pNextFree = (i == (HEAP_INCREMENTAL_SIZE - 1)) ? NULL :
+            bufferElement->pNextFree = (i == (growCount - 1)) ? NULL :
                 &bufferHeapBase[bufferHeap->uiElementCount + i + 1];
+            bufferElement->pBuf = NULL;
         }
-        bufferHeap->uiElementCount += HEAP_INCREMENTAL_SIZE; // move to next heap
+        bufferHeap->uiElementCount += growCount; // move to next heap
     }
 
     // restore address of first freed element
@@ -203,69 +268,89 @@ HDDLVABufferElement *HDDLMemoryMgr_AllocBufferHeap (HDDLVAHeap *bufferHeap)
     // move to next-to-free element
     bufferHeap->pFirstFreeElement = bufferElement->pNextFree;
 
+    if (!HDDLMemoryMgr_IndexElement (bufferHeap, bufId, bufferElement,
+        (void **)&bufferElement->pNextFree))
+    {
+        return empty;
+    }
+
     return bufferElement;
 }
 
-HDDLVAImageElement *HDDLMemoryMgr_AllocImageHeap (HDDLVAHeap *imageHeap)
+HDDLVAImageElement *HDDLMemoryMgr_AllocImageHeap (HDDLVAHeap *imageHeap, VAImageID imgId)
 {
+    HDDLVAImageElement *imageHeapBase;
     HDDLVAImageElement *imageElement;
+    uint32_t growCount;
     void *empty = NULL;
 
     if (imageHeap->pFirstFreeElement == NULL)
     {
-        void *newHeapBase = HDDLMemoryMgr_ReallocMemory (imageHeap->pHeapBase,
-            (imageHeap->uiElementCount + HEAP_INCREMENTAL_SIZE) * sizeof(HDDLVAImageElement));
-        SHIM_CHK_NULL (newHeapBase, "nullptr newheapbase", empty);
+        imageHeapBase = HDDLMemoryMgr_GrowHeap (imageHeap, &growCount);
+        SHIM_CHK_NULL (imageHeapBase, "nullptr newheapbase", empty);
 
-        imageHeap->pHeapBase = newHeapBase;
-        HDDLVAImageElement *imageHeapBase = (HDDLVAImageElement *)imageHeap->pHeapBase;
         imageHeap->pFirstFreeElement = (void*)(&imageHeapBase[imageHeap->uiElementCount]);
 
-        for (int32_t i = 0; i < (HEAP_INCREMENTAL_SIZE); i++)
+        for (int32_t i = 0; i < growCount; i++)
         {
             // select heap element with i counter
             imageElement = &imageHeapBase[imageHeap->uiElementCount + i];
             // set next-to-free heap element. if it is last element, then return null.
-            imageElement->pNextFree = (i == (HEAP_INCREMENTAL_SIZE - 1)) ? NULL :
+            imageElement->pNextFree = (i == (growCount - 1)) ? NULL :
                 &imageHeapBase[imageHeap->uiElementCount + i + 1];
+            imageElement->pImage = NULL;
         }
-        imageHeap->uiElementCount += HEAP_INCREMENTAL_SIZE;
+        imageHeap->uiElementCount += growCount;
     }
 
     // restore address of first heap element which freed
     imageElement = (HDDLVAImageElement *)imageHeap->pFirstFreeElement;
     // clear the saved address
     imageHeap->pFirstFreeElement = imageElement->pNextFree;
+
+    if (!HDDLMemoryMgr_IndexElement (imageHeap, imgId, imageElement,
+        (void **)&imageElement->pNextFree))
+    {
+        return empty;
+    }
+
     return imageElement;
 }
 
-HDDLCommContextElement *HDDLMemoryMgr_AllocCommContextHeap (HDDLVAHeap *contextHeap)
+HDDLCommContextElement *HDDLMemoryMgr_AllocCommContextHeap (HDDLVAHeap *contextHeap, uint64_t pid,
+    uint64_t tid)
 {
+    HDDLCommContextElement *ctxHeapBase;
     HDDLCommContextElement *commCtxElement;
+    uint32_t growCount;
     void *empty = NULL;
 
     if (contextHeap->pFirstFreeElement == NULL)
     {
-        void *newHeapBase = HDDLMemoryMgr_ReallocMemory (contextHeap->pHeapBase,
-            (contextHeap->uiElementCount + HEAP_INCREMENTAL_SIZE) * sizeof (HDDLCommContextElement));
-        SHIM_CHK_NULL (newHeapBase, "nullptr newheapbase", empty);
+        ctxHeapBase = HDDLMemoryMgr_GrowHeap (contextHeap, &growCount);
+        SHIM_CHK_NULL (ctxHeapBase, "nullptr newheapbase", empty);
 
-        contextHeap->pHeapBase = newHeapBase;
-        HDDLCommContextElement *ctxHeapBase = (HDDLCommContextElement *)contextHeap->pHeapBase;
         contextHeap->pFirstFreeElement = (void *) (&ctxHeapBase[contextHeap->uiElementCount]);
 
-        for (int32_t i = 0; i < HEAP_INCREMENTAL_SIZE; i++)
+        for (int32_t i = 0; i < growCount; i++)
         {
             commCtxElement = &ctxHeapBase[contextHeap->uiElementCount + i];
-            commCtxElement->pNextFree = (i == (HEAP_INCREMENTAL_SIZE - 1)) ? NULL :
+            commCtxElement->pNextFree = (i == (growCount - 1)) ? NULL :
                 &ctxHeapBase[contextHeap->uiElementCount + i + 1];
             commCtxElement->pCommContext = NULL;
         }
-        contextHeap->uiElementCount += HEAP_INCREMENTAL_SIZE;
+        contextHeap->uiElementCount += growCount;
     }
 
     commCtxElement = (HDDLCommContextElement *)contextHeap->pFirstFreeElement;
     contextHeap->pFirstFreeElement = commCtxElement->pNextFree;
+
+    if (!HDDLMemoryMgr_IndexElement (contextHeap, COMM_CONTEXT_KEY (pid, tid), commCtxElement,
+        (void **)&commCtxElement->pNextFree))
+    {
+        return empty;
+    }
+
     return commCtxElement;
 }
 
@@ -281,6 +366,8 @@ void HDDLMemoryMgr_ReleaseBufferElement (HDDLVAHeap *bufferHeap, uint32_t buffer
     bufferElement = &bufferHeapBase[bufferId];
     SHIM_CHK_NULL (bufferElement->pBuf, "buffer is already released", );
 
+    HDDLMemoryMgr_RemoveId (bufferHeap->index, bufferElement->pBuf->bufId);
+
     firstFree = bufferHeap->pFirstFreeElement;
     bufferHeap->pFirstFreeElement = (void*)bufferElement;
     bufferElement->pNextFree = (HDDLVABufferElement *)firstFree;
@@ -299,6 +386,8 @@ void HDDLMemoryMgr_ReleaseImageElement (HDDLVAHeap *imageHeap, uint32_t imageId)
     imageElement = &imageHeapBase[imageId];
     SHIM_CHK_NULL (imageElement->pImage, "Image already released", );
 
+    HDDLMemoryMgr_RemoveId (imageHeap->index, imageElement->pImage->image_id);
+
     firstFree = imageHeap->pFirstFreeElement;
     imageHeap->pFirstFreeElement = (void*)imageElement;
     imageElement->pNextFree = (HDDLVAImageElement *)firstFree;
@@ -309,6 +398,7 @@ void HDDLMemoryMgr_ReleaseCommContextElement (HDDLVAHeap *contextHeap, uint32_t
 {
     HDDLCommContextElement *commCtxHeapBase = (HDDLCommContextElement *)contextHeap->pHeapBase;
     HDDLCommContextElement *commCtxElement;
+    HDDLShimCommContext *commCtx;
     void *firstFree;
 
     SHIM_CHK_LESS (commCtxId, contextHeap->uiElementCount, "Invalid context ID", );
@@ -317,6 +407,9 @@ void HDDLMemoryMgr_ReleaseCommContextElement (HDDLVAHeap *contextHeap, uint32_t
     commCtxElement = &commCtxHeapBase[commCtxId];
     SHIM_CHK_NULL (commCtxElement->pCommContext, "Context already released", );
 
+    commCtx = commCtxElement->pCommContext;
+    HDDLMemoryMgr_RemoveId (contextHeap->index, COMM_CONTEXT_KEY (commCtx->pid, commCtx->tid));
+
     firstFree = contextHeap->pFirstFreeElement;
     contextHeap->pFirstFreeElement = (void *)commCtxElement;
     commCtxElement->pNextFree = (HDDLCommContextElement *)firstFree;
@@ -326,79 +419,49 @@ void HDDLMemoryMgr_ReleaseCommContextElement (HDDLVAHeap *contextHeap, uint32_t
 HDDLVABuffer *HDDLMemoryMgr_GetBufferFromVABufferID (HDDLVAShimDriverContext *ctx,
     VABufferID bufId, uint32_t *hostBufId)
 {
-    HDDLVABufferElement *bufferElement;
-    HDDLVABuffer *buffer = NULL;
-    uint32_t elementCount = ctx->bufferHeap->uiElementCount;
-    void *empty = NULL;
-
-    bufferElement = (HDDLVABufferElement *)ctx->bufferHeap->pHeapBase;
-    SHIM_CHK_NULL (bufferElement, "nullptr bufferElement", empty);
+    HDDLVAHeap *bufferHeap = ctx->bufferHeap;
+    uint32_t position = HDDLMemoryMgr_FindElement (bufferHeap, bufId);
 
-    // FIXME: will implement better search mechanism
-    for (int i = 0; i < elementCount; i++)
+    if (position == bufferHeap->uiElementCount)
     {
-        buffer = bufferElement[i].pBuf;
-        if (buffer && (buffer->bufId == bufId))
-        {
-            *hostBufId = i; // return host's bufferId
-            return buffer;
-        }
+        return NULL;
     }
 
-    return buffer;
+    *hostBufId = position; // return host's bufferId
+
+    return ( (HDDLVABufferElement *)bufferHeap->pHeapBase)[position].pBuf;
 }
 
 VAImage *HDDLMemoryMgr_GetVAImageFromVAImageID (HDDLVAShimDriverContext *ctx,
     VAImageID imgId, uint32_t *hostImgId)
 {
-    HDDLVAImageElement *imageElement;
-    VAImage *vaImage = NULL;
-    uint32_t elementCount = ctx->imageHeap->uiElementCount;
-    void *empty = NULL;
+    HDDLVAHeap *imageHeap = ctx->imageHeap;
+    uint32_t position = HDDLMemoryMgr_FindElement (imageHeap, imgId);
 
-    imageElement = (HDDLVAImageElement *)ctx->imageHeap->pHeapBase;
-    SHIM_CHK_NULL (imageElement, "nullptr imageElement", empty);
-
-    // FIXME: will implement better search mechanism
-    for (int i = 0; i < elementCount; i++)
+    if (position == imageHeap->uiElementCount)
     {
-        vaImage = imageElement[i].pImage;
-        if (vaImage && (vaImage->image_id == imgId))
-        {
-            *hostImgId = i; // return host's imageId
-            return vaImage;
-        }
+        return NULL;
     }
 
-    return vaImage;
+    *hostImgId = position; // return host's imageId
+
+    return ( (HDDLVAImageElement *)imageHeap->pHeapBase)[position].pImage;
 }
 
 HDDLShimCommContext *HDDLMemoryMgr_GetCommContext (HDDLVAShimDriverContext *ctx, uint64_t pid,
     uint64_t tid, uint32_t *commCtxId)
 {
-    HDDLCommContextElement *commCtxElement;
-    HDDLShimCommContext *commCtx = NULL;
-    uint32_t elementCount = ctx->contextHeap->uiElementCount;
-    void *empty = NULL;
-
-    commCtxElement = (HDDLCommContextElement *)ctx->contextHeap->pHeapBase;
-    SHIM_CHK_NULL (commCtxElement, "nullptr commCtxElement", empty);
+    HDDLVAHeap *contextHeap = ctx->contextHeap;
+    uint32_t position = HDDLMemoryMgr_FindElement (contextHeap, COMM_CONTEXT_KEY (pid, tid));
 
-    for (int i = 0; i < elementCount; i++)
+    if (position == contextHeap->uiElementCount)
     {
-        commCtx = commCtxElement[i].pCommContext;
-
-        if (commCtx)
-        {
-            if ( (commCtx->pid == pid) && (commCtx->tid == tid))
-            {
-                *commCtxId = i;
-                return commCtx;
-            }
-        }
+        return NULL;
     }
 
-    return commCtx;
+    *commCtxId = position;
+
+    return ( (HDDLCommContextElement *)contextHeap->pHeapBase)[position].pCommContext;
 }
 
 void *HDDLMemoryMgr_LockBuffer (HDDLVABuffer *buf)
@@ -445,4 +508,530 @@ void *HDDLMemoryMgr_Memcpy (void *destBuf, const void *srcBuf, size_t destSize,
 
     return memcpy (destBuf, srcBuf, srcSize);
 }
+
+int HDDLMemoryMgr_PoolClassOf (HDDLShimBufferPool *pool, size_t size)
+{
+    int index = 0;
+
+    while (index < BUFFER_POOL_CLASS_COUNT && pool->classSize[index] < size)
+    {
+        index++;
+    }
+
+    return index;
+}
+
+void HDDLMemoryMgr_InitBufferPool (HDDLShimBufferPool *pool, HDDLShimBufferPoolKind kind)
+{
+    for (int i = 0; i < BUFFER_POOL_CLASS_COUNT; i++)
+    {
+        pool->sizeClass[i].pFirstFree = NULL;
+        pool->sizeClass[i].freeCount = 0;
+        pool->classSize[i] = gPoolClassSize[i];
+    }
+
+    pool->kind = kind;
+    HDDLThreadMgr_InitMutex (&pool->poolMutex);
+}
+
+void *HDDLMemoryMgr_PoolAlloc (HDDLShimBufferPool *pool, size_t size)
+{
+    HDDLShimBufferClass *sizeClass;
+    void *ptr = NULL;
+    int index = HDDLMemoryMgr_PoolClassOf (pool, size);
+
+    if (index == BUFFER_POOL_CLASS_COUNT || gPoolClassMaxFree[pool->kind][index] == 0)
+    {
+        return HDDLMemoryMgr_AllocMemory (size);
+    }
+
+    sizeClass = &pool->sizeClass[index];
+
+    HDDLThreadMgr_LockMutex (&pool->poolMutex);
+
+    if (sizeClass->pFirstFree != NULL)
+    {
+        ptr = sizeClass->pFirstFree;
+        sizeClass->pFirstFree = *(void **)ptr;
+        sizeClass->freeCount--;
+    }
+
+    HDDLThreadMgr_UnlockMutex (&pool->poolMutex);
+
+    if (ptr == NULL)
+    {
+        ptr = HDDLMemoryMgr_AllocMemory (pool->classSize[index]);
+    }
+
+    return ptr;
+}
+
+void HDDLMemoryMgr_PoolRelease (HDDLShimBufferPool *pool, void *ptr, size_t size)
+{
+    HDDLShimBufferClass *sizeClass;
+    int index = HDDLMemoryMgr_PoolClassOf (pool, size);
+
+    if (ptr == NULL)
+    {
+        return;
+    }
+
+    if (index == BUFFER_POOL_CLASS_COUNT || gPoolClassMaxFree[pool->kind][index] == 0)
+    {
+        HDDLMemoryMgr_FreeMemory (ptr);
+        return;
+    }
+
+    sizeClass = &pool->sizeClass[index];
+
+    HDDLThreadMgr_LockMutex (&pool->poolMutex);
+
+    if (sizeClass->freeCount < gPoolClassMaxFree[pool->kind][index])
+    {
+        *(void **)ptr = sizeClass->pFirstFree;
+        sizeClass->pFirstFree = ptr;
+        sizeClass->freeCount++;
+        ptr = NULL;
+    }
+
+    HDDLThreadMgr_UnlockMutex (&pool->poolMutex);
+
+    HDDLMemoryMgr_FreeMemory (ptr);
+}
+
+void HDDLMemoryMgr_ResizeLargestPoolClass (HDDLShimBufferPool *pool, size_t size)
+{
+    HDDLShimBufferClass *sizeClass = &pool->sizeClass[BUFFER_POOL_CLASS_COUNT - 1];
+    void *ptr;
+
+    // Never below the class before it, sizes must keep growing from class to class
+    if (size < pool->classSize[BUFFER_POOL_CLASS_COUNT - 2])
+    {
+        size = pool->classSize[BUFFER_POOL_CLASS_COUNT - 2];
+    }
+
+    HDDLThreadMgr_LockMutex (&pool->poolMutex);
+
+    // Buffers kept so far have the old capacity
+    if (pool->classSize[BUFFER_POOL_CLASS_COUNT - 1] != size)
+    {
+        while (sizeClass->pFirstFree != NULL)
+        {
+            ptr = sizeClass->pFirstFree;
+            sizeClass->pFirstFree = *(void **)ptr;
+            HDDLMemoryMgr_FreeMemory (ptr);
+        }
+
+        sizeClass->freeCount = 0;
+        pool->classSize[BUFFER_POOL_CLASS_COUNT - 1] = size;
+    }
+
+    HDDLThreadMgr_UnlockMutex (&pool->poolMutex);
+}
+
+void HDDLMemoryMgr_FlushBufferPool (HDDLShimBufferPool *pool)
+{
+    void *ptr;
+
+    HDDLThreadMgr_LockMutex (&pool->poolMutex);
+
+    for (int i = 0; i < BUFFER_POOL_CLASS_COUNT; i++)
+    {
+        while (pool->sizeClass[i].pFirstFree != NULL)
+        {
+            ptr = pool->sizeClass[i].pFirstFree;
+            pool->sizeClass[i].pFirstFree = *(void **)ptr;
+            HDDLMemoryMgr_FreeMemory (ptr);
+        }
+
+        pool->sizeClass[i].freeCount = 0;
+    }
+
+    HDDLThreadMgr_UnlockMutex (&pool->poolMutex);
+}
+
+void HDDLMemoryMgr_DestroyBufferPool (HDDLShimBufferPool *pool)
+{
+    HDDLMemoryMgr_FlushBufferPool (pool);
+    HDDLThreadMgr_DestroyMutex (&pool->poolMutex);
+}
+
+HDDLShimArena *HDDLMemoryMgr_CreateArena (size_t capacity)
+{
+    HDDLShimArena *arena = HDDLMemoryMgr_AllocAndZeroMemory (sizeof (HDDLShimArena));
+    SHIM_CHK_NULL (arena, "Failed to allocate arena", NULL);
+
+    if (capacity > 0)
+    {
+        arena->block = HDDLMemoryMgr_AllocMemory (capacity);
+        if (arena->block == NULL)
+        {
+            HDDLMemoryMgr_FreeMemory (arena);
+            return NULL;
+        }
+
+        arena->capacity = capacity;
+        arena->minCapacity = capacity;
+    }
+
+    return arena;
+}
+
+// Replaces the block, keeping the old one if there is no memory for the new one
+static void HDDLMemoryMgr_ResizeArena (HDDLShimArena *arena, size_t capacity)
+{
+    uint8_t *block = NULL;
+
+    if (capacity > 0)
+    {
+        block = HDDLMemoryMgr_AllocMemory (capacity);
+        if (block == NULL)
+        {
+            return;
+        }
+    }
+
+    HDDLMemoryMgr_FreeMemory (arena->block);
+    arena->block = block;
+    arena->capacity = capacity;
+    arena->peak = 0;
+    arena->resets = 0;
+}
+
+void *HDDLMemoryMgr_ArenaAlloc (HDDLShimArena *arena, size_t size)
+{
+    HDDLShimArenaChunk *chunk;
+    void *ptr;
+
+    SHIM_CHK_NULL (arena, "nullptr arena", NULL);
+
+    size = (size + ARENA_ALIGNMENT - 1) & ~ (size_t) (ARENA_ALIGNMENT - 1);
+    arena->demand += size;
+
+    if (arena->capacity - arena->used >= size)
+    {
+        ptr = arena->block + arena->used;
+        arena->used += size;
+        return ptr;
+    }
+
+    // The chunk header takes a whole alignment unit so that the memory after it stays aligned
+    chunk = HDDLMemoryMgr_AllocMemory (ARENA_ALIGNMENT + size);
+    SHIM_CHK_NULL (chunk, "Failed to allocate arena chunk", NULL);
+
+    chunk->next = arena->overflow;
+    arena->overflow = chunk;
+
+    return (uint8_t *)chunk + ARENA_ALIGNMENT;
+}
+
+void HDDLMemoryMgr_ResetArena (HDDLShimArena *arena)
+{
+    HDDLShimArenaChunk *chunk;
+    size_t capacity;
+
+    while (arena->overflow != NULL)
+    {
+        chunk = arena->overflow;
+        arena->overflow = chunk->next;
+        HDDLMemoryMgr_FreeMemory (chunk);
+    }
+
+    if (arena->demand > arena->peak)
+    {
+        arena->peak = arena->demand;
+    }
+
+    // Grow to what was asked for this time, the odd huge reply is left to the heap
+    if (arena->demand > arena->capacity && arena->demand <= ARENA_MAX_BLOCK_SIZE)
+    {
+        capacity = arena->capacity > 0 ? arena->capacity : ARENA_ALIGNMENT;
+        while (capacity < arena->demand)
+        {
+            capacity *= 2;
+        }
+
+        HDDLMemoryMgr_ResizeArena (arena, capacity);
+    }
+    // Once the large messages are over the thread would keep the block for good otherwise
+    else if (++arena->resets >= ARENA_SHRINK_RESETS)
+    {
+        if (arena->capacity > arena->minCapacity && arena->peak <= arena->capacity / 4)
+        {
+            capacity = arena->minCapacity;
+            if (capacity < arena->peak)
+            {
+                capacity = capacity > 0 ? capacity : ARENA_ALIGNMENT;
+                while (capacity < arena->peak)
+                {
+                    capacity *= 2;
+                }
+            }
+
+            HDDLMemoryMgr_ResizeArena (arena, capacity);
+        }
+        else
+        {
+            arena->peak = 0;
+            arena->resets = 0;
+        }
+    }
+
+    arena->used = 0;
+    arena->demand = 0;
+}
+
+void HDDLMemoryMgr_DestroyArena (HDDLShimArena *arena)
+{
+    if (arena == NULL)
+    {
+        return;
+    }
+
+    HDDLMemoryMgr_ResetArena (arena);
+    HDDLMemoryMgr_FreeMemory (arena->block);
+    HDDLMemoryMgr_FreeMemory (arena);
+}
+
+// Spread the keys over the table, host buffer IDs and tids only differ in their low bits
+static uint32_t HDDLMemoryMgr_IdTableHome (HDDLShimIdTable *table, uint64_t key)
+{
+    return (uint32_t) ( (key * 0x9E3779B97F4A7C15ULL) >> 32) & (table->capacity - 1);
+}
+
+static HDDLShimIdEntry *HDDLMemoryMgr_IdTableSlot (HDDLShimIdTable *table, uint64_t key)
+{
+    uint32_t mask = table->capacity - 1;
+    uint32_t slot = HDDLMemoryMgr_IdTableHome (table, key);
+
+    while (table->entries[slot].used && table->entries[slot].key != key)
+    {
+        slot = (slot + 1) & mask;
+    }
+
+    return &table->entries[slot];
+}
+
+static bool HDDLMemoryMgr_GrowIdTable (HDDLShimIdTable *table)
+{
+    HDDLShimIdEntry *entries = table->entries;
+    uint32_t capacity = table->capacity;
+
+    table->entries = HDDLMemoryMgr_AllocAndZeroMemory (capacity * 2 * sizeof (HDDLShimIdEntry));
+    if (table->entries == NULL)
+    {
+        table->entries = entries;
+        return false;
+    }
+
+    table->capacity = capacity * 2;
+
+    for (uint32_t i = 0; i < capacity; i++)
+    {
+        if (entries[i].used)
+        {
+            *HDDLMemoryMgr_IdTableSlot (table, entries[i].key) = entries[i];
+        }
+    }
+
+    HDDLMemoryMgr_FreeMemory (entries);
+
+    return true;
+}
+
+HDDLShimIdTable *HDDLMemoryMgr_CreateIdTable ()
+{
+    HDDLShimIdTable *table = HDDLMemoryMgr_AllocAndZeroMemory (sizeof (HDDLShimIdTable));
+    SHIM_CHK_NULL (table, "Failed to allocate ID table", NULL);
+
+    table->entries = HDDLMemoryMgr_AllocAndZeroMemory (
+        ID_TABLE_INITIAL_SIZE * sizeof (HDDLShimIdEntry));
+    if (table->entries == NULL)
+    {
+        SHIM_ERROR_MESSAGE ("Failed to allocate ID table entries");
+        HDDLMemoryMgr_FreeMemory (table);
+        return NULL;
+    }
+
+    table->capacity = ID_TABLE_INITIAL_SIZE;
+    HDDLThreadMgr_InitMutex (&table->tableMutex);
+
+    return table;
+}
+
+void HDDLMemoryMgr_DestroyIdTable (HDDLShimIdTable *table)
+{
+    if (table == NULL)
+    {
+        return;
+    }
+
+    HDDLThreadMgr_DestroyMutex (&table->tableMutex);
+    HDDLMemoryMgr_FreeMemory (table->entries);
+    HDDLMemoryMgr_FreeMemory (table);
+}
+
+// Slot recording key from now on, NULL if the table could not grow. Called with the table locked.
+static HDDLShimIdEntry *HDDLMemoryMgr_ClaimIdSlot (HDDLShimIdTable *table, uint64_t key)
+{
+    HDDLShimIdEntry *entry;
+
+    // Keep at least a quarter of the slots free so that lookups stay short
+    if ( (table->count + 1) * 4 > table->capacity * 3 && !HDDLMemoryMgr_GrowIdTable (table))
+    {
+        return NULL;
+    }
+
+    entry = HDDLMemoryMgr_IdTableSlot (table, key);
+    if (!entry->used)
+    {
+        table->count++;
+    }
+
+    entry->key = key;
+    entry->used = true;
+
+    return entry;
+}
+
+bool HDDLMemoryMgr_AddId (HDDLShimIdTable *table, uint64_t key, uint32_t value)
+{
+    HDDLShimIdEntry *entry;
+
+    SHIM_CHK_NULL (table, "nullptr ID table", false);
+
+    HDDLThreadMgr_LockMutex (&table->tableMutex);
+
+    entry = HDDLMemoryMgr_ClaimIdSlot (table, key);
+    if (entry != NULL)
+    {
+        entry->value = value;
+    }
+
+    HDDLThreadMgr_UnlockMutex (&table->tableMutex);
+
+    return entry != NULL;
+}
+
+uint32_t HDDLMemoryMgr_LookupId (HDDLShimIdTable *table, uint64_t key)
+{
+    HDDLShimIdEntry *entry;
+    uint32_t value = VA_INVALID_ID;
+
+    HDDLThreadMgr_LockMutex (&table->tableMutex);
+
+    entry = HDDLMemoryMgr_IdTableSlot (table, key);
+    if (entry->used)
+    {
+        value = entry->value;
+    }
+
+    HDDLThreadMgr_UnlockMutex (&table->tableMutex);
+
+    return value;
+}
+
+bool HDDLMemoryMgr_AddIdPointer (HDDLShimIdTable *table, uint64_t key, void *pointer)
+{
+    HDDLShimIdEntry *entry;
+
+    SHIM_CHK_NULL (table, "nullptr ID table", false);
+
+    HDDLThreadMgr_LockMutex (&table->tableMutex);
+
+    entry = HDDLMemoryMgr_ClaimIdSlot (table, key);
+    if (entry != NULL)
+    {
+        entry->pointer = pointer;
+    }
+
+    HDDLThreadMgr_UnlockMutex (&table->tableMutex);
+
+    return entry != NULL;
+}
+
+void *HDDLMemoryMgr_LookupIdPointer (HDDLShimIdTable *table, uint64_t key)
+{
+    HDDLShimIdEntry *entry;
+    void *pointer = NULL;
+
+    HDDLThreadMgr_LockMutex (&table->tableMutex);
+
+    entry = HDDLMemoryMgr_IdTableSlot (table, key);
+    if (entry->used)
+    {
+        pointer = entry->pointer;
+    }
+
+    HDDLThreadMgr_UnlockMutex (&table->tableMutex);
+
+    return pointer;
+}
+
+void HDDLMemoryMgr_RemoveId (HDDLShimIdTable *table, uint64_t key)
+{
+    uint32_t mask;
+    uint32_t hole;
+    uint32_t slot;
+    uint32_t home;
+    HDDLShimIdEntry *entry;
+
+    if (table == NULL)
+    {
+        return;
+    }
+
+    HDDLThreadMgr_LockMutex (&table->tableMutex);
+
+    entry = HDDLMemoryMgr_IdTableSlot (table, key);
+    if (!entry->used)
+    {
+        HDDLThreadMgr_UnlockMutex (&table->tableMutex);
+        return;
+    }
+
+    entry->used = false;
+    table->count--;
+
+    // Move later entries of the probe run back into the hole so that none gets cut off
+    mask = table->capacity - 1;
+    hole = entry - table->entries;
+    slot = (hole + 1) & mask;
+
+    while (table->entries[slot].used)
+    {
+        home = HDDLMemoryMgr_IdTableHome (table, table->entries[slot].key);
+
+        if ( ( (slot - home) & mask) >= ( (slot - hole) & mask))
+        {
+            table->entries[hole] = table->entries[slot];
+            table->entries[slot].used = false;
+            hole = slot;
+        }
+
+        slot = (slot + 1) & mask;
+    }
+
+    HDDLThreadMgr_UnlockMutex (&table->tableMutex);
+}
+
+void HDDLMemoryMgr_ReleaseIdPointers (HDDLShimIdTable *table, void (*release) (void *pointer))
+{
+    if (table == NULL)
+    {
+        return;
+    }
+
+    HDDLThreadMgr_LockMutex (&table->tableMutex);
+
+    for (uint32_t i = 0; i < table->capacity; i++)
+    {
+        if (table->entries[i].used)
+        {
+            release (table->entries[i].pointer);
+        }
+    }
+
+    HDDLThreadMgr_UnlockMutex (&table->tableMutex);
+}
 //EOF
@@ -83,26 +83,28 @@ void  HDDLMemoryMgr_FillMemory (void *destination, size_t length, uint8_t fill);
 void  HDDLMemoryMgr_FreeMemory (void *ptr);
 
 //!
-//! \brief   Allocate memory & unique ID for each buffer heap element
+//! \brief   Allocate memory & unique ID for each buffer heap element, indexed by bufId
 //! \return  HDDLVABufferElement *
 //!          Return pointer if success, else NULL
 //!
-HDDLVABufferElement *HDDLMemoryMgr_AllocBufferHeap (HDDLVAHeap *bufferHeap);
+HDDLVABufferElement *HDDLMemoryMgr_AllocBufferHeap (HDDLVAHeap *bufferHeap, VABufferID bufId);
 
 //!
-//! \brief   Allocate memory & unique ID for each image heap element
+//! \brief   Allocate memory & unique ID for each image heap element, indexed by imgId
 //! \return  HDDLVAImageElement *
 //!          Return pointer if success, else NULL
 //!
-HDDLVAImageElement  *HDDLMemoryMgr_AllocImageHeap (HDDLVAHeap *imageHeap);
+HDDLVAImageElement  *HDDLMemoryMgr_AllocImageHeap (HDDLVAHeap *imageHeap, VAImageID imgId);
 
 
 //!
-//! \brief   Allocate memory & unique ID for each comm context heap element
+//! \brief   Allocate memory & unique ID for each comm context heap element, indexed by
+//!          pid and tid
 //! \return  HDDLCommContextElement *
 //!          Return pointer if success, else NULL
 //!
-HDDLCommContextElement *HDDLMemoryMgr_AllocCommContextHeap (HDDLVAHeap *contextHeap);
+HDDLCommContextElement *HDDLMemoryMgr_AllocCommContextHeap (HDDLVAHeap *contextHeap, uint64_t pid,
+    uint64_t tid);
 
 //!
 //! \brief   Release buffer element referring to Host VABufferID
@@ -175,6 +177,147 @@ void HDDLMemoryMgr_UnlockBuffer (HDDLVABuffer *buf);
 //!
 void *HDDLMemoryMgr_Memcpy (void *destBuf, const void *srcBuf, size_t destSize,
     size_t srcSize);
+
+// Buffer pool. Pool buffers are ordinary HDDLMemoryMgr_AllocMemory blocks, so freeing one with
+// HDDLMemoryMgr_FreeMemory is always allowed, it is just not recycled then. Recycled buffers
+// are not zeroed.
+
+//!
+//! \brief   Initialize an empty buffer pool of the given kind
+//! \return  void
+//!          Return nothing
+//!
+void HDDLMemoryMgr_InitBufferPool (HDDLShimBufferPool *pool, HDDLShimBufferPoolKind kind);
+
+//!
+//! \brief   Size class a buffer of size bytes belongs to
+//! \return  int
+//!          Return the class index, BUFFER_POOL_CLASS_COUNT if size is beyond the largest class
+//!
+int HDDLMemoryMgr_PoolClassOf (HDDLShimBufferPool *pool, size_t size);
+
+//!
+//! \brief   Let the largest size class of the pool hold buffers of size bytes, dropping the
+//!          buffers it kept so far if their capacity changes
+//! \return  void
+//!          Return nothing
+//!
+void HDDLMemoryMgr_ResizeLargestPoolClass (HDDLShimBufferPool *pool, size_t size);
+
+//!
+//! \brief   Take a buffer of at least size bytes from the pool, allocating one if the size
+//!          class has none left. Sizes beyond the largest class, or of a class the pool kind
+//!          does not recycle, are plainly allocated.
+//! \return  void *
+//!          Return pointer if success, else NULL
+//!
+void *HDDLMemoryMgr_PoolAlloc (HDDLShimBufferPool *pool, size_t size);
+
+//!
+//! \brief   Give a buffer back to the pool. size must be the one it was taken for, buffers
+//!          beyond the largest class or above the free limit of their class are freed.
+//! \return  void
+//!          Return nothing
+//!
+void HDDLMemoryMgr_PoolRelease (HDDLShimBufferPool *pool, void *ptr, size_t size);
+
+//!
+//! \brief   Free every buffer kept in the pool, the pool stays usable
+//! \return  void
+//!          Return nothing
+//!
+void HDDLMemoryMgr_FlushBufferPool (HDDLShimBufferPool *pool);
+
+//!
+//! \brief   Free every buffer kept in the pool and release the pool lock
+//! \return  void
+//!          Return nothing
+//!
+void HDDLMemoryMgr_DestroyBufferPool (HDDLShimBufferPool *pool);
+
+//!
+//! \brief   Create an arena with a block of capacity bytes, capacity may be 0
+//! \return  HDDLShimArena *
+//!          Return pointer if success, else NULL
+//!
+HDDLShimArena *HDDLMemoryMgr_CreateArena (size_t capacity);
+
+//!
+//! \brief   Allocate from an arena, the memory lives until the arena is reset
+//! \return  void *
+//!          Return pointer if success, else NULL
+//!
+void *HDDLMemoryMgr_ArenaAlloc (HDDLShimArena *arena, size_t size);
+
+//!
+//! \brief   Release everything allocated from an arena
+//! \return  void
+//!          Return nothing
+//!
+void HDDLMemoryMgr_ResetArena (HDDLShimArena *arena);
+
+//!
+//! \brief   Free an arena and everything allocated from it, arena may be NULL
+//! \return  void
+//!          Return nothing
+//!
+void HDDLMemoryMgr_DestroyArena (HDDLShimArena *arena);
+
+//!
+//! \brief   Create an empty table of IDs, used for host buffer IDs and heap indexes
+//! \return  HDDLShimIdTable *
+//!          Return pointer if success, else NULL
+//!
+HDDLShimIdTable *HDDLMemoryMgr_CreateIdTable ();
+
+//!
+//! \brief   Free an ID table, table may be NULL
+//! \return  void
+//!          Return nothing
+//!
+void HDDLMemoryMgr_DestroyIdTable (HDDLShimIdTable *table);
+
+//!
+//! \brief   Record the value a key stands for, replacing any earlier value
+//! \return  bool
+//!          Return true if success, else false
+//!
+bool HDDLMemoryMgr_AddId (HDDLShimIdTable *table, uint64_t key, uint32_t value);
+
+//!
+//! \brief   Value a key stands for
+//! \return  uint32_t
+//!          Return the value, VA_INVALID_ID if key is unknown
+//!
+uint32_t HDDLMemoryMgr_LookupId (HDDLShimIdTable *table, uint64_t key);
+
+//!
+//! \brief   Record the pointer a key stands for, replacing any earlier pointer
+//! \return  bool
+//!          Return true if success, else false
+//!
+bool HDDLMemoryMgr_AddIdPointer (HDDLShimIdTable *table, uint64_t key, void *pointer);
+
+//!
+//! \brief   Pointer a key stands for
+//! \return  void *
+//!          Return the pointer, NULL if key is unknown
+//!
+void *HDDLMemoryMgr_LookupIdPointer (HDDLShimIdTable *table, uint64_t key);
+
+//!
+//! \brief   Forget a key
+//! \return  void
+//!          Return nothing
+//!
+void HDDLMemoryMgr_RemoveId (HDDLShimIdTable *table, uint64_t key);
+
+//!
+//! \brief   Call release on the pointer of every key, table may be NULL
+//! \return  void
+//!          Return nothing
+//!
+void HDDLMemoryMgr_ReleaseIdPointers (HDDLShimIdTable *table, void (*release) (void *pointer));
 #endif
 
 //EOF
@@ -0,0 +1,815 @@
+/*
+ * Copyright (c) 2019 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+//!
+//! \file    shm.c
+//! \brief   Communcation interface for shared memory communication
+//! \details Provide shared memory communication for a target shim running on the same
+//!          machine as the host driver. Host creates a memfd holding one control page and
+//!          two single producer single consumer byte rings, one per direction, and hands it
+//!          over to the target through an abstract unix socket named after the channel pair.
+//!          Each ring is mapped twice back to back so any slot up to the ring size is
+//!          virtually contiguous. Readers and writers sleep on futex doorbells in the control
+//!          page, the unix socket is kept open only to find out when the peer is gone.
+//!
+
+#include "shm.h"
+#include "debug_manager.h"
+#include <limits.h>
+#include <poll.h>
+#include <stddef.h>
+#include <sys/un.h>
+#include <linux/futex.h>
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+#define SHM_MAGIC 0x4d485348
+#define SHM_HOST_TO_TARGET 0
+#define SHM_TARGET_TO_HOST 1
+#define SHM_RING_COUNT 2
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t ringSize;
+    HDDLShimShmRing ring[SHM_RING_COUNT];
+}HDDLShimShmControl;
+
+static void Shm_CloseFd (int *fd)
+{
+    if (*fd >= 0)
+    {
+        close (*fd);
+        *fd = -1;
+    }
+}
+
+static size_t Shm_ControlSize ()
+{
+    size_t pageSize = (size_t)sysconf (_SC_PAGESIZE);
+
+    return (sizeof (HDDLShimShmControl) + pageSize - 1) & ~(pageSize - 1);
+}
+
+// Ring size has to be a power of two for the free running head/tail counters, it can be
+// tuned with BYPASS_SHM_RING_SIZE in MB on host side
+static uint32_t Shm_GetRingSize ()
+{
+    char *ringSizeEnv = getenv ("BYPASS_SHM_RING_SIZE");
+    uint32_t ringSize = SHM_RING_SIZE;
+    uint32_t size = 1024 * 1024;
+
+    if (ringSizeEnv && atoi (ringSizeEnv) > 0 && atoi (ringSizeEnv) <= 1024)
+    {
+        while (size < (uint32_t)atoi (ringSizeEnv) * 1024 * 1024)
+        {
+            size <<= 1;
+        }
+
+        ringSize = size;
+    }
+
+    return ringSize;
+}
+
+// Both sides name the socket after the host TX/RX channel pair
+static socklen_t Shm_SocketAddress (HDDLShimShmContext *shmCtx, struct sockaddr_un *address)
+{
+    uint16_t hostTX = (shmCtx->flag == HOST) ? shmCtx->channelTX : shmCtx->channelRX;
+    uint16_t hostRX = (shmCtx->flag == HOST) ? shmCtx->channelRX : shmCtx->channelTX;
+    int nameLength;
+
+    HDDLMemoryMgr_ZeroMemory (address, sizeof (struct sockaddr_un));
+    address->sun_family = AF_UNIX;
+
+    // Leading '\0' puts the socket in the abstract namespace, nothing is left behind in
+    // the file system when either side dies
+    nameLength = snprintf (address->sun_path + 1, sizeof (address->sun_path) - 1, "%s_%x_%x",
+        SHM_SOCKET_NAME, hostTX, hostRX);
+
+    return (socklen_t) (offsetof (struct sockaddr_un, sun_path) + 1 + nameLength);
+}
+
+static ShmStatus Shm_Map (HDDLShimShmContext *shmCtx, uint32_t ringSize)
+{
+    size_t controlSize = Shm_ControlSize ();
+    HDDLShimShmControl *control;
+    uint8_t *base;
+    uint8_t *data[SHM_RING_COUNT];
+    int writeIndex = (shmCtx->flag == HOST) ? SHM_HOST_TO_TARGET : SHM_TARGET_TO_HOST;
+    int readIndex = (shmCtx->flag == HOST) ? SHM_TARGET_TO_HOST : SHM_HOST_TO_TARGET;
+
+    // Reserve the whole address range first, then place the control page and both copies
+    // of each ring on top of it
+    shmCtx->mapSize = controlSize + 2 * SHM_RING_COUNT * (size_t)ringSize;
+    base = mmap (NULL, shmCtx->mapSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (base == MAP_FAILED)
+    {
+        SHIM_ERROR_MESSAGE ("Failed to reserve shared memory range with errno %d", errno);
+        return SHM_FAILED;
+    }
+
+    shmCtx->mapAddr = base;
+
+    if (mmap (base, controlSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, shmCtx->memFd,
+        0) == MAP_FAILED)
+    {
+        SHIM_ERROR_MESSAGE ("Failed to map shared memory control page with errno %d", errno);
+        munmap (base, shmCtx->mapSize);
+        shmCtx->mapAddr = NULL;
+        return SHM_FAILED;
+    }
+
+    for (int i = 0; i < SHM_RING_COUNT; i++)
+    {
+        off_t offset = controlSize + i * (size_t)ringSize;
+        data[i] = base + controlSize + 2 * i * (size_t)ringSize;
+
+        if (mmap (data[i], ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+            shmCtx->memFd, offset) == MAP_FAILED ||
+            mmap (data[i] + ringSize, ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+            shmCtx->memFd, offset) == MAP_FAILED)
+        {
+            SHIM_ERROR_MESSAGE ("Failed to map shared memory ring with errno %d", errno);
+            munmap (base, shmCtx->mapSize);
+            shmCtx->mapAddr = NULL;
+            return SHM_FAILED;
+        }
+    }
+
+    control = (HDDLShimShmControl *)base;
+    shmCtx->writeRing = &control->ring[writeIndex];
+    shmCtx->readRing = &control->ring[readIndex];
+    shmCtx->writeData = data[writeIndex];
+    shmCtx->readData = data[readIndex];
+
+    return SHM_SUCCESS;
+}
+
+static void Shm_Unmap (HDDLShimShmContext *shmCtx)
+{
+    if (shmCtx->mapAddr)
+    {
+        munmap (shmCtx->mapAddr, shmCtx->mapSize);
+        shmCtx->mapAddr = NULL;
+    }
+
+    shmCtx->writeRing = NULL;
+    shmCtx->readRing = NULL;
+    shmCtx->writeData = NULL;
+    shmCtx->readData = NULL;
+}
+
+static ShmStatus Shm_SendFd (int sock, int fd)
+{
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg;
+    char control[CMSG_SPACE (sizeof (int))];
+    char byte = 0;
+
+    HDDLMemoryMgr_ZeroMemory (&msg, sizeof (msg));
+    HDDLMemoryMgr_ZeroMemory (control, sizeof (control));
+    iov.iov_base = &byte;
+    iov.iov_len = sizeof (byte);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof (control);
+
+    cmsg = CMSG_FIRSTHDR (&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN (sizeof (int));
+    HDDLMemoryMgr_Memcpy (CMSG_DATA (cmsg), &fd, sizeof (int), sizeof (int));
+
+    if (sendmsg (sock, &msg, MSG_NOSIGNAL) != sizeof (byte))
+    {
+        SHIM_ERROR_MESSAGE ("Failed to send shared memory fd with errno %d", errno);
+        return SHM_FAILED;
+    }
+
+    return SHM_SUCCESS;
+}
+
+static int Shm_ReceiveFd (int sock)
+{
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg;
+    char control[CMSG_SPACE (sizeof (int))];
+    char byte;
+    int fd = -1;
+
+    HDDLMemoryMgr_ZeroMemory (&msg, sizeof (msg));
+    iov.iov_base = &byte;
+    iov.iov_len = sizeof (byte);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof (control);
+
+    if (recvmsg (sock, &msg, MSG_CMSG_CLOEXEC) != sizeof (byte))
+    {
+        SHIM_ERROR_MESSAGE ("Failed to receive shared memory fd with errno %d", errno);
+        return -1;
+    }
+
+    cmsg = CMSG_FIRSTHDR (&msg);
+
+    if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+    {
+        HDDLMemoryMgr_Memcpy (&fd, CMSG_DATA (cmsg), sizeof (int), sizeof (int));
+    }
+
+    return fd;
+}
+
+// Nothing is sent on the unix socket once the fd has been handed over, so anything other
+// than "would block" means the peer has closed it
+static bool Shm_PeerAlive (HDDLShimShmContext *shmCtx)
+{
+    struct pollfd pollFd;
+    char byte;
+
+    pollFd.fd = shmCtx->clientSocket;
+    pollFd.events = POLLIN;
+    pollFd.revents = 0;
+
+    if (poll (&pollFd, 1, 0) <= 0)
+    {
+        return true;
+    }
+
+    if (pollFd.revents & (POLLHUP | POLLERR))
+    {
+        return false;
+    }
+
+    return recv (shmCtx->clientSocket, &byte, sizeof (byte), MSG_PEEK | MSG_DONTWAIT) != 0;
+}
+
+static void Shm_FutexWait (uint32_t *address, uint32_t value)
+{
+    struct timespec timeout = { 0, SHM_WAIT_TIMEOUT };
+
+    // Shared futex, the word is mapped by both processes
+    syscall (SYS_futex, address, FUTEX_WAIT, value, &timeout, NULL, 0);
+}
+
+static void Shm_FutexWake (uint32_t *address)
+{
+    syscall (SYS_futex, address, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+// Producer side: make data up to head visible and ring the data doorbell if the reader sleeps
+static void Shm_Publish (HDDLShimShmRing *ring, uint32_t head)
+{
+    __atomic_store_n (&ring->head, head, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch (&ring->dataSeq, 1, __ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n (&ring->dataWaiters, __ATOMIC_SEQ_CST))
+    {
+        Shm_FutexWake (&ring->dataSeq);
+    }
+}
+
+// Consumer side: hand the space up to tail back and ring the space doorbell if the writer
+// sleeps
+static void Shm_Release (HDDLShimShmRing *ring, uint32_t tail)
+{
+    __atomic_store_n (&ring->tail, tail, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch (&ring->spaceSeq, 1, __ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n (&ring->spaceWaiters, __ATOMIC_SEQ_CST))
+    {
+        Shm_FutexWake (&ring->spaceSeq);
+    }
+}
+
+static uint32_t Shm_DataAvailable (HDDLShimShmRing *ring)
+{
+    return __atomic_load_n (&ring->head, __ATOMIC_ACQUIRE) - ring->tail;
+}
+
+static uint32_t Shm_SpaceAvailable (HDDLShimShmRing *ring)
+{
+    return ring->size - (ring->head - __atomic_load_n (&ring->tail, __ATOMIC_ACQUIRE));
+}
+
+// Wait until at least 'size' bytes can be read, return the readable size or 0 if the peer
+// is gone. Spin shortly first since most replies come back within a few microseconds.
+static uint32_t Shm_WaitData (HDDLShimShmContext *shmCtx, uint32_t size)
+{
+    HDDLShimShmRing *ring = shmCtx->readRing;
+    uint32_t available;
+    uint32_t seq;
+
+    for (int i = 0; i < SHM_SPIN_COUNT; i++)
+    {
+        available = Shm_DataAvailable (ring);
+
+        if (available >= size)
+        {
+            return available;
+        }
+    }
+
+    while (1)
+    {
+        seq = __atomic_load_n (&ring->dataSeq, __ATOMIC_ACQUIRE);
+        __atomic_add_fetch (&ring->dataWaiters, 1, __ATOMIC_SEQ_CST);
+
+        if (__atomic_load_n (&ring->head, __ATOMIC_SEQ_CST) - ring->tail < size)
+        {
+            Shm_FutexWait (&ring->dataSeq, seq);
+        }
+
+        __atomic_sub_fetch (&ring->dataWaiters, 1, __ATOMIC_SEQ_CST);
+
+        available = Shm_DataAvailable (ring);
+
+        if (available >= size)
+        {
+            return available;
+        }
+
+        if (!Shm_PeerAlive (shmCtx))
+        {
+            return 0;
+        }
+    }
+}
+
+// Wait until at least 'size' bytes can be written, return the writable size or 0 if the
+// peer is gone
+static uint32_t Shm_WaitSpace (HDDLShimShmContext *shmCtx, uint32_t size)
+{
+    HDDLShimShmRing *ring = shmCtx->writeRing;
+    uint32_t available;
+    uint32_t seq;
+
+    for (int i = 0; i < SHM_SPIN_COUNT; i++)
+    {
+        available = Shm_SpaceAvailable (ring);
+
+        if (available >= size)
+        {
+            return available;
+        }
+    }
+
+    while (1)
+    {
+        seq = __atomic_load_n (&ring->spaceSeq, __ATOMIC_ACQUIRE);
+        __atomic_add_fetch (&ring->spaceWaiters, 1, __ATOMIC_SEQ_CST);
+
+        if (ring->size - (ring->head - __atomic_load_n (&ring->tail, __ATOMIC_SEQ_CST)) < size)
+        {
+            Shm_FutexWait (&ring->spaceSeq, seq);
+        }
+
+        __atomic_sub_fetch (&ring->spaceWaiters, 1, __ATOMIC_SEQ_CST);
+
+        available = Shm_SpaceAvailable (ring);
+
+        if (available >= size)
+        {
+            return available;
+        }
+
+        if (!Shm_PeerAlive (shmCtx))
+        {
+            return 0;
+        }
+    }
+}
+
+HDDLShimShmContext *Shm_ContextInit (uint16_t channelTX, uint16_t channelRX)
+{
+    HDDLShimShmContext *shmCtx = HDDLMemoryMgr_AllocAndZeroMemory (sizeof (HDDLShimShmContext));
+    SHIM_CHK_NULL (shmCtx, "shmCtx returned NULL", NULL);
+
+    shmCtx->channelTX = channelTX;
+    shmCtx->channelRX = channelRX;
+    shmCtx->memFd = -1;
+    shmCtx->serverSocket = -1;
+    shmCtx->clientSocket = -1;
+
+    return shmCtx;
+}
+
+ShmStatus Shm_Initialize (HDDLShimShmContext *shmCtx, int flag)
+{
+    struct sockaddr_un address;
+    socklen_t addressLength;
+
+    SHIM_CHK_NULL (shmCtx, "NULL SHM context", SHM_FAILED);
+
+    shmCtx->flag = flag;
+    addressLength = Shm_SocketAddress (shmCtx, &address);
+
+    if (flag == HOST)
+    {
+        uint32_t ringSize = Shm_GetRingSize ();
+        HDDLShimShmControl *control;
+        int retry = 0;
+
+        shmCtx->memFd = syscall (SYS_memfd_create, SHM_SOCKET_NAME, MFD_CLOEXEC);
+
+        if (shmCtx->memFd < 0 || ftruncate (shmCtx->memFd,
+            Shm_ControlSize () + SHM_RING_COUNT * (size_t)ringSize) < 0)
+        {
+            SHIM_ERROR_MESSAGE ("Failed to create shared memory with errno %d", errno);
+            Shm_CloseFd (&shmCtx->memFd);
+            return SHM_FAILED;
+        }
+
+        if (Shm_Map (shmCtx, ringSize) != SHM_SUCCESS)
+        {
+            Shm_CloseFd (&shmCtx->memFd);
+            return SHM_FAILED;
+        }
+
+        // memfd is zero filled, only the sizes have to be set
+        control = (HDDLShimShmControl *)shmCtx->mapAddr;
+        control->magic = SHM_MAGIC;
+        control->ringSize = ringSize;
+
+        for (int i = 0; i < SHM_RING_COUNT; i++)
+        {
+            control->ring[i].size = ringSize;
+        }
+
+        // Host is the client, connection is established here since Comm_Connect only
+        // performs accept on target
+        shmCtx->clientSocket = socket (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+        while (shmCtx->clientSocket >= 0 && connect (shmCtx->clientSocket,
+            (SocketAddress *)&address, addressLength) < 0)
+        {
+            // Target might not be listening on this channel pair yet
+            if ( (errno != ECONNREFUSED && errno != EAGAIN) || ++retry >= SHM_CONNECT_RETRY)
+            {
+                Shm_CloseFd (&shmCtx->clientSocket);
+                break;
+            }
+
+            usleep (SHM_CONNECT_RETRY_INTERVAL);
+        }
+
+        if (shmCtx->clientSocket < 0 || Shm_SendFd (shmCtx->clientSocket, shmCtx->memFd) !=
+            SHM_SUCCESS)
+        {
+            SHIM_ERROR_MESSAGE ("Failed to connect SHM channel %x/%x", shmCtx->channelTX,
+                shmCtx->channelRX);
+            Shm_CloseFd (&shmCtx->clientSocket);
+            Shm_Unmap (shmCtx);
+            Shm_CloseFd (&shmCtx->memFd);
+            return SHM_FAILED;
+        }
+
+        SHIM_NORMAL_MESSAGE ("[SHM channel %x/%x] Connected with ring size %u",
+            shmCtx->channelTX, shmCtx->channelRX, ringSize);
+    }
+    else
+    {
+        shmCtx->serverSocket = socket (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+        if (shmCtx->serverSocket < 0 ||
+            bind (shmCtx->serverSocket, (SocketAddress *)&address, addressLength) < 0 ||
+            listen (shmCtx->serverSocket, 1) < 0)
+        {
+            SHIM_ERROR_MESSAGE ("Failed to listen on SHM channel %x/%x with errno %d",
+                shmCtx->channelTX, shmCtx->channelRX, errno);
+            Shm_CloseFd (&shmCtx->serverSocket);
+            return SHM_FAILED;
+        }
+
+        SHIM_NORMAL_MESSAGE ("[SHM channel %x/%x] Listening", shmCtx->channelTX,
+            shmCtx->channelRX);
+    }
+
+    HDDLThreadMgr_InitMutex (&shmCtx->shmMutex);
+
+    return SHM_SUCCESS;
+}
+
+ShmStatus Shm_Connect (HDDLShimShmContext *shmCtx)
+{
+    HDDLShimShmControl *control;
+    struct stat memStat;
+    uint32_t ringSize;
+
+    SHIM_CHK_NULL (shmCtx, "NULL SHM context", SHM_FAILED);
+
+    SHIM_NORMAL_MESSAGE ("[SHM channel %x/%x] Waiting for connection", shmCtx->channelTX,
+        shmCtx->channelRX);
+
+    do
+    {
+        shmCtx->clientSocket = accept (shmCtx->serverSocket, NULL, NULL);
+    } while (shmCtx->clientSocket < 0 && errno == EINTR);
+
+    if (shmCtx->clientSocket < 0)
+    {
+        SHIM_ERROR_MESSAGE ("Failed to accept SHM connection with errno %d", errno);
+        return SHM_FAILED;
+    }
+
+    shmCtx->memFd = Shm_ReceiveFd (shmCtx->clientSocket);
+
+    if (shmCtx->memFd < 0 || fstat (shmCtx->memFd, &memStat) < 0 ||
+        memStat.st_size <= Shm_ControlSize ())
+    {
+        SHIM_ERROR_MESSAGE ("Invalid shared memory received from host");
+        Shm_CloseFd (&shmCtx->memFd);
+        Shm_CloseFd (&shmCtx->clientSocket);
+        return SHM_FAILED;
+    }
+
+    ringSize = (memStat.st_size - Shm_ControlSize ()) / SHM_RING_COUNT;
+
+    if (Shm_Map (shmCtx, ringSize) != SHM_SUCCESS)
+    {
+        Shm_CloseFd (&shmCtx->memFd);
+        Shm_CloseFd (&shmCtx->clientSocket);
+        return SHM_FAILED;
+    }
+
+    control = (HDDLShimShmControl *)shmCtx->mapAddr;
+
+    if (control->magic != SHM_MAGIC || control->ringSize != ringSize)
+    {
+        SHIM_ERROR_MESSAGE ("Shared memory layout mismatch");
+        Shm_Unmap (shmCtx);
+        Shm_CloseFd (&shmCtx->memFd);
+        Shm_CloseFd (&shmCtx->clientSocket);
+        return SHM_FAILED;
+    }
+
+    SHIM_NORMAL_MESSAGE ("[SHM channel %x/%x] Connected with ring size %u", shmCtx->channelTX,
+        shmCtx->channelRX, ringSize);
+
+    return SHM_SUCCESS;
+}
+
+ShmStatus Shm_Write (HDDLShimShmContext *shmCtx, int dataSize, void *payload)
+{
+    struct iovec iov;
+
+    iov.iov_base = payload;
+    iov.iov_len = dataSize;
+
+    return Shm_WriteV (shmCtx, &iov, 1);
+}
+
+ShmStatus Shm_WriteV (HDDLShimShmContext *shmCtx, struct iovec *iov, int iovCount)
+{
+    SHIM_CHK_NULL (shmCtx, "NULL SHM context", SHM_FAILED);
+    SHIM_CHK_NULL (shmCtx->writeRing, "SHM not connected", SHM_FAILED);
+
+    HDDLShimShmRing *ring = shmCtx->writeRing;
+    uint32_t mask = ring->size - 1;
+    uint32_t head = ring->head;
+    uint32_t space = Shm_SpaceAvailable (ring);
+
+    for (int i = 0; i < iovCount; i++)
+    {
+        uint8_t *data = (uint8_t *)iov[i].iov_base;
+        size_t remaining = iov[i].iov_len;
+
+        // Messages larger than the ring are streamed, the reader drains it as it goes
+        while (remaining > 0)
+        {
+            uint32_t chunk;
+
+            if (space == 0)
+            {
+                Shm_Publish (ring, head);
+                space = Shm_WaitSpace (shmCtx, 1);
+
+                if (space == 0)
+                {
+                    SHIM_ERROR_MESSAGE ("SHM peer closed while writing");
+                    return SHM_FAILED;
+                }
+            }
+
+            chunk = (remaining < space) ? (uint32_t)remaining : space;
+            HDDLMemoryMgr_Memcpy (shmCtx->writeData + (head & mask), data, chunk, chunk);
+
+            head += chunk;
+            data += chunk;
+            remaining -= chunk;
+            space -= chunk;
+        }
+    }
+
+    Shm_Publish (ring, head);
+
+    return SHM_SUCCESS;
+}
+
+void *Shm_WriteReserve (HDDLShimShmContext *shmCtx, uint32_t dataSize)
+{
+    SHIM_CHK_NULL (shmCtx, "NULL SHM context", NULL);
+    SHIM_CHK_NULL (shmCtx->writeRing, "SHM not connected", NULL);
+
+    HDDLShimShmRing *ring = shmCtx->writeRing;
+
+    if (dataSize == 0 || dataSize > ring->size)
+    {
+        return NULL;
+    }
+
+    if (Shm_WaitSpace (shmCtx, dataSize) == 0)
+    {
+        SHIM_ERROR_MESSAGE ("SHM peer closed while reserving");
+        return NULL;
+    }
+
+    return shmCtx->writeData + (ring->head & (ring->size - 1));
+}
+
+ShmStatus Shm_WriteCommit (HDDLShimShmContext *shmCtx, uint32_t dataSize)
+{
+    SHIM_CHK_NULL (shmCtx, "NULL SHM context", SHM_FAILED);
+    SHIM_CHK_NULL (shmCtx->writeRing, "SHM not connected", SHM_FAILED);
+
+    Shm_Publish (shmCtx->writeRing, shmCtx->writeRing->head + dataSize);
+
+    return SHM_SUCCESS;
+}
+
+ShmStatus Shm_Read (HDDLShimShmContext *shmCtx, int dataSize, void *payload)
+{
+    SHIM_CHK_NULL (shmCtx, "NULL SHM context", SHM_FAILED);
+    SHIM_CHK_NULL (shmCtx->readRing, "SHM not connected", SHM_FAILED);
+    SHIM_CHK_NULL (payload, "NULL payload", SHM_FAILED);
+
+    HDDLShimShmRing *ring = shmCtx->readRing;
+    uint32_t mask = ring->size - 1;
+    uint32_t tail = ring->tail;
+    uint8_t *data = (uint8_t *)payload;
+    uint32_t remaining = dataSize;
+
+    while (remaining > 0)
+    {
+        uint32_t available = Shm_WaitData (shmCtx, 1);
+        uint32_t chunk;
+
+        if (available == 0)
+        {
+            return SHM_EOF;
+        }
+
+        chunk = (remaining < available) ? remaining : available;
+        HDDLMemoryMgr_Memcpy (data, shmCtx->readData + (tail & mask), chunk, chunk);
+
+        tail += chunk;
+        data += chunk;
+        remaining -= chunk;
+
+        // Release straight away so a writer streaming a message larger than the ring can
+        // carry on
+        Shm_Release (ring, tail);
+    }
+
+    return SHM_SUCCESS;
+}
+
+ShmStatus Shm_Peek (HDDLShimShmContext *shmCtx, uint32_t *size, void *payload)
+{
+    SHIM_CHK_NULL (shmCtx, "NULL SHM context", SHM_FAILED);
+    SHIM_CHK_NULL (shmCtx->readRing, "SHM not connected", SHM_FAILED);
+    SHIM_CHK_NULL (payload, "NULL payload", SHM_FAILED);
+
+    HDDLShimShmRing *ring = shmCtx->readRing;
+
+    if (*size == 0 || *size > ring->size)
+    {
+        SHIM_ERROR_MESSAGE ("Invalid SHM peek size %u", *size);
+        return SHM_FAILED;
+    }
+
+    if (Shm_WaitData (shmCtx, *size) == 0)
+    {
+        return SHM_CONNECTION_CLOSED;
+    }
+
+    HDDLMemoryMgr_Memcpy (payload, shmCtx->readData + (ring->tail & (ring->size - 1)), *size,
+        *size);
+
+    return SHM_SUCCESS;
+}
+
+ShmStatus Shm_Borrow (HDDLShimShmContext *shmCtx, uint32_t size, void **payload)
+{
+    SHIM_CHK_NULL (shmCtx, "NULL SHM context", SHM_FAILED);
+    SHIM_CHK_NULL (shmCtx->readRing, "SHM not connected", SHM_FAILED);
+    SHIM_CHK_NULL (payload, "NULL payload", SHM_FAILED);
+
+    HDDLShimShmRing *ring = shmCtx->readRing;
+
+    if (size == 0 || size > ring->size)
+    {
+        SHIM_ERROR_MESSAGE ("Invalid SHM borrow size %u", size);
+        return SHM_FAILED;
+    }
+
+    if (Shm_WaitData (shmCtx, size) == 0)
+    {
+        return SHM_CONNECTION_CLOSED;
+    }
+
+    // The ring is mapped twice in a row, so the message is contiguous even when it wraps
+    *payload = shmCtx->readData + (ring->tail & (ring->size - 1));
+
+    return SHM_SUCCESS;
+}
+
+ShmStatus Shm_ReleaseBorrowed (HDDLShimShmContext *shmCtx, uint32_t size)
+{
+    SHIM_CHK_NULL (shmCtx, "NULL SHM context", SHM_FAILED);
+    SHIM_CHK_NULL (shmCtx->readRing, "SHM not connected", SHM_FAILED);
+
+    Shm_Release (shmCtx->readRing, shmCtx->readRing->tail + size);
+
+    return SHM_SUCCESS;
+}
+
+ShmStatus Shm_Shutdown (HDDLShimShmContext *shmCtx)
+{
+    SHIM_CHK_NULL (shmCtx, "NULL SHM context", SHM_FAILED);
+
+    // Shm_PeerAlive sees the hang up, the doorbell makes a sleeping reader look right away
+    if (shutdown (shmCtx->clientSocket, SHUT_RDWR) != 0)
+    {
+        SHIM_ERROR_MESSAGE ("Failed to shut down socket with errno %d", errno);
+        return SHM_FAILED;
+    }
+
+    Shm_FutexWake (&shmCtx->readRing->dataSeq);
+
+    return SHM_SUCCESS;
+}
+
+ShmStatus Shm_Disconnect (HDDLShimShmContext *shmCtx, int flag)
+{
+    SHIM_CHK_NULL (shmCtx, "NULL SHM context", SHM_FAILED);
+
+    Shm_CloseFd (&shmCtx->clientSocket);
+    Shm_Unmap (shmCtx);
+    Shm_CloseFd (&shmCtx->memFd);
+
+    if (flag == HOST)
+    {
+        HDDLThreadMgr_DestroyMutex (&shmCtx->shmMutex);
+        HDDLMemoryMgr_FreeMemory (shmCtx);
+    }
+    else
+    {
+        Shm_CloseFd (&shmCtx->serverSocket);
+    }
+
+    return SHM_SUCCESS;
+}
+
+ShmStatus Shm_Reconnect (HDDLShimShmContext *shmCtx)
+{
+    SHIM_CHK_NULL (shmCtx, "NULL SHM context", SHM_FAILED);
+
+    // Drop the current host memory and wait for the next host on the same channel pair
+    Shm_CloseFd (&shmCtx->clientSocket);
+    Shm_Unmap (shmCtx);
+    Shm_CloseFd (&shmCtx->memFd);
+
+    return Shm_Connect (shmCtx);
+}
+
+//EOF
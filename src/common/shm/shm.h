@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2019 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+//!
+//! \file    shm.h
+//! \brief   Communcation interface for shared memory communication
+//! \details Provide shared memory ring communication between host driver and a target
+//!          shim running on the same machine
+//!
+
+#ifndef __SHM_RING_H__
+#define __SHM_RING_H__
+
+#include <sys/uio.h>
+
+#include "hddl_va_shim_common.h"
+#include "thread_manager.h"
+#include "memory_manager.h"
+
+//!
+//! \brief   Shared memory communcation context initialization
+//! \return  HDDLShimShmContext *
+//!          Return pointer if success, else NULL
+//!
+HDDLShimShmContext *Shm_ContextInit (uint16_t channelTX, uint16_t channelRX);
+
+//!
+//! \brief   Shared memory communcation initialization
+//! \return  ShmStatus
+//!          Return SHM_SUCCESS if success, else fail
+//!
+ShmStatus Shm_Initialize (HDDLShimShmContext *shmCtx, int flag);
+
+//!
+//! \brief   Shared memory communcation connection, host hands the ring memory over to the
+//!          target here
+//! \return  ShmStatus
+//!          Return SHM_SUCCESS if success, else fail
+//!
+ShmStatus Shm_Connect (HDDLShimShmContext *shmCtx);
+
+//!
+//! \brief   Shared memory communcation write operation
+//! \return  ShmStatus
+//!          Return SHM_SUCCESS if success, else fail
+//!
+ShmStatus Shm_Write (HDDLShimShmContext *shmCtx, int dataSize, void *payload);
+
+//!
+//! \brief   Shared memory communcation vectored write operation
+//! \return  ShmStatus
+//!          Return SHM_SUCCESS if success, else fail
+//!
+ShmStatus Shm_WriteV (HDDLShimShmContext *shmCtx, struct iovec *iov, int iovCount);
+
+//!
+//! \brief   Reserve a contiguous slot in the write ring so that a message can be built in
+//!          place, must be followed by Shm_WriteCommit
+//! \return  void *
+//!          Return pointer to the slot if success, NULL if the message does not fit in the
+//!          ring or the peer is gone
+//!
+void *Shm_WriteReserve (HDDLShimShmContext *shmCtx, uint32_t dataSize);
+
+//!
+//! \brief   Publish a slot obtained from Shm_WriteReserve to the reader
+//! \return  ShmStatus
+//!          Return SHM_SUCCESS if success, else fail
+//!
+ShmStatus Shm_WriteCommit (HDDLShimShmContext *shmCtx, uint32_t dataSize);
+
+//!
+//! \brief   Shared memory communcation read operation
+//! \return  ShmStatus
+//!          Return SHM_SUCCESS if success, SHM_EOF if peer is gone, else fail
+//!
+ShmStatus Shm_Read (HDDLShimShmContext *shmCtx, int dataSize, void *payload);
+
+//!
+//! \brief   Shared memory communcation peek operation, data is left in the ring
+//! \return  ShmStatus
+//!          Return SHM_SUCCESS if success, SHM_CONNECTION_CLOSED if peer is gone, else fail
+//!
+ShmStatus Shm_Peek (HDDLShimShmContext *shmCtx, uint32_t *size, void *payload);
+
+//!
+//! \brief   Shared memory communcation read operation without copy. Waits for size bytes
+//!          and hands them out in place, the writer cannot reuse that part of the ring until
+//!          Shm_ReleaseBorrowed. Nothing else may be read meanwhile.
+//! \return  ShmStatus
+//!          Return SHM_SUCCESS if success, SHM_CONNECTION_CLOSED if peer is gone, else fail
+//!
+ShmStatus Shm_Borrow (HDDLShimShmContext *shmCtx, uint32_t size, void **payload);
+
+//!
+//! \brief   Give the size bytes obtained with Shm_Borrow back to the writer
+//! \return  ShmStatus
+//!          Return SHM_SUCCESS if success, else fail
+//!
+ShmStatus Shm_ReleaseBorrowed (HDDLShimShmContext *shmCtx, uint32_t size);
+
+//!
+//! \brief   Hang up on the peer, a read blocked on the ring returns
+//! \return  ShmStatus
+//!          Return SHM_SUCCESS if success, else fail
+//!
+ShmStatus Shm_Shutdown (HDDLShimShmContext *shmCtx);
+
+//!
+//! \brief   Shared memory communcation disconnection
+//! \return  ShmStatus
+//!          Return SHM_SUCCESS if success, else fail
+//!
+ShmStatus Shm_Disconnect (HDDLShimShmContext *shmCtx, int flag);
+
+//!
+//! \brief   Shared memory communcation reconnect, wait for the next host on TARGET side
+//! \return  ShmStatus
+//!          Return SHM_SUCCESS if success, else fail
+//!
+ShmStatus Shm_Reconnect (HDDLShimShmContext *shmCtx);
+
+#endif
+
+//EOF
@@ -0,0 +1,652 @@
+/*
+ * Copyright (c) 2019 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+//!
+//! \file    tcp.c
+//! \brief   Communcation interface for TCP communication
+//! \details Provide tcp/ip basic communication operation. Each context holds a socket pair,
+//!          TX and RX port are always named from target point of view, so host writes to
+//!          the target RX port and reads from the target TX port.
+//!
+
+#include "tcp.h"
+#include "debug_manager.h"
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <linux/errqueue.h>
+
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+
+#define TCP_CONTROL_BUF_SIZE 128
+
+#define TCP_WRITE_SOCKET(ctx) ( ( (ctx)->flag == HOST) ? (ctx)->clientRX : (ctx)->clientTX)
+#define TCP_READ_SOCKET(ctx) ( ( (ctx)->flag == HOST) ? (ctx)->clientTX : (ctx)->clientRX)
+
+static void TCP_CloseSocket (int *sock)
+{
+    if (*sock >= 0)
+    {
+        close (*sock);
+        *sock = -1;
+    }
+}
+
+// Skip the data already transferred by sendmsg/recvmsg, together with any empty segment
+static void TCP_AdvanceIov (struct msghdr *msg, size_t size)
+{
+    while (msg->msg_iovlen > 0)
+    {
+        if (size < msg->msg_iov->iov_len)
+        {
+            msg->msg_iov->iov_base = (uint8_t *)msg->msg_iov->iov_base + size;
+            msg->msg_iov->iov_len -= size;
+            break;
+        }
+
+        size -= msg->msg_iov->iov_len;
+        msg->msg_iov++;
+        msg->msg_iovlen--;
+    }
+}
+
+static void TCP_SetSocketOption (int sock)
+{
+    int option = 1;
+    int bufSize = TCP_SOCKET_BUFFER_SIZE;
+
+    // Most of the VA calls are small request/reply pairs, do not let Nagle hold them back
+    if (setsockopt (sock, IPPROTO_TCP, TCP_NODELAY, &option, sizeof (option)) < 0)
+    {
+        SHIM_NORMAL_MESSAGE ("Unable to set TCP_NODELAY with errno %d", errno);
+    }
+
+    // Large socket buffers so that a whole slice or image payload can be queued at once
+    if (setsockopt (sock, SOL_SOCKET, SO_SNDBUF, &bufSize, sizeof (bufSize)) < 0)
+    {
+        SHIM_NORMAL_MESSAGE ("Unable to set SO_SNDBUF with errno %d", errno);
+    }
+
+    if (setsockopt (sock, SOL_SOCKET, SO_RCVBUF, &bufSize, sizeof (bufSize)) < 0)
+    {
+        SHIM_NORMAL_MESSAGE ("Unable to set SO_RCVBUF with errno %d", errno);
+    }
+}
+
+static void TCP_SetupConnection (HDDLShimTCPContext *tcpCtx)
+{
+    char *zeroCopyEnv = getenv ("BYPASS_TCP_ZEROCOPY");
+    int option = 1;
+
+    TCP_SetSocketOption (tcpCtx->clientTX);
+    TCP_SetSocketOption (tcpCtx->clientRX);
+
+    tcpCtx->zeroCopy = false;
+    tcpCtx->zeroCopySent = 0;
+    tcpCtx->zeroCopyDone = 0;
+
+    if (zeroCopyEnv && atoi (zeroCopyEnv) == 0)
+    {
+        return;
+    }
+
+    // MSG_ZEROCOPY needs kernel 4.14 onwards, stay with normal copy if it is not available
+    if (setsockopt (TCP_WRITE_SOCKET (tcpCtx), SOL_SOCKET, SO_ZEROCOPY, &option,
+        sizeof (option)) == 0)
+    {
+        tcpCtx->zeroCopy = true;
+    }
+
+    SHIM_NORMAL_MESSAGE ("TCP zero copy send: %d", tcpCtx->zeroCopy);
+}
+
+// Wait for the kernel to release every page pinned by MSG_ZEROCOPY sends, caller is free
+// to reuse or release its payload only after this returns
+static TCPStatus TCP_ZeroCopyWait (HDDLShimTCPContext *tcpCtx, int sock)
+{
+    struct pollfd pollFd;
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    struct sock_extended_err *extErr;
+    char control[TCP_CONTROL_BUF_SIZE];
+
+    pollFd.fd = sock;
+    pollFd.events = 0;
+
+    while (tcpCtx->zeroCopyDone != tcpCtx->zeroCopySent)
+    {
+        // POLLERR is always reported when completion is queued in the error queue
+        if (poll (&pollFd, 1, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            SHIM_ERROR_MESSAGE ("Failed to poll zero copy completion with errno %d", errno);
+            return TCP_FAILED;
+        }
+
+        if (! (pollFd.revents & POLLERR))
+        {
+            SHIM_ERROR_MESSAGE ("Connection closed before zero copy completion");
+            return TCP_CONNECTION_CLOSED;
+        }
+
+        HDDLMemoryMgr_ZeroMemory (&msg, sizeof (msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof (control);
+
+        if (recvmsg (sock, &msg, MSG_ERRQUEUE) < 0)
+        {
+            if (errno == EAGAIN || errno == EINTR)
+            {
+                continue;
+            }
+
+            SHIM_ERROR_MESSAGE ("Failed to read zero copy completion with errno %d", errno);
+            return TCP_FAILED;
+        }
+
+        for (cmsg = CMSG_FIRSTHDR (&msg); cmsg != NULL; cmsg = CMSG_NXTHDR (&msg, cmsg))
+        {
+            extErr = (struct sock_extended_err *)CMSG_DATA (cmsg);
+
+            if (extErr->ee_errno != 0 || extErr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+            {
+                continue;
+            }
+
+            // Each notification covers an inclusive range of zero copy send calls
+            tcpCtx->zeroCopyDone += extErr->ee_data - extErr->ee_info + 1;
+        }
+    }
+
+    return TCP_SUCCESS;
+}
+
+static int TCP_ConnectSocket (struct sockaddr_in *address)
+{
+    int sock;
+
+    for (int retry = 0; retry < TCP_CONNECT_RETRY; retry++)
+    {
+        sock = socket (AF_INET, SOCK_STREAM, 0);
+        if (sock < 0)
+        {
+            SHIM_ERROR_MESSAGE ("Failed to create socket with errno %d", errno);
+            return -1;
+        }
+
+        if (connect (sock, (SocketAddress *)address, sizeof (struct sockaddr_in)) == 0)
+        {
+            return sock;
+        }
+
+        close (sock);
+
+        // Target might not start listening yet, retry for a while before giving up
+        if (errno != ECONNREFUSED && errno != EINTR)
+        {
+            break;
+        }
+
+        usleep (TCP_CONNECT_RETRY_INTERVAL);
+    }
+
+    SHIM_ERROR_MESSAGE ("Failed to connect port %u with errno %d", ntohs (address->sin_port),
+        errno);
+    return -1;
+}
+
+static int TCP_ListenSocket (struct sockaddr_in *address)
+{
+    int sock;
+    int option = 1;
+
+    sock = socket (AF_INET, SOCK_STREAM, 0);
+    if (sock < 0)
+    {
+        SHIM_ERROR_MESSAGE ("Failed to create socket with errno %d", errno);
+        return -1;
+    }
+
+    setsockopt (sock, SOL_SOCKET, SO_REUSEADDR, &option, sizeof (option));
+
+    if (bind (sock, (SocketAddress *)address, sizeof (struct sockaddr_in)) < 0)
+    {
+        SHIM_ERROR_MESSAGE ("Failed to bind port %u with errno %d", ntohs (address->sin_port),
+            errno);
+        close (sock);
+        return -1;
+    }
+
+    if (listen (sock, TCP_LISTEN_BACKLOG) < 0)
+    {
+        SHIM_ERROR_MESSAGE ("Failed to listen port %u with errno %d", ntohs (address->sin_port),
+            errno);
+        close (sock);
+        return -1;
+    }
+
+    return sock;
+}
+
+HDDLShimTCPContext *TCP_ContextInit (uint16_t portTX, uint16_t portRX, struct hostent *server)
+{
+    HDDLShimTCPContext *tcpCtx = HDDLMemoryMgr_AllocAndZeroMemory (sizeof (HDDLShimTCPContext));
+    SHIM_CHK_NULL (tcpCtx, "Fail to create TCP context", NULL);
+
+    tcpCtx->serverTX = -1;
+    tcpCtx->serverRX = -1;
+    tcpCtx->clientTX = -1;
+    tcpCtx->clientRX = -1;
+
+    tcpCtx->addressTX.sin_family = AF_INET;
+    tcpCtx->addressTX.sin_port = htons (portTX);
+    tcpCtx->addressRX.sin_family = AF_INET;
+    tcpCtx->addressRX.sin_port = htons (portRX);
+
+    // Without server address, target listens on all interfaces while host connects to
+    // DEFAULT_TCP_HOST, which is resolved in TCP_Initialize once the side is known
+    if (server != NULL && server->h_addr_list[0] != NULL)
+    {
+        HDDLMemoryMgr_Memcpy (&tcpCtx->addressTX.sin_addr, server->h_addr_list[0],
+            sizeof (tcpCtx->addressTX.sin_addr), server->h_length);
+        HDDLMemoryMgr_Memcpy (&tcpCtx->addressRX.sin_addr, server->h_addr_list[0],
+            sizeof (tcpCtx->addressRX.sin_addr), server->h_length);
+    }
+    else
+    {
+        tcpCtx->addressTX.sin_addr.s_addr = htonl (INADDR_ANY);
+        tcpCtx->addressRX.sin_addr.s_addr = htonl (INADDR_ANY);
+    }
+
+    return tcpCtx;
+}
+
+TCPStatus TCP_Initialize (HDDLShimTCPContext *tcpCtx, int flag)
+{
+    SHIM_CHK_NULL (tcpCtx, "NULL TCP context", TCP_FAILED);
+
+    tcpCtx->flag = flag;
+
+    if (flag == HOST)
+    {
+        if (tcpCtx->addressTX.sin_addr.s_addr == htonl (INADDR_ANY))
+        {
+            inet_pton (AF_INET, DEFAULT_TCP_HOST, &tcpCtx->addressTX.sin_addr);
+            inet_pton (AF_INET, DEFAULT_TCP_HOST, &tcpCtx->addressRX.sin_addr);
+        }
+
+        // Host is the client, connection is established here since Comm_Connect only
+        // performs accept on target
+        tcpCtx->clientTX = TCP_ConnectSocket (&tcpCtx->addressTX);
+        tcpCtx->clientRX = TCP_ConnectSocket (&tcpCtx->addressRX);
+
+        if (tcpCtx->clientTX < 0 || tcpCtx->clientRX < 0)
+        {
+            TCP_CloseSocket (&tcpCtx->clientTX);
+            TCP_CloseSocket (&tcpCtx->clientRX);
+            return TCP_FAILED;
+        }
+
+        TCP_SetupConnection (tcpCtx);
+
+        SHIM_NORMAL_MESSAGE ("[TCP port %u/%u] Connected", ntohs (tcpCtx->addressTX.sin_port),
+            ntohs (tcpCtx->addressRX.sin_port));
+    }
+    else
+    {
+        tcpCtx->serverTX = TCP_ListenSocket (&tcpCtx->addressTX);
+        tcpCtx->serverRX = TCP_ListenSocket (&tcpCtx->addressRX);
+
+        if (tcpCtx->serverTX < 0 || tcpCtx->serverRX < 0)
+        {
+            TCP_CloseSocket (&tcpCtx->serverTX);
+            TCP_CloseSocket (&tcpCtx->serverRX);
+            return TCP_FAILED;
+        }
+
+        SHIM_NORMAL_MESSAGE ("[TCP port %u/%u] Listening", ntohs (tcpCtx->addressTX.sin_port),
+            ntohs (tcpCtx->addressRX.sin_port));
+    }
+
+    HDDLThreadMgr_InitMutex (&tcpCtx->tcpMutex);
+
+    return TCP_SUCCESS;
+}
+
+TCPStatus TCP_Connect (HDDLShimTCPContext *tcpCtx)
+{
+    SHIM_CHK_NULL (tcpCtx, "NULL TCP context", TCP_FAILED);
+
+    SHIM_NORMAL_MESSAGE ("[TCP port %u/%u] Waiting for connection",
+        ntohs (tcpCtx->addressTX.sin_port), ntohs (tcpCtx->addressRX.sin_port));
+
+    do
+    {
+        tcpCtx->clientTX = accept (tcpCtx->serverTX, NULL, NULL);
+    } while (tcpCtx->clientTX < 0 && errno == EINTR);
+
+    if (tcpCtx->clientTX < 0)
+    {
+        SHIM_ERROR_MESSAGE ("Failed to accept TX connection with errno %d", errno);
+        return TCP_FAILED;
+    }
+
+    do
+    {
+        tcpCtx->clientRX = accept (tcpCtx->serverRX, NULL, NULL);
+    } while (tcpCtx->clientRX < 0 && errno == EINTR);
+
+    if (tcpCtx->clientRX < 0)
+    {
+        SHIM_ERROR_MESSAGE ("Failed to accept RX connection with errno %d", errno);
+        TCP_CloseSocket (&tcpCtx->clientTX);
+        return TCP_FAILED;
+    }
+
+    TCP_SetupConnection (tcpCtx);
+
+    SHIM_NORMAL_MESSAGE ("[TCP port %u/%u] Connected", ntohs (tcpCtx->addressTX.sin_port),
+        ntohs (tcpCtx->addressRX.sin_port));
+
+    return TCP_SUCCESS;
+}
+
+TCPStatus TCP_WriteV (HDDLShimTCPContext *tcpCtx, struct iovec *iov, int iovCount)
+{
+    struct iovec iovLocal[iovCount];
+    struct msghdr msg;
+    size_t totalSize = 0;
+    ssize_t sendSize;
+    int sendFlag = MSG_NOSIGNAL;
+    int sock;
+
+    SHIM_CHK_NULL (tcpCtx, "NULL TCP context", TCP_FAILED);
+    SHIM_CHK_NULL (iov, "null iov", TCP_FAILED);
+
+    sock = TCP_WRITE_SOCKET (tcpCtx);
+
+    // Work on a copy, the segments are advanced as the data goes out
+    for (int i = 0; i < iovCount; i++)
+    {
+        iovLocal[i] = iov[i];
+        totalSize += iov[i].iov_len;
+    }
+
+    // Large slice data and image payloads are sent straight from the caller pages
+    if (tcpCtx->zeroCopy && totalSize >= TCP_ZEROCOPY_THRESHOLD)
+    {
+        sendFlag |= MSG_ZEROCOPY;
+    }
+
+    HDDLMemoryMgr_ZeroMemory (&msg, sizeof (msg));
+    msg.msg_iov = iovLocal;
+    msg.msg_iovlen = iovCount;
+    TCP_AdvanceIov (&msg, 0);
+
+    while (msg.msg_iovlen > 0)
+    {
+        sendSize = sendmsg (sock, &msg, sendFlag);
+
+        if (sendSize < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            // Out of optmem for pinned pages, finish the rest with normal copy
+            if (errno == ENOBUFS && (sendFlag & MSG_ZEROCOPY))
+            {
+                sendFlag &= ~MSG_ZEROCOPY;
+                continue;
+            }
+
+            SHIM_ERROR_MESSAGE ("Failed to write data with errno %d", errno);
+            return TCP_FAILED;
+        }
+
+        if (sendFlag & MSG_ZEROCOPY)
+        {
+            tcpCtx->zeroCopySent++;
+        }
+
+        TCP_AdvanceIov (&msg, sendSize);
+    }
+
+    if (tcpCtx->zeroCopyDone != tcpCtx->zeroCopySent)
+    {
+        return TCP_ZeroCopyWait (tcpCtx, sock);
+    }
+
+    return TCP_SUCCESS;
+}
+
+TCPStatus TCP_Write (HDDLShimTCPContext *tcpCtx, int dataSize, void *payload)
+{
+    struct iovec iov;
+
+    SHIM_CHK_NULL (payload, "null payload", TCP_FAILED);
+
+    iov.iov_base = payload;
+    iov.iov_len = dataSize;
+
+    return TCP_WriteV (tcpCtx, &iov, 1);
+}
+
+TCPStatus TCP_ReadV (HDDLShimTCPContext *tcpCtx, struct iovec *iov, int iovCount)
+{
+    struct iovec iovLocal[iovCount];
+    struct msghdr msg;
+    ssize_t readSize;
+    int sock;
+
+    SHIM_CHK_NULL (tcpCtx, "NULL TCP context", TCP_FAILED);
+    SHIM_CHK_NULL (iov, "null iov", TCP_FAILED);
+
+    sock = TCP_READ_SOCKET (tcpCtx);
+
+    for (int i = 0; i < iovCount; i++)
+    {
+        iovLocal[i] = iov[i];
+    }
+
+    HDDLMemoryMgr_ZeroMemory (&msg, sizeof (msg));
+    msg.msg_iov = iovLocal;
+    msg.msg_iovlen = iovCount;
+    TCP_AdvanceIov (&msg, 0);
+
+    while (msg.msg_iovlen > 0)
+    {
+        readSize = recvmsg (sock, &msg, MSG_WAITALL);
+
+        if (readSize < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            SHIM_ERROR_MESSAGE ("Failed to read data with errno %d", errno);
+            return TCP_FAILED;
+        }
+
+        if (readSize == 0)
+        {
+            SHIM_NORMAL_MESSAGE ("Connection closed by peer");
+            return TCP_EOF;
+        }
+
+        TCP_AdvanceIov (&msg, readSize);
+    }
+
+    return TCP_SUCCESS;
+}
+
+TCPStatus TCP_Read (HDDLShimTCPContext *tcpCtx, int dataSize, void *payload)
+{
+    struct iovec iov;
+
+    SHIM_CHK_NULL (payload, "null payload", TCP_FAILED);
+
+    iov.iov_base = payload;
+    iov.iov_len = dataSize;
+
+    return TCP_ReadV (tcpCtx, &iov, 1);
+}
+
+// Peek leaves the data in the socket. Caller normally peeks the HDDLVAData header to learn
+// the full message size, then reads the whole message with TCP_Read.
+TCPStatus TCP_Peek (HDDLShimTCPContext *tcpCtx, uint32_t *size, void *payload)
+{
+    ssize_t readSize;
+
+    SHIM_CHK_NULL (tcpCtx, "NULL TCP context", TCP_FAILED);
+    SHIM_CHK_NULL (payload, "null payload", TCP_FAILED);
+
+    do
+    {
+        readSize = recv (TCP_READ_SOCKET (tcpCtx), payload, *size, MSG_PEEK | MSG_WAITALL);
+    } while (readSize < 0 && errno == EINTR);
+
+    if (readSize == 0)
+    {
+        return TCP_CONNECTION_CLOSED;
+    }
+
+    if (readSize < 0)
+    {
+        SHIM_ERROR_MESSAGE ("Failed to peek data with errno %d", errno);
+        return TCP_FAILED;
+    }
+
+    *size = readSize;
+
+    return TCP_SUCCESS;
+}
+
+TCPStatus TCP_Borrow (HDDLShimTCPContext *tcpCtx, uint32_t size, void **payload)
+{
+    SHIM_CHK_NULL (tcpCtx, "NULL TCP context", TCP_FAILED);
+    SHIM_CHK_NULL (payload, "null payload", TCP_FAILED);
+
+    // The socket data has to be copied anyway, reuse one buffer per channel for it
+    if (size > tcpCtx->rxBufferSize)
+    {
+        uint8_t *rxBuffer = HDDLMemoryMgr_ReallocMemory (tcpCtx->rxBuffer, size);
+        SHIM_CHK_NULL (rxBuffer, "Failed to grow receive buffer", TCP_FAILED);
+
+        tcpCtx->rxBuffer = rxBuffer;
+        tcpCtx->rxBufferSize = size;
+    }
+
+    *payload = tcpCtx->rxBuffer;
+
+    return TCP_Read (tcpCtx, size, tcpCtx->rxBuffer);
+}
+
+TCPStatus TCP_ReleaseBorrowed (HDDLShimTCPContext *tcpCtx)
+{
+    SHIM_CHK_NULL (tcpCtx, "NULL TCP context", TCP_FAILED);
+
+    // Keep the buffer around unless a message beyond the socket receive buffer has blown it
+    // up, TCP does not cut messages into fragments
+    if (tcpCtx->rxBufferSize > TCP_SOCKET_BUFFER_SIZE)
+    {
+        HDDLMemoryMgr_FreeMemory (tcpCtx->rxBuffer);
+        tcpCtx->rxBuffer = NULL;
+        tcpCtx->rxBufferSize = 0;
+    }
+
+    return TCP_SUCCESS;
+}
+
+int TCP_GetPollSocket (HDDLShimTCPContext *tcpCtx, bool listen)
+{
+    SHIM_CHK_NULL (tcpCtx, "NULL TCP context", -1);
+
+    // TCP_Connect accepts on serverTX first
+    return listen ? tcpCtx->serverTX : TCP_READ_SOCKET (tcpCtx);
+}
+
+TCPStatus TCP_Shutdown (HDDLShimTCPContext *tcpCtx)
+{
+    SHIM_CHK_NULL (tcpCtx, "NULL TCP context", TCP_FAILED);
+
+    // A recv blocked on the socket returns 0 as if the peer had closed it
+    if (shutdown (TCP_READ_SOCKET (tcpCtx), SHUT_RD) != 0)
+    {
+        SHIM_ERROR_MESSAGE ("Failed to shut down socket with errno %d", errno);
+        return TCP_FAILED;
+    }
+
+    return TCP_SUCCESS;
+}
+
+TCPStatus TCP_Disconnect (HDDLShimTCPContext *tcpCtx, int flag)
+{
+    SHIM_CHK_NULL (tcpCtx, "NULL TCP context", TCP_FAILED);
+
+    HDDLMemoryMgr_FreeMemory (tcpCtx->rxBuffer);
+    tcpCtx->rxBuffer = NULL;
+    tcpCtx->rxBufferSize = 0;
+
+    TCP_CloseSocket (&tcpCtx->clientTX);
+    TCP_CloseSocket (&tcpCtx->clientRX);
+
+    if (flag == HOST)
+    {
+        HDDLThreadMgr_DestroyMutex (&tcpCtx->tcpMutex);
+        HDDLMemoryMgr_FreeMemory (tcpCtx);
+    }
+    else
+    {
+        TCP_CloseSocket (&tcpCtx->serverTX);
+        TCP_CloseSocket (&tcpCtx->serverRX);
+    }
+
+    return TCP_SUCCESS;
+}
+
+TCPStatus TCP_Reconnect (HDDLShimTCPContext *tcpCtx)
+{
+    SHIM_CHK_NULL (tcpCtx, "NULL TCP context", TCP_FAILED);
+
+    // Drop the current host connection and wait for the next one on the same ports
+    TCP_CloseSocket (&tcpCtx->clientTX);
+    TCP_CloseSocket (&tcpCtx->clientRX);
+
+    return TCP_Connect (tcpCtx);
+}
+
+//EOF
@@ -31,6 +31,8 @@
 #ifndef __TCP_SOCKET_H__
 #define __TCP_SOCKET_H__
 
+#include <sys/uio.h>
+
 #include "hddl_va_shim_common.h"
 #include "thread_manager.h"
 #include "memory_manager.h"
@@ -63,6 +65,14 @@ TCPStatus TCP_Connect (HDDLShimTCPContext *tcpCtx);
 //!
 TCPStatus TCP_Write (HDDLShimTCPContext *tcpCtx, int dataSize, void *payload);
 
+//!
+//! \brief   TCP communcation vectored write operation, gathers all iov segments in one
+//!          send without staging them into a single buffer
+//! \return  TCPStatus
+//!          Return nonnegative integer if success, else fail
+//!
+TCPStatus TCP_WriteV (HDDLShimTCPContext *tcpCtx, struct iovec *iov, int iovCount);
+
 //!
 //! \brief   TCP communcation read operation
 //! \return  TCPStatus
@@ -70,6 +80,14 @@ TCPStatus TCP_Write (HDDLShimTCPContext *tcpCtx, int dataSize, void *payload);
 //!
 TCPStatus TCP_Read (HDDLShimTCPContext *tcpCtx, int dataSize, void *payload);
 
+//!
+//! \brief   TCP communcation vectored read operation, scatters the received data into
+//!          all iov segments
+//! \return  TCPStatus
+//!          Return nonnegative if success, else fail
+//!
+TCPStatus TCP_ReadV (HDDLShimTCPContext *tcpCtx, struct iovec *iov, int iovCount);
+
 //!
 //! \brief   TCP communcation peek operation
 //! \return  TCPStatus
@@ -77,6 +95,36 @@ TCPStatus TCP_Read (HDDLShimTCPContext *tcpCtx, int dataSize, void *payload);
 //!
 TCPStatus TCP_Peek (HDDLShimTCPContext *tcpCtx, uint32_t *size, void *payload);
 
+//!
+//! \brief   TCP communcation read operation into the channel receive buffer, which is lent
+//!          out until TCP_ReleaseBorrowed. Nothing else may be read meanwhile.
+//! \return  TCPStatus
+//!          Return nonnegative if success, else fail
+//!
+TCPStatus TCP_Borrow (HDDLShimTCPContext *tcpCtx, uint32_t size, void **payload);
+
+//!
+//! \brief   Give the receive buffer obtained with TCP_Borrow back to the channel
+//! \return  TCPStatus
+//!          Return nonnegative if success, else fail
+//!
+TCPStatus TCP_ReleaseBorrowed (HDDLShimTCPContext *tcpCtx);
+
+//!
+//! \brief   Socket which becomes readable once the next message is there, or with listen
+//!          once the next host connects
+//! \return  int
+//!          Return the socket, -1 if there is none
+//!
+int TCP_GetPollSocket (HDDLShimTCPContext *tcpCtx, bool listen);
+
+//!
+//! \brief   Stop reading from the peer, a read blocked on the socket returns
+//! \return  TCPStatus
+//!          Return TCP_SUCCESS if success, else fail
+//!
+TCPStatus TCP_Shutdown (HDDLShimTCPContext *tcpCtx);
+
 //!
 //! \brief   TCP communcation disconnection
 //! \return  TCPStatus
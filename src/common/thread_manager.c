@@ -28,8 +28,14 @@
 //! \details Allow mutex & thread event
 //!
 
+// pthread_setaffinity_np and the CPU_SET macros
+#define _GNU_SOURCE
+
 #include "thread_manager.h"
+#include "memory_manager.h"
 #include "debug_manager.h"
+#include <errno.h>
+#include <sched.h>
 
 pthread_mutex_t GlobalMutex = PTHREAD_MUTEX_INITIALIZER;
 
@@ -65,6 +71,47 @@ void HDDLThreadMgr_UnlockMutex (pthread_mutex_t *mutex)
     }
 }
 
+void HDDLThreadMgr_InitRWLock (pthread_rwlock_t *lock)
+{
+    pthread_rwlock_init (lock, NULL);
+}
+
+void HDDLThreadMgr_DestroyRWLock (pthread_rwlock_t *lock)
+{
+    int32_t ret = pthread_rwlock_destroy (lock);
+    if (ret != 0)
+    {
+        SHIM_NORMAL_MESSAGE ("can't destroy the rwlock!");
+    }
+}
+
+void HDDLThreadMgr_ReadLock (pthread_rwlock_t *lock)
+{
+    int32_t ret = pthread_rwlock_rdlock (lock);
+    if (ret != 0)
+    {
+        SHIM_NORMAL_MESSAGE ("can't read lock the rwlock!");
+    }
+}
+
+void HDDLThreadMgr_WriteLock (pthread_rwlock_t *lock)
+{
+    int32_t ret = pthread_rwlock_wrlock (lock);
+    if (ret != 0)
+    {
+        SHIM_NORMAL_MESSAGE ("can't write lock the rwlock!");
+    }
+}
+
+void HDDLThreadMgr_UnlockRWLock (pthread_rwlock_t *lock)
+{
+    int32_t ret = pthread_rwlock_unlock (lock);
+    if (ret != 0)
+    {
+        SHIM_NORMAL_MESSAGE ("can't unlock the rwlock!");
+    }
+}
+
 int32_t HDDLThreadMgr_CreateThread (pthread_t *thread, const pthread_attr_t *attr,
     void *(*start_routine) (void *), void *arg)
 {
@@ -89,6 +136,18 @@ void HDDLThreadMgr_CondWaitThread (pthread_cond_t *cond, pthread_mutex_t *mutex)
     }
 }
 
+int32_t HDDLThreadMgr_CondTimedWaitThread (pthread_cond_t *cond, pthread_mutex_t *mutex,
+    const struct timespec *absTime)
+{
+    int32_t ret = pthread_cond_timedwait (cond, mutex, absTime);
+    if (ret != 0 && ret != ETIMEDOUT)
+    {
+        SHIM_NORMAL_MESSAGE ("can't wait the mutex!");
+    }
+
+    return ret;
+}
+
 void HDDLThreadMgr_CondBroadcastThread (pthread_cond_t *cond)
 {
     int32_t ret = pthread_cond_broadcast (cond);
@@ -97,3 +156,375 @@ void HDDLThreadMgr_CondBroadcastThread (pthread_cond_t *cond)
         SHIM_NORMAL_MESSAGE ("can't boardcast the mutex!");
     }
 }
+
+void HDDLThreadMgr_InitCond (pthread_cond_t *cond)
+{
+    pthread_cond_init (cond, NULL);
+}
+
+void HDDLThreadMgr_InitMonotonicCond (pthread_cond_t *cond)
+{
+    pthread_condattr_t condAttrib;
+
+    pthread_condattr_init (&condAttrib);
+    pthread_condattr_setclock (&condAttrib, CLOCK_MONOTONIC);
+    pthread_cond_init (cond, &condAttrib);
+    pthread_condattr_destroy (&condAttrib);
+}
+
+void HDDLThreadMgr_DestroyCond (pthread_cond_t *cond)
+{
+    int32_t ret = pthread_cond_destroy (cond);
+    if (ret != 0)
+    {
+        SHIM_NORMAL_MESSAGE ("can't destroy the cond!");
+    }
+}
+
+// Cores given as "2,3", "4-7" or a mix of both, at most maxCpus of them
+static uint32_t HDDLThreadMgr_ParseCpuList (const char *cpuList, int32_t *cpus,
+    uint32_t maxCpus)
+{
+    const char *next = cpuList;
+    char *end;
+    long first;
+    long last;
+    uint32_t numCpus = 0;
+
+    while (numCpus < maxCpus)
+    {
+        first = strtol (next, &end, 10);
+        if (end == next || first < 0 || first >= CPU_SETSIZE)
+        {
+            break;
+        }
+
+        last = first;
+        if (*end == '-')
+        {
+            next = end + 1;
+            last = strtol (next, &end, 10);
+            if (end == next || last < first || last >= CPU_SETSIZE)
+            {
+                break;
+            }
+        }
+
+        for (long cpu = first; cpu <= last && numCpus < maxCpus; cpu++)
+        {
+            cpus[numCpus++] = (int32_t)cpu;
+        }
+
+        if (*end != ',')
+        {
+            break;
+        }
+
+        next = end + 1;
+    }
+
+    return numCpus;
+}
+
+// Next task of the worker or else the oldest one waiting behind the busiest other worker.
+// Called with the pool mutex held.
+static HDDLShimThreadPoolTask *HDDLThreadMgr_TakePoolTask (HDDLShimThreadPool *pool,
+    HDDLShimThreadPoolWorker *worker)
+{
+    HDDLShimThreadPoolWorker *owner = NULL;
+    HDDLShimThreadPoolTask *task;
+
+    if (worker->head != NULL)
+    {
+        owner = worker;
+    }
+    else
+    {
+        for (uint32_t i = 0; i < pool->numWorkers; i++)
+        {
+            HDDLShimThreadPoolWorker *other = &pool->workers[i];
+
+            if (other->head != NULL && (owner == NULL || other->queueDepth > owner->queueDepth))
+            {
+                owner = other;
+            }
+        }
+
+        if (owner == NULL)
+        {
+            return NULL;
+        }
+
+        owner->queueDepth--;
+        worker->queueDepth++;
+    }
+
+    task = owner->head;
+    owner->head = task->next;
+    if (owner->head == NULL)
+    {
+        owner->tail = NULL;
+    }
+
+    return task;
+}
+
+static void *HDDLThreadMgr_PoolWorker (void *arg)
+{
+    HDDLShimThreadPoolWorker *worker = (HDDLShimThreadPoolWorker *)arg;
+    HDDLShimThreadPool *pool = worker->pool;
+    HDDLShimThreadPoolTask *task;
+    cpu_set_t cpuSet;
+
+    if (worker->cpu >= 0)
+    {
+        CPU_ZERO (&cpuSet);
+        CPU_SET (worker->cpu, &cpuSet);
+
+        if (pthread_setaffinity_np (pthread_self (), sizeof (cpuSet), &cpuSet) != 0)
+        {
+            SHIM_ERROR_MESSAGE ("Failed to pin worker to core %d", worker->cpu);
+        }
+    }
+
+    HDDLThreadMgr_LockMutex (&pool->mutex);
+
+    while (1)
+    {
+        task = HDDLThreadMgr_TakePoolTask (pool, worker);
+        if (task == NULL)
+        {
+            // Tasks queued before the pool was stopped are still run
+            if (pool->stopping)
+            {
+                break;
+            }
+
+            HDDLThreadMgr_CondWaitThread (&worker->cond, &pool->mutex);
+            continue;
+        }
+
+        HDDLThreadMgr_UnlockMutex (&pool->mutex);
+
+        task->routine (task->arg);
+        HDDLMemoryMgr_FreeMemory (task);
+
+        HDDLThreadMgr_LockMutex (&pool->mutex);
+        worker->queueDepth--;
+        worker->completed++;
+    }
+
+    HDDLThreadMgr_UnlockMutex (&pool->mutex);
+
+    return NULL;
+}
+
+int32_t HDDLThreadMgr_CreatePool (HDDLShimThreadPool **pool, uint32_t numWorkers,
+    const char *cpuList)
+{
+    HDDLShimThreadPool *newPool;
+    HDDLShimThreadPoolWorker *worker;
+    int32_t cpus[MAX_POOL_THREADS];
+    uint32_t numCpus = 0;
+
+    if (numWorkers == 0 || numWorkers > MAX_POOL_THREADS)
+    {
+        SHIM_ERROR_MESSAGE ("Invalid number of pool workers %u", numWorkers);
+        return -1;
+    }
+
+    newPool = HDDLMemoryMgr_AllocAndZeroMemory (sizeof (HDDLShimThreadPool));
+    SHIM_CHK_NULL (newPool, "Failed to allocate thread pool", -1);
+
+    newPool->workers = HDDLMemoryMgr_AllocAndZeroMemory (
+        numWorkers * sizeof (HDDLShimThreadPoolWorker));
+    if (newPool->workers == NULL)
+    {
+        SHIM_ERROR_MESSAGE ("Failed to allocate pool workers");
+        HDDLMemoryMgr_FreeMemory (newPool);
+        return -1;
+    }
+
+    if (cpuList != NULL)
+    {
+        numCpus = HDDLThreadMgr_ParseCpuList (cpuList, cpus, MAX_POOL_THREADS);
+        if (numCpus == 0)
+        {
+            SHIM_ERROR_MESSAGE ("Invalid core list %s, pool workers are not pinned", cpuList);
+        }
+    }
+
+    HDDLThreadMgr_InitMutex (&newPool->mutex);
+
+    for (uint32_t i = 0; i < numWorkers; i++)
+    {
+        worker = &newPool->workers[i];
+        worker->pool = newPool;
+        worker->cpu = (numCpus > 0) ? cpus[i % numCpus] : -1;
+        HDDLThreadMgr_InitCond (&worker->cond);
+
+        if (HDDLThreadMgr_CreateThread (&worker->thread, NULL, HDDLThreadMgr_PoolWorker,
+            (void *)worker) != 0)
+        {
+            SHIM_ERROR_MESSAGE ("Failed to start pool worker %u", i);
+            HDDLThreadMgr_DestroyCond (&worker->cond);
+            HDDLThreadMgr_DestroyPool (newPool);
+            return -1;
+        }
+
+        HDDLThreadMgr_LockMutex (&newPool->mutex);
+        newPool->numWorkers++;
+        HDDLThreadMgr_UnlockMutex (&newPool->mutex);
+    }
+
+    *pool = newPool;
+
+    return 0;
+}
+
+int32_t HDDLThreadMgr_CreateDetachedThread (void *(*routine) (void *), void *arg,
+    const char *cpuList)
+{
+    pthread_attr_t attr;
+    pthread_t thread;
+    cpu_set_t cpuSet;
+    int32_t cpus[MAX_POOL_THREADS];
+    uint32_t numCpus = 0;
+    int32_t ret;
+
+    if (pthread_attr_init (&attr) != 0)
+    {
+        SHIM_ERROR_MESSAGE ("Failed to init thread attributes");
+        return -1;
+    }
+
+    pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+
+    if (cpuList != NULL)
+    {
+        numCpus = HDDLThreadMgr_ParseCpuList (cpuList, cpus, MAX_POOL_THREADS);
+        if (numCpus == 0)
+        {
+            SHIM_ERROR_MESSAGE ("Invalid core list %s, thread is not pinned", cpuList);
+        }
+    }
+
+    // The thread may run on any of the cores, there is no telling how many will be started
+    if (numCpus > 0)
+    {
+        CPU_ZERO (&cpuSet);
+        for (uint32_t i = 0; i < numCpus; i++)
+        {
+            CPU_SET (cpus[i], &cpuSet);
+        }
+
+        if (pthread_attr_setaffinity_np (&attr, sizeof (cpuSet), &cpuSet) != 0)
+        {
+            SHIM_ERROR_MESSAGE ("Failed to pin thread to cores %s", cpuList);
+        }
+    }
+
+    ret = HDDLThreadMgr_CreateThread (&thread, &attr, routine, arg);
+
+    pthread_attr_destroy (&attr);
+
+    return ret;
+}
+
+int32_t HDDLThreadMgr_SubmitPool (HDDLShimThreadPool *pool, void *(*routine) (void *),
+    void *arg)
+{
+    HDDLShimThreadPoolWorker *worker;
+    HDDLShimThreadPoolTask *task;
+
+    SHIM_CHK_NULL (pool, "Thread pool is not running", -1);
+
+    task = HDDLMemoryMgr_AllocAndZeroMemory (sizeof (HDDLShimThreadPoolTask));
+    SHIM_CHK_NULL (task, "Failed to allocate pool task", -1);
+
+    task->routine = routine;
+    task->arg = arg;
+
+    HDDLThreadMgr_LockMutex (&pool->mutex);
+
+    if (pool->stopping)
+    {
+        HDDLThreadMgr_UnlockMutex (&pool->mutex);
+        HDDLMemoryMgr_FreeMemory (task);
+        return -1;
+    }
+
+    worker = &pool->workers[0];
+    for (uint32_t i = 1; i < pool->numWorkers; i++)
+    {
+        if (pool->workers[i].queueDepth < worker->queueDepth)
+        {
+            worker = &pool->workers[i];
+        }
+    }
+
+    if (worker->tail != NULL)
+    {
+        worker->tail->next = task;
+    }
+    else
+    {
+        worker->head = task;
+    }
+    worker->tail = task;
+
+    worker->queueDepth++;
+    if (worker->queueDepth > worker->maxQueueDepth)
+    {
+        worker->maxQueueDepth = worker->queueDepth;
+    }
+
+    HDDLThreadMgr_CondBroadcastThread (&worker->cond);
+    HDDLThreadMgr_UnlockMutex (&pool->mutex);
+
+    return 0;
+}
+
+void HDDLThreadMgr_LogPoolStats (HDDLShimThreadPool *pool, const char *poolName)
+{
+    SHIM_CHK_NULL (pool, "Thread pool is not running", );
+
+    HDDLThreadMgr_LockMutex (&pool->mutex);
+
+    for (uint32_t i = 0; i < pool->numWorkers; i++)
+    {
+        SHIM_NORMAL_MESSAGE ("%s worker %u core %d: queue depth %u max %u completed %lu",
+            poolName, i, pool->workers[i].cpu, pool->workers[i].queueDepth,
+            pool->workers[i].maxQueueDepth, pool->workers[i].completed);
+    }
+
+    HDDLThreadMgr_UnlockMutex (&pool->mutex);
+}
+
+void HDDLThreadMgr_DestroyPool (HDDLShimThreadPool *pool)
+{
+    if (pool == NULL)
+    {
+        return;
+    }
+
+    HDDLThreadMgr_LockMutex (&pool->mutex);
+
+    pool->stopping = true;
+    for (uint32_t i = 0; i < pool->numWorkers; i++)
+    {
+        HDDLThreadMgr_CondBroadcastThread (&pool->workers[i].cond);
+    }
+
+    HDDLThreadMgr_UnlockMutex (&pool->mutex);
+
+    for (uint32_t i = 0; i < pool->numWorkers; i++)
+    {
+        HDDLThreadMgr_JoinThread (pool->workers[i].thread, NULL);
+        HDDLThreadMgr_DestroyCond (&pool->workers[i].cond);
+    }
+
+    HDDLThreadMgr_DestroyMutex (&pool->mutex);
+    HDDLMemoryMgr_FreeMemory (pool->workers);
+    HDDLMemoryMgr_FreeMemory (pool);
+}
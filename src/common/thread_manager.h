@@ -61,6 +61,41 @@ void HDDLThreadMgr_LockMutex (pthread_mutex_t *mutex);
 //!
 void HDDLThreadMgr_UnlockMutex (pthread_mutex_t *mutex);
 
+//!
+//! \brief   Initialises the read-write lock referenced by lock
+//! \return  void
+//!          Return nothing
+//!
+void HDDLThreadMgr_InitRWLock (pthread_rwlock_t *lock);
+
+//!
+//! \brief   Destroys the read-write lock referenced by lock
+//! \return  void
+//!          Return nothing
+//!
+void HDDLThreadMgr_DestroyRWLock (pthread_rwlock_t *lock);
+
+//!
+//! \brief   Lock for reading, shared with other readers
+//! \return  void
+//!          Return nothing
+//!
+void HDDLThreadMgr_ReadLock (pthread_rwlock_t *lock);
+
+//!
+//! \brief   Lock for writing, excluding readers and other writers
+//! \return  void
+//!          Return nothing
+//!
+void HDDLThreadMgr_WriteLock (pthread_rwlock_t *lock);
+
+//!
+//! \brief   Release a read or write lock
+//! \return  void
+//!          Return nothing
+//!
+void HDDLThreadMgr_UnlockRWLock (pthread_rwlock_t *lock);
+
 //!
 //! \brief   Start a new thread
 //! \return  int32_t
@@ -83,6 +118,15 @@ void HDDLThreadMgr_JoinThread (pthread_t thread, void **retval);
 //!
 void HDDLThreadMgr_CondWaitThread (pthread_cond_t  *cond, pthread_mutex_t *mutex);
 
+//!
+//! \brief   Function block on a condition variable until the given time, on CLOCK_MONOTONIC
+//!          for conditions from HDDLThreadMgr_InitMonotonicCond and CLOCK_REALTIME otherwise
+//! \return  int32_t
+//!          Return 0 if signalled, ETIMEDOUT once the time has passed
+//!
+int32_t HDDLThreadMgr_CondTimedWaitThread (pthread_cond_t *cond, pthread_mutex_t *mutex,
+    const struct timespec *absTime);
+
 //!
 //! \brief   Unblock threads blocked on a condition variable
 //! \return  void
@@ -90,6 +134,68 @@ void HDDLThreadMgr_CondWaitThread (pthread_cond_t  *cond, pthread_mutex_t *mutex
 //!
 void HDDLThreadMgr_CondBroadcastThread (pthread_cond_t *cond);
 
+//!
+//! \brief   Initialises the condition variable referenced by cond
+//! \return  void
+//!          Return nothing
+//!
+void HDDLThreadMgr_InitCond (pthread_cond_t *cond);
+
+//!
+//! \brief   Initialises a condition variable whose timed waits take CLOCK_MONOTONIC times,
+//!          which clock steps do not move
+//! \return  void
+//!          Return nothing
+//!
+void HDDLThreadMgr_InitMonotonicCond (pthread_cond_t *cond);
+
+//!
+//! \brief   Destroys the condition variable referenced by cond
+//! \return  void
+//!          Return nothing
+//!
+void HDDLThreadMgr_DestroyCond (pthread_cond_t *cond);
+
+//!
+//! \brief   Start a pool of numWorkers threads, pinned in turn to the cores of cpuList such
+//!          as "2,3" or "4-7" if it is not NULL
+//! \return  int32_t
+//!          Return 0 if success, else fail
+//!
+int32_t HDDLThreadMgr_CreatePool (HDDLShimThreadPool **pool, uint32_t numWorkers,
+    const char *cpuList);
+
+//!
+//! \brief   Start routine (arg) on a detached thread, allowed on the cores of cpuList such as
+//!          "2,3" or "4-7" if it is not NULL
+//! \return  int32_t
+//!          Return 0 if success, else fail
+//!
+int32_t HDDLThreadMgr_CreateDetachedThread (void *(*routine) (void *), void *arg,
+    const char *cpuList);
+
+//!
+//! \brief   Queue routine (arg) on the least busy worker of the pool
+//! \return  int32_t
+//!          Return 0 if success, else fail
+//!
+int32_t HDDLThreadMgr_SubmitPool (HDDLShimThreadPool *pool, void *(*routine) (void *),
+    void *arg);
+
+//!
+//! \brief   Log the queue depth and completed tasks of every worker of the pool
+//! \return  void
+//!          Return nothing
+//!
+void HDDLThreadMgr_LogPoolStats (HDDLShimThreadPool *pool, const char *poolName);
+
+//!
+//! \brief   Run the tasks still queued, then stop and free the pool
+//! \return  void
+//!          Return nothing
+//!
+void HDDLThreadMgr_DestroyPool (HDDLShimThreadPool *pool);
+
 #endif
 
 //EOF
@@ -111,6 +111,8 @@ HDDLShimUniteContext *Unite_ContextInit (xLinkChannelId_t channelTX, xLinkChanne
 	return NULL;
     }
 
+    XLink_InitReceive (xLinkCtx);
+
     uniteCtx->internalWorkloadId = WORKLOAD_ID_NONE;
     uniteCtx->workloadId = WORKLOAD_ID_NONE;
 
@@ -175,6 +177,58 @@ HDDLShimUniteContext *Unite_ContextInit (xLinkChannelId_t channelTX, xLinkChanne
     return uniteCtx;
 }
 
+HDDLShimUniteContext *Unite_DynamicContextInit (HDDLShimUniteContext *mainUniteCtx,
+    xLinkChannelId_t channelTX, xLinkChannelId_t channelRX)
+{
+    SHIM_CHK_NULL (mainUniteCtx, "NULL main Unite context", NULL);
+
+    HDDLShimUniteContext *uniteCtx = HDDLMemoryMgr_AllocAndZeroMemory (
+        sizeof (HDDLShimUniteContext));
+    SHIM_CHK_NULL (uniteCtx, "Fail to create Unite context", NULL);
+
+    HDDLShimXLinkContext *xLinkCtx = HDDLMemoryMgr_AllocAndZeroMemory (
+        sizeof (HDDLShimXLinkContext));
+
+    if (xLinkCtx == NULL)
+    {
+        SHIM_ERROR_MESSAGE ("Failed to create XLink context");
+	HDDLMemoryMgr_FreeMemory (uniteCtx);
+	return NULL;
+    }
+
+    XLink_InitReceive (xLinkCtx);
+
+    // The channels are released to the workload of the main context, which alone destroys an
+    // internally created workload
+    uniteCtx->workloadId = mainUniteCtx->workloadId != WORKLOAD_ID_NONE ?
+        mainUniteCtx->workloadId : mainUniteCtx->internalWorkloadId;
+    uniteCtx->internalWorkloadId = WORKLOAD_ID_NONE;
+    uniteCtx->swDeviceId = mainUniteCtx->swDeviceId;
+
+    xLinkCtx->xLinkChannelTX = channelTX;
+    xLinkCtx->xLinkChannelRX = channelRX;
+
+#if defined (HDDL_UNITE) && defined (IA)
+    ChannelID channelIdList[MAX_XLINK_CHANNELS];
+
+    if (allocateVAChannelId (uniteCtx->workloadId, channelIdList, MAX_XLINK_CHANNELS) != HDDL_OK)
+    {
+        SHIM_ERROR_MESSAGE ("Failed to allocate channels for workload %ld",
+            uniteCtx->workloadId);
+        HDDLMemoryMgr_FreeMemory (xLinkCtx);
+        HDDLMemoryMgr_FreeMemory (uniteCtx);
+        return NULL;
+    }
+
+    xLinkCtx->xLinkChannelTX = channelIdList[0];
+    xLinkCtx->xLinkChannelRX = channelIdList[1];
+#endif
+
+    uniteCtx->xLinkCtx = xLinkCtx;
+
+    return uniteCtx;
+}
+
 CommStatus Unite_Initialize (HDDLShimUniteContext *uniteCtx, int flag)
 {
     HDDLShimXLinkContext *xLinkCtx;
@@ -301,6 +355,16 @@ CommStatus Unite_Connect (HDDLShimUniteContext *uniteCtx)
 }
 
 CommStatus Unite_Write (HDDLShimUniteContext *uniteCtx, int size, void *payload)
+{
+    struct iovec iov;
+
+    iov.iov_base = payload;
+    iov.iov_len = size;
+
+    return Unite_WriteV (uniteCtx, &iov, 1);
+}
+
+CommStatus Unite_WriteV (HDDLShimUniteContext *uniteCtx, struct iovec *iov, int iovCount)
 {
     SHIM_CHK_NULL (uniteCtx, "NULL Unite context", COMM_STATUS_FAILED);
 
@@ -319,7 +383,7 @@ CommStatus Unite_Write (HDDLShimUniteContext *uniteCtx, int size, void *payload)
         xLinkStatus = Unite_CheckDeviceEvent (uniteCtx);
         SHIM_CHK_ERROR (xLinkStatus, "XLink Device Down", COMM_STATUS_FAILED);
 
-        xLinkStatus = XLink_Write (uniteCtx->xLinkCtx, size, payload);
+        xLinkStatus = XLink_WriteV (uniteCtx->xLinkCtx, iov, iovCount);
 	SHIM_CHK_EQUAL (xLinkStatus, X_LINK_ERROR, "Failed to write data", COMM_STATUS_FAILED);
 
 	if (xLinkStatus == X_LINK_TIMEOUT)
@@ -359,7 +423,7 @@ CommStatus Unite_Write (HDDLShimUniteContext *uniteCtx, int size, void *payload)
     }
     while (xLinkStatus == X_LINK_TIMEOUT);
 #else
-    xLinkStatus = XLink_Write (uniteCtx->xLinkCtx, size, payload);
+    xLinkStatus = XLink_WriteV (uniteCtx->xLinkCtx, iov, iovCount);
     SHIM_CHK_ERROR (xLinkStatus, "Failed to write data", COMM_STATUS_FAILED);
 #endif
 
@@ -400,6 +464,38 @@ CommStatus Unite_Peek (HDDLShimUniteContext *uniteCtx, uint32_t *size, void *pay
     return COMM_STATUS_SUCCESS;
 }
 
+void Unite_ReleasePayload (HDDLShimUniteContext *uniteCtx, void *payload, uint32_t size)
+{
+    XLink_ReleasePayload (uniteCtx->xLinkCtx, payload, size);
+}
+
+CommStatus Unite_Borrow (HDDLShimUniteContext *uniteCtx, uint32_t *size, void **payload)
+{
+    SHIM_CHK_NULL (uniteCtx, "NULL Unite context", COMM_STATUS_FAILED);
+
+    XLinkStatus xLinkStatus = X_LINK_ERROR;
+
+#ifdef KMB
+    xLinkStatus = Unite_CheckDeviceEvent (uniteCtx);
+    SHIM_CHK_ERROR (xLinkStatus, "XLink Device Down", COMM_STATUS_FAILED);
+#endif
+
+    xLinkStatus = XLink_Borrow (uniteCtx->xLinkCtx, size, payload);
+    SHIM_CHK_ERROR (xLinkStatus, "Failed to borrow data", COMM_STATUS_FAILED);
+
+    return COMM_STATUS_SUCCESS;
+}
+
+CommStatus Unite_ReleaseBorrowed (HDDLShimUniteContext *uniteCtx, void *payload)
+{
+    SHIM_CHK_NULL (uniteCtx, "NULL Unite context", COMM_STATUS_FAILED);
+
+    XLinkStatus xLinkStatus = XLink_ReleaseBorrowed (uniteCtx->xLinkCtx, payload);
+    SHIM_CHK_ERROR (xLinkStatus, "Failed to release borrowed data", COMM_STATUS_FAILED);
+
+    return COMM_STATUS_SUCCESS;
+}
+
 CommStatus Unite_Disconnect (HDDLShimUniteContext *uniteCtx, int flag)
 {
     SHIM_CHK_NULL (uniteCtx, "NULL Unite context", COMM_STATUS_FAILED);
@@ -455,6 +551,7 @@ CommStatus Unite_Disconnect (HDDLShimUniteContext *uniteCtx, int flag)
 
     if (flag == TARGET)
     {
+	    HDDLMemoryMgr_DestroyBufferPool (&uniteCtx->xLinkCtx->rxPool);
 	    HDDLMemoryMgr_FreeMemory (uniteCtx->xLinkCtx);
     }
 
@@ -55,6 +55,15 @@
 HDDLShimUniteContext *Unite_ContextInit (xLinkChannelId_t channelTX, xLinkChannelId_t channelRX,
     uint64_t workloadId, uint32_t swDeviceId);
 
+//!
+//! \brief   Unite context for one more channel pair of the workload and device of mainUniteCtx.
+//!          channelTX and channelRX are only used without HDDLUnite to allocate channels.
+//! \return  HDDLShimUniteContext *
+//!          Return pointer if success, else NULL
+//!
+HDDLShimUniteContext *Unite_DynamicContextInit (HDDLShimUniteContext *mainUniteCtx,
+    xLinkChannelId_t channelTX, xLinkChannelId_t channelRX);
+
 //!
 //! \brief   Unite communcation initialization
 //! \return  CommStatus
@@ -76,6 +85,13 @@ CommStatus Unite_Connect (HDDLShimUniteContext *uniteCtx);
 //!
 CommStatus Unite_Write (HDDLShimUniteContext *uniteCtx, int size, void *payload);
 
+//!
+//! \brief   Unite communcation write operation gathering the payload from several buffers
+//! \return  CommStatus
+//!          Return COMM_STATUS_SUCCESS if success, else fail
+//!
+CommStatus Unite_WriteV (HDDLShimUniteContext *uniteCtx, struct iovec *iov, int iovCount);
+
 //!
 //! \brief   Unite communcation read operation
 //! \return  CommStatus
@@ -90,6 +106,27 @@ CommStatus Unite_Read (HDDLShimUniteContext *uniteCtx, int size, void *payload);
 //!
 CommStatus Unite_Peek (HDDLShimUniteContext *uniteCtx, uint32_t *size, void *payload);
 
+//!
+//! \brief   Hand a Unite_Peek payload back to the receive pool of the XLink channel
+//! \return  void
+//!          Return nothing
+//!
+void Unite_ReleasePayload (HDDLShimUniteContext *uniteCtx, void *payload, uint32_t size);
+
+//!
+//! \brief   Unite communcation read operation without copy, see XLink_Borrow
+//! \return  CommStatus
+//!          Return COMM_STATUS_SUCCESS if success, else fail
+//!
+CommStatus Unite_Borrow (HDDLShimUniteContext *uniteCtx, uint32_t *size, void **payload);
+
+//!
+//! \brief   Give a message obtained with Unite_Borrow back to xlink
+//! \return  CommStatus
+//!          Return COMM_STATUS_SUCCESS if success, else fail
+//!
+CommStatus Unite_ReleaseBorrowed (HDDLShimUniteContext *uniteCtx, void *payload);
+
 //!
 //! \brief   Unite communcation disconnection
 //! \return  CommStatus
@@ -59,6 +59,7 @@ HDDLShimXLinkContext *XLink_ContextInit (xLinkChannelId_t channelTX, xLinkChanne
 
     xLinkCtx->xLinkChannelTX = channelTX;
     xLinkCtx->xLinkChannelRX = channelRX;
+    XLink_InitReceive (xLinkCtx);
 
     lastChannel = channelTX > channelRX ? channelTX : channelRX;
     gLastChannel = lastChannel > gLastChannel ? lastChannel : gLastChannel;
@@ -66,6 +67,29 @@ HDDLShimXLinkContext *XLink_ContextInit (xLinkChannelId_t channelTX, xLinkChanne
     return xLinkCtx;
 }
 
+void XLink_ContextDestroy (HDDLShimXLinkContext *xLinkCtx)
+{
+    if (xLinkCtx == NULL)
+    {
+        return;
+    }
+
+    HDDLThreadMgr_DestroyMutex (&xLinkCtx->xLinkMutex);
+    HDDLMemoryMgr_DestroyBufferPool (&xLinkCtx->rxPool);
+    HDDLMemoryMgr_FreeMemory (xLinkCtx->gather);
+    HDDLMemoryMgr_FreeMemory (xLinkCtx);
+}
+
+void XLink_InitReceive (HDDLShimXLinkContext *xLinkCtx)
+{
+    char *zeroCopyEnv = getenv ("BYPASS_XLINK_ZEROCOPY");
+
+    HDDLMemoryMgr_InitBufferPool (&xLinkCtx->rxPool, BUFFER_POOL_RECEIVE);
+
+    xLinkCtx->zeroCopyRead = !(zeroCopyEnv && atoi (zeroCopyEnv) == 0);
+    xLinkCtx->fragmentSize = DATA_MAX_SEND_SIZE;
+}
+
 void XLink_GetLastChannel (uint16_t *lastChannel)
 {
     *lastChannel = gLastChannel;
@@ -137,7 +161,6 @@ XLinkStatus XLink_Initialize (HDDLShimXLinkContext *xLinkCtx, int flag)
         {
             SHIM_ERROR_MESSAGE ("Error initialize xlink pcie device with XLink status %d",
 		xLinkStatus);
-            HDDLMemoryMgr_FreeMemory (xLinkCtx);
             return xLinkStatus;
         }
     }
@@ -157,11 +180,25 @@ XLinkStatus XLink_Initialize (HDDLShimXLinkContext *xLinkCtx, int flag)
         uint32_t swInterface = GET_INTERFACE_FROM_SW_DEVICE_ID (swDeviceIdList[i]);
 	if (swInterface == SW_DEVICE_ID_PCIE_INTERFACE)
 	{
-            swDeviceId = swDeviceIdList[i];
-	    break;
+            // The device asked for, else the first one
+            if (swDeviceId == 0 || swDeviceIdList[i] == xLinkCtx->swDeviceId)
+            {
+                swDeviceId = swDeviceIdList[i];
+            }
+
+            if (xLinkCtx->swDeviceId == 0 || swDeviceId == xLinkCtx->swDeviceId)
+            {
+                break;
+            }
 	}
     }
 
+    if (xLinkCtx->swDeviceId != 0 && swDeviceId != xLinkCtx->swDeviceId)
+    {
+        SHIM_ERROR_MESSAGE ("Device %u not found, use device %u", xLinkCtx->swDeviceId,
+            swDeviceId);
+    }
+
 #ifdef KMB
     for (int i = 0; i < MAX_DEVICE; i++)
     {
@@ -188,7 +225,6 @@ XLinkStatus XLink_Initialize (HDDLShimXLinkContext *xLinkCtx, int flag)
 
 	if (xLinkStatus != X_LINK_SUCCESS)
 	{
-	     HDDLMemoryMgr_FreeMemory (xLinkCtx);
 	     return xLinkStatus;
         }
 #endif
@@ -233,12 +269,162 @@ XLinkStatus XLink_Initialize (HDDLShimXLinkContext *xLinkCtx, int flag)
     return xLinkStatus;
 }
 
+XLinkStatus XLink_GetDeviceList (uint32_t *swDeviceIdList, uint32_t *numDevices)
+{
+    XLinkStatus xLinkStatus;
+    uint32_t allDevices[MAX_DEVICE_LIST_SIZE];
+    uint32_t numAllDevices = 0;
+
+    *numDevices = 0;
+
+    if (!gXlinkInit)
+    {
+        xLinkStatus = xlink_initialize ();
+        SHIM_CHK_ERROR (xLinkStatus, "Error initialize xlink pcie device", xLinkStatus);
+        gXlinkInit = true;
+    }
+
+    xLinkStatus = xlink_get_device_list (allDevices, &numAllDevices);
+    SHIM_CHK_ERROR (xLinkStatus, "Error get device list", xLinkStatus);
+
+    for (uint32_t i = 0; i < numAllDevices && i < MAX_DEVICE_LIST_SIZE; i++)
+    {
+        if (GET_INTERFACE_FROM_SW_DEVICE_ID (allDevices[i]) == SW_DEVICE_ID_PCIE_INTERFACE)
+        {
+            swDeviceIdList[(*numDevices)++] = allDevices[i];
+        }
+    }
+
+    return X_LINK_SUCCESS;
+}
+
+// Write one xlink message of at most fragmentSize bytes
+static XLinkStatus XLink_WriteFragment (HDDLShimXLinkContext *xLinkCtx, uint8_t *payload,
+    uint32_t writeSize)
+{
+    XLinkStatus xLinkStatus = X_LINK_SUCCESS;
+
+    SHIM_NORMAL_MESSAGE ("[TX channel %u] Attempt to write", xLinkCtx->xLinkChannelTX);
+
+#if defined (XLINK_SECURE)
+    //Workaround as current secureXLink does not support xlink_write_control_data api
+    //TODO: Will re-examine once secureXLink support xlink_write_control data api
+    xLinkStatus = xlink_write_data (&xLinkCtx->xLinkHandler, xLinkCtx->xLinkChannelTX,
+        payload, writeSize);
+#else
+    // Use xlink_write_control_data for data size less than 100 bytes since it has less DMA
+    // transfer compare to xlink_write_data. The limit for xlink_write_control_data is 100 bytes.
+    // This is for performance optimization.
+    if (writeSize < 100)
+    {
+        xLinkStatus = xlink_write_control_data (&xLinkCtx->xLinkHandler,
+            xLinkCtx->xLinkChannelTX, payload, writeSize);
+    }
+    else
+    {
+        xLinkStatus = xlink_write_data (&xLinkCtx->xLinkHandler, xLinkCtx->xLinkChannelTX,
+            payload, writeSize);
+    }
+#endif
+
+    if (xLinkStatus != X_LINK_SUCCESS)
+    {
+        SHIM_ERROR_MESSAGE ("DeviceID %u Channel %u: Failed to write data to the device with "
+            "XLink status %d", xLinkCtx->xLinkHandler.sw_device_id, xLinkCtx->xLinkChannelTX,
+            xLinkStatus);
+        return xLinkStatus;
+    }
+
+    SHIM_NORMAL_MESSAGE ("[TX channel %u] Write done", xLinkCtx->xLinkChannelTX);
+
+    return xLinkStatus;
+}
+
+// Fragment size this end would like to use, set BYPASS_XLINK_FRAGMENT_SIZE=<KB> to change it
+static uint32_t XLink_LocalFragmentSize ()
+{
+    char *fragmentEnv = getenv ("BYPASS_XLINK_FRAGMENT_SIZE");
+    uint32_t fragmentSize = DATA_MAX_SEND_SIZE;
+
+    if (fragmentEnv && atoi (fragmentEnv) > 0)
+    {
+        fragmentSize = (uint32_t)atoi (fragmentEnv) * 1024;
+    }
+
+    if (fragmentSize < MIN_XLINK_FRAGMENT_SIZE)
+    {
+        fragmentSize = MIN_XLINK_FRAGMENT_SIZE;
+    }
+    else if (fragmentSize > MAX_XLINK_FRAGMENT_SIZE)
+    {
+        fragmentSize = MAX_XLINK_FRAGMENT_SIZE;
+    }
+
+    return fragmentSize;
+}
+
+// Both ends send their proposal and go with the smaller one, which fits the channels opened
+// on either side
+static XLinkStatus XLink_NegotiateFragmentSize (HDDLShimXLinkContext *xLinkCtx,
+    uint32_t localSize)
+{
+    XLinkStatus xLinkStatus;
+    HDDLShimXLinkHandshake local;
+    HDDLShimXLinkHandshake peer;
+    uint8_t *peerData = (uint8_t *)&peer;
+    uint32_t peerSize = 0;
+
+    local.magic = XLINK_HANDSHAKE_MAGIC;
+    local.fragmentSize = localSize;
+
+    xLinkStatus = XLink_WriteFragment (xLinkCtx, (uint8_t *)&local, sizeof (local));
+    SHIM_CHK_ERROR (xLinkStatus, "Failed to send fragment size", X_LINK_ERROR);
+
+    xLinkStatus = xlink_read_data (&xLinkCtx->xLinkHandler, xLinkCtx->xLinkChannelRX,
+        &peerData, &peerSize);
+    SHIM_CHK_ERROR (xLinkStatus, "Failed to receive fragment size", X_LINK_ERROR);
+
+    xLinkStatus = xlink_release_data (&xLinkCtx->xLinkHandler, xLinkCtx->xLinkChannelRX, NULL);
+    SHIM_CHK_ERROR (xLinkStatus, "Failed to release read data", X_LINK_ERROR);
+
+    if (peerSize != sizeof (peer) || peer.magic != XLINK_HANDSHAKE_MAGIC ||
+        peer.fragmentSize < MIN_XLINK_FRAGMENT_SIZE)
+    {
+        SHIM_ERROR_MESSAGE ("[RX channel %u] Invalid fragment size handshake",
+            xLinkCtx->xLinkChannelRX);
+        return X_LINK_ERROR;
+    }
+
+    xLinkCtx->fragmentSize = peer.fragmentSize < localSize ? peer.fragmentSize : localSize;
+
+    // Every message is received into a buffer of the fragment size
+    HDDLMemoryMgr_ResizeLargestPoolClass (&xLinkCtx->rxPool, xLinkCtx->fragmentSize);
+
+    // Writes are serialized on the channel, one gather buffer serves all of them
+    HDDLMemoryMgr_FreeMemory (xLinkCtx->gather);
+    xLinkCtx->gather = HDDLMemoryMgr_AllocMemory (xLinkCtx->fragmentSize);
+    SHIM_CHK_NULL (xLinkCtx->gather, "Failed to allocate gather buffer", X_LINK_ERROR);
+
+    SHIM_NORMAL_MESSAGE ("[TX channel %u] Fragment size %u", xLinkCtx->xLinkChannelTX,
+        xLinkCtx->fragmentSize);
+
+    return X_LINK_SUCCESS;
+}
+
 XLinkStatus XLink_Connect (HDDLShimXLinkContext *xLinkCtx)
 {
     XLinkStatus xLinkStatus;
+    uint32_t fragmentSize = XLink_LocalFragmentSize ();
+    uint32_t channelSize;
 
     SHIM_CHK_NULL (xLinkCtx, "NULL XLink context", COMM_STATUS_FAILED);
 
+    // The channel queues several fragments, so writing the next one does not wait for the
+    // receiver to release the last. Both ends still copy and transfer one fragment at a time.
+    // The headroom on top is the one a single fragment always had.
+    channelSize = XLINK_FRAGMENTS_IN_FLIGHT * fragmentSize + DATA_FRAGMENT_SIZE -
+        DATA_MAX_SEND_SIZE;
+
     xLinkStatus = xlink_connect (&xLinkCtx->xLinkHandler);
 
     if (!(xLinkStatus == X_LINK_SUCCESS || xLinkStatus == X_LINK_ALREADY_OPEN))
@@ -254,7 +440,7 @@ XLinkStatus XLink_Connect (HDDLShimXLinkContext *xLinkCtx)
     do
     {
         xLinkStatus = xlink_open_channel (&xLinkCtx->xLinkHandler, xLinkCtx->xLinkChannelTX,
-            OPERATION_TYPE, DATA_FRAGMENT_SIZE, OPEN_CHANNEL_TIMEOUT);
+            OPERATION_TYPE, channelSize, OPEN_CHANNEL_TIMEOUT);
     } while (xLinkStatus == X_LINK_TIMEOUT);
     SHIM_CHK_EQUAL (xLinkStatus, X_LINK_ERROR, "Failed to open channel", X_LINK_ERROR);
     SHIM_NORMAL_MESSAGE ("[TX channel %u] Open done", xLinkCtx->xLinkChannelTX);
@@ -266,24 +452,56 @@ XLinkStatus XLink_Connect (HDDLShimXLinkContext *xLinkCtx)
     do
     {
         xLinkStatus = xlink_open_channel (&xLinkCtx->xLinkHandler, xLinkCtx->xLinkChannelRX,
-            OPERATION_TYPE, DATA_FRAGMENT_SIZE, OPEN_CHANNEL_TIMEOUT);
+            OPERATION_TYPE, channelSize, OPEN_CHANNEL_TIMEOUT);
     } while (xLinkStatus == X_LINK_TIMEOUT);
-    SHIM_CHK_EQUAL (xLinkStatus, X_LINK_ERROR, "Failed to open channel", X_LINK_ERROR);
+
+    // Nothing is left open for the caller to clean up after a failed connect
+    if (xLinkStatus == X_LINK_ERROR)
+    {
+        SHIM_ERROR_MESSAGE ("Failed to open channel");
+        xlink_close_channel (&xLinkCtx->xLinkHandler, xLinkCtx->xLinkChannelTX);
+        return X_LINK_ERROR;
+    }
     SHIM_NORMAL_MESSAGE ("[RX channel %u] Open done", xLinkCtx->xLinkChannelRX);
+    xLinkCtx->rxClosed = false;
 
-    // XLink_Connect function considered fail only if return status from XLink function call
-    // is X_LINK_ERROR, which has already being handled in previous code segment. Thus return
-    // X_LINK_SUCCESS directly when reaching this point.
-    return X_LINK_SUCCESS;
+    // XLink_Connect function considered fail only if return status from the open calls is
+    // X_LINK_ERROR, which has already being handled in previous code segment.
+    xLinkStatus = XLink_NegotiateFragmentSize (xLinkCtx, fragmentSize);
+    if (xLinkStatus != X_LINK_SUCCESS)
+    {
+        xlink_close_channel (&xLinkCtx->xLinkHandler, xLinkCtx->xLinkChannelTX);
+        xlink_close_channel (&xLinkCtx->xLinkHandler, xLinkCtx->xLinkChannelRX);
+    }
+
+    return xLinkStatus;
 }
 
 XLinkStatus XLink_Write (HDDLShimXLinkContext *xLinkCtx, int size, void *payload)
+{
+    struct iovec iov;
+
+    SHIM_CHK_NULL (payload, "null payload", X_LINK_ERROR);
+
+    iov.iov_base = payload;
+    iov.iov_len = size;
+
+    return XLink_WriteV (xLinkCtx, &iov, 1);
+}
+
+XLinkStatus XLink_WriteV (HDDLShimXLinkContext *xLinkCtx, struct iovec *iov, int iovCount)
 {
     XLinkStatus xLinkStatus = X_LINK_SUCCESS;
-    uint32_t writeSize = size;
+    uint8_t *fragment = NULL;
+    uint32_t writeSize = 0;
+    uint32_t fragmentSize = 0;
+    uint32_t copySize = 0;
+    size_t offset = 0;
+    int index = 0;
 
     SHIM_CHK_NULL (xLinkCtx, "NULL XLink context", COMM_STATUS_FAILED);
-    SHIM_CHK_NULL (payload, "null payload", X_LINK_ERROR);
+    SHIM_CHK_NULL (iov, "null payload", X_LINK_ERROR);
+    SHIM_CHK_NULL (xLinkCtx->gather, "XLink channel not connected", X_LINK_ERROR);
 
 #ifdef KMB
     if (registerEventCallback == true)
@@ -293,83 +511,64 @@ XLinkStatus XLink_Write (HDDLShimXLinkContext *xLinkCtx, int size, void *payload
     }
 #endif
 
-    while (writeSize > DATA_MAX_SEND_SIZE)
+    for (int i = 0; i < iovCount; i++)
     {
-        SHIM_NORMAL_MESSAGE ("Splitting write data to smaller chunk");
-
-        SHIM_NORMAL_MESSAGE ("[TX channel %u] Attempt to write", xLinkCtx->xLinkChannelTX);
-        xLinkStatus = xlink_write_data (&xLinkCtx->xLinkHandler, xLinkCtx->xLinkChannelTX,
-            (uint8_t*)payload, (uint32_t)DATA_MAX_SEND_SIZE);
-
-	if (xLinkStatus != X_LINK_SUCCESS)
-	{
-	    SHIM_ERROR_MESSAGE ("DeviceID %u Channel %u: Failed to write data to the device "
-                "with XLink status %d", xLinkCtx->xLinkHandler.sw_device_id,
-                xLinkCtx->xLinkChannelTX, xLinkStatus);
-	    return xLinkStatus;
-	}
-
-        SHIM_NORMAL_MESSAGE ("[TX channel %u] Write done", xLinkCtx->xLinkChannelTX);
-
-        writeSize -= DATA_MAX_SEND_SIZE;
-        payload += DATA_MAX_SEND_SIZE;
+        writeSize += iov[i].iov_len;
     }
 
-#if defined (XLINK_SECURE)
-    //Workaround as current secureXLink does not support xlink_write_control_data api
-    //TODO: Will re-examine once secureXLink support xlink_write_control data api
-    SHIM_NORMAL_MESSAGE ("[TX channel %u] Attempt to write", xLinkCtx->xLinkChannelTX);
-
-    xLinkStatus = xlink_write_data (&xLinkCtx->xLinkHandler, xLinkCtx->xLinkChannelTX,
-                (uint8_t*)payload, (uint32_t)writeSize);
-
-    if (xLinkStatus != X_LINK_SUCCESS)
+    if (writeSize > xLinkCtx->fragmentSize)
     {
-        SHIM_ERROR_MESSAGE ("DeviceID %u Channel %u: Failed to write data to the device with "
-            "XLink status %d", xLinkCtx->xLinkHandler.sw_device_id, xLinkCtx->xLinkChannelTX,
-            xLinkStatus);
-        return xLinkStatus;
+        SHIM_NORMAL_MESSAGE ("Splitting write data to smaller chunk");
     }
 
-    SHIM_NORMAL_MESSAGE ("[TX channel %u] Write done", xLinkCtx->xLinkChannelTX);
-#else
-    if (writeSize > 0)
+    // The receiver expects the message in fragments of the agreed size. A fragment which sits
+    // in a single element goes out from the caller buffer, only fragments spanning several
+    // elements are gathered into the context buffer, the caller holds the write lock.
+    while (writeSize > 0)
     {
-        SHIM_NORMAL_MESSAGE ("[TX channel %u] Attempt to write", xLinkCtx->xLinkChannelTX);
+        fragmentSize = writeSize > xLinkCtx->fragmentSize ? xLinkCtx->fragmentSize : writeSize;
 
-	// Use xlink_write_control_data for data size less than 100 bytes since it has less DMA
-	// transfer compare to xlink_write_data. The limit for xlink_write_control_data is 100 bytes.
-	// This is for performance optimization.
-	if (writeSize < 100)
-	{
-            xLinkStatus = xlink_write_control_data (&xLinkCtx->xLinkHandler,
-                xLinkCtx->xLinkChannelTX, (uint8_t*)payload, (uint32_t)writeSize);
+        while (offset == iov[index].iov_len)
+        {
+            index++;
+            offset = 0;
+        }
 
-	    if (xLinkStatus != X_LINK_SUCCESS)
+        if (iov[index].iov_len - offset >= fragmentSize)
+        {
+            fragment = (uint8_t *)iov[index].iov_base + offset;
+            offset += fragmentSize;
+        }
+        else
+        {
+            for (uint32_t gathered = 0; gathered < fragmentSize; gathered += copySize)
             {
-		SHIM_ERROR_MESSAGE ("DeviceID %u Channel %u: Failed to write data to the device "
-                    "with XLink status %d", xLinkCtx->xLinkHandler.sw_device_id,
-                    xLinkCtx->xLinkChannelTX, xLinkStatus);
-		return xLinkStatus;
-            }
-	}
-	else
-	{
-            xLinkStatus = xlink_write_data (&xLinkCtx->xLinkHandler, xLinkCtx->xLinkChannelTX,
-                (uint8_t*)payload, (uint32_t)writeSize);
+                while (offset == iov[index].iov_len)
+                {
+                    index++;
+                    offset = 0;
+                }
 
-            if (xLinkStatus != X_LINK_SUCCESS)
-            {
-                SHIM_ERROR_MESSAGE ("DeviceID %u Channel %u: Failed to write data to the device "
-                    "with XLink status %d", xLinkCtx->xLinkHandler.sw_device_id,
-                    xLinkCtx->xLinkChannelTX, xLinkStatus);
-                return xLinkStatus;
+                copySize = iov[index].iov_len - offset;
+                copySize = copySize < fragmentSize - gathered ? copySize : fragmentSize - gathered;
+
+                HDDLMemoryMgr_Memcpy (xLinkCtx->gather + gathered,
+                    (uint8_t *)iov[index].iov_base + offset,
+                    fragmentSize - gathered, copySize);
+                offset += copySize;
             }
+
+            fragment = xLinkCtx->gather;
         }
-        SHIM_NORMAL_MESSAGE ("[TX channel %u] Write done", xLinkCtx->xLinkChannelTX);
 
+        xLinkStatus = XLink_WriteFragment (xLinkCtx, fragment, fragmentSize);
+        if (xLinkStatus != X_LINK_SUCCESS)
+        {
+            break;
+        }
+
+        writeSize -= fragmentSize;
     }
-#endif
 
     return xLinkStatus;
 }
@@ -390,7 +589,9 @@ XLinkStatus XLink_Read (HDDLShimXLinkContext *xLinkCtx, int size, void *payload)
     }
 #endif
 
-    while (readSize > DATA_MAX_SEND_SIZE)
+    // Fragments are read one after the other straight into place, each is handed back to
+    // xlink before the next one is read
+    while (readSize > xLinkCtx->fragmentSize)
     {
         SHIM_NORMAL_MESSAGE ("Reading huge data in smaller chunk");
 
@@ -443,9 +644,12 @@ XLinkStatus XLink_Read (HDDLShimXLinkContext *xLinkCtx, int size, void *payload)
 XLinkStatus XLink_Peek (HDDLShimXLinkContext *xLinkCtx, uint32_t *size, void **payload)
 {
     XLinkStatus xLinkStatus = X_LINK_SUCCESS;
+    void *message = NULL;
 
     SHIM_CHK_NULL (xLinkCtx, "NULL XLink context", COMM_STATUS_FAILED);
 
+    *payload = NULL;
+
 #ifdef KMB
     if (registerEventCallback == true)
     {
@@ -454,37 +658,126 @@ XLinkStatus XLink_Peek (HDDLShimXLinkContext *xLinkCtx, uint32_t *size, void **p
     }
 #endif
 
-    *payload = HDDLMemoryMgr_AllocMemory (DATA_MAX_SEND_SIZE);
+    message = HDDLMemoryMgr_PoolAlloc (&xLinkCtx->rxPool, xLinkCtx->fragmentSize);
+    SHIM_CHK_NULL (message, "Failed to allocate receive buffer", X_LINK_ERROR);
 
     SHIM_NORMAL_MESSAGE ("[RX channel %u] Attempt to read", xLinkCtx->xLinkChannelRX);
 
     xLinkStatus = xlink_read_data (&xLinkCtx->xLinkHandler, xLinkCtx->xLinkChannelRX,
-        (uint8_t **)payload, size);
+        (uint8_t **)&message, size);
 
     if (xLinkStatus != X_LINK_SUCCESS)
     {
 	SHIM_ERROR_MESSAGE ("DeviceID %u Channel %u: Failed to read data from device with XLink "
             "status %d", xLinkCtx->xLinkHandler.sw_device_id,
             xLinkCtx->xLinkChannelRX, xLinkStatus);
+        HDDLMemoryMgr_PoolRelease (&xLinkCtx->rxPool, message, xLinkCtx->fragmentSize);
         return xLinkStatus;
     }
 
-    SHIM_CHK_NULL (*payload, "Payload returned NULL", X_LINK_ERROR);
+    SHIM_CHK_NULL (message, "Payload returned NULL", X_LINK_ERROR);
 
     SHIM_NORMAL_MESSAGE ("[RX channel %u] Read done", xLinkCtx->xLinkChannelRX);
 
-    if (*size != DATA_MAX_SEND_SIZE)
+    // Small messages move to a buffer of their own size class, so that the whole message
+    // buffer is back in the pool right away instead of being held by the consumer
+    if (HDDLMemoryMgr_PoolClassOf (&xLinkCtx->rxPool, *size) <
+        HDDLMemoryMgr_PoolClassOf (&xLinkCtx->rxPool, xLinkCtx->fragmentSize))
+    {
+        *payload = HDDLMemoryMgr_PoolAlloc (&xLinkCtx->rxPool, *size);
+        if (*payload != NULL)
+        {
+            HDDLMemoryMgr_Memcpy (*payload, message, *size, *size);
+        }
+
+        HDDLMemoryMgr_PoolRelease (&xLinkCtx->rxPool, message, xLinkCtx->fragmentSize);
+    }
+    else
     {
-        *payload = HDDLMemoryMgr_ReallocMemory (*payload, *size);
-	SHIM_CHK_NULL (*payload, "Payload returned NULL", X_LINK_ERROR);
+        *payload = message;
     }
 
     xLinkStatus = xlink_release_data (&xLinkCtx->xLinkHandler, xLinkCtx->xLinkChannelRX, NULL);
     SHIM_CHK_ERROR (xLinkStatus, "Failed to release read data", X_LINK_ERROR);
 
+    SHIM_CHK_NULL (*payload, "Payload returned NULL", X_LINK_ERROR);
+
     return xLinkStatus;
 }
 
+void XLink_ReleasePayload (HDDLShimXLinkContext *xLinkCtx, void *payload, uint32_t size)
+{
+    HDDLMemoryMgr_PoolRelease (&xLinkCtx->rxPool, payload, size);
+}
+
+XLinkStatus XLink_Borrow (HDDLShimXLinkContext *xLinkCtx, uint32_t *size, void **payload)
+{
+    XLinkStatus xLinkStatus = X_LINK_SUCCESS;
+    uint8_t *message = NULL;
+
+    SHIM_CHK_NULL (xLinkCtx, "NULL XLink context", COMM_STATUS_FAILED);
+
+    *payload = NULL;
+
+#ifdef KMB
+    if (registerEventCallback == true)
+    {
+        xLinkStatus = XLink_CheckDeviceEvent (xLinkCtx);
+	SHIM_CHK_ERROR (xLinkStatus, "XLink Device Down", X_LINK_ERROR);
+    }
+#endif
+
+    SHIM_NORMAL_MESSAGE ("[RX channel %u] Attempt to borrow", xLinkCtx->xLinkChannelRX);
+
+    // Without a buffer of ours xlink returns its own receive buffer, which stays valid until
+    // it is released
+    xLinkStatus = xlink_read_data (&xLinkCtx->xLinkHandler, xLinkCtx->xLinkChannelRX,
+        &message, size);
+
+    if (xLinkStatus != X_LINK_SUCCESS)
+    {
+	SHIM_ERROR_MESSAGE ("DeviceID %u Channel %u: Failed to read data from device with XLink "
+            "status %d", xLinkCtx->xLinkHandler.sw_device_id,
+            xLinkCtx->xLinkChannelRX, xLinkStatus);
+        return xLinkStatus;
+    }
+
+    SHIM_CHK_NULL (message, "Payload returned NULL", X_LINK_ERROR);
+
+    SHIM_NORMAL_MESSAGE ("[RX channel %u] Borrow done", xLinkCtx->xLinkChannelRX);
+
+    *payload = message;
+
+    return xLinkStatus;
+}
+
+XLinkStatus XLink_ReleaseBorrowed (HDDLShimXLinkContext *xLinkCtx, void *payload)
+{
+    XLinkStatus xLinkStatus;
+
+    SHIM_CHK_NULL (xLinkCtx, "NULL XLink context", COMM_STATUS_FAILED);
+
+    xLinkStatus = xlink_release_data (&xLinkCtx->xLinkHandler, xLinkCtx->xLinkChannelRX,
+        (uint8_t *)payload);
+    SHIM_CHK_ERROR (xLinkStatus, "Failed to release borrowed data", X_LINK_ERROR);
+
+    return xLinkStatus;
+}
+
+XLinkStatus XLink_Shutdown (HDDLShimXLinkContext *xLinkCtx)
+{
+    XLinkStatus xLinkStatus;
+
+    SHIM_CHK_NULL (xLinkCtx, "NULL XLink context", X_LINK_ERROR);
+
+    // A read blocked on the channel returns with an error once it is closed
+    xLinkStatus = xlink_close_channel (&xLinkCtx->xLinkHandler, xLinkCtx->xLinkChannelRX);
+    SHIM_CHK_ERROR (xLinkStatus, "Failed to close RX channel", X_LINK_ERROR);
+    xLinkCtx->rxClosed = true;
+
+    return X_LINK_SUCCESS;
+}
+
 XLinkStatus XLink_Disconnect (HDDLShimXLinkContext *xLinkCtx, int flag)
 {
     XLinkStatus xLinkStatus = X_LINK_SUCCESS;
@@ -497,10 +790,16 @@ XLinkStatus XLink_Disconnect (HDDLShimXLinkContext *xLinkCtx, int flag)
     SHIM_CHK_ERROR (xLinkStatus, "Failed to close TX channel", X_LINK_ERROR);
     SHIM_NORMAL_MESSAGE ("[TX channel %u] Close done", xLinkCtx->xLinkChannelTX);
 
-    SHIM_NORMAL_MESSAGE ("[RX channel %u] Attempt to close", xLinkCtx->xLinkChannelRX);
-    xLinkStatus = xlink_close_channel (&xLinkCtx->xLinkHandler, xLinkCtx->xLinkChannelRX);
-    SHIM_CHK_ERROR (xLinkStatus, "Failed to close RX channel", X_LINK_ERROR);
-    SHIM_NORMAL_MESSAGE ("[RX channel %u] Close done", xLinkCtx->xLinkChannelRX);
+    if (!xLinkCtx->rxClosed)
+    {
+        SHIM_NORMAL_MESSAGE ("[RX channel %u] Attempt to close", xLinkCtx->xLinkChannelRX);
+        xLinkStatus = xlink_close_channel (&xLinkCtx->xLinkHandler, xLinkCtx->xLinkChannelRX);
+        SHIM_CHK_ERROR (xLinkStatus, "Failed to close RX channel", X_LINK_ERROR);
+        SHIM_NORMAL_MESSAGE ("[RX channel %u] Close done", xLinkCtx->xLinkChannelRX);
+    }
+
+    HDDLMemoryMgr_FreeMemory (xLinkCtx->gather);
+    xLinkCtx->gather = NULL;
 
     if (flag == HOST)
     {
@@ -517,8 +816,12 @@ XLinkStatus XLink_Disconnect (HDDLShimXLinkContext *xLinkCtx, int flag)
 	//    SHIM_CHK_ERROR (xLinkStatus, "Failed to unregister device", X_LINK_ERROR);
 	//}
 #endif
-        HDDLThreadMgr_DestroyMutex (&xLinkCtx->xLinkMutex);
-        HDDLMemoryMgr_FreeMemory (xLinkCtx);
+        XLink_ContextDestroy (xLinkCtx);
+    }
+    else
+    {
+        // The target keeps the context for the next host, only drop the cached buffers
+        HDDLMemoryMgr_FlushBufferPool (&xLinkCtx->rxPool);
     }
 
     return xLinkStatus;
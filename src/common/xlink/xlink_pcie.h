@@ -31,6 +31,8 @@
 #ifndef __XLINK_PCIE_H__
 #define __XLINK_PCIE_H__
 
+#include <sys/uio.h>
+
 #include "hddl_va_shim_common.h"
 #include "thread_manager.h"
 #include "memory_manager.h"
@@ -42,6 +44,21 @@
 //!
 HDDLShimXLinkContext *XLink_ContextInit (xLinkChannelId_t channelTX, xLinkChannelId_t channelRX);
 
+//!
+//! \brief   Free an XLINK context whose channels are closed or were never opened
+//! \return  void
+//!          Return nothing
+//!
+void XLink_ContextDestroy (HDDLShimXLinkContext *xLinkCtx);
+
+//!
+//! \brief   Set up the receive side of a XLINK context, the buffer pool, the zero copy
+//!          read setting and the default fragment size
+//! \return  void
+//!          Return nothing
+//!
+void XLink_InitReceive (HDDLShimXLinkContext *xLinkCtx);
+
 //!
 //! \brief   XLINK communcation initialization
 //! \return  XLinkStatus
@@ -50,7 +67,15 @@ HDDLShimXLinkContext *XLink_ContextInit (xLinkChannelId_t channelTX, xLinkChanne
 XLinkStatus XLink_Initialize (HDDLShimXLinkContext *xLinkCtx, int flag);
 
 //!
-//! \brief   XLINK communcation connection
+//! \brief   List the PCIe devices, at most MAX_DEVICE_LIST_SIZE
+//! \return  XLinkStatus
+//!          Return X_LINK_SUCCESS if success, else fail
+//!
+XLinkStatus XLink_GetDeviceList (uint32_t *swDeviceIdList, uint32_t *numDevices);
+
+//!
+//! \brief   XLINK communcation connection. Both ends agree on the fragment size once the
+//!          channels are open, see BYPASS_XLINK_FRAGMENT_SIZE
 //! \return  XLinkStatus
 //!          Return COMM_STATUS_SUCCESS if success, else fail
 //!
@@ -63,6 +88,13 @@ XLinkStatus XLink_Connect (HDDLShimXLinkContext *xLinkCtx);
 //!
 XLinkStatus XLink_Write (HDDLShimXLinkContext *xLinkCtx, int size, void *payload);
 
+//!
+//! \brief   XLINK communcation write operation gathering the payload from several buffers
+//! \return  XLinkStatus
+//!          Return COMM_STATUS_SUCCESS if success, else fail
+//!
+XLinkStatus XLink_WriteV (HDDLShimXLinkContext *xLinkCtx, struct iovec *iov, int iovCount);
+
 //!
 //! \brief   XLINK communcation read operation
 //! \return  XLinkStatus
@@ -71,12 +103,44 @@ XLinkStatus XLink_Write (HDDLShimXLinkContext *xLinkCtx, int size, void *payload
 XLinkStatus XLink_Read (HDDLShimXLinkContext *xLinkCtx, int size, void *payload);
 
 //!
-//! \brief   XLINK communcation read operation for dynamic data
+//! \brief   XLINK communcation read operation for dynamic data. The payload is taken from the
+//!          channel receive pool, see XLink_ReleasePayload.
 //! \return  XLinkStatus
 //!          Return COMM_STATUS_SUCCESS if success, else fail
 //!
 XLinkStatus XLink_Peek (HDDLShimXLinkContext *xLinkCtx, uint32_t *size, void **payload);
 
+//!
+//! \brief   Hand a XLink_Peek payload back to the channel receive pool. size is the one
+//!          XLink_Peek returned, or the new size if the payload has been reallocated.
+//! \return  void
+//!          Return nothing
+//!
+void XLink_ReleasePayload (HDDLShimXLinkContext *xLinkCtx, void *payload, uint32_t size);
+
+//!
+//! \brief   XLINK communcation read operation without copy. The next message is handed out
+//!          in the xlink receive buffer, which stays valid until XLink_ReleaseBorrowed.
+//!          Borrowed messages may be released in any order.
+//! \return  XLinkStatus
+//!          Return COMM_STATUS_SUCCESS if success, else fail
+//!
+XLinkStatus XLink_Borrow (HDDLShimXLinkContext *xLinkCtx, uint32_t *size, void **payload);
+
+//!
+//! \brief   Give a message obtained with XLink_Borrow back to xlink
+//! \return  XLinkStatus
+//!          Return COMM_STATUS_SUCCESS if success, else fail
+//!
+XLinkStatus XLink_ReleaseBorrowed (HDDLShimXLinkContext *xLinkCtx, void *payload);
+
+//!
+//! \brief   Close the RX channel ahead of XLink_Disconnect so a read blocked on it returns
+//! \return  XLinkStatus
+//!          Return X_LINK_SUCCESS if success, else fail
+//!
+XLinkStatus XLink_Shutdown (HDDLShimXLinkContext *xLinkCtx);
+
 //!
 //! \brief   XLINK communcation disconnection
 //! \return  XLinkStatus
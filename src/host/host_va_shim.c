@@ -35,6 +35,18 @@
 
 pthread_mutex_t gMutex;
 
+// Tells driver contexts apart for the comm context cached by each thread, an address could be
+// reused by the next driver context. Counted under gMutex.
+static uint64_t gDriverSerial = 0;
+static __thread uint64_t tlsCommCtxSerial = 0;
+static __thread HDDLShimCommContext *tlsCommCtx = NULL;
+
+static void HDDLVAShim_ChannelPoolInit (HDDLVAShimDriverContext *vaShimCtx);
+static void HDDLVAShim_ChannelPoolDestroy (HDDLVAShimDriverContext *vaShimCtx);
+static void HDDLVAShim_CommContextAttachBulk (HDDLVAShimDriverContext *vaShimCtx,
+    HDDLShimCommContext *commCtx);
+static void HDDLVAShim_CommContextDestroy (HDDLShimCommContext *commCtx);
+
 VAStatus __vaDriverInit (VADriverContextP ctx)
 {
     SHIM_PROFILE_INIT ();
@@ -150,6 +162,7 @@ VAStatus HDDLVAShim_DriverInit (VADriverContextP ctx)
     HDDLVAShimDriverContext *vaShimCtx;
     HDDLShimCommContext *commCtx;
     CommStatus commStatus;
+    char *bindEnv;
 
     SHIM_FUNCTION_ENTER ();
     SHIM_CHK_NULL (ctx, "ctx ptr returned NULL", VA_STATUS_ERROR_INVALID_CONTEXT);
@@ -170,6 +183,9 @@ VAStatus HDDLVAShim_DriverInit (VADriverContextP ctx)
     SHIM_CHK_NULL (vaShimCtx, "Failed to create SHIM context",
         VA_STATUS_ERROR_ALLOCATION_FAILED);
 
+    vaShimCtx->serial = ++gDriverSerial;
+    bindEnv = getenv ("BYPASS_CONTEXT_CHANNEL");
+
     commCtx = HDDLVAShim_CommContextSetup (vaShimCtx, getpid (), syscall (SYS_gettid),
         MAIN_COMM_CONTEXT);
     if (commCtx == NULL)
@@ -181,6 +197,13 @@ VAStatus HDDLVAShim_DriverInit (VADriverContextP ctx)
 
     vaShimCtx->uiRefCount++;
 
+    // Opt-in: contexts driven from one thread, such as a transcode, do not wait for each other
+    if (bindEnv != NULL && atoi (bindEnv) != 0)
+    {
+        vaShimCtx->bindContextChannel = IS_XLINK_MODE (commCtx) || IS_UNITE_MODE (commCtx);
+    }
+    SHIM_NORMAL_MESSAGE ("Context Channel Mode: %d", vaShimCtx->bindContextChannel);
+
     // Construct the HDDLVAData structure to send
     vaDataTX.vaData.vaFunctionID = HDDLVAMedia_DriverInit;
     vaDataTX.vaData.size = sizeof (HDDLVAMedia_DriverInitTX);
@@ -191,6 +214,8 @@ VAStatus HDDLVAShim_DriverInit (VADriverContextP ctx)
 
     if (commStatus != COMM_STATUS_SUCCESS)
     {
+        Comm_BatchCoalesceStop (commCtx);
+        Comm_PipelineStop (commCtx);
 	Comm_MutexDestroy (commCtx);
         Comm_CloseSocket (commCtx, HOST);
         HDDLMemoryMgr_FreeMemory (commCtx);
@@ -203,6 +228,8 @@ VAStatus HDDLVAShim_DriverInit (VADriverContextP ctx)
     if ( (vaDataRX.vaData.vaFunctionID != HDDLVAMedia_DriverInit) ||
         (vaDataRX.vaData.size != sizeof (HDDLVAMedia_DriverInitRX)))
     {
+        Comm_BatchCoalesceStop (commCtx);
+        Comm_PipelineStop (commCtx);
 	Comm_MutexDestroy (commCtx);
         Comm_CloseSocket (commCtx, HOST);
         HDDLMemoryMgr_FreeMemory (commCtx);
@@ -230,10 +257,19 @@ VAStatus HDDLVAShim_DriverInit (VADriverContextP ctx)
     HDDLVAShim_HeapInit (vaShimCtx);
 
     // Init mutexs
-    HDDLThreadMgr_InitMutex (&vaShimCtx->bufferMutex);
+    HDDLThreadMgr_InitRWLock (&vaShimCtx->bufferLock);
     HDDLThreadMgr_InitMutex (&vaShimCtx->imageMutex);
     HDDLThreadMgr_InitMutex (&vaShimCtx->contextMutex);
 
+    HDDLMemoryMgr_InitBufferPool (&vaShimCtx->shadowPool, BUFFER_POOL_SHADOW);
+
+    // The target has to know the display before it can serve a second pair for it
+    HDDLVAShim_CommContextAttachBulk (vaShimCtx, commCtx);
+
+    HDDLVAShim_ChannelPoolInit (vaShimCtx);
+
+    Comm_UpdateDeviceLoad (commCtx, 1, 0);
+
     ctx->pDriverData = vaShimCtx;
 
     HDDLThreadMgr_UnlockMutex (&gMutex);
@@ -259,7 +295,8 @@ VAStatus HDDLVAShim_Terminate (VADriverContextP ctx)
     vaShimCtx = HDDL_GetVAShimContext (ctx);
     SHIM_CHK_NULL (vaShimCtx, "VAShimCtx returned NULL", VA_STATUS_ERROR_INVALID_CONTEXT);
 
-    commCtx = HDDLVAShim_GetCommContext (vaShimCtx);
+    // The target closes the display on the channel it was opened on
+    commCtx = vaShimCtx->mainCommCtx;
     SHIM_CHK_NULL (commCtx, "commCtx return NULL", VA_STATUS_ERROR_INVALID_CONTEXT);
 
     if (vaShimCtx->uiRefCount > 1)
@@ -302,6 +339,16 @@ VAStatus HDDLVAShim_Terminate (VADriverContextP ctx)
     HDDLVAShim_DestroyBufferHeap (ctx);
     HDDLVAShim_DestroyImageHeap (ctx);
     HDDLVAShim_DestroyContextHeap (ctx);
+    HDDLVAShim_ChannelPoolDestroy (vaShimCtx);
+
+    // Contexts the application never destroyed go with the display
+    Comm_UpdateDeviceLoad (commCtx, -1, -(int32_t)vaShimCtx->uiNumVAContext);
+
+    if (commCtx->bulkCtx)
+    {
+        HDDLVAShim_CommContextDestroy (commCtx->bulkCtx);
+        commCtx->bulkCtx = NULL;
+    }
 
     commStatus = Comm_Disconnect(commCtx, HOST);
     SHIM_CHK_ERROR(commStatus, "Error to Disconnect", VA_STATUS_ERROR_UNKNOWN);
@@ -322,16 +369,22 @@ VAStatus HDDLVAShim_Terminate (VADriverContextP ctx)
         HDDLMemoryMgr_FreeMemory (vaShimCtx->contextHeap->pHeapBase);
     }
 
+    HDDLMemoryMgr_DestroyIdTable (vaShimCtx->bufferHeap->index);
+    HDDLMemoryMgr_DestroyIdTable (vaShimCtx->imageHeap->index);
+    HDDLMemoryMgr_DestroyIdTable (vaShimCtx->contextHeap->index);
+
     // Destroy/Free the heap
     HDDLMemoryMgr_FreeMemory (vaShimCtx->bufferHeap);
     HDDLMemoryMgr_FreeMemory (vaShimCtx->imageHeap);
     HDDLMemoryMgr_FreeMemory (vaShimCtx->contextHeap);
 
     // Destroy the mutexs
-    HDDLThreadMgr_DestroyMutex (&vaShimCtx->bufferMutex);
+    HDDLThreadMgr_DestroyRWLock (&vaShimCtx->bufferLock);
     HDDLThreadMgr_DestroyMutex (&vaShimCtx->imageMutex);
     HDDLThreadMgr_DestroyMutex (&vaShimCtx->contextMutex);
 
+    HDDLMemoryMgr_DestroyBufferPool (&vaShimCtx->shadowPool);
+
     // Resource check
     if (vaShimCtx->uiNumBuffer != 0)
     {
@@ -352,7 +405,8 @@ VAStatus HDDLVAShim_Terminate (VADriverContextP ctx)
 
     if (IS_BATCH (commCtx))
     {
-        HDDLMemoryMgr_FreeMemory (commCtx->batchPayload);
+        Comm_BatchCoalesceStop (commCtx);
+        Comm_BatchDestroy (commCtx);
     }
 
     HDDLMemoryMgr_FreeMemory (commCtx);
@@ -520,6 +574,17 @@ VAStatus HDDLVAShim_CreateContext (VADriverContextP ctx, VAConfigID configId,
     vaStatus = vaDataRX.ret;
     *context = vaDataRX.context; // return VAContextID
 
+    if (vaStatus == VA_STATUS_SUCCESS)
+    {
+        __atomic_add_fetch (&vaShimCtx->uiNumVAContext, 1, __ATOMIC_RELAXED);
+        Comm_UpdateDeviceLoad (vaShimCtx->mainCommCtx, 0, 1);
+    }
+
+    if (vaStatus == VA_STATUS_SUCCESS && vaShimCtx->bindContextChannel)
+    {
+        HDDLVAShim_BindContextChannel (vaShimCtx, *context);
+    }
+
     SHIM_FUNCTION_EXIT ();
     return vaStatus;
 }
@@ -538,7 +603,7 @@ VAStatus HDDLVAShim_DestroyContext (VADriverContextP ctx, VAContextID context)
     HDDLVAShimDriverContext *vaShimCtx = HDDL_GetVAShimContext (ctx);
     SHIM_CHK_NULL (vaShimCtx, "VAShimCtx returned NULL", VA_STATUS_ERROR_INVALID_CONTEXT);
 
-    commCtx = HDDLVAShim_GetCommContext (vaShimCtx);
+    commCtx = HDDLVAShim_GetContextCommContext (vaShimCtx, context);
     SHIM_CHK_NULL (commCtx, "commCtx return NULL", VA_STATUS_ERROR_INVALID_CONTEXT);
 
     // Construct the HDDLVAData structure to send
@@ -549,6 +614,13 @@ VAStatus HDDLVAShim_DestroyContext (VADriverContextP ctx, VAContextID context)
     commStatus = Comm_Submission (commCtx, HDDLVADestroyContext, COMM_READ_FULL,
         sizeof (HDDLVADestroyContextTX), (void *)&vaDataTX,
         sizeof (HDDLVADestroyContextRX), (void **)&vaDataRX);
+
+    // The channel of the context goes away with it, whether the target agreed or not
+    if (vaShimCtx->bindContextChannel)
+    {
+        HDDLVAShim_UnbindContextChannel (vaShimCtx, context);
+    }
+
     SHIM_CHK_ERROR (commStatus, "Com operation failed", VA_STATUS_ERROR_UNKNOWN);
 
     // Returned function ID and size needed to match
@@ -560,6 +632,12 @@ VAStatus HDDLVAShim_DestroyContext (VADriverContextP ctx, VAContextID context)
 
     vaStatus = vaDataRX.ret;
 
+    if (vaStatus == VA_STATUS_SUCCESS)
+    {
+        __atomic_sub_fetch (&vaShimCtx->uiNumVAContext, 1, __ATOMIC_RELAXED);
+        Comm_UpdateDeviceLoad (vaShimCtx->mainCommCtx, 0, -1);
+    }
+
     SHIM_FUNCTION_EXIT ();
     return vaStatus;
 }
@@ -672,11 +750,14 @@ VAStatus HDDLVAShim_DestroySurfaces (VADriverContextP ctx, VASurfaceID *surfaceL
 VAStatus HDDLVAShim_CreateBuffer (VADriverContextP ctx, VAContextID context, VABufferType type,
     unsigned int size, unsigned int numElement, void *data, VABufferID *bufId)
 {
+    HDDLVACreateBufferTX vaDataTX;
     HDDLVACreateBufferRX vaDataRX;
     HDDLShimCommContext *commCtx;
     CommStatus commStatus;
+    CommReadOp readOp = COMM_READ_NONE;
     VAStatus vaStatus;
     unsigned int bufferSize = size * numElement;
+    struct iovec iov[2];
 
     SHIM_FUNCTION_ENTER ();
     SHIM_CHK_NULL (ctx, "nullptr ctx", VA_STATUS_ERROR_INVALID_CONTEXT);
@@ -687,7 +768,7 @@ VAStatus HDDLVAShim_CreateBuffer (VADriverContextP ctx, VAContextID context, VAB
     HDDLVAShimDriverContext *vaShimCtx = HDDL_GetVAShimContext (ctx);
     SHIM_CHK_NULL (vaShimCtx, "nullptr VAShimCtx", VA_STATUS_ERROR_INVALID_CONTEXT);
 
-    commCtx = HDDLVAShim_GetCommContext (vaShimCtx);
+    commCtx = HDDLVAShim_GetContextCommContext (vaShimCtx, context);
     SHIM_CHK_NULL (commCtx, "commCtx return NULL", VA_STATUS_ERROR_INVALID_CONTEXT);
 
     if (data == NULL)
@@ -695,30 +776,38 @@ VAStatus HDDLVAShim_CreateBuffer (VADriverContextP ctx, VAContextID context, VAB
         bufferSize = 0;
     }
 
-    typedef struct {
-        HDDLVACreateBufferTX vaDataTX;
-        unsigned char data[bufferSize];
-    }HDDLVADataFullTX;
-
-
-    HDDLVADataFullTX vaDataFullTX;
-    vaDataFullTX.vaDataTX.vaData.vaFunctionID = HDDLVACreateBuffer;
-    vaDataFullTX.vaDataTX.vaData.size = sizeof (HDDLVADataFullTX);
-    vaDataFullTX.vaDataTX.context = context;
-    vaDataFullTX.vaDataTX.type = type;
-    vaDataFullTX.vaDataTX.size = size;
-    vaDataFullTX.vaDataTX.numElement = numElement;
+    vaDataTX.vaData.vaFunctionID = HDDLVACreateBuffer;
+    vaDataTX.vaData.size = sizeof (HDDLVACreateBufferTX) + bufferSize;
+    vaDataTX.context = context;
+    vaDataTX.type = type;
+    vaDataTX.size = size;
+    vaDataTX.numElement = numElement;
 
-    // Data might be NULL. Copy data only when it's not null to avoid segfault
-    if (data)
+    // The buffer ID is handed out here, so nothing has to wait for the target. A failure shows
+    // up once the buffer is used. Coded buffer IDs are embedded in the encoder parameters the
+    // driver reads, those have to come from the target. XLINK and UNITE open channels per
+    // thread, per context and for bulk data, and a call using the ID on one of those could
+    // reach the target before the unanswered create does, so there the create is answered.
+    if (type == VAEncCodedBufferType || IS_XLINK_MODE (vaShimCtx->mainCommCtx) ||
+        IS_UNITE_MODE (vaShimCtx->mainCommCtx) || vaShimCtx->bindContextChannel)
+    {
+        vaDataTX.bufId = VA_INVALID_ID;
+        readOp = COMM_READ_FULL;
+    }
+    else
     {
-        HDDLMemoryMgr_Memcpy (vaDataFullTX.data, data, sizeof (vaDataFullTX.data),
-            sizeof (unsigned char) * numElement * size);
+        vaDataTX.bufId = HDDLVAShim_NewBufferId (vaShimCtx);
     }
 
-    commStatus = Comm_Submission (commCtx, HDDLVACreateBuffer, COMM_READ_FULL,
-        sizeof (HDDLVADataFullTX), (void *)&vaDataFullTX,
-        sizeof (HDDLVACreateBufferRX), (void **)&vaDataRX);
+    // The initial data follows the header on the wire and is sent from the user buffer.
+    // Data might be NULL, in which case only the header is sent.
+    iov[0].iov_base = &vaDataTX;
+    iov[0].iov_len = sizeof (HDDLVACreateBufferTX);
+    iov[1].iov_base = data;
+    iov[1].iov_len = bufferSize;
+
+    commStatus = Comm_SubmissionV (commCtx, HDDLVACreateBuffer, readOp, iov,
+        data ? 2 : 1, sizeof (HDDLVACreateBufferRX), (void **)&vaDataRX);
     SHIM_CHK_ERROR (commStatus, "Com operation failed", VA_STATUS_ERROR_UNKNOWN);
 
     if ( (vaDataRX.vaData.vaFunctionID != HDDLVACreateBuffer) ||
@@ -731,7 +820,7 @@ VAStatus HDDLVAShim_CreateBuffer (VADriverContextP ctx, VAContextID context, VAB
     SHIM_CHK_ERROR (vaStatus, "VA status failed", VA_STATUS_ERROR_UNKNOWN);
 
     // Get VABufferID from target
-    *bufId = vaDataRX.bufId;
+    *bufId = (readOp == COMM_READ_NONE) ? vaDataTX.bufId : vaDataRX.bufId;
 
     vaStatus = HDDLVAShim_CreateInternalBufferAtHeap (vaShimCtx, context, type, size, numElement,
         *bufId, (void*)data);
@@ -755,7 +844,7 @@ VAStatus HDDLVAShim_DestroyBuffer (VADriverContextP ctx, VABufferID bufId)
     SHIM_CHK_NULL (vaShimCtx, "nullptr VAShimCtx", VA_STATUS_ERROR_INVALID_CONTEXT);
     SHIM_CHK_NULL (vaShimCtx->bufferHeap, "nullptr VAShimCtx", VA_STATUS_ERROR_INVALID_CONTEXT);
 
-    commCtx = HDDLVAShim_GetCommContext (vaShimCtx);
+    commCtx = HDDLVAShim_GetBufferCommContext (vaShimCtx, bufId);
     SHIM_CHK_NULL (commCtx, "commCtx return NULL", VA_STATUS_ERROR_INVALID_CONTEXT);
 
     vaDataTX.vaData.vaFunctionID = HDDLVADestroyBuffer;
@@ -782,6 +871,73 @@ VAStatus HDDLVAShim_DestroyBuffer (VADriverContextP ctx, VABufferID bufId)
     return vaStatus;
 }
 
+// Give the host copy of a buffer back to the shadow pool, coded buffers own their segments
+static void HDDLVAShim_ReleaseShadowBuffer (HDDLVAShimDriverContext *vaShimCtx,
+    HDDLVABuffer *vaBuffer)
+{
+    if (vaBuffer->type == VAEncCodedBufferType)
+    {
+        if (vaBuffer->pData)
+        {
+            HDDLVAShim_DestroyInternalVAEncCodedBuffer (vaBuffer);
+        }
+    }
+    else
+    {
+        HDDLMemoryMgr_PoolRelease (&vaShimCtx->shadowPool, vaBuffer->pData,
+            vaBuffer->uiSize * vaBuffer->uiNumElement);
+        vaBuffer->pData = NULL;
+    }
+
+    HDDLThreadMgr_DestroyMutex (&vaBuffer->bufMutex);
+    HDDLMemoryMgr_PoolRelease (&vaShimCtx->shadowPool, vaBuffer, sizeof (HDDLVABuffer));
+}
+
+// Look a buffer up under the shared heap lock and lock the buffer itself, so that a round trip
+// made for it does not hold up other buffers. The buffer stays valid until
+// HDDLVAShim_PutBuffer even if another thread destroys it meanwhile.
+static HDDLVABuffer *HDDLVAShim_GetBuffer (HDDLVAShimDriverContext *vaShimCtx, VABufferID bufId)
+{
+    HDDLVABuffer *vaBuffer;
+    uint32_t hostBufId;
+
+    HDDLThreadMgr_ReadLock (&vaShimCtx->bufferLock);
+
+    vaBuffer = HDDLMemoryMgr_GetBufferFromVABufferID (vaShimCtx, bufId, &hostBufId);
+    if (vaBuffer != NULL)
+    {
+        __atomic_add_fetch (&vaBuffer->iUseCount, 1, __ATOMIC_RELAXED);
+    }
+
+    HDDLThreadMgr_UnlockRWLock (&vaShimCtx->bufferLock);
+
+    if (vaBuffer != NULL)
+    {
+        HDDLThreadMgr_LockMutex (&vaBuffer->bufMutex);
+    }
+
+    return vaBuffer;
+}
+
+static void HDDLVAShim_PutBuffer (HDDLVAShimDriverContext *vaShimCtx, HDDLVABuffer *vaBuffer)
+{
+    bool release;
+
+    HDDLThreadMgr_UnlockMutex (&vaBuffer->bufMutex);
+
+    // bReleased only changes under the exclusive lock, so it cannot be set between the last
+    // user leaving and the check below
+    HDDLThreadMgr_ReadLock (&vaShimCtx->bufferLock);
+    release = __atomic_sub_fetch (&vaBuffer->iUseCount, 1, __ATOMIC_ACQ_REL) == 0 &&
+        vaBuffer->bReleased;
+    HDDLThreadMgr_UnlockRWLock (&vaShimCtx->bufferLock);
+
+    if (release)
+    {
+        HDDLVAShim_ReleaseShadowBuffer (vaShimCtx, vaBuffer);
+    }
+}
+
 VAStatus HDDLVAShim_MapBuffer (VADriverContextP ctx, VABufferID bufId, void **buf)
 {
     HDDLVAMapBufferTX vaDataTX;
@@ -789,11 +945,8 @@ VAStatus HDDLVAShim_MapBuffer (VADriverContextP ctx, VABufferID bufId, void **bu
     HDDLShimCommContext *commCtx;
     VAStatus vaStatus;
     HDDLVABuffer *vaBuffer;
-    uint32_t hostBufId;
     unsigned int dataSize;
-    void *peekData = NULL;
-    uint32_t peekSize = sizeof (HDDLVAMapBufferRX);
-    uint32_t fullRXSize = 0;
+    HDDLShimCommMessage reply;
     CommMode commMode = COMM_MODE_UNKNOWN;
     CommStatus commStatus = COMM_STATUS_FAILED;
 
@@ -804,20 +957,17 @@ VAStatus HDDLVAShim_MapBuffer (VADriverContextP ctx, VABufferID bufId, void **bu
     SHIM_CHK_NULL (vaShimCtx, "nullptr VAShimCtx", VA_STATUS_ERROR_INVALID_CONTEXT);
     SHIM_CHK_NULL (vaShimCtx->bufferHeap, "nullptr VAShimCtx", VA_STATUS_ERROR_INVALID_CONTEXT);
 
-    commCtx = HDDLVAShim_GetCommContext (vaShimCtx);
+    commCtx = HDDLVAShim_GetBufferCommContext (vaShimCtx, bufId);
     SHIM_CHK_NULL (commCtx, "commCtx return NULL", VA_STATUS_ERROR_INVALID_CONTEXT);
 
     commMode = COMM_MODE (commCtx);
     SHIM_CHK_EQUAL (commMode, COMM_MODE_UNKNOWN, "Invalid commumication mode",
         VA_STATUS_ERROR_INVALID_CONTEXT);
 
-    HDDLThreadMgr_LockMutex (&vaShimCtx->bufferMutex);
-
-    vaBuffer = HDDLMemoryMgr_GetBufferFromVABufferID (vaShimCtx, bufId, &hostBufId);
+    vaBuffer = HDDLVAShim_GetBuffer (vaShimCtx, bufId);
     if (vaBuffer == NULL)
     {
         SHIM_ERROR_MESSAGE ("vaBuffer returned NULL");
-        HDDLThreadMgr_UnlockMutex (&vaShimCtx->bufferMutex);
         return VA_STATUS_ERROR_INVALID_CONTEXT;
     }
 
@@ -836,6 +986,26 @@ VAStatus HDDLVAShim_MapBuffer (VADriverContextP ctx, VABufferID bufId, void **bu
         vaDataTX.dataSize = dataSize;
         vaDataTX.bufType = vaBuffer->type;
 
+        // The reply is read in place and only released once its content has been copied
+        // into the host side buffer
+        commStatus = Comm_Submission (commCtx, HDDLVAMapBuffer, COMM_READ_BORROW,
+            sizeof (HDDLVAMapBufferTX), (void *)&vaDataTX, 0, (void **)&reply);
+
+        if (commStatus != COMM_STATUS_SUCCESS)
+        {
+            HDDLVAShim_PutBuffer (vaShimCtx, vaBuffer);
+            return VA_STATUS_ERROR_UNKNOWN;
+        }
+
+        if (reply.size < sizeof (HDDLVAMapBufferRX))
+        {
+            Comm_ReleaseMessage (commCtx, &reply);
+            HDDLVAShim_PutBuffer (vaShimCtx, vaBuffer);
+            return VA_STATUS_ERROR_UNKNOWN;
+        }
+
+        vaDataRX = *(HDDLVAMapBufferRX *)reply.payload;
+
 	if (vaBuffer->type == VAImageBufferType)
 	{
             typedef struct {
@@ -843,132 +1013,54 @@ VAStatus HDDLVAShim_MapBuffer (VADriverContextP ctx, VABufferID bufId, void **bu
                 unsigned char data[dataSize];
             }HDDLVADataFullRX;
 
-            // VAImageBufferType data might be huge, depending on decoded source.
-            // Allocate the data on heap instead of stack to avoid too large
-            // array allocated on the stack that might eventually causing some
-            // issue
-            HDDLVADataFullRX *vaDataFullRX = HDDLMemoryMgr_AllocMemory (sizeof (HDDLVADataFullRX));
-
-	    if (vaDataFullRX == NULL)
-	    {
-                SHIM_ERROR_MESSAGE ("vaDataFullRX returned NULL");
-		HDDLThreadMgr_UnlockMutex (&vaShimCtx->bufferMutex);
-		return VA_STATUS_ERROR_UNKNOWN;
-	    }
-
-            commStatus = Comm_Submission (commCtx, HDDLVAMapBuffer, COMM_READ_FULL,
-                sizeof (HDDLVAMapBufferTX), (void *)&vaDataTX,
-                sizeof (HDDLVADataFullRX), (void **)vaDataFullRX);
-
-            if (commStatus != COMM_STATUS_SUCCESS)
-            {
-                HDDLThreadMgr_UnlockMutex (&vaShimCtx->bufferMutex);
-                return VA_STATUS_ERROR_UNKNOWN;
-            }
+            HDDLVADataFullRX *vaDataFullRX = (HDDLVADataFullRX *)reply.payload;
 
-            if ( (vaDataFullRX->vaDataRX.vaData.vaFunctionID != HDDLVAMapBuffer) ||
-                (vaDataFullRX->vaDataRX.vaData.size != sizeof (HDDLVADataFullRX)))
+            if ( (vaDataRX.vaData.vaFunctionID != HDDLVAMapBuffer) ||
+                (vaDataRX.vaData.size != sizeof (HDDLVADataFullRX)) ||
+                (reply.size != sizeof (HDDLVADataFullRX)))
             {
-                HDDLThreadMgr_UnlockMutex (&vaShimCtx->bufferMutex);
+                Comm_ReleaseMessage (commCtx, &reply);
+                HDDLVAShim_PutBuffer (vaShimCtx, vaBuffer);
                 return VA_STATUS_ERROR_UNKNOWN;
             }
 
-            vaStatus = vaDataFullRX->vaDataRX.ret;
+            vaStatus = vaDataRX.ret;
             if (vaStatus != VA_STATUS_SUCCESS)
             {
-                HDDLThreadMgr_UnlockMutex (&vaShimCtx->bufferMutex);
+                Comm_ReleaseMessage (commCtx, &reply);
+                HDDLVAShim_PutBuffer (vaShimCtx, vaBuffer);
                 return vaStatus;
             }
 
             HDDLMemoryMgr_Memcpy (vaBuffer->pData, vaDataFullRX->data,
 	        vaBuffer->uiSize * vaBuffer->uiNumElement, dataSize);
-
-            HDDLMemoryMgr_FreeMemory (vaDataFullRX);
 	}
 	else if (vaBuffer->type == VAEncCodedBufferType)
 	{
             unsigned int offset = 0;
 
-            if (commMode == COMM_MODE_TCP)
-            {
-                peekData = &vaDataRX;
-            }
-
-            commStatus = Comm_Submission (commCtx, HDDLVAMapBuffer,
-                COMM_READ_PARTIAL, sizeof (HDDLVAMapBufferTX), (void *)&vaDataTX,
-                peekSize, (void **)&peekData);
-
-            if (commStatus != COMM_STATUS_SUCCESS)
-            {
-                HDDLThreadMgr_UnlockMutex (&vaShimCtx->bufferMutex);
-		HDDLMemoryMgr_FreeMemory (peekData);
-                return VA_STATUS_ERROR_UNKNOWN;
-            }
-
-            if (commMode == COMM_MODE_XLINK || commMode == COMM_MODE_UNITE)
-            {
-	        vaDataRX = *(HDDLVAMapBufferRX *)peekData;
-            }
-
             typedef struct {
                 HDDLVAMapBufferRX vaDataRX;
                 VACodedBufferSegment segment[vaDataRX.segmentCount];
                 unsigned char data[vaDataRX.dataSize];
             }HDDLVADataFullRX;
-            HDDLVADataFullRX *vaDataFullRX;
-
-            fullRXSize = sizeof (HDDLVADataFullRX);
-            commStatus = COMM_STATUS_FAILED;
-
-            if (commMode == COMM_MODE_TCP)
-            {
-                vaDataFullRX = HDDLMemoryMgr_AllocMemory (fullRXSize);
-
-		if (vaDataFullRX == NULL)
-		{
-                    SHIM_ERROR_MESSAGE ("vaDataFullRX returned NULL");
-		    HDDLThreadMgr_UnlockMutex (&vaShimCtx->bufferMutex);
-		    return VA_STATUS_ERROR_UNKNOWN;
-		}
-
-                commStatus = Comm_Read (commCtx, fullRXSize, (void *)vaDataFullRX);
-            }
-            else if (commMode == COMM_MODE_XLINK || commMode == COMM_MODE_UNITE)
-            {
-                vaDataFullRX = (HDDLVADataFullRX *)peekData;
-
-                if (fullRXSize > DATA_MAX_SEND_SIZE)
-                {
-                    vaDataFullRX = HDDLMemoryMgr_ReallocMemory (vaDataFullRX, fullRXSize);
 
-                    commStatus = Comm_Read (commCtx, fullRXSize - DATA_MAX_SEND_SIZE,
-                        (char *) (vaDataFullRX) + DATA_MAX_SEND_SIZE);
-                }
-                else
-                {
-                    commStatus = COMM_STATUS_SUCCESS;
-                }
-            }
+            HDDLVADataFullRX *vaDataFullRX = (HDDLVADataFullRX *)reply.payload;
 
-            if (commStatus != COMM_STATUS_SUCCESS)
+            if ( (vaDataRX.vaData.vaFunctionID != HDDLVAMapBuffer) ||
+                (vaDataRX.vaData.size != sizeof (HDDLVADataFullRX)) ||
+                (reply.size != sizeof (HDDLVADataFullRX)))
             {
-                HDDLThreadMgr_UnlockMutex (&vaShimCtx->bufferMutex);
+                Comm_ReleaseMessage (commCtx, &reply);
+                HDDLVAShim_PutBuffer (vaShimCtx, vaBuffer);
                 return VA_STATUS_ERROR_UNKNOWN;
             }
 
-            if ( (vaDataFullRX->vaDataRX.vaData.vaFunctionID != HDDLVAMapBuffer) ||
-                (vaDataFullRX->vaDataRX.vaData.size != sizeof (HDDLVADataFullRX)))
-            {
-                HDDLThreadMgr_UnlockMutex (&vaShimCtx->bufferMutex);
-		HDDLMemoryMgr_FreeMemory (peekData);
-                return VA_STATUS_ERROR_UNKNOWN;
-            }
-
-            vaStatus = vaDataFullRX->vaDataRX.ret;
+            vaStatus = vaDataRX.ret;
             if (vaStatus != VA_STATUS_SUCCESS)
             {
-                HDDLThreadMgr_UnlockMutex (&vaShimCtx->bufferMutex);
-		HDDLMemoryMgr_FreeMemory (peekData);
+                Comm_ReleaseMessage (commCtx, &reply);
+                HDDLVAShim_PutBuffer (vaShimCtx, vaBuffer);
                 return vaStatus;
             }
 
@@ -988,8 +1080,8 @@ VAStatus HDDLVAShim_MapBuffer (VADriverContextP ctx, VABufferID bufId, void **bu
 		if (segment == NULL)
 		{
 	            SHIM_ERROR_MESSAGE ("segment returned NULL");
-		    HDDLMemoryMgr_FreeMemory (peekData);
-		    HDDLThreadMgr_UnlockMutex (&vaShimCtx->bufferMutex);
+		    Comm_ReleaseMessage (commCtx, &reply);
+		    HDDLVAShim_PutBuffer (vaShimCtx, vaBuffer);
 		    return VA_STATUS_ERROR_UNKNOWN;
 		}
 
@@ -1017,14 +1109,14 @@ VAStatus HDDLVAShim_MapBuffer (VADriverContextP ctx, VABufferID bufId, void **bu
                 }
                 prev = segment;
             }
-
-	    HDDLMemoryMgr_FreeMemory (vaDataFullRX);
         }
+
+        Comm_ReleaseMessage (commCtx, &reply);
     }
 
     vaStatus = HDDLVAShim_MapInternalBuffer (vaShimCtx, bufId, vaBuffer, buf);
 
-    HDDLThreadMgr_UnlockMutex (&vaShimCtx->bufferMutex);
+    HDDLVAShim_PutBuffer (vaShimCtx, vaBuffer);
 
     SHIM_FUNCTION_EXIT ();
     return vaStatus;
@@ -1032,11 +1124,13 @@ VAStatus HDDLVAShim_MapBuffer (VADriverContextP ctx, VABufferID bufId, void **bu
 
 VAStatus HDDLVAShim_UnmapBuffer (VADriverContextP ctx, VABufferID bufId)
 {
+    HDDLVAUnmapBufferTX vaDataTX;
     HDDLVAUnmapBufferRX vaDataRX;
     HDDLShimCommContext *commCtx;
     HDDLVABuffer *vaBuffer;
-    uint32_t hostBufId;
     unsigned int dataSize;
+    unsigned char *data = NULL;
+    struct iovec iov[2];
     CommStatus commStatus;
     VAStatus vaStatus;
 
@@ -1053,15 +1147,12 @@ VAStatus HDDLVAShim_UnmapBuffer (VADriverContextP ctx, VABufferID bufId)
     SHIM_CHK_NULL (vaShimCtx, "nullptr VAShimCtx", VA_STATUS_ERROR_INVALID_CONTEXT);
     SHIM_CHK_NULL (vaShimCtx->bufferHeap, "nullptr VAShimCtx", VA_STATUS_ERROR_INVALID_CONTEXT);
 
-    commCtx = HDDLVAShim_GetCommContext (vaShimCtx);
+    commCtx = HDDLVAShim_GetBufferCommContext (vaShimCtx, bufId);
     SHIM_CHK_NULL (commCtx, "commCtx return NULL", VA_STATUS_ERROR_INVALID_CONTEXT);
 
-    HDDLThreadMgr_LockMutex (&vaShimCtx->bufferMutex);
-
-    vaBuffer = HDDLMemoryMgr_GetBufferFromVABufferID (vaShimCtx, bufId, &hostBufId);
+    vaBuffer = HDDLVAShim_GetBuffer (vaShimCtx, bufId);
     if (NULL == vaBuffer)
     {
-        HDDLThreadMgr_UnlockMutex (&vaShimCtx->bufferMutex);
         return VA_STATUS_ERROR_ALLOCATION_FAILED;
     }
 
@@ -1075,11 +1166,11 @@ VAStatus HDDLVAShim_UnmapBuffer (VADriverContextP ctx, VABufferID bufId)
         if (vaStatus != VA_STATUS_SUCCESS)
         {
             SHIM_ERROR_MESSAGE ("Failed to unmap buffer");
-            HDDLThreadMgr_UnlockMutex (&vaShimCtx->bufferMutex);
+            HDDLVAShim_PutBuffer (vaShimCtx, vaBuffer);
             return VA_STATUS_ERROR_INVALID_BUFFER;
         }
 
-        HDDLThreadMgr_UnlockMutex (&vaShimCtx->bufferMutex);
+        HDDLVAShim_PutBuffer (vaShimCtx, vaBuffer);
         return vaStatus;
     }
     else if (vaBuffer->type == VAProcPipelineParameterBufferType)
@@ -1096,32 +1187,31 @@ VAStatus HDDLVAShim_UnmapBuffer (VADriverContextP ctx, VABufferID bufId)
         dataSize = vaBuffer->uiSize * vaBuffer->uiNumElement;
     }
 
-    typedef struct {
-        HDDLVAUnmapBufferTX vaDataTX;
-        unsigned char data[dataSize];
-    }HDDLVADataFullTX;
-
-    HDDLVADataFullTX *vaDataFullTX = HDDLMemoryMgr_AllocMemory (sizeof (HDDLVADataFullTX));
+    vaDataTX.vaData.vaFunctionID = HDDLVAUnmapBuffer;
+    vaDataTX.vaData.size = sizeof (HDDLVAUnmapBufferTX) + dataSize;
+    vaDataTX.bufId = bufId;
+    vaDataTX.bufType = vaBuffer->type;
 
-    if (vaDataFullTX == NULL)
+    // Parameters pointing to separate arrays are flattened behind the buffer content, any
+    // other buffer content is sent straight from the mapped buffer
+    if (vaBuffer->type == VAEncMiscParameterBufferType ||
+        vaBuffer->type == VAProcPipelineParameterBufferType)
     {
-        SHIM_ERROR_MESSAGE ("vaDataFullTX returned NULL");
-	HDDLThreadMgr_UnlockMutex (&vaShimCtx->bufferMutex);
-	return VA_STATUS_ERROR_UNKNOWN;
-    }
-
-    HDDLMemoryMgr_ZeroMemory (vaDataFullTX->data, sizeof (unsigned char) * dataSize);
+        data = HDDLMemoryMgr_AllocAndZeroMemory (sizeof (unsigned char) * dataSize);
 
-    vaDataFullTX->vaDataTX.vaData.vaFunctionID = HDDLVAUnmapBuffer;
-    vaDataFullTX->vaDataTX.vaData.size = sizeof (HDDLVADataFullTX);
-    vaDataFullTX->vaDataTX.bufId = bufId;
-    vaDataFullTX->vaDataTX.bufType = vaBuffer->type;
+        if (data == NULL)
+        {
+            SHIM_ERROR_MESSAGE ("data returned NULL");
+	    HDDLVAShim_PutBuffer (vaShimCtx, vaBuffer);
+	    return VA_STATUS_ERROR_UNKNOWN;
+        }
+    }
 
     if (vaBuffer->type == VAEncMiscParameterBufferType)
     {
         VAEncMiscParameterBuffer *misc_param = (VAEncMiscParameterBuffer *)vaBuffer->pData;
         unsigned int offset = sizeof (VAEncMiscParameterBuffer);
-        ( (VAEncMiscParameterBuffer *)vaDataFullTX->data)->type = misc_param->type;
+        ( (VAEncMiscParameterBuffer *)data)->type = misc_param->type;
 
         switch ( (int)misc_param->type)
         {
@@ -1130,13 +1220,13 @@ VAStatus HDDLVAShim_UnmapBuffer (VADriverContextP ctx, VABufferID bufId)
                 VAEncMiscParameterBufferROI *misc_roi_param = (VAEncMiscParameterBufferROI *)misc_param->data;
                 VAEncROI *region_roi = (VAEncROI *)misc_roi_param->roi;
 
-                HDDLMemoryMgr_Memcpy ( (void *) (vaDataFullTX->data + offset), misc_roi_param,
-		    sizeof (vaDataFullTX->data) - offset, sizeof (VAEncMiscParameterBufferROI));
+                HDDLMemoryMgr_Memcpy ( (void *) (data + offset), misc_roi_param,
+		    dataSize - offset, sizeof (VAEncMiscParameterBufferROI));
 
                 offset += sizeof (VAEncMiscParameterBufferROI);
 
-                HDDLMemoryMgr_Memcpy ( (void *) (vaDataFullTX->data + offset), region_roi,
-		    sizeof (vaDataFullTX->data) - offset, sizeof (VAEncROI));
+                HDDLMemoryMgr_Memcpy ( (void *) (data + offset), region_roi,
+		    dataSize - offset, sizeof (VAEncROI));
                 break;
             }
 
@@ -1146,8 +1236,8 @@ VAStatus HDDLVAShim_UnmapBuffer (VADriverContextP ctx, VABufferID bufId)
                 HANTROEncMiscParameterBufferEmbeddedPreprocess *misc_prp_param =
                     (HANTROEncMiscParameterBufferEmbeddedPreprocess *)misc_param->data;
 
-                HDDLMemoryMgr_Memcpy ( (void *) (vaDataFullTX->data + offset), misc_prp_param,
-                    sizeof (vaDataFullTX->data) - offset,
+                HDDLMemoryMgr_Memcpy ( (void *) (data + offset), misc_prp_param,
+                    dataSize - offset,
 		    sizeof (HANTROEncMiscParameterBufferEmbeddedPreprocess));
                 break;
             }
@@ -1156,13 +1246,13 @@ VAStatus HDDLVAShim_UnmapBuffer (VADriverContextP ctx, VABufferID bufId)
                 HANTROEncMiscParameterBufferROI *misc_roi_param = (HANTROEncMiscParameterBufferROI *)misc_param->data;
                 HANTROEncROI *region_roi = (HANTROEncROI *)misc_roi_param->roi;
 
-                HDDLMemoryMgr_Memcpy ( (void *) (vaDataFullTX->data + offset), misc_roi_param,
-		    sizeof (vaDataFullTX->data) - offset, sizeof (HANTROEncMiscParameterBufferROI));
+                HDDLMemoryMgr_Memcpy ( (void *) (data + offset), misc_roi_param,
+		    dataSize - offset, sizeof (HANTROEncMiscParameterBufferROI));
 
                 offset += sizeof (HANTROEncMiscParameterBufferROI);
 
-                HDDLMemoryMgr_Memcpy ( (void *) (vaDataFullTX->data + offset), region_roi,
-		    sizeof (vaDataFullTX->data) - offset,
+                HDDLMemoryMgr_Memcpy ( (void *) (data + offset), region_roi,
+		    dataSize - offset,
 		    sizeof (HANTROEncROI) * misc_roi_param->num_roi);
                 break;
             }
@@ -1171,13 +1261,13 @@ VAStatus HDDLVAShim_UnmapBuffer (VADriverContextP ctx, VABufferID bufId)
                 HANTROEncMiscParameterBufferIPCM *misc_ipcm_param = (HANTROEncMiscParameterBufferIPCM *)misc_param->data;
                 HANTRORectangle *region_ipcm = (HANTRORectangle *)misc_ipcm_param->ipcm;
 
-                HDDLMemoryMgr_Memcpy ( (void *) (vaDataFullTX->data + offset), misc_ipcm_param,
-		    sizeof (vaDataFullTX->data) - offset,
+                HDDLMemoryMgr_Memcpy ( (void *) (data + offset), misc_ipcm_param,
+		    dataSize - offset,
 		    sizeof (HANTROEncMiscParameterBufferIPCM));
 
                 offset += sizeof (HANTROEncMiscParameterBufferIPCM);
-                HDDLMemoryMgr_Memcpy ( (void *) (vaDataFullTX->data + offset), region_ipcm,
-		    sizeof (vaDataFullTX->data) - offset,
+                HDDLMemoryMgr_Memcpy ( (void *) (data + offset), region_ipcm,
+		    dataSize - offset,
 		    sizeof (HANTRORectangle) * misc_ipcm_param->num_ipcm);
                 break;
             }
@@ -1185,8 +1275,9 @@ VAStatus HDDLVAShim_UnmapBuffer (VADriverContextP ctx, VABufferID bufId)
 #endif
             default:
             {
-                HDDLMemoryMgr_Memcpy (vaDataFullTX->data, vaBuffer->pData,
-		    sizeof (vaDataFullTX->data), dataSize);
+                // Self contained parameter, nothing to flatten
+                HDDLMemoryMgr_FreeMemory (data);
+                data = NULL;
                 break;
             }
         }
@@ -1200,39 +1291,37 @@ VAStatus HDDLVAShim_UnmapBuffer (VADriverContextP ctx, VABufferID bufId)
         uint32_t numAdditionalOutputs = pipelineParam->num_additional_outputs;
         unsigned int offset = sizeof (VAProcPipelineParameterBuffer);
 
-        HDDLMemoryMgr_Memcpy ( (void *) (vaDataFullTX->data), pipelineParam,
-	    sizeof (vaDataFullTX->data), sizeof (VAProcPipelineParameterBuffer));
+        HDDLMemoryMgr_Memcpy ( (void *)data, pipelineParam,
+	    dataSize, sizeof (VAProcPipelineParameterBuffer));
 
-        HDDLMemoryMgr_Memcpy ( (void *) (vaDataFullTX->data + offset), surfaceRegion,
-	    sizeof (vaDataFullTX->data) - offset, sizeof (VARectangle) * numAdditionalOutputs);
+        HDDLMemoryMgr_Memcpy ( (void *) (data + offset), surfaceRegion,
+	    dataSize - offset, sizeof (VARectangle) * numAdditionalOutputs);
 
         offset += (sizeof (VARectangle) * numAdditionalOutputs);
-        HDDLMemoryMgr_Memcpy ( (void *) (vaDataFullTX->data + offset), additionalOutputs,
-	    sizeof (vaDataFullTX->data) - offset, sizeof (VASurfaceID) * numAdditionalOutputs);
-    }
-    // Do not perform HDDLMemoryMgr_Memcpy when it's VAEncCodedBufferType
-    else if (vaBuffer->type != VAEncCodedBufferType)
-    {
-        HDDLMemoryMgr_Memcpy (vaDataFullTX->data, vaBuffer->pData,
-	    sizeof (vaDataFullTX->data), dataSize);
+        HDDLMemoryMgr_Memcpy ( (void *) (data + offset), additionalOutputs,
+	    dataSize - offset, sizeof (VASurfaceID) * numAdditionalOutputs);
     }
 
-    commStatus = Comm_Submission (commCtx, HDDLVAUnmapBuffer, COMM_READ_FULL,
-        sizeof (HDDLVADataFullTX), (void *)vaDataFullTX,
+    iov[0].iov_base = &vaDataTX;
+    iov[0].iov_len = sizeof (HDDLVAUnmapBufferTX);
+    iov[1].iov_base = data ? data : vaBuffer->pData;
+    iov[1].iov_len = dataSize;
+
+    commStatus = Comm_SubmissionV (commCtx, HDDLVAUnmapBuffer, COMM_READ_FULL, iov, 2,
         sizeof (HDDLVAUnmapBufferRX), (void **)&vaDataRX);
-        
-    HDDLMemoryMgr_FreeMemory (vaDataFullTX);
+
+    HDDLMemoryMgr_FreeMemory (data);
 
     if (commStatus != COMM_STATUS_SUCCESS)
     {
-        HDDLThreadMgr_UnlockMutex (&vaShimCtx->bufferMutex);
+        HDDLVAShim_PutBuffer (vaShimCtx, vaBuffer);
         return VA_STATUS_ERROR_UNKNOWN;
     }
 
     if ( (vaDataRX.vaData.vaFunctionID != HDDLVAUnmapBuffer) ||
         (vaDataRX.vaData.size != sizeof (HDDLVAUnmapBufferRX)))
     {
-        HDDLThreadMgr_UnlockMutex (&vaShimCtx->bufferMutex);
+        HDDLVAShim_PutBuffer (vaShimCtx, vaBuffer);
         return VA_STATUS_ERROR_UNKNOWN;
     }
 
@@ -1240,11 +1329,11 @@ VAStatus HDDLVAShim_UnmapBuffer (VADriverContextP ctx, VABufferID bufId)
     if (vaStatus != VA_STATUS_SUCCESS)
     {
         SHIM_ERROR_MESSAGE ("Failed to unmap buffer");
-        HDDLThreadMgr_UnlockMutex (&vaShimCtx->bufferMutex);
+        HDDLVAShim_PutBuffer (vaShimCtx, vaBuffer);
         return VA_STATUS_ERROR_INVALID_BUFFER;
     }
 
-    HDDLThreadMgr_UnlockMutex (&vaShimCtx->bufferMutex);
+    HDDLVAShim_PutBuffer (vaShimCtx, vaBuffer);
 
     vaStatus = vaDataRX.ret;
 
@@ -1309,7 +1398,8 @@ VAStatus HDDLVAShim_CreateImage (VADriverContextP ctx, VAImageFormat *format, in
 
     HDDLThreadMgr_LockMutex (&vaShimCtx->imageMutex);
 
-    vaImageElement = (HDDLVAImageElement *)HDDLMemoryMgr_AllocImageHeap (vaShimCtx->imageHeap);
+    vaImageElement = (HDDLVAImageElement *)HDDLMemoryMgr_AllocImageHeap (vaShimCtx->imageHeap,
+        vaImg->image_id);
     if (NULL == vaImageElement)
     {
         HDDLMemoryMgr_FreeMemory (vaImg);
@@ -1383,7 +1473,8 @@ VAStatus HDDLVAShim_DeriveImage (VADriverContextP ctx, VASurfaceID surface, VAIm
 
     HDDLThreadMgr_LockMutex (&vaShimCtx->imageMutex);
 
-    vaImageElement = (HDDLVAImageElement *)HDDLMemoryMgr_AllocImageHeap (vaShimCtx->imageHeap);
+    vaImageElement = (HDDLVAImageElement *)HDDLMemoryMgr_AllocImageHeap (vaShimCtx->imageHeap,
+        vaImg->image_id);
     if (NULL == vaImageElement)
     {
         HDDLMemoryMgr_FreeMemory (vaImg);
@@ -1494,7 +1585,7 @@ VAStatus HDDLVAShim_BeginPicture (VADriverContextP ctx, VAContextID context,
     HDDLVAShimDriverContext *vaShimCtx = HDDL_GetVAShimContext (ctx);
     SHIM_CHK_NULL (vaShimCtx, "VAShimCtx returned NULL", VA_STATUS_ERROR_INVALID_CONTEXT);
 
-    commCtx = HDDLVAShim_GetCommContext (vaShimCtx);
+    commCtx = HDDLVAShim_GetContextCommContext (vaShimCtx, context);
     SHIM_CHK_NULL (commCtx, "commCtx return NULL", VA_STATUS_ERROR_INVALID_CONTEXT);
 
     vaDataTX.vaData.vaFunctionID = HDDLVABeginPicture;
@@ -1533,7 +1624,7 @@ VAStatus HDDLVAShim_RenderPicture (VADriverContextP ctx, VAContextID context, VA
     HDDLVAShimDriverContext *vaShimCtx = HDDL_GetVAShimContext (ctx);
     SHIM_CHK_NULL (vaShimCtx, "VAShimCtx returned NULL", VA_STATUS_ERROR_INVALID_CONTEXT);
 
-    commCtx = HDDLVAShim_GetCommContext (vaShimCtx);
+    commCtx = HDDLVAShim_GetContextCommContext (vaShimCtx, context);
     SHIM_CHK_NULL (commCtx, "commCtx return NULL", VA_STATUS_ERROR_INVALID_CONTEXT);
 
     typedef struct {
@@ -1581,7 +1672,7 @@ VAStatus HDDLVAShim_EndPicture (VADriverContextP ctx, VAContextID context)
     HDDLVAShimDriverContext *vaShimCtx = HDDL_GetVAShimContext (ctx);
     SHIM_CHK_NULL (vaShimCtx, "VAShimCtx returned NULL", VA_STATUS_ERROR_INVALID_CONTEXT);
 
-    commCtx = HDDLVAShim_GetCommContext (vaShimCtx);
+    commCtx = HDDLVAShim_GetContextCommContext (vaShimCtx, context);
     SHIM_CHK_NULL (commCtx, "commCtx return NULL", VA_STATUS_ERROR_INVALID_CONTEXT);
 
     vaDataTX.vaData.vaFunctionID = HDDLVAEndPicture;
@@ -1601,6 +1692,13 @@ VAStatus HDDLVAShim_EndPicture (VADriverContextP ctx, VAContextID context)
 
     vaStatus = vaDataRX.ret;
 
+    // The other calls of the frame went on with a zeroed reply, a failure among them shows
+    // up here unless the frame is still held back for coalescing
+    if (vaStatus == VA_STATUS_SUCCESS)
+    {
+        vaStatus = Comm_BatchTakeStatus ();
+    }
+
     SHIM_FUNCTION_EXIT ();
     return vaStatus;
 }
@@ -1639,6 +1737,12 @@ VAStatus HDDLVAShim_SyncSurface (VADriverContextP ctx, VASurfaceID renderTarget)
 
     vaStatus = vaDataRX.ret;
 
+    // Frames held back for coalescing are answered later on, their failures surface here
+    if (vaStatus == VA_STATUS_SUCCESS)
+    {
+        vaStatus = Comm_BatchTakeStatus ();
+    }
+
     SHIM_FUNCTION_EXIT ();
     return vaStatus;
 }
@@ -1674,7 +1778,7 @@ VAStatus HDDLVAShim_QueryConfigProfiles (VADriverContextP ctx, VAProfile *profil
     vaDataTX.vaData.size = sizeof (HDDLVAQueryConfigProfilesTX);
     vaDataTX.numProfiles = ctx->max_profiles;
 
-    if (commMode == COMM_MODE_TCP)
+    if (commMode == COMM_MODE_TCP || commMode == COMM_MODE_SHM)
     {
         peekData = &vaData;
     }
@@ -1706,7 +1810,7 @@ VAStatus HDDLVAShim_QueryConfigProfiles (VADriverContextP ctx, VAProfile *profil
     fullRXSize = sizeof (HDDLVADataFullRX);
     commStatus = COMM_STATUS_FAILED;
 
-    if (commMode == COMM_MODE_TCP)
+    if (commMode == COMM_MODE_TCP || commMode == COMM_MODE_SHM)
     {
         vaDataFullRX = HDDLMemoryMgr_AllocMemory (fullRXSize);
 	SHIM_CHK_NULL (vaDataFullRX, "nullptr vaDataFullRX", VA_STATUS_ERROR_UNKNOWN);
@@ -1716,12 +1820,12 @@ VAStatus HDDLVAShim_QueryConfigProfiles (VADriverContextP ctx, VAProfile *profil
     {
         vaDataFullRX = (HDDLVADataFullRX *)peekData;
 
-        if (fullRXSize > DATA_MAX_SEND_SIZE)
+        if (fullRXSize > Comm_FragmentSize (commCtx))
         {
             vaDataFullRX = HDDLMemoryMgr_ReallocMemory (vaDataFullRX, fullRXSize);
 
-            commStatus = Comm_Read (commCtx, fullRXSize - DATA_MAX_SEND_SIZE,
-                (char *) (vaDataFullRX) + DATA_MAX_SEND_SIZE);
+            commStatus = Comm_Read (commCtx, fullRXSize - Comm_FragmentSize (commCtx),
+                (char *) (vaDataFullRX) + Comm_FragmentSize (commCtx));
         }
         else
         {
@@ -1781,7 +1885,7 @@ VAStatus HDDLVAShim_QueryConfigEntrypoints (VADriverContextP ctx, VAProfile prof
     vaDataTX.numEntrypoint = ctx->max_entrypoints;
     vaDataTX.profile = profile;
 
-    if (commMode == COMM_MODE_TCP)
+    if (commMode == COMM_MODE_TCP || commMode == COMM_MODE_SHM)
     {
         peekData = &vaData;
     }
@@ -1814,7 +1918,7 @@ VAStatus HDDLVAShim_QueryConfigEntrypoints (VADriverContextP ctx, VAProfile prof
     fullRXSize = sizeof (HDDLVADataFullRX);
     commStatus = COMM_STATUS_FAILED;
 
-    if (commMode == COMM_MODE_TCP)
+    if (commMode == COMM_MODE_TCP || commMode == COMM_MODE_SHM)
     {
         vaDataFullRX = HDDLMemoryMgr_AllocMemory (fullRXSize);
         SHIM_CHK_NULL (vaDataFullRX, "nullptr vaDataFullRX", VA_STATUS_ERROR_UNKNOWN);
@@ -1824,12 +1928,12 @@ VAStatus HDDLVAShim_QueryConfigEntrypoints (VADriverContextP ctx, VAProfile prof
     {
         vaDataFullRX = (HDDLVADataFullRX *)peekData;
 
-        if (fullRXSize > DATA_MAX_SEND_SIZE)
+        if (fullRXSize > Comm_FragmentSize (commCtx))
         {
             vaDataFullRX = HDDLMemoryMgr_ReallocMemory (vaDataFullRX, fullRXSize);
 
-            commStatus = Comm_Read (commCtx, fullRXSize - DATA_MAX_SEND_SIZE,
-                (char *) (vaDataFullRX) + DATA_MAX_SEND_SIZE);
+            commStatus = Comm_Read (commCtx, fullRXSize - Comm_FragmentSize (commCtx),
+                (char *) (vaDataFullRX) + Comm_FragmentSize (commCtx));
         }
         else
         {
@@ -1946,7 +2050,7 @@ VAStatus HDDLVAShim_QueryConfigAttributes (VADriverContextP ctx, VAConfigID conf
     vaDataTX.numAttributes = ctx->max_attributes;
     vaDataTX.configId = configId;
 
-    if (commMode == COMM_MODE_TCP)
+    if (commMode == COMM_MODE_TCP || commMode == COMM_MODE_SHM)
     {
         peekData = &vaData;
     }
@@ -1979,7 +2083,7 @@ VAStatus HDDLVAShim_QueryConfigAttributes (VADriverContextP ctx, VAConfigID conf
     fullRXSize = sizeof (HDDLVADataFullRX);
     commStatus = COMM_STATUS_FAILED;
 
-    if (commMode == COMM_MODE_TCP)
+    if (commMode == COMM_MODE_TCP || commMode == COMM_MODE_SHM)
     {
         vaDataFullRX = HDDLMemoryMgr_AllocMemory (fullRXSize);
 	SHIM_CHK_NULL (vaDataFullRX, "nullptr vaDataFullRX", VA_STATUS_ERROR_UNKNOWN);
@@ -1990,12 +2094,12 @@ VAStatus HDDLVAShim_QueryConfigAttributes (VADriverContextP ctx, VAConfigID conf
     {
         vaDataFullRX = (HDDLVADataFullRX *)peekData;
 
-	if (fullRXSize > DATA_MAX_SEND_SIZE)
+	if (fullRXSize > Comm_FragmentSize (commCtx))
         {
             vaDataFullRX = HDDLMemoryMgr_ReallocMemory (vaDataFullRX, fullRXSize);
 
-            commStatus = Comm_Read (commCtx, fullRXSize - DATA_MAX_SEND_SIZE,
-                (char *) (vaDataFullRX) + DATA_MAX_SEND_SIZE);
+            commStatus = Comm_Read (commCtx, fullRXSize - Comm_FragmentSize (commCtx),
+                (char *) (vaDataFullRX) + Comm_FragmentSize (commCtx));
         }
         else
         {
@@ -2097,7 +2201,7 @@ VAStatus HDDLVAShim_QueryImageFormats (VADriverContextP ctx, VAImageFormat *form
     vaDataTX.vaData.size = sizeof (HDDLVAQueryImageFormatsTX);
     vaDataTX.numFormat = ctx->max_image_formats;
 
-    if (commMode == COMM_MODE_TCP)
+    if (commMode == COMM_MODE_TCP || commMode == COMM_MODE_SHM)
     {
 	peekData = &vaData;
     }
@@ -2129,7 +2233,7 @@ VAStatus HDDLVAShim_QueryImageFormats (VADriverContextP ctx, VAImageFormat *form
     fullRXSize = sizeof (HDDLVADataFullRX);
     commStatus = COMM_STATUS_FAILED;
 
-    if (commMode == COMM_MODE_TCP)
+    if (commMode == COMM_MODE_TCP || commMode == COMM_MODE_SHM)
     {
         vaDataFullRX = HDDLMemoryMgr_AllocMemory (fullRXSize);
 	SHIM_CHK_NULL (vaDataFullRX, "nullptr vaDataFullRX", VA_STATUS_ERROR_UNKNOWN);
@@ -2140,12 +2244,12 @@ VAStatus HDDLVAShim_QueryImageFormats (VADriverContextP ctx, VAImageFormat *form
     {
         vaDataFullRX = (HDDLVADataFullRX *)peekData;
 
-	if (fullRXSize > DATA_MAX_SEND_SIZE)
+	if (fullRXSize > Comm_FragmentSize (commCtx))
         {
             vaDataFullRX = HDDLMemoryMgr_ReallocMemory (vaDataFullRX, fullRXSize);
 
-            commStatus = Comm_Read (commCtx, fullRXSize - DATA_MAX_SEND_SIZE,
-                (char *) (vaDataFullRX) + DATA_MAX_SEND_SIZE);
+            commStatus = Comm_Read (commCtx, fullRXSize - Comm_FragmentSize (commCtx),
+                (char *) (vaDataFullRX) + Comm_FragmentSize (commCtx));
         }
         else
         {
@@ -2266,7 +2370,7 @@ VAStatus HDDLVAShim_PutImage (VADriverContextP ctx, VASurfaceID surface, VAImage
     vaDataTX.bufId = vaImage->buf;
     vaDataTX.bufSize = vaImage->data_size;
 
-    if (commMode == COMM_MODE_TCP)
+    if (commMode == COMM_MODE_TCP || commMode == COMM_MODE_SHM)
     {
         peekData = &vaData;
     }
@@ -2298,7 +2402,7 @@ VAStatus HDDLVAShim_PutImage (VADriverContextP ctx, VASurfaceID surface, VAImage
     fullRXSize = sizeof (HDDLVADataFullRX);
     commStatus = COMM_STATUS_FAILED;
 
-    if (commMode == COMM_MODE_TCP)
+    if (commMode == COMM_MODE_TCP || commMode == COMM_MODE_SHM)
     {
         vaDataFullRX = HDDLMemoryMgr_AllocMemory (fullRXSize);
 	SHIM_CHK_NULL (vaDataFullRX, "nullptr vaDataFullRX", VA_STATUS_ERROR_UNKNOWN);
@@ -2309,12 +2413,12 @@ VAStatus HDDLVAShim_PutImage (VADriverContextP ctx, VASurfaceID surface, VAImage
     {
         vaDataFullRX = (HDDLVADataFullRX *)peekData;
 
-	if (fullRXSize > DATA_MAX_SEND_SIZE)
+	if (fullRXSize > Comm_FragmentSize (commCtx))
         {
             vaDataFullRX = HDDLMemoryMgr_ReallocMemory (vaDataFullRX, fullRXSize);
 
-            commStatus = Comm_ReadSafe (commCtx, fullRXSize - DATA_MAX_SEND_SIZE,
-                (void *) (vaDataFullRX + DATA_MAX_SEND_SIZE));
+            commStatus = Comm_ReadSafe (commCtx, fullRXSize - Comm_FragmentSize (commCtx),
+                (char *) (vaDataFullRX) + Comm_FragmentSize (commCtx));
         }
         else
         {
@@ -2333,20 +2437,27 @@ VAStatus HDDLVAShim_PutImage (VADriverContextP ctx, VASurfaceID surface, VAImage
 
     void *pBuf = NULL;
 
-    HDDLThreadMgr_LockMutex (&vaShimCtx->bufferMutex);
-    vaStatus = HDDLVAShim_MapInternalBuffer (vaShimCtx, vaImage->buf, NULL, &pBuf);
+    HDDLVABuffer *vaBuffer = HDDLVAShim_GetBuffer (vaShimCtx, vaImage->buf);
+    if (vaBuffer == NULL)
+    {
+        SHIM_ERROR_MESSAGE ("Fail to map buffer");
+	HDDLMemoryMgr_FreeMemory (peekData);
+        return VA_STATUS_ERROR_INVALID_BUFFER;
+    }
+
+    vaStatus = HDDLVAShim_MapInternalBuffer (vaShimCtx, vaImage->buf, vaBuffer, &pBuf);
     if (vaStatus != VA_STATUS_SUCCESS)
     {
         SHIM_ERROR_MESSAGE ("Fail to map buffer");
 	HDDLMemoryMgr_FreeMemory (peekData);
-        HDDLThreadMgr_UnlockMutex (&vaShimCtx->bufferMutex);
+        HDDLVAShim_PutBuffer (vaShimCtx, vaBuffer);
         return VA_STATUS_ERROR_INVALID_BUFFER;
     }
 
     HDDLMemoryMgr_Memcpy (pBuf, vaDataFullRX->bufData, bufSize, sizeof (vaDataFullRX->bufData));
 
-    vaStatus = HDDLVAShim_UnmapInternalBuffer (vaShimCtx, vaImage->buf, NULL);
-    HDDLThreadMgr_UnlockMutex (&vaShimCtx->bufferMutex);
+    vaStatus = HDDLVAShim_UnmapInternalBuffer (vaShimCtx, vaImage->buf, vaBuffer);
+    HDDLVAShim_PutBuffer (vaShimCtx, vaBuffer);
 
     if (vaStatus != VA_STATUS_SUCCESS)
     {
@@ -2394,7 +2505,7 @@ VAStatus HDDLVAShim_QueryDisplayAttributes (VADriverContextP ctx, VADisplayAttri
     vaDataTX.vaData.size = sizeof (HDDLVAQueryDisplayAttributesTX);
     vaDataTX.numAttributes = ctx->max_display_attributes;
 
-    if (commMode == COMM_MODE_TCP)
+    if (commMode == COMM_MODE_TCP || commMode == COMM_MODE_SHM)
     {
         peekData = &vaData;
     }
@@ -2427,7 +2538,7 @@ VAStatus HDDLVAShim_QueryDisplayAttributes (VADriverContextP ctx, VADisplayAttri
     fullRXSize = sizeof (HDDLVADataFullRX);
     commStatus = COMM_STATUS_FAILED;
 
-    if (commMode == COMM_MODE_TCP)
+    if (commMode == COMM_MODE_TCP || commMode == COMM_MODE_SHM)
     {
         vaDataFullRX = HDDLMemoryMgr_AllocMemory (fullRXSize);
 	SHIM_CHK_NULL (vaDataFullRX, "nullptr vaDataFullRX", VA_STATUS_ERROR_UNKNOWN);
@@ -2438,12 +2549,12 @@ VAStatus HDDLVAShim_QueryDisplayAttributes (VADriverContextP ctx, VADisplayAttri
     {
         vaDataFullRX = (HDDLVADataFullRX *)peekData;
 
-	if (fullRXSize > DATA_MAX_SEND_SIZE)
+	if (fullRXSize > Comm_FragmentSize (commCtx))
         {
             vaDataFullRX = HDDLMemoryMgr_ReallocMemory (vaDataFullRX, fullRXSize);
 
-            commStatus = Comm_Read (commCtx, fullRXSize - DATA_MAX_SEND_SIZE,
-                (char *) (vaDataFullRX) + DATA_MAX_SEND_SIZE);
+            commStatus = Comm_Read (commCtx, fullRXSize - Comm_FragmentSize (commCtx),
+                (char *) (vaDataFullRX) + Comm_FragmentSize (commCtx));
         }
         else
         {
@@ -2606,7 +2717,7 @@ VAStatus HDDLVAShim_QuerySurfaceAttributes (VADriverContextP dpy, VAConfigID con
     vaDataTX.config = config;
     vaDataTX.numAttribs = *numAttribs;
 
-    if (commMode == COMM_MODE_TCP)
+    if (commMode == COMM_MODE_TCP || commMode == COMM_MODE_SHM)
     {
         peekData = &vaData;
     }
@@ -2639,7 +2750,7 @@ VAStatus HDDLVAShim_QuerySurfaceAttributes (VADriverContextP dpy, VAConfigID con
     fullRXSize = sizeof (HDDLVADataFullRX);
     commStatus = COMM_STATUS_FAILED;
 
-    if (commMode == COMM_MODE_TCP)
+    if (commMode == COMM_MODE_TCP || commMode == COMM_MODE_SHM)
     {
         vaDataFullRX = HDDLMemoryMgr_AllocMemory (fullRXSize);
 	SHIM_CHK_NULL (vaDataFullRX, "nullptr vaDataFullRX", VA_STATUS_ERROR_UNKNOWN);
@@ -2650,12 +2761,12 @@ VAStatus HDDLVAShim_QuerySurfaceAttributes (VADriverContextP dpy, VAConfigID con
     {
         vaDataFullRX = (HDDLVADataFullRX *)peekData;
 
-	if (fullRXSize > DATA_MAX_SEND_SIZE)
+	if (fullRXSize > Comm_FragmentSize (commCtx))
         {
             vaDataFullRX = HDDLMemoryMgr_ReallocMemory (vaDataFullRX, fullRXSize);
 
-            commStatus = Comm_Read (commCtx, fullRXSize - DATA_MAX_SEND_SIZE,
-                (char *) (vaDataFullRX) + DATA_MAX_SEND_SIZE);
+            commStatus = Comm_Read (commCtx, fullRXSize - Comm_FragmentSize (commCtx),
+                (char *) (vaDataFullRX) + Comm_FragmentSize (commCtx));
         }
         else
         {
@@ -2693,9 +2804,11 @@ VAStatus HDDLVAShim_CreateSurfaces2 (VADriverContextP ctx, unsigned int format,
     unsigned int height, VASurfaceID *surfaces, unsigned int numSurfaces,
     VASurfaceAttrib *attribList, unsigned int numAttribs)
 {
+    HDDLVACreateSurfaces2TX vaDataTX;
     HDDLShimCommContext *commCtx;
     CommStatus commStatus;
     VAStatus vaStatus;
+    struct iovec iov[2];
 
     SHIM_FUNCTION_ENTER ();
     SHIM_CHK_NULL (ctx, "ctx returned NULL", VA_STATUS_ERROR_INVALID_CONTEXT);
@@ -2709,52 +2822,43 @@ VAStatus HDDLVAShim_CreateSurfaces2 (VADriverContextP ctx, unsigned int format,
     commCtx = HDDLVAShim_GetCommContext (vaShimCtx);
     SHIM_CHK_NULL (commCtx, "commCtx return NULL", VA_STATUS_ERROR_INVALID_CONTEXT);
 
-    typedef struct {
-        HDDLVACreateSurfaces2TX vaDataTX;
-        VASurfaceAttrib attribList[numAttribs];
-    }HDDLVADataFullTX;
-
-    HDDLVADataFullTX vaDataFullTX;
-
-    vaDataFullTX.vaDataTX.vaData.vaFunctionID = HDDLVACreateSurfaces2;
-    vaDataFullTX.vaDataTX.vaData.size = sizeof (HDDLVADataFullTX);
-    vaDataFullTX.vaDataTX.format = format;
-    vaDataFullTX.vaDataTX.width = width;
-    vaDataFullTX.vaDataTX.height = height;
-    vaDataFullTX.vaDataTX.numSurfaces = numSurfaces;
-    vaDataFullTX.vaDataTX.numAttribs = numAttribs;
-
-    HDDLMemoryMgr_Memcpy (vaDataFullTX.attribList, attribList,
-	sizeof (vaDataFullTX.attribList), sizeof (VASurfaceAttrib) * numAttribs);
+    vaDataTX.vaData.vaFunctionID = HDDLVACreateSurfaces2;
+    vaDataTX.vaData.size = sizeof (HDDLVACreateSurfaces2TX) +
+        sizeof (VASurfaceAttrib) * numAttribs;
+    vaDataTX.format = format;
+    vaDataTX.width = width;
+    vaDataTX.height = height;
+    vaDataTX.numSurfaces = numSurfaces;
+    vaDataTX.numAttribs = numAttribs;
 
     //VASurfaceAttribExternalBuffersAndFdBuffer
     for(int i = 0; i < numAttribs; i++)
     {
-        if (vaDataFullTX.attribList[i].type == VASurfaceAttribExternalBufferDescriptor)
+        if (attribList[i].type == VASurfaceAttribExternalBufferDescriptor)
         {
-            if (vaDataFullTX.attribList[i].value.type == VAGenericValueTypePointer)
+            if (attribList[i].value.type == VAGenericValueTypePointer)
             {
                 VASurfaceAttribExternalBuffers *memAttribute =
-                (VASurfaceAttribExternalBuffers *)vaDataFullTX.attribList[i].value.value.p;
-
-                vaDataFullTX.vaDataTX.externalBuffers[i].extBuf.pixel_format = memAttribute->pixel_format;
-                vaDataFullTX.vaDataTX.externalBuffers[i].extBuf.width = memAttribute->width;
-                vaDataFullTX.vaDataTX.externalBuffers[i].extBuf.height = memAttribute->height;
-                vaDataFullTX.vaDataTX.externalBuffers[i].extBuf.data_size = memAttribute->data_size;
-                vaDataFullTX.vaDataTX.externalBuffers[i].extBuf.num_planes = memAttribute->num_planes;
-                for (int j = 0; j < vaDataFullTX.vaDataTX.externalBuffers[i].extBuf.num_planes; j++)
+                (VASurfaceAttribExternalBuffers *)attribList[i].value.value.p;
+
+                vaDataTX.externalBuffers[i].extBuf.pixel_format = memAttribute->pixel_format;
+                vaDataTX.externalBuffers[i].extBuf.width = memAttribute->width;
+                vaDataTX.externalBuffers[i].extBuf.height = memAttribute->height;
+                vaDataTX.externalBuffers[i].extBuf.data_size = memAttribute->data_size;
+                vaDataTX.externalBuffers[i].extBuf.num_planes = memAttribute->num_planes;
+                for (int j = 0; j < vaDataTX.externalBuffers[i].extBuf.num_planes; j++)
                 {
-                    vaDataFullTX.vaDataTX.externalBuffers[i].extBuf.pitches[j] = memAttribute->pitches[j];
-                    vaDataFullTX.vaDataTX.externalBuffers[i].extBuf.offsets[j] = memAttribute->offsets[j];
+                    vaDataTX.externalBuffers[i].extBuf.pitches[j] = memAttribute->pitches[j];
+                    vaDataTX.externalBuffers[i].extBuf.offsets[j] = memAttribute->offsets[j];
                 }
 
-                vaDataFullTX.vaDataTX.externalBuffers[i].extBuf.flags = memAttribute->flags;
-                vaDataFullTX.vaDataTX.externalBuffers[i].extBuf.num_buffers = memAttribute->num_buffers;
-                vaDataFullTX.vaDataTX.externalBuffers[i].extBuf.private_data = memAttribute->private_data;
+                vaDataTX.externalBuffers[i].extBuf.flags = memAttribute->flags;
+                vaDataTX.externalBuffers[i].extBuf.num_buffers = memAttribute->num_buffers;
+                vaDataTX.externalBuffers[i].extBuf.private_data = memAttribute->private_data;
 
-                for(int k = 0 ; k < vaDataFullTX.vaDataTX.externalBuffers[i].extBuf.num_buffers; k++)
+                for(int k = 0 ; k < vaDataTX.externalBuffers[i].extBuf.num_buffers; k++)
                 {
-                    vaDataFullTX.vaDataTX.externalBuffers[i].extbuf_handle[k] = memAttribute->buffers[k];
+                    vaDataTX.externalBuffers[i].extbuf_handle[k] = memAttribute->buffers[k];
                 }
             }
         }
@@ -2767,9 +2871,14 @@ VAStatus HDDLVAShim_CreateSurfaces2 (VADriverContextP ctx, unsigned int format,
 
     HDDLVADataFullRX vaDataFullRX;
 
-    commStatus = Comm_Submission (commCtx, HDDLVACreateSurfaces2, COMM_READ_FULL,
-        sizeof (HDDLVADataFullTX), (void *)&vaDataFullTX,
-        sizeof (HDDLVADataFullRX), (void **)&vaDataFullRX);
+    // The attribute list follows the header on the wire and is sent from the user array
+    iov[0].iov_base = &vaDataTX;
+    iov[0].iov_len = sizeof (HDDLVACreateSurfaces2TX);
+    iov[1].iov_base = attribList;
+    iov[1].iov_len = sizeof (VASurfaceAttrib) * numAttribs;
+
+    commStatus = Comm_SubmissionV (commCtx, HDDLVACreateSurfaces2, COMM_READ_FULL, iov,
+        numAttribs ? 2 : 1, sizeof (HDDLVADataFullRX), (void **)&vaDataFullRX);
     SHIM_CHK_ERROR (commStatus, "Com operation failed", VA_STATUS_ERROR_UNKNOWN);
 
     if ( (vaDataFullRX.vaDataRX.vaData.vaFunctionID != HDDLVACreateSurfaces2) ||
@@ -3020,12 +3129,29 @@ HDDLVAShimDriverContext *HDDLVAShim_CreateHDDLBypassDriverContext ()
         (HDDLVAShimDriverContext));
 }
 
+static void HDDLVAShim_CommContextCoalesce (HDDLShimCommContext *commCtx)
+{
+    char *coalesceEnv = getenv ("BYPASS_BATCH_COALESCE");
+    CommStatus commStatus;
+
+    // Opt-in: frames of small, fast streams go out together instead of one round trip each
+    if (IS_BATCH (commCtx) && coalesceEnv != NULL && atoi (coalesceEnv) > 0)
+    {
+        commStatus = Comm_BatchCoalesceStart (commCtx, atoi (coalesceEnv));
+        if (commStatus != COMM_STATUS_SUCCESS)
+        {
+            SHIM_ERROR_MESSAGE ("Failed to start batch coalescing, flush every frame");
+        }
+    }
+}
+
 HDDLShimCommContext *HDDLVAShim_CommContextSetup (HDDLVAShimDriverContext *vaShimCtx,
     uint64_t pid, uint64_t tid, HDDLShimCommContextNew commContextNew)
 {
     HDDLShimCommContext *commCtx = NULL;
     CommStatus commStatus;
     char *batchEnv = getenv ("BYPASS_BATCH_MODE");
+    char *pipelineEnv = getenv ("BYPASS_PIPELINE_MODE");
 
     commCtx = (HDDLShimCommContext *)HDDLMemoryMgr_AllocAndZeroMemory (
         sizeof (HDDLShimCommContext));
@@ -3060,7 +3186,7 @@ HDDLShimCommContext *HDDLVAShim_CommContextSetup (HDDLVAShimDriverContext *vaShi
 	// dynamic context creation
         commStatus = Comm_GetLastChannel (commCtx, &vaShimCtx->lastChannel);
     }
-    else if (commContextNew == DYNAMIC_COMM_CONTEXT)
+    else if (commContextNew == DYNAMIC_COMM_CONTEXT || commContextNew == BULK_COMM_CONTEXT)
     {
         HDDLShimCommContext *mainCommCtx = vaShimCtx->mainCommCtx;
         HDDLDynamicChannelTX vaDataTX;
@@ -3068,13 +3194,17 @@ HDDLShimCommContext *HDDLVAShim_CommContextSetup (HDDLVAShimDriverContext *vaShi
         uint16_t tx = 0;
         uint16_t rx = 0;
 
-        commStatus = Comm_DynamicContextInit (&commCtx, mainCommCtx, &vaShimCtx->lastChannel,
-            &tx, &rx);
-        if (commStatus != COMM_STATUS_SUCCESS)
+        // Channels the target handed out are known to it only, it picks the pair and tells
+        if (!mainCommCtx->autoChannel)
         {
-            SHIM_ERROR_MESSAGE ("Fail to init dynamic context");
-            HDDLMemoryMgr_FreeMemory (commCtx);
-            return NULL;
+            commStatus = Comm_DynamicContextInit (&commCtx, mainCommCtx,
+                &vaShimCtx->lastChannel, &tx, &rx);
+            if (commStatus != COMM_STATUS_SUCCESS)
+            {
+                SHIM_ERROR_MESSAGE ("Fail to init dynamic context");
+                HDDLMemoryMgr_FreeMemory (commCtx);
+                return NULL;
+            }
         }
 
         vaDataTX.vaData.vaFunctionID = HDDLDynamicChannelID;
@@ -3099,14 +3229,48 @@ HDDLShimCommContext *HDDLVAShim_CommContextSetup (HDDLVAShimDriverContext *vaShi
             return NULL;
         }
 
+        if (mainCommCtx->autoChannel)
+        {
+            ShimThreadParams threadParams;
+
+            if (vaDataRX.ret != VA_STATUS_SUCCESS)
+            {
+                SHIM_ERROR_MESSAGE ("Target has no channel pair to hand out");
+                HDDLMemoryMgr_FreeMemory (commCtx);
+                return NULL;
+            }
+
+            HDDLMemoryMgr_ZeroMemory (&threadParams, sizeof (threadParams));
+            threadParams.commMode = mainCommCtx->commMode;
+            threadParams.tx = vaDataRX.channelRX;
+            threadParams.rx = vaDataRX.channelTX;
+            threadParams.swDeviceId = mainCommCtx->xLinkCtx->xLinkHandler.sw_device_id;
+
+            commStatus = Comm_ContextInit (&commCtx, &threadParams);
+            if (commStatus != COMM_STATUS_SUCCESS)
+            {
+                SHIM_ERROR_MESSAGE ("Fail to init dynamic context");
+                HDDLMemoryMgr_FreeMemory (commCtx);
+                return NULL;
+            }
+
+            commCtx->autoChannel = true;
+        }
+
         COMM_MODE (commCtx) = mainCommCtx->commMode;
+
+        // Calls reach a bulk pair one at a time from the batch of its control pair
+        if (commContextNew == BULK_COMM_CONTEXT)
+        {
+            IS_BATCH (commCtx) = false;
+        }
     }
 
-    // Batching Mode is not supported for TCP communication. Turning off Batching
+    // Batching Mode is not supported for TCP and SHM communication. Turning off Batching
     // Mode if it has been set.
-    if (IS_TCP_MODE (commCtx))
+    if (IS_TCP_MODE (commCtx) || IS_SHM_MODE (commCtx))
     {
-        SHIM_NORMAL_MESSAGE ("Turning off Batching Mode in TCP communication");
+        SHIM_NORMAL_MESSAGE ("Turning off Batching Mode in TCP/SHM communication");
         IS_BATCH (commCtx) = false;
     }
     SHIM_NORMAL_MESSAGE ("Batching Mode: %d", IS_BATCH (commCtx));
@@ -3115,6 +3279,10 @@ HDDLShimCommContext *HDDLVAShim_CommContextSetup (HDDLVAShimDriverContext *vaShi
     if (commStatus != COMM_STATUS_SUCCESS)
     {
         SHIM_ERROR_MESSAGE ("Error initializing communication settings");
+        if (IS_XLINK_MODE (commCtx))
+        {
+            XLink_ContextDestroy (commCtx->xLinkCtx);
+        }
         HDDLMemoryMgr_FreeMemory (commCtx);
         return NULL;
     }
@@ -3129,6 +3297,161 @@ HDDLShimCommContext *HDDLVAShim_CommContextSetup (HDDLVAShimDriverContext *vaShi
         return NULL;
     }
 
+    // Pipelining lets several threads keep requests in flight on the channel, replies are
+    // routed back by request id. Falls back to one request at a time if it cannot start.
+    if (pipelineEnv == NULL || atoi (pipelineEnv) != 0)
+    {
+        commStatus = Comm_PipelineStart (commCtx);
+        if (commStatus != COMM_STATUS_SUCCESS)
+        {
+            SHIM_ERROR_MESSAGE ("Failed to start pipelining, fall back to single request");
+        }
+    }
+    SHIM_NORMAL_MESSAGE ("Pipeline Mode: %d", IS_PIPELINE (commCtx));
+
+    // Not for channels bound to a VAContext, a vaSyncSurface sent on the channel of the thread
+    // would not flush the frames held back there. Pooled channels are set up under that pid
+    // too and start coalescing once a thread takes them.
+    if (pid != VA_CONTEXT_COMM_PID)
+    {
+        HDDLVAShim_CommContextCoalesce (commCtx);
+    }
+
+    return commCtx;
+}
+
+// Opt-in: give the context a second pair for the calls moving frame and image data, the
+// routing is done in Comm_SingleSubmissionV. Without it everything shares the one pair.
+static void HDDLVAShim_CommContextAttachBulk (HDDLVAShimDriverContext *vaShimCtx,
+    HDDLShimCommContext *commCtx)
+{
+    char *bulkEnv = getenv ("BYPASS_BULK_CHANNEL");
+    HDDLShimCommContext *bulkCtx;
+
+    if (commCtx->bulkCtx != NULL || bulkEnv == NULL || atoi (bulkEnv) == 0 ||
+        !(IS_XLINK_MODE (commCtx) || IS_UNITE_MODE (commCtx)))
+    {
+        return;
+    }
+
+    bulkCtx = HDDLVAShim_CommContextSetup (vaShimCtx, commCtx->pid, commCtx->tid,
+        BULK_COMM_CONTEXT);
+    if (bulkCtx == NULL)
+    {
+        SHIM_ERROR_MESSAGE ("Failed to open bulk channel, data calls share the control channel");
+        return;
+    }
+
+    commCtx->bulkCtx = bulkCtx;
+}
+
+static void HDDLVAShim_CommContextDestroy (HDDLShimCommContext *commCtx)
+{
+    if (commCtx->bulkCtx)
+    {
+        HDDLVAShim_CommContextDestroy (commCtx->bulkCtx);
+    }
+
+    if (IS_BATCH (commCtx))
+    {
+        Comm_BatchCoalesceStop (commCtx);
+        Comm_BatchDestroy (commCtx);
+    }
+
+    Comm_Disconnect (commCtx, HOST);
+    HDDLMemoryMgr_FreeMemory (commCtx);
+}
+
+static void HDDLVAShim_ChannelPoolInit (HDDLVAShimDriverContext *vaShimCtx)
+{
+    HDDLShimCommContext *commCtx;
+    char *poolEnv = getenv ("BYPASS_CHANNEL_POOL");
+    uint32_t poolSize;
+
+    if (poolEnv == NULL || atoi (poolEnv) <= 0)
+    {
+        return;
+    }
+
+    // Only XLINK and UNITE can open more channels
+    if (!IS_XLINK_MODE (vaShimCtx->mainCommCtx) && !IS_UNITE_MODE (vaShimCtx->mainCommCtx))
+    {
+        return;
+    }
+
+    poolSize = atoi (poolEnv);
+    if (poolSize > MAX_CHANNEL_POOL_SIZE)
+    {
+        poolSize = MAX_CHANNEL_POOL_SIZE;
+    }
+
+    vaShimCtx->channelPool = (HDDLShimCommContext **)HDDLMemoryMgr_AllocAndZeroMemory (
+        poolSize * sizeof (HDDLShimCommContext *));
+    SHIM_CHK_NULL (vaShimCtx->channelPool, "Failed to allocate channel pool", );
+
+    // Each pair waits for the target to open its side, better here than on the first call of
+    // a thread or context. A pair that cannot be opened only makes the pool smaller.
+    while (vaShimCtx->uiChannelPoolCount < poolSize)
+    {
+        commCtx = HDDLVAShim_CommContextSetup (vaShimCtx, VA_CONTEXT_COMM_PID, 0,
+            DYNAMIC_COMM_CONTEXT);
+        if (commCtx == NULL)
+        {
+            SHIM_ERROR_MESSAGE ("Failed to open pooled channel, pool holds %u",
+                vaShimCtx->uiChannelPoolCount);
+            break;
+        }
+
+        vaShimCtx->channelPool[vaShimCtx->uiChannelPoolCount++] = commCtx;
+    }
+
+    SHIM_NORMAL_MESSAGE ("Channel Pool: %u", vaShimCtx->uiChannelPoolCount);
+}
+
+static void HDDLVAShim_ChannelPoolDestroy (HDDLVAShimDriverContext *vaShimCtx)
+{
+    // Pairs no thread or context took
+    while (vaShimCtx->uiChannelPoolCount > 0)
+    {
+        HDDLVAShim_CommContextDestroy (
+            vaShimCtx->channelPool[--vaShimCtx->uiChannelPoolCount]);
+    }
+
+    if (vaShimCtx->channelPool)
+    {
+        HDDLMemoryMgr_FreeMemory (vaShimCtx->channelPool);
+        vaShimCtx->channelPool = NULL;
+    }
+}
+
+// Called with contextMutex held. Takes a pair from the pool, opens a new one once it is empty.
+// The bulk pair is only opened here, pairs waiting in the pool carry no traffic to route.
+static HDDLShimCommContext *HDDLVAShim_CommContextAcquire (HDDLVAShimDriverContext *vaShimCtx,
+    uint64_t pid, uint64_t tid)
+{
+    HDDLShimCommContext *commCtx;
+
+    if (vaShimCtx->uiChannelPoolCount == 0)
+    {
+        commCtx = HDDLVAShim_CommContextSetup (vaShimCtx, pid, tid, DYNAMIC_COMM_CONTEXT);
+    }
+    else
+    {
+        commCtx = vaShimCtx->channelPool[--vaShimCtx->uiChannelPoolCount];
+        commCtx->pid = pid;
+        commCtx->tid = tid;
+
+        if (pid != VA_CONTEXT_COMM_PID)
+        {
+            HDDLVAShim_CommContextCoalesce (commCtx);
+        }
+    }
+
+    if (commCtx != NULL)
+    {
+        HDDLVAShim_CommContextAttachBulk (vaShimCtx, commCtx);
+    }
+
     return commCtx;
 }
 
@@ -3136,67 +3459,173 @@ HDDLShimCommContext *HDDLVAShim_GetCommContext (HDDLVAShimDriverContext *vaShimC
 {
     HDDLShimCommContext *commCtx = NULL;
     HDDLShimCommContext *mainCommCtx = vaShimCtx->mainCommCtx;
-
-    // TODO: Temporary disable this piece of code until UNITE and TCP code is
-    // ready
-#if 0
     HDDLCommContextElement *commCtxElement = NULL;
     uint64_t pid;
     uint64_t tid;
     uint32_t commCtxId;
-#endif
 
     SHIM_CHK_NULL (mainCommCtx, "Null main comm context", NULL);
 
-    commCtx = mainCommCtx;
+    // Case 1: The calling thread already found its comm context for this driver context
+    if (tlsCommCtxSerial == vaShimCtx->serial)
+    {
+        return tlsCommCtx;
+    }
 
-    // TODO: Temporary disable this piece of code until UNITE and TCP code is
-    // ready
-#if 0
     pid = getpid ();
     tid = syscall (SYS_gettid);
 
-    // Case 1: Caller is in the sharing the same thread as the main context
-    if ( (mainCommCtx->pid == pid) && (mainCommCtx->tid == tid))
+    // Case 2: Caller is in the sharing the same thread as the main context. Only XLINK and
+    // UNITE can open more channels, TCP and SHM threads all share the main context.
+    if ( ( (mainCommCtx->pid == pid) && (mainCommCtx->tid == tid)) ||
+        (!IS_XLINK_MODE (mainCommCtx) && !IS_UNITE_MODE (mainCommCtx)))
     {
-        return mainCommCtx;
+        commCtx = mainCommCtx;
     }
+    else
+    {
+        HDDLThreadMgr_LockMutex (&vaShimCtx->contextMutex);
 
-    // Case 2: Caller is from different thread but we already have a dynamic
-    // comm context created for this pid + tid combination
-    commCtx = HDDLMemoryMgr_GetCommContext (vaShimCtx, pid, tid, &commCtxId);
+        // Case 3: Caller is from different thread but we already have a dynamic
+        // comm context created for this pid + tid combination
+        commCtx = HDDLMemoryMgr_GetCommContext (vaShimCtx, pid, tid, &commCtxId);
 
-    // Case 3: Caller is from different thread and there's no dynamic comm
-    // context being created yet. Create a new comm context for this.
-    if (!commCtx)
+        // Case 4: Caller is from different thread and there's no dynamic comm
+        // context being created yet. Create a new comm context for this.
+        if (!commCtx)
+        {
+            commCtx = HDDLVAShim_CommContextAcquire (vaShimCtx, pid, tid);
+            if (commCtx != NULL)
+            {
+                commCtxElement = HDDLMemoryMgr_AllocCommContextHeap (vaShimCtx->contextHeap,
+                    pid, tid);
+                if (!commCtxElement)
+                {
+                    HDDLVAShim_CommContextDestroy (commCtx);
+                    commCtx = NULL;
+                }
+            }
+
+            if (commCtx != NULL)
+            {
+                commCtxElement->pCommContext = commCtx;
+                vaShimCtx->uiNumContext++;
+
+                SHIM_NORMAL_MESSAGE ("Create new comm context for pid %lu tid %lu", pid, tid);
+            }
+            else
+            {
+                // The thread still works, just without a channel of its own
+                SHIM_ERROR_MESSAGE ("Failed to setup comm context, share the main one");
+                commCtx = mainCommCtx;
+            }
+        }
+
+        HDDLThreadMgr_UnlockMutex (&vaShimCtx->contextMutex);
+    }
+
+    tlsCommCtx = commCtx;
+    tlsCommCtxSerial = vaShimCtx->serial;
+
+    return commCtx;
+}
+
+HDDLShimCommContext *HDDLVAShim_GetContextCommContext (HDDLVAShimDriverContext *vaShimCtx,
+    VAContextID context)
+{
+    HDDLShimCommContext *commCtx = NULL;
+    uint32_t commCtxId;
+
+    if (vaShimCtx->bindContextChannel)
     {
         HDDLThreadMgr_LockMutex (&vaShimCtx->contextMutex);
+        commCtx = HDDLMemoryMgr_GetCommContext (vaShimCtx, VA_CONTEXT_COMM_PID, context,
+            &commCtxId);
+        HDDLThreadMgr_UnlockMutex (&vaShimCtx->contextMutex);
+    }
 
-        commCtx = HDDLVAShim_CommContextSetup (vaShimCtx, pid, tid, DYNAMIC_COMM_CONTEXT);
-        if (commCtx == NULL)
+    // Contexts without a channel of their own, and calls not tied to a context, go out on the
+    // channel of the calling thread
+    return commCtx ? commCtx : HDDLVAShim_GetCommContext (vaShimCtx);
+}
+
+HDDLShimCommContext *HDDLVAShim_GetBufferCommContext (HDDLVAShimDriverContext *vaShimCtx,
+    VABufferID bufId)
+{
+    HDDLVABuffer *vaBuffer;
+    VAContextID context = VA_INVALID_ID;
+    uint32_t hostBufId;
+
+    if (vaShimCtx->bindContextChannel)
+    {
+        HDDLThreadMgr_ReadLock (&vaShimCtx->bufferLock);
+        vaBuffer = HDDLMemoryMgr_GetBufferFromVABufferID (vaShimCtx, bufId, &hostBufId);
+        if (vaBuffer != NULL)
         {
-            SHIM_ERROR_MESSAGE ("Failed to setup comm context");
-            HDDLThreadMgr_UnlockMutex (&vaShimCtx->contextMutex);
-            return NULL;
+            context = vaBuffer->context;
         }
+        HDDLThreadMgr_UnlockRWLock (&vaShimCtx->bufferLock);
+    }
+
+    return HDDLVAShim_GetContextCommContext (vaShimCtx, context);
+}
+
+void HDDLVAShim_BindContextChannel (HDDLVAShimDriverContext *vaShimCtx, VAContextID context)
+{
+    HDDLShimCommContext *commCtx;
+    HDDLCommContextElement *commCtxElement;
 
-        commCtxElement = HDDLMemoryMgr_AllocCommContextHeap (vaShimCtx->contextHeap);
-        if (!commCtxElement)
+    HDDLThreadMgr_LockMutex (&vaShimCtx->contextMutex);
+
+    commCtx = HDDLVAShim_CommContextAcquire (vaShimCtx, VA_CONTEXT_COMM_PID, context);
+    if (commCtx != NULL)
+    {
+        commCtxElement = HDDLMemoryMgr_AllocCommContextHeap (vaShimCtx->contextHeap,
+            VA_CONTEXT_COMM_PID, context);
+        if (commCtxElement == NULL)
         {
-            HDDLThreadMgr_UnlockMutex (&vaShimCtx->contextMutex);
-            return NULL;
+            HDDLVAShim_CommContextDestroy (commCtx);
+            commCtx = NULL;
         }
+        else
+        {
+            commCtxElement->pCommContext = commCtx;
+            vaShimCtx->uiNumContext++;
+        }
+    }
 
-        commCtxElement->pCommContext = commCtx;
-        vaShimCtx->uiNumContext++;
+    HDDLThreadMgr_UnlockMutex (&vaShimCtx->contextMutex);
 
-        HDDLThreadMgr_UnlockMutex (&vaShimCtx->contextMutex);
+    if (commCtx == NULL)
+    {
+        SHIM_ERROR_MESSAGE ("Failed to bind a channel to context %u, share the thread's one",
+            context);
+        return;
+    }
+
+    SHIM_NORMAL_MESSAGE ("Bind new comm context to context %u", context);
+}
+
+void HDDLVAShim_UnbindContextChannel (HDDLVAShimDriverContext *vaShimCtx, VAContextID context)
+{
+    HDDLShimCommContext *commCtx;
+    uint32_t commCtxId;
+
+    HDDLThreadMgr_LockMutex (&vaShimCtx->contextMutex);
 
-        SHIM_NORMAL_MESSAGE ("Create new comm context for pid %lu tid %lu", pid, tid);
+    commCtx = HDDLMemoryMgr_GetCommContext (vaShimCtx, VA_CONTEXT_COMM_PID, context, &commCtxId);
+    if (commCtx != NULL)
+    {
+        HDDLMemoryMgr_ReleaseCommContextElement (vaShimCtx->contextHeap, commCtxId);
+        vaShimCtx->uiNumContext--;
     }
-#endif
 
-    return commCtx;
+    HDDLThreadMgr_UnlockMutex (&vaShimCtx->contextMutex);
+
+    if (commCtx != NULL)
+    {
+        HDDLVAShim_CommContextDestroy (commCtx);
+    }
 }
 
 VAStatus HDDLVAShim_HeapInit (HDDLVAShimDriverContext *vaShimCtx)
@@ -3208,6 +3637,11 @@ VAStatus HDDLVAShim_HeapInit (HDDLVAShimDriverContext *vaShimCtx)
         return VA_STATUS_ERROR_ALLOCATION_FAILED;
     }
     vaShimCtx->bufferHeap->uiElementSize = sizeof (HDDLVABufferElement);
+    vaShimCtx->bufferHeap->index = HDDLMemoryMgr_CreateIdTable ();
+    if (vaShimCtx->bufferHeap->index == NULL)
+    {
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+    }
 
     vaShimCtx->imageHeap = (HDDLVAHeap *)HDDLMemoryMgr_AllocAndZeroMemory (sizeof (HDDLVAHeap));
     if (vaShimCtx->imageHeap == NULL)
@@ -3216,6 +3650,11 @@ VAStatus HDDLVAShim_HeapInit (HDDLVAShimDriverContext *vaShimCtx)
         return VA_STATUS_ERROR_ALLOCATION_FAILED;
     }
     vaShimCtx->imageHeap->uiElementSize = sizeof (HDDLVAImageElement);
+    vaShimCtx->imageHeap->index = HDDLMemoryMgr_CreateIdTable ();
+    if (vaShimCtx->imageHeap->index == NULL)
+    {
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+    }
 
     vaShimCtx->contextHeap = (HDDLVAHeap *)HDDLMemoryMgr_AllocAndZeroMemory (sizeof (HDDLVAHeap));
     if (vaShimCtx->contextHeap == NULL)
@@ -3224,10 +3663,23 @@ VAStatus HDDLVAShim_HeapInit (HDDLVAShimDriverContext *vaShimCtx)
         return VA_STATUS_ERROR_ALLOCATION_FAILED;
     }
     vaShimCtx->contextHeap->uiElementSize = sizeof (HDDLCommContextElement);
+    vaShimCtx->contextHeap->index = HDDLMemoryMgr_CreateIdTable ();
+    if (vaShimCtx->contextHeap->index == NULL)
+    {
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+    }
 
     return VA_STATUS_SUCCESS;
 }
 
+VABufferID HDDLVAShim_NewBufferId (HDDLVAShimDriverContext *vaShimCtx)
+{
+    uint32_t count = __atomic_fetch_add (&vaShimCtx->nextBufferId, 1, __ATOMIC_RELAXED);
+
+    // Wrap before the top ID, which would be VA_INVALID_ID
+    return HOST_BUFFER_ID_FLAG | (count % (~HOST_BUFFER_ID_FLAG));
+}
+
 VAStatus HDDLVAShim_CreateInternalBufferAtHeap (HDDLVAShimDriverContext *vaShimCtx,
     VAContextID context, VABufferType type, unsigned int size, unsigned int numElement,
     VABufferID bufId, void *data)
@@ -3236,17 +3688,21 @@ VAStatus HDDLVAShim_CreateInternalBufferAtHeap (HDDLVAShimDriverContext *vaShimC
     HDDLVABufferElement *vaBufferElement;
     uint32_t bufSize = 0;
 
-    HDDLThreadMgr_LockMutex (&vaShimCtx->bufferMutex);
+    HDDLThreadMgr_WriteLock (&vaShimCtx->bufferLock);
 
-    vaBuffer = (HDDLVABuffer *)HDDLMemoryMgr_AllocAndZeroMemory (sizeof (HDDLVABuffer));
+    vaBuffer = (HDDLVABuffer *)HDDLMemoryMgr_PoolAlloc (&vaShimCtx->shadowPool,
+        sizeof (HDDLVABuffer));
 
     if (vaBuffer == NULL)
     {
         SHIM_ERROR_MESSAGE ("vaBuffer returned NULL");
-        HDDLThreadMgr_UnlockMutex (&vaShimCtx->bufferMutex);
+        HDDLThreadMgr_UnlockRWLock (&vaShimCtx->bufferLock);
         return VA_STATUS_ERROR_ALLOCATION_FAILED;
     }
 
+    HDDLMemoryMgr_ZeroMemory (vaBuffer, sizeof (HDDLVABuffer));
+    HDDLThreadMgr_InitMutex (&vaBuffer->bufMutex);
+
     vaBuffer->bufId = bufId;
     vaBuffer->context = context;
     vaBuffer->type = type;
@@ -3298,8 +3754,16 @@ VAStatus HDDLVAShim_CreateInternalBufferAtHeap (HDDLVAShimDriverContext *vaShimC
         case HANTROEncCuCtrlBufferType:
 #endif
 #endif
+            // Recycled from an earlier buffer of the same size class, it only needs zeroing
+            // when there is no data to fill it with
             bufSize = sizeof (unsigned char) * size * numElement;
-            vaBuffer->pData = HDDLMemoryMgr_AllocAndZeroMemory (bufSize);
+            vaBuffer->pData = HDDLMemoryMgr_PoolAlloc (&vaShimCtx->shadowPool, bufSize);
+            if (vaBuffer->pData == NULL)
+            {
+                HDDLVAShim_ReleaseShadowBuffer (vaShimCtx, vaBuffer);
+                HDDLThreadMgr_UnlockRWLock (&vaShimCtx->bufferLock);
+                return VA_STATUS_ERROR_ALLOCATION_FAILED;
+            }
 
             // Data might be NULL. Copy data only when it's not null to avoid segfault
             if (data)
@@ -3321,26 +3785,26 @@ VAStatus HDDLVAShim_CreateInternalBufferAtHeap (HDDLVAShimDriverContext *vaShimC
             break;
 
         default:
-            HDDLMemoryMgr_FreeMemory (vaBuffer);
-            HDDLThreadMgr_UnlockMutex (&vaShimCtx->bufferMutex);
+            HDDLVAShim_ReleaseShadowBuffer (vaShimCtx, vaBuffer);
+            HDDLThreadMgr_UnlockRWLock (&vaShimCtx->bufferLock);
             return VA_STATUS_ERROR_UNSUPPORTED_BUFFERTYPE;
     }
 
     // Count total buffer created
     vaShimCtx->uiNumBuffer++;
 
-    vaBufferElement = HDDLMemoryMgr_AllocBufferHeap (vaShimCtx->bufferHeap);
+    vaBufferElement = HDDLMemoryMgr_AllocBufferHeap (vaShimCtx->bufferHeap, bufId);
     if (vaBufferElement == NULL)
     {
-        HDDLMemoryMgr_FreeMemory (vaBuffer);
-        HDDLThreadMgr_UnlockMutex (&vaShimCtx->bufferMutex);
+        HDDLVAShim_ReleaseShadowBuffer (vaShimCtx, vaBuffer);
+        HDDLThreadMgr_UnlockRWLock (&vaShimCtx->bufferLock);
         return VA_STATUS_ERROR_ALLOCATION_FAILED;
     }
 
     // Store user info in created element
     vaBufferElement->pBuf = vaBuffer;
 
-    HDDLThreadMgr_UnlockMutex (&vaShimCtx->bufferMutex);
+    HDDLThreadMgr_UnlockRWLock (&vaShimCtx->bufferLock);
 
     return VA_STATUS_SUCCESS;
 }
@@ -3489,13 +3953,13 @@ VAStatus HDDLVAShim_ReleaseInternalBufferFromHeap (HDDLVAShimDriverContext *vaSh
     HDDLVABuffer *vaBuffer;
     uint32_t hostBufId;
 
-    HDDLThreadMgr_LockMutex (&vaShimCtx->bufferMutex);
+    HDDLThreadMgr_WriteLock (&vaShimCtx->bufferLock);
 
     vaBuffer = HDDLMemoryMgr_GetBufferFromVABufferID (vaShimCtx, bufId, &hostBufId);
 
     if (NULL == vaBuffer)
     {
-        HDDLThreadMgr_UnlockMutex (&vaShimCtx->bufferMutex);
+        HDDLThreadMgr_UnlockRWLock (&vaShimCtx->bufferLock);
         SHIM_ERROR_MESSAGE ("va buffer not exist");
         return VA_STATUS_ERROR_ALLOCATION_FAILED;
     }
@@ -3503,29 +3967,24 @@ VAStatus HDDLVAShim_ReleaseInternalBufferFromHeap (HDDLVAShimDriverContext *vaSh
     if (!vaBuffer->bMapped)
     {
         HDDLMemoryMgr_ReleaseBufferElement (vaShimCtx->bufferHeap, hostBufId);
+        vaShimCtx->uiNumBuffer--;
 
-        if (vaBuffer->type == VAEncCodedBufferType)
+        // A thread still using the buffer frees it once it is done
+        if (__atomic_load_n (&vaBuffer->iUseCount, __ATOMIC_ACQUIRE) == 0)
         {
-            if (vaBuffer->pData)
-            {
-                HDDLVAShim_DestroyInternalVAEncCodedBuffer (vaBuffer);
-            }
+            HDDLVAShim_ReleaseShadowBuffer (vaShimCtx, vaBuffer);
         }
         else
         {
-            HDDLMemoryMgr_FreeMemory (vaBuffer->pData);
-            vaBuffer->pData = NULL;
+            vaBuffer->bReleased = true;
         }
-
-        HDDLMemoryMgr_FreeMemory (vaBuffer);
-        vaShimCtx->uiNumBuffer--;
     }
     else
     {
         SHIM_ERROR_MESSAGE ("Try to free a mapped buffer: type %d", vaBuffer->type);
     }
 
-    HDDLThreadMgr_UnlockMutex (&vaShimCtx->bufferMutex);
+    HDDLThreadMgr_UnlockRWLock (&vaShimCtx->bufferLock);
 
     return VA_STATUS_SUCCESS;
 }
@@ -3563,10 +4022,14 @@ VAStatus HDDLVAShim_DestroyBufferHeap (VADriverContextP ctx)
         HDDLVABufferElement *bufferHeapBase = (HDDLVABufferElement *)bufferHeap->pHeapBase;
         SHIM_CHK_NULL (bufferHeapBase, "nullptr bufferHeapBase", VA_STATUS_ERROR_INVALID_CONTEXT);
 
-        for (int32_t elementId = 0; elementId < bufNum; ++elementId)
+        // Buffers in use are spread over the heap, free elements have no buffer
+        for (int32_t elementId = 0; elementId < bufferHeap->uiElementCount; ++elementId)
         {
             HDDLVABufferElement *bufferElement = &bufferHeapBase[elementId];
-            SHIM_CHK_NULL (bufferElement->pBuf, "nullptr buffer", VA_STATUS_ERROR_INVALID_CONTEXT);
+            if (bufferElement->pBuf == NULL)
+            {
+                continue;
+            }
             HDDLVAShim_DestroyBuffer (ctx, bufferElement->pBuf->bufId);
         }
     }
@@ -3588,10 +4051,13 @@ VAStatus HDDLVAShim_DestroyImageHeap (VADriverContextP ctx)
     {
         HDDLVAImageElement *imageHeapBase = (HDDLVAImageElement *)imageHeap->pHeapBase;
 
-        for (int32_t elementId = 0; elementId < imageNum; ++elementId)
+        for (int32_t elementId = 0; elementId < imageHeap->uiElementCount; ++elementId)
         {
             HDDLVAImageElement *imageElement = &imageHeapBase[elementId];
-            SHIM_CHK_NULL (&imageElement->pImage, "nullptr buffer", VA_STATUS_ERROR_INVALID_CONTEXT);
+            if (imageElement->pImage == NULL)
+            {
+                continue;
+            }
             HDDLVAShim_DestroyImage (ctx, imageElement->pImage->image_id);
         }
     }
@@ -3616,10 +4082,13 @@ VAStatus HDDLVAShim_DestroyContextHeap (VADriverContextP ctx)
         HDDLCommContextElement *ctxHeapBase = (HDDLCommContextElement *)ctxHeap->pHeapBase;
         SHIM_CHK_NULL (ctxHeapBase, "nullptr ctxHeapBase", VA_STATUS_ERROR_INVALID_CONTEXT);
 
-        for (int32_t elementId = 0; elementId < ctxNum; ++elementId)
+        for (int32_t elementId = 0; elementId < ctxHeap->uiElementCount; ++elementId)
         {
             HDDLCommContextElement *ctxElement = &ctxHeapBase[elementId];
-            SHIM_CHK_NULL (&ctxElement->pCommContext, "nullptr context", VA_STATUS_ERROR_INVALID_CONTEXT);
+            if (ctxElement->pCommContext == NULL)
+            {
+                continue;
+            }
 
             commCtx = ctxElement->pCommContext;
 
@@ -3630,7 +4099,7 @@ VAStatus HDDLVAShim_DestroyContextHeap (VADriverContextP ctx)
 
             HDDLThreadMgr_UnlockMutex (&vaShimCtx->contextMutex);
 
-            HDDLMemoryMgr_FreeMemory (commCtx);
+            HDDLVAShim_CommContextDestroy (commCtx);
         }
     }
 
@@ -364,6 +364,38 @@ HDDLShimCommContext *HDDLVAShim_CommContextSetup (HDDLVAShimDriverContext *vaShi
 //!
 HDDLShimCommContext *HDDLVAShim_GetCommContext (HDDLVAShimDriverContext *vaShimCtx);
 
+//!
+//! \brief   Comm context to reach a VAContext with, the channel bound to it if there is one,
+//!          else the one of the calling thread
+//! \return  HDDLShimCommContext *
+//!          Return pointer if success, else NULL
+//!
+HDDLShimCommContext *HDDLVAShim_GetContextCommContext (HDDLVAShimDriverContext *vaShimCtx,
+    VAContextID context);
+
+//!
+//! \brief   Comm context to reach the VAContext a buffer was created for
+//! \return  HDDLShimCommContext *
+//!          Return pointer if success, else NULL
+//!
+HDDLShimCommContext *HDDLVAShim_GetBufferCommContext (HDDLVAShimDriverContext *vaShimCtx,
+    VABufferID bufId);
+
+//!
+//! \brief   Open a channel pair for a VAContext, the context shares the channel of the calling
+//!          thread if that fails
+//! \return  void
+//!          Return nothing
+//!
+void HDDLVAShim_BindContextChannel (HDDLVAShimDriverContext *vaShimCtx, VAContextID context);
+
+//!
+//! \brief   Close the channel pair of a VAContext, if it has one
+//! \return  void
+//!          Return nothing
+//!
+void HDDLVAShim_UnbindContextChannel (HDDLVAShimDriverContext *vaShimCtx, VAContextID context);
+
 //!
 //! \brief   VA shim driver heap initialization
 //! \return  VAStatus
@@ -371,6 +403,14 @@ HDDLShimCommContext *HDDLVAShim_GetCommContext (HDDLVAShimDriverContext *vaShimC
 //!
 VAStatus HDDLVAShim_HeapInit (HDDLVAShimDriverContext *vaShimCtx);
 
+//!
+//! \brief   Hand out a buffer ID without asking the target, the target maps it to the buffer
+//!          it creates
+//! \return  VABufferID
+//!          Return the new buffer ID
+//!
+VABufferID HDDLVAShim_NewBufferId (HDDLVAShimDriverContext *vaShimCtx);
+
 //!
 //! \brief   VA shim driver internal buffer allocation
 //! \return  VAStatus
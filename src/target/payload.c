@@ -29,9 +29,23 @@
 //!
 
 #include "payload.h"
+#include "target_va_shim.h"
 #include "va_display.h"
+#include "shm.h"
 #define STR_VENDOR_MAX_STRLEN 200
 
+// Set once the reply of the current request has been built straight in the shared memory
+// ring and committed. Requests may run on worker threads, so it is kept per thread.
+static __thread bool replyInPlace;
+
+// Replies and scratch memory of the current request come from an arena of the thread serving
+// it, reset once the reply is written. It is freed when the thread exits.
+#define MESSAGE_ARENA_SIZE (64 * 1024)
+
+static __thread HDDLShimArena *messageArena;
+static pthread_key_t messageArenaKey;
+static pthread_once_t messageArenaOnce = PTHREAD_ONCE_INIT;
+
 #pragma pack(push, 1)
 
 bool registerVABufferNodeList (VABufferID bufferId, int32_t remoteFd, HDDLVABufferNode *list)
@@ -94,289 +108,431 @@ bool HDDLShim_GetGPUNodesAttributes (VADisplay *vaDpy, VAProfile profile, VAEntr
     return true;
 }
 
-VAStatus HDDLShim_ExtractPayload (HDDLVAFunctionID functionId, HDDLShimCommContext *ctx,
-    void *inPayload, void **outPayload)
+// Buffer on target a host buffer ID stands for, IDs the driver handed out pass through
+static VABufferID HDDLShim_TargetBufferId (HDDLShimCommContext *ctx, VABufferID bufId)
 {
-    VAStatus vaStatus = VA_STATUS_SUCCESS;
+    if (!IS_HOST_BUFFER_ID (bufId))
+    {
+        return bufId;
+    }
 
-    switch (functionId)
+    if (ctx->idTable == NULL)
     {
-        case HDDLVAMedia_DriverInit:
-        {
-            vaStatus = HDDLShim_ExtractandCallVAInit (ctx->vaDpy, inPayload, outPayload);
-            break;
-        }
-        case HDDLVATerminate:
-        {
-            vaStatus = HDDLShim_ExtractandCallVATerminate (ctx->vaDpy, inPayload, outPayload);
-            break;
-        }
-        case HDDLVACreateConfig:
-        {
-            vaStatus = HDDLShim_ExtractandCallVACreateConfig (ctx, inPayload, outPayload);
-            break;
-        }
-        case HDDLVADestroyConfig:
-        {
-            vaStatus = HDDLShim_ExtractandCallVADestroyConfig (ctx->vaDpy, inPayload, outPayload);
-            break;
-        }
-        case HDDLVACreateContext:
-        {
-            vaStatus = HDDLShim_ExtractandCallVACreateContext (ctx->vaDpy, inPayload, outPayload);
-            break;
-        }
-        case HDDLVADestroyContext:
-        {
-            vaStatus = HDDLShim_ExtractandCallVADestroyContext (ctx->vaDpy, inPayload, outPayload);
-            break;
-        }
-        case HDDLVACreateSurfaces:
-        {
-            vaStatus = HDDLShim_ExtractandCallVACreateSurfaces (ctx->vaDpy, inPayload, outPayload);
-            break;
-        }
-        case HDDLVADestroySurfaces:
-        {
-            vaStatus = HDDLShim_ExtractandCallVADestroySurfaces (ctx->vaDpy, inPayload, outPayload);
-            break;
-        }
-        case HDDLVACreateBuffer:
-        {
-            vaStatus = HDDLShim_ExtractandCallVACreateBuffer (ctx->vaDpy, inPayload, outPayload);
-            break;
-        }
-        case HDDLVADestroyBuffer:
-        {
-            vaStatus = HDDLShim_ExtractandCallVADestroyBuffer (ctx->vaDpy, inPayload, outPayload);
-            break;
-        }
-        case HDDLVAMapBuffer:
-        {
-            vaStatus = HDDLShim_ExtractandCallVAMapBuffer (ctx->vaDpy, inPayload, outPayload);
-            break;
-        }
-        case HDDLVAUnmapBuffer:
-        {
-            vaStatus = HDDLShim_ExtractandCallVAUnmapBuffer (ctx->vaDpy, inPayload, outPayload);
-            break;
-        }
-        case HDDLVACreateImage:
-        {
-            vaStatus = HDDLShim_ExtractandCallVACreateImage (ctx->vaDpy, inPayload, outPayload);
-            break;
-        }
-        case HDDLVADeriveImage:
-        {
-            vaStatus = HDDLShim_ExtractandCallVADeriveImage (ctx->vaDpy, inPayload, outPayload);
-            break;
-        }
-        case HDDLVADestroyImage:
-        {
-            vaStatus = HDDLShim_ExtractandCallVADestroyImage (ctx->vaDpy, inPayload, outPayload);
-            break;
-        }
-        case HDDLVABeginPicture:
-        {
-            vaStatus = HDDLShim_ExtractandCallVABeginPicture (ctx->vaDpy, inPayload, outPayload);
-            break;
-        }
-        case HDDLVARenderPicture:
-        {
-            vaStatus = HDDLShim_ExtractandCallVARenderPicture (ctx->vaDpy, inPayload, outPayload);
-            break;
-        }
-        case HDDLVAEndPicture:
-        {
-            vaStatus = HDDLShim_ExtractandCallVAEndPicture (ctx->vaDpy, inPayload, outPayload);
-            break;
-        }
-        case HDDLVASyncSurface:
-        {
-            vaStatus = HDDLShim_ExtractandCallVASyncSurface (ctx->vaDpy, inPayload, outPayload);
-            break;
-        }
-        case HDDLVAQueryConfigProfiles:
-        {
-            vaStatus = HDDLShim_ExtractandCallVAQueryConfigProfiles (ctx->vaDpy, inPayload,
-                outPayload);
-            break;
-        }
-        case HDDLVAQueryConfigEntrypoints:
-        {
-            vaStatus = HDDLShim_ExtractandCallVAQueryConfigEntrypoints (ctx->vaDpy, inPayload,
-                outPayload);
-            break;
-        }
-        case HDDLVAGetConfigAttributes:
-        {
-            vaStatus = HDDLShim_ExtractandCallVAGetConfigAttributes (ctx->vaDpy, inPayload,
-                outPayload);
-            break;
-        }
-        case HDDLVAQueryConfigAttributes:
-        {
-            vaStatus = HDDLShim_ExtractandCallVAQueryConfigAttributes (ctx->vaDpy, inPayload,
-                outPayload);
-            break;
-        }
-        case HDDLVAQuerySurfaceStatus:
-        {
-            vaStatus = HDDLShim_ExtractandCallVAQuerySurfaceStatus (ctx->vaDpy, inPayload,
-                outPayload);
-            break;
-        }
-        case HDDLVAQueryImageFormats:
-        {
-            vaStatus = HDDLShim_ExtractandCallVAQueryImageFormats (ctx->vaDpy, inPayload,
-                outPayload);
-            break;
-        }
-        case HDDLVAGetImage:
-        {
-            vaStatus = HDDLShim_ExtractandCallVAGetImage (ctx->vaDpy, inPayload, outPayload);
-            break;
-        }
-        case HDDLVAPutImage:
-        {
-            vaStatus = HDDLShim_ExtractandCallVAPutImage (ctx->vaDpy, inPayload, outPayload);
-            break;
-        }
-        case HDDLVAQueryDisplayAttributes:
-        {
-            vaStatus = HDDLShim_ExtractandCallVAQueryDisplayAttributes (ctx->vaDpy, inPayload,
-                outPayload);
-            break;
-        }
-        case HDDLVAGetDisplayAttributes:
-        {
-            vaStatus = HDDLShim_ExtractandCallVAGetDisplayAttributes (ctx->vaDpy, inPayload,
-                outPayload);
-            break;
-        }
-        case HDDLVASetDisplayAttributes:
-        {
-            vaStatus = HDDLShim_ExtractandCallVASetDisplayAttributes (ctx->vaDpy, inPayload,
-                outPayload);
-            break;
-        }
-        case HDDLVAQuerySurfaceAttributes:
-        {
-            vaStatus = HDDLShim_ExtractandCallVAQuerySurfaceAttributes (ctx->vaDpy, inPayload,
-                outPayload);
-            break;
-        }
-        case HDDLVACreateSurfaces2:
-        {
-            bool importFd = IS_UNITE_MODE (ctx);
-	    uint32_t swDeviceId = -1;
+        return VA_INVALID_ID;
+    }
 
-	    if (IS_UNITE_MODE (ctx))
-	    {
-	        swDeviceId = ctx->uniteCtx->xLinkCtx->xLinkHandler.sw_device_id;
-	    }
+    return HDDLMemoryMgr_LookupId (ctx->idTable, bufId);
+}
 
-            vaStatus = HDDLShim_ExtractandCallVACreateSurfaces2 (ctx->vaDpy, inPayload, outPayload,
-                importFd, swDeviceId);
-            break;
-        }
-        case HDDLVAExportSurfaceHandle:
-        {
-            bool registerFd = IS_UNITE_MODE (ctx);
-            uint64_t workloadId = IS_UNITE_MODE (ctx) ? ctx->uniteCtx->workloadId : -1;
+static void HDDLShim_DestroyArena (void *arena)
+{
+    HDDLMemoryMgr_DestroyArena ( (HDDLShimArena *)arena);
+}
 
-            vaStatus = HDDLShim_ExtractandCallVAExportSurfaceHandle (ctx->vaDpy, inPayload,
-                outPayload, registerFd, workloadId);
-            break;
-        }
-        case HDDLVACreateBuffer2:
-        {
-            vaStatus = HDDLShim_ExtractandCallVACreateBuffer2 (ctx, inPayload, outPayload);
-            break;
-        }
-	case HDDLVAAcquireBufferHandle:
-        {
-            bool registerFd = IS_UNITE_MODE (ctx);
-            uint64_t workloadId = IS_UNITE_MODE (ctx) ? ctx->uniteCtx->workloadId : -1;
-            HDDLVABufferNode *vaBufferNodeList = IS_UNITE_MODE (ctx) ?
-                ctx->uniteCtx->HDDLVABufferNodeList : NULL;
+static void HDDLShim_CreateArenaKey ()
+{
+    pthread_key_create (&messageArenaKey, HDDLShim_DestroyArena);
+}
 
-            vaStatus = HDDLShim_ExtractandCallVAAcquireBufferHandle (ctx->vaDpy, inPayload,
-                outPayload, registerFd, workloadId, vaBufferNodeList);
-            break;
-        }
-	case HDDLVAReleaseBufferHandle:
-        {
-            bool unregisterFd = IS_UNITE_MODE (ctx);
-            uint64_t workloadId = IS_UNITE_MODE (ctx) ? ctx->uniteCtx->workloadId : -1;
-            HDDLVABufferNode* vaBufferNodeList = IS_UNITE_MODE (ctx) ?
-                ctx->uniteCtx->HDDLVABufferNodeList : NULL;
+static void *HDDLShim_AllocPayload (size_t size)
+{
+    if (messageArena == NULL)
+    {
+        pthread_once (&messageArenaOnce, HDDLShim_CreateArenaKey);
 
-            vaStatus = HDDLShim_ExtractandCallVAReleaseBufferHandle (ctx->vaDpy, inPayload,
-                outPayload, unregisterFd, workloadId, vaBufferNodeList);
-            break;
-        }
-        case HDDLVABufferSetNumElements:
-        {
-            vaStatus = HDDLShim_ExtractandCallVASetNumElements (ctx, inPayload, outPayload);
-            break;
-        }
-        case HDDLDynamicChannelID:
-        {
-            vaStatus = HDDLShim_ExtractandCallDynamicChannelID (ctx, inPayload, outPayload);
-            break;
-        }
+        messageArena = HDDLMemoryMgr_CreateArena (MESSAGE_ARENA_SIZE);
+        SHIM_CHK_NULL (messageArena, "Failed to create message arena", NULL);
+
+        pthread_setspecific (messageArenaKey, messageArena);
+    }
+
+    return HDDLMemoryMgr_ArenaAlloc (messageArena, size);
+}
+
+void HDDLShim_ReleasePayload ()
+{
+    if (messageArena != NULL)
+    {
+        HDDLMemoryMgr_ResetArena (messageArena);
+    }
+}
+
+// Arrays a buffer points to are needed until the driver is done with the frame the buffer
+// went into. They live in an arena of the buffer, reset when the next update of the buffer
+// replaces them and destroyed along with the buffer.
+static HDDLShimArena *HDDLShim_RenewFrameArena (HDDLShimCommContext *ctx, VABufferID bufId)
+{
+    HDDLShimArena *arena;
+
+    SHIM_CHK_NULL (ctx->frameTable, "nullptr frameTable", NULL);
+
+    arena = HDDLMemoryMgr_LookupIdPointer (ctx->frameTable, bufId);
+    if (arena != NULL)
+    {
+        HDDLMemoryMgr_ResetArena (arena);
+        return arena;
+    }
+
+    arena = HDDLMemoryMgr_CreateArena (0);
+    SHIM_CHK_NULL (arena, "Failed to create frame arena", NULL);
+
+    if (!HDDLMemoryMgr_AddIdPointer (ctx->frameTable, bufId, arena))
+    {
+        HDDLMemoryMgr_DestroyArena (arena);
+        return NULL;
+    }
+
+    return arena;
+}
+
+// Parameter buffers the host rewrites for every frame. With BYPASS_MAP_CACHE they are mapped on
+// their first update and stay mapped until vaDestroyBuffer, so the driver pays for one map and
+// unmap per buffer instead of one per update.
+static bool HDDLShim_IsMapCachedType (VABufferType bufType)
+{
+    switch (bufType)
+    {
+        case VAPictureParameterBufferType:
+        case VAIQMatrixBufferType:
+        case VASliceParameterBufferType:
+        case VAHuffmanTableBufferType:
+        case VAQMatrixBufferType:
+        case VAEncSequenceParameterBufferType:
+        case VAEncPictureParameterBufferType:
+        case VAEncSliceParameterBufferType:
+        case VAEncMiscParameterBufferType:
+            return true;
         default:
-            break;
+            return false;
+    }
+}
+
+static VAStatus HDDLShim_MapUpdateBuffer (HDDLShimCommContext *ctx, VABufferID bufId,
+    VABufferType bufType, void **pBuf)
+{
+    VAStatus vaStatus;
+
+    if (ctx->mapTable == NULL || !HDDLShim_IsMapCachedType (bufType))
+    {
+        return vaMapBuffer (ctx->vaDpy, bufId, pBuf);
+    }
+
+    *pBuf = HDDLMemoryMgr_LookupIdPointer (ctx->mapTable, bufId);
+    if (*pBuf != NULL)
+    {
+        return VA_STATUS_SUCCESS;
+    }
+
+    vaStatus = vaMapBuffer (ctx->vaDpy, bufId, pBuf);
+
+    // A buffer the table has no room for is unmapped after the update as before
+    if (vaStatus == VA_STATUS_SUCCESS && *pBuf != NULL)
+    {
+        HDDLMemoryMgr_AddIdPointer (ctx->mapTable, bufId, *pBuf);
     }
 
     return vaStatus;
 }
 
-void *HDDLShim_MainPayloadExtraction (HDDLVAFunctionID vaFunctionId, HDDLShimCommContext *ctx,
-    void *inPayload, int inSize)
+static VAStatus HDDLShim_UnmapUpdateBuffer (HDDLShimCommContext *ctx, VABufferID bufId)
 {
-    void *outPayload = NULL;
-    HDDLVAFunctionID functionId = vaFunctionId;
-    bool extract = true;
-    void *payload = inPayload;
-    VAStatus vaStatus = VA_STATUS_SUCCESS;
-    uint32_t offset = 0;
+    if (ctx->mapTable != NULL && HDDLMemoryMgr_LookupIdPointer (ctx->mapTable, bufId) != NULL)
+    {
+        return VA_STATUS_SUCCESS;
+    }
+
+    return vaUnmapBuffer (ctx->vaDpy, bufId);
+}
+
+// The driver must not be left with a mapping of a buffer it is about to free
+static void HDDLShim_ReleaseMapping (HDDLShimCommContext *ctx, VABufferID bufId)
+{
+    if (ctx->mapTable == NULL || HDDLMemoryMgr_LookupIdPointer (ctx->mapTable, bufId) == NULL)
+    {
+        return;
+    }
+
+    vaUnmapBuffer (ctx->vaDpy, bufId);
+    HDDLMemoryMgr_RemoveId (ctx->mapTable, bufId);
+}
+
+void HDDLShim_DestroyFrameTable (HDDLShimCommContext *ctx)
+{
+    // Frame data of the buffers the host never destroyed
+    HDDLMemoryMgr_ReleaseIdPointers (ctx->frameTable, HDDLShim_DestroyArena);
+    HDDLMemoryMgr_DestroyIdTable (ctx->frameTable);
+    ctx->frameTable = NULL;
+}
+
+static void HDDLShim_ReleaseFrameArena (HDDLShimCommContext *ctx, VABufferID bufId)
+{
+    HDDLShimArena *arena;
+
+    if (ctx->frameTable == NULL)
+    {
+        return;
+    }
+
+    arena = HDDLMemoryMgr_LookupIdPointer (ctx->frameTable, bufId);
+    if (arena != NULL)
+    {
+        HDDLMemoryMgr_RemoveId (ctx->frameTable, bufId);
+        HDDLMemoryMgr_DestroyArena (arena);
+    }
+}
+
+typedef VAStatus (*HDDLShimPayloadHandler) (HDDLShimCommContext *ctx, void *inPayload,
+    void **outPayload);
+
+// Handlers which only need the display of the channel
+#define DISPLAY_HANDLER(name)                                                                  \
+static VAStatus HDDLShim_OnDisplay##name (HDDLShimCommContext *ctx, void *inPayload,           \
+    void **outPayload)                                                                         \
+{                                                                                              \
+    return HDDLShim_ExtractandCall##name (ctx->vaDpy, inPayload, outPayload);                  \
+}
+
+DISPLAY_HANDLER (VAInit)
+DISPLAY_HANDLER (VATerminate)
+DISPLAY_HANDLER (VADestroyConfig)
+DISPLAY_HANDLER (VACreateContext)
+DISPLAY_HANDLER (VADestroyContext)
+DISPLAY_HANDLER (VACreateSurfaces)
+DISPLAY_HANDLER (VADestroySurfaces)
+DISPLAY_HANDLER (VACreateImage)
+DISPLAY_HANDLER (VADeriveImage)
+DISPLAY_HANDLER (VADestroyImage)
+DISPLAY_HANDLER (VABeginPicture)
+DISPLAY_HANDLER (VAEndPicture)
+DISPLAY_HANDLER (VASyncSurface)
+DISPLAY_HANDLER (VAQueryConfigProfiles)
+DISPLAY_HANDLER (VAQueryConfigEntrypoints)
+DISPLAY_HANDLER (VAGetConfigAttributes)
+DISPLAY_HANDLER (VAQueryConfigAttributes)
+DISPLAY_HANDLER (VAQuerySurfaceStatus)
+DISPLAY_HANDLER (VAQueryImageFormats)
+DISPLAY_HANDLER (VAGetImage)
+DISPLAY_HANDLER (VAPutImage)
+DISPLAY_HANDLER (VAQueryDisplayAttributes)
+DISPLAY_HANDLER (VAGetDisplayAttributes)
+DISPLAY_HANDLER (VASetDisplayAttributes)
+DISPLAY_HANDLER (VAQuerySurfaceAttributes)
+
+static VAStatus HDDLShim_OnChannelVACreateSurfaces2 (HDDLShimCommContext *ctx, void *inPayload,
+    void **outPayload)
+{
+    bool importFd = IS_UNITE_MODE (ctx);
+    uint32_t swDeviceId = -1;
+
+    if (IS_UNITE_MODE (ctx))
+    {
+        swDeviceId = ctx->uniteCtx->xLinkCtx->xLinkHandler.sw_device_id;
+    }
+
+    return HDDLShim_ExtractandCallVACreateSurfaces2 (ctx->vaDpy, inPayload, outPayload, importFd,
+        swDeviceId);
+}
+
+static VAStatus HDDLShim_OnChannelVAExportSurfaceHandle (HDDLShimCommContext *ctx,
+    void *inPayload, void **outPayload)
+{
+    bool registerFd = IS_UNITE_MODE (ctx);
+    uint64_t workloadId = IS_UNITE_MODE (ctx) ? ctx->uniteCtx->workloadId : -1;
+
+    return HDDLShim_ExtractandCallVAExportSurfaceHandle (ctx->vaDpy, inPayload, outPayload,
+        registerFd, workloadId);
+}
+
+static VAStatus HDDLShim_OnChannelVAAcquireBufferHandle (HDDLShimCommContext *ctx,
+    void *inPayload, void **outPayload)
+{
+    bool registerFd = IS_UNITE_MODE (ctx);
+    uint64_t workloadId = IS_UNITE_MODE (ctx) ? ctx->uniteCtx->workloadId : -1;
+    HDDLVABufferNode *vaBufferNodeList = IS_UNITE_MODE (ctx) ?
+        ctx->uniteCtx->HDDLVABufferNodeList : NULL;
+
+    return HDDLShim_ExtractandCallVAAcquireBufferHandle (ctx, inPayload, outPayload, registerFd,
+        workloadId, vaBufferNodeList);
+}
+
+static VAStatus HDDLShim_OnChannelVAReleaseBufferHandle (HDDLShimCommContext *ctx,
+    void *inPayload, void **outPayload)
+{
+    bool unregisterFd = IS_UNITE_MODE (ctx);
+    uint64_t workloadId = IS_UNITE_MODE (ctx) ? ctx->uniteCtx->workloadId : -1;
+    HDDLVABufferNode *vaBufferNodeList = IS_UNITE_MODE (ctx) ?
+        ctx->uniteCtx->HDDLVABufferNodeList : NULL;
+
+    return HDDLShim_ExtractandCallVAReleaseBufferHandle (ctx, inPayload, outPayload,
+        unregisterFd, workloadId, vaBufferNodeList);
+}
+
+// Handler of every call the target serves, Comm_GetFunctionInfo tells how the call is batched
+// and routed
+static const HDDLShimPayloadHandler gPayloadHandler[HDDLVAMaxFunctionID] = {
+    [HDDLVAMedia_DriverInit] = HDDLShim_OnDisplayVAInit,
+    [HDDLVATerminate] = HDDLShim_OnDisplayVATerminate,
+    [HDDLVACreateConfig] = HDDLShim_ExtractandCallVACreateConfig,
+    [HDDLVADestroyConfig] = HDDLShim_OnDisplayVADestroyConfig,
+    [HDDLVACreateContext] = HDDLShim_OnDisplayVACreateContext,
+    [HDDLVADestroyContext] = HDDLShim_OnDisplayVADestroyContext,
+    [HDDLVACreateSurfaces] = HDDLShim_OnDisplayVACreateSurfaces,
+    [HDDLVADestroySurfaces] = HDDLShim_OnDisplayVADestroySurfaces,
+    [HDDLVACreateBuffer] = HDDLShim_ExtractandCallVACreateBuffer,
+    [HDDLVADestroyBuffer] = HDDLShim_ExtractandCallVADestroyBuffer,
+    [HDDLVAMapBuffer] = HDDLShim_ExtractandCallVAMapBuffer,
+    [HDDLVAUnmapBuffer] = HDDLShim_ExtractandCallVAUnmapBuffer,
+    [HDDLVACreateImage] = HDDLShim_OnDisplayVACreateImage,
+    [HDDLVADeriveImage] = HDDLShim_OnDisplayVADeriveImage,
+    [HDDLVADestroyImage] = HDDLShim_OnDisplayVADestroyImage,
+    [HDDLVABeginPicture] = HDDLShim_OnDisplayVABeginPicture,
+    [HDDLVARenderPicture] = HDDLShim_ExtractandCallVARenderPicture,
+    [HDDLVAEndPicture] = HDDLShim_OnDisplayVAEndPicture,
+    [HDDLVASyncSurface] = HDDLShim_OnDisplayVASyncSurface,
+    [HDDLVAQueryConfigProfiles] = HDDLShim_OnDisplayVAQueryConfigProfiles,
+    [HDDLVAQueryConfigEntrypoints] = HDDLShim_OnDisplayVAQueryConfigEntrypoints,
+    [HDDLVAGetConfigAttributes] = HDDLShim_OnDisplayVAGetConfigAttributes,
+    [HDDLVAQueryConfigAttributes] = HDDLShim_OnDisplayVAQueryConfigAttributes,
+    [HDDLVAQuerySurfaceStatus] = HDDLShim_OnDisplayVAQuerySurfaceStatus,
+    [HDDLVAQueryImageFormats] = HDDLShim_OnDisplayVAQueryImageFormats,
+    [HDDLVAGetImage] = HDDLShim_OnDisplayVAGetImage,
+    [HDDLVAPutImage] = HDDLShim_OnDisplayVAPutImage,
+    [HDDLVAQueryDisplayAttributes] = HDDLShim_OnDisplayVAQueryDisplayAttributes,
+    [HDDLVAGetDisplayAttributes] = HDDLShim_OnDisplayVAGetDisplayAttributes,
+    [HDDLVASetDisplayAttributes] = HDDLShim_OnDisplayVASetDisplayAttributes,
+    [HDDLVAQuerySurfaceAttributes] = HDDLShim_OnDisplayVAQuerySurfaceAttributes,
+    [HDDLVACreateSurfaces2] = HDDLShim_OnChannelVACreateSurfaces2,
+    [HDDLVAExportSurfaceHandle] = HDDLShim_OnChannelVAExportSurfaceHandle,
+    [HDDLVACreateBuffer2] = HDDLShim_ExtractandCallVACreateBuffer2,
+    [HDDLVAAcquireBufferHandle] = HDDLShim_OnChannelVAAcquireBufferHandle,
+    [HDDLVAReleaseBufferHandle] = HDDLShim_OnChannelVAReleaseBufferHandle,
+    [HDDLVABufferSetNumElements] = HDDLShim_ExtractandCallVASetNumElements,
+    [HDDLDynamicChannelID] = HDDLShim_ExtractandCallDynamicChannelID,
+};
+
+VAStatus HDDLShim_ExtractPayload (HDDLVAFunctionID functionId, HDDLShimCommContext *ctx,
+    void *inPayload, uint32_t inSize, void **outPayload)
+{
+    const HDDLShimFunctionInfo *info = Comm_GetFunctionInfo (functionId);
+    VAStatus vaStatus;
+
+    if (functionId >= HDDLVAMaxFunctionID || gPayloadHandler[functionId] == NULL)
+    {
+        return VA_STATUS_SUCCESS;
+    }
+
+    // Handlers read the fixed part of the request without checking, and trust the size in the
+    // header for the rest. Both have to be there.
+    if (inSize < info->txSize || ( (HDDLVAData *)inPayload)->size > inSize)
+    {
+        SHIM_ERROR_MESSAGE ("%s request of %u bytes, %u received, %u expected", info->name,
+            ( (HDDLVAData *)inPayload)->size, inSize, info->txSize);
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    }
+
+    SHIM_PROFILE_START ();
+
+    vaStatus = gPayloadHandler[functionId] (ctx, inPayload, outPayload);
+
+    SHIM_PROFILE_END_NAMED (info->name);
+
+    return vaStatus;
+}
+
+// Run every call of an HDDLTransferBatch and pack their results in call order. A failing call
+// does not stop the batch, the host already let its caller go on and reports the status.
+static void *HDDLShim_BatchPayloadExtraction (HDDLShimCommContext *ctx, void *inPayload,
+    int inSize)
+{
+    HDDLTransferBatchRX *batchRX;
+    HDDLTransferBatchResult *result;
+    HDDLVAData *payload;
+    void *outPayload;
+    void *reply;
+    VAStatus vaStatus;
+    uint32_t offset = sizeof (HDDLVAData);
+    uint32_t replySize = sizeof (HDDLTransferBatchRX);
+    uint32_t replyCapacity = BATCH_REPLY_SIZE;
+    uint32_t rxSize;
 
-    while (extract)
+    reply = HDDLShim_AllocPayload (replyCapacity);
+    SHIM_CHK_NULL (reply, "Failed to allocate batch reply", NULL);
+
+    batchRX = (HDDLTransferBatchRX *)reply;
+    batchRX->callCount = 0;
+
+    while (offset < inSize)
     {
-        SHIM_CHK_LESS (functionId, HDDLVAMaxFunctionID, "out of boundary", outPayload);
-        SHIM_CHK_NULL (payload, "nullptr input payload", outPayload);
+        payload = (HDDLVAData *) (inPayload + offset);
 
-        if (functionId == HDDLTransferBatch)
+        if (inSize - offset < sizeof (HDDLVAData) || payload->size < sizeof (HDDLVAData) ||
+            payload->size > inSize - offset || payload->vaFunctionID >= HDDLVAMaxFunctionID)
         {
-            offset += sizeof (HDDLVAData);
-            payload = (void *) (inPayload + offset);
-            functionId = ( (HDDLVAData *)payload)->vaFunctionID;
+            SHIM_ERROR_MESSAGE ("Malformed batched call at offset %u", offset);
+            break;
         }
 
-        vaStatus = HDDLShim_ExtractPayload (functionId, ctx, payload, &outPayload);
+        outPayload = NULL;
+        vaStatus = HDDLShim_ExtractPayload (payload->vaFunctionID, ctx, payload, payload->size,
+            &outPayload);
 
         if (vaStatus != VA_STATUS_SUCCESS)
         {
-            SHIM_NORMAL_MESSAGE ("Function %d return status %d", functionId, vaStatus);
-
-            return outPayload;
+            SHIM_NORMAL_MESSAGE ("%s return status %d",
+                Comm_GetFunctionInfo (payload->vaFunctionID)->name, vaStatus);
         }
 
-        offset += ( (HDDLVAData *)payload)->size;
+        rxSize = outPayload != NULL ? ( (HDDLVAData *)outPayload)->size : 0;
 
-        // Done processing all the batched content. Stop extracting.
-        if (offset == inSize)
+        if (replySize + sizeof (HDDLTransferBatchResult) + rxSize > replyCapacity)
         {
-            extract = false;
+            replyCapacity = (replySize + sizeof (HDDLTransferBatchResult) + rxSize) * 2;
+            batchRX = HDDLShim_AllocPayload (replyCapacity);
+            SHIM_CHK_NULL (batchRX, "Failed to grow batch reply", NULL);
+            HDDLMemoryMgr_Memcpy (batchRX, reply, replyCapacity, replySize);
+            reply = batchRX;
         }
-        else
+
+        result = (HDDLTransferBatchResult *) ( (char *)reply + replySize);
+        result->ret = vaStatus;
+        result->size = rxSize;
+
+        if (rxSize > 0)
         {
-            payload = (void *) (inPayload + offset);
-            functionId = ( (HDDLVAData *)payload)->vaFunctionID;
-	    HDDLMemoryMgr_FreeMemory (outPayload);
+            HDDLMemoryMgr_Memcpy (result + 1, outPayload, rxSize, rxSize);
         }
+
+        replySize += sizeof (HDDLTransferBatchResult) + rxSize;
+        batchRX->callCount++;
+        offset += payload->size;
+    }
+
+    batchRX->vaData.vaFunctionID = HDDLTransferBatch;
+    batchRX->vaData.size = replySize;
+
+    return reply;
+}
+
+void *HDDLShim_MainPayloadExtraction (HDDLVAFunctionID vaFunctionId, HDDLShimCommContext *ctx,
+    void *inPayload, int inSize)
+{
+    void *outPayload = NULL;
+    VAStatus vaStatus = VA_STATUS_SUCCESS;
+
+    SHIM_CHK_LESS (vaFunctionId, HDDLVAMaxFunctionID, "out of boundary", outPayload);
+    SHIM_CHK_NULL (inPayload, "nullptr input payload", outPayload);
+
+    if (vaFunctionId == HDDLTransferBatch)
+    {
+        return HDDLShim_BatchPayloadExtraction (ctx, inPayload, inSize);
+    }
+
+    vaStatus = HDDLShim_ExtractPayload (vaFunctionId, ctx, inPayload, inSize, &outPayload);
+
+    if (vaStatus != VA_STATUS_SUCCESS)
+    {
+        SHIM_NORMAL_MESSAGE ("%s return status %d", Comm_GetFunctionInfo (vaFunctionId)->name,
+            vaStatus);
     }
 
     return outPayload;
@@ -398,7 +554,7 @@ VAStatus HDDLShim_ExtractandCallVAInit (VADisplay vaDpy, void *inPayload, void *
     VADriverContextP dpyCtx = ( (VADisplayContextP)vaDpy)->pDriverContext;
 
     // Return message back to host
-    vaDataRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataRX, "nullptr vaDataRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataRX->vaData.vaFunctionID = HDDLVAMedia_DriverInit;
     vaDataRX->vaData.size = rxSize;
@@ -434,7 +590,7 @@ VAStatus HDDLShim_ExtractandCallVATerminate (VADisplay vaDpy, void *inPayload, v
     vaStatus = vaTerminate (vaDpy);
 
     // Return message back to host
-    vaDataRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataRX, "nullptr vaDataRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataRX->vaData.vaFunctionID = HDDLVATerminate;
     vaDataRX->vaData.size = rxSize;
@@ -475,7 +631,7 @@ VAStatus HDDLShim_ExtractandCallVACreateConfig (HDDLShimCommContext *ctx, void *
         numAttrib, &configId);
 
     // Return message back to host
-    vaDataRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataRX, "nullptr vaDataRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataRX->vaData.vaFunctionID = HDDLVACreateConfig;
     vaDataRX->vaData.size = rxSize;
@@ -504,7 +660,7 @@ VAStatus HDDLShim_ExtractandCallVADestroyConfig (VADisplay vaDpy, void *inPayloa
     vaStatus = vaDestroyConfig (vaDpy, vaDataTX->configId);
 
     // Return message back to host
-    vaDataRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataRX, "nullptr vaDataRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataRX->vaData.vaFunctionID = HDDLVADestroyConfig;
     vaDataRX->vaData.size = rxSize;
@@ -543,7 +699,7 @@ VAStatus HDDLShim_ExtractandCallVACreateContext (VADisplay vaDpy, void *inPayloa
         vaDataFullTX->vaDataTX.numRenderTarget, &contextId);
 
     // Return message back to host
-    vaDataRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataRX, "nullptr vaDataRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataRX->vaData.vaFunctionID = HDDLVACreateContext;
     vaDataRX->vaData.size = rxSize;
@@ -571,7 +727,7 @@ VAStatus HDDLShim_ExtractandCallVADestroyContext (VADisplay vaDpy, void *inPaylo
     vaStatus = vaDestroyContext (vaDpy, vaDataTX->context);
 
     // Return message back to host
-    vaDataRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataRX, "nullptr vaDataRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataRX->vaData.vaFunctionID = HDDLVADestroyContext;
     vaDataRX->vaData.size = rxSize;
@@ -593,7 +749,7 @@ VAStatus HDDLShim_ExtractandCallVACreateSurfaces (VADisplay vaDpy, void *inPaylo
     int numSurfaces = vaDataTX->numSurfaces;
     VAStatus vaStatus;
     uint32_t rxSize = 0;
-    VASurfaceID *surfaceId = HDDLMemoryMgr_AllocMemory (sizeof (VASurfaceID) * numSurfaces);
+    VASurfaceID *surfaceId = HDDLShim_AllocPayload (sizeof (VASurfaceID) * numSurfaces);
     SHIM_CHK_NULL (surfaceId, "nullptr surfaceId", VA_STATUS_ERROR_INVALID_PARAMETER);
 
     // Call VA function
@@ -609,7 +765,7 @@ VAStatus HDDLShim_ExtractandCallVACreateSurfaces (VADisplay vaDpy, void *inPaylo
     HDDLVADataFullRX *vaDataFullRX;
     rxSize = sizeof (HDDLVADataFullRX);
 
-    vaDataFullRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataFullRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataFullRX, "nullptr vaDataFullRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataFullRX->vaDataRX.vaData.vaFunctionID = HDDLVACreateSurfaces;
     vaDataFullRX->vaDataRX.vaData.size = rxSize;
@@ -617,7 +773,6 @@ VAStatus HDDLShim_ExtractandCallVACreateSurfaces (VADisplay vaDpy, void *inPaylo
 
     HDDLMemoryMgr_Memcpy (vaDataFullRX->surfaces, surfaceId, sizeof (vaDataFullRX->surfaces),
         sizeof (VASurfaceID) * numSurfaces);
-    HDDLMemoryMgr_FreeMemory (surfaceId);
 
     *outPayload = vaDataFullRX;
 
@@ -649,7 +804,7 @@ VAStatus HDDLShim_ExtractandCallVADestroySurfaces (VADisplay vaDpy, void *inPayl
         vaDataFullTX->vaDataTX.numSurfaces);
 
     // Return message back to host
-    vaDataRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataRX, "nullptr vaDataRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataRX->vaData.vaFunctionID = HDDLVADestroySurfaces;
     vaDataRX->vaData.size = rxSize;
@@ -661,7 +816,7 @@ VAStatus HDDLShim_ExtractandCallVADestroySurfaces (VADisplay vaDpy, void *inPayl
     return vaStatus;
 }
 
-VAStatus HDDLShim_ExtractandCallVACreateBuffer (VADisplay vaDpy, void *inPayload,
+VAStatus HDDLShim_ExtractandCallVACreateBuffer (HDDLShimCommContext *ctx, void *inPayload,
     void **outPayload)
 {
     SHIM_FUNCTION_ENTER ();
@@ -675,6 +830,7 @@ VAStatus HDDLShim_ExtractandCallVACreateBuffer (VADisplay vaDpy, void *inPayload
     VABufferID bufId;
     VAStatus vaStatus;
     uint32_t rxSize = sizeof (HDDLVACreateBufferRX);
+    VADisplay vaDpy = ctx->vaDpy;
 
     // Buffer is empty
     if (vaDataTX->vaData.size == sizeof (HDDLVACreateBufferTX))
@@ -698,8 +854,21 @@ VAStatus HDDLShim_ExtractandCallVACreateBuffer (VADisplay vaDpy, void *inPayload
             vaDataFullTX->vaDataTX.numElement, vaDataFullTX->data, &bufId);
     }
 
+    // The host already handed its own ID out, which stands for the new buffer from now on
+    if (vaStatus == VA_STATUS_SUCCESS && IS_HOST_BUFFER_ID (vaDataTX->bufId))
+    {
+        if (ctx->idTable == NULL || !HDDLMemoryMgr_AddId (ctx->idTable, vaDataTX->bufId, bufId))
+        {
+            SHIM_ERROR_MESSAGE ("Failed to record host buffer ID %u", vaDataTX->bufId);
+            vaDestroyBuffer (vaDpy, bufId);
+            vaStatus = VA_STATUS_ERROR_ALLOCATION_FAILED;
+        }
+
+        bufId = vaDataTX->bufId;
+    }
+
     // Return message back to host
-    vaDataRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataRX, "nullptr vaDataRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataRX->vaData.vaFunctionID = HDDLVACreateBuffer;
     vaDataRX->vaData.size = rxSize;
@@ -712,7 +881,7 @@ VAStatus HDDLShim_ExtractandCallVACreateBuffer (VADisplay vaDpy, void *inPayload
     return vaStatus;
 }
 
-VAStatus HDDLShim_ExtractandCallVADestroyBuffer (VADisplay vaDpy, void *inPayload,
+VAStatus HDDLShim_ExtractandCallVADestroyBuffer (HDDLShimCommContext *ctx, void *inPayload,
     void **outPayload)
 {
     SHIM_FUNCTION_ENTER ();
@@ -721,16 +890,27 @@ VAStatus HDDLShim_ExtractandCallVADestroyBuffer (VADisplay vaDpy, void *inPayloa
     HDDLVADestroyBufferTX *vaDataTX;
     HDDLVADestroyBufferRX *vaDataRX;
     VAStatus vaStatus;
+    VABufferID bufId;
     uint32_t rxSize = sizeof (HDDLVADestroyBufferRX);
 
     // Extract payload
     vaDataTX = (HDDLVADestroyBufferTX *)inPayload;
+    bufId = HDDLShim_TargetBufferId (ctx, vaDataTX->bufId);
+
+    HDDLShim_ReleaseMapping (ctx, bufId);
 
     // Call VA function
-    vaStatus = vaDestroyBuffer (vaDpy, vaDataTX->bufId);
+    vaStatus = vaDestroyBuffer (ctx->vaDpy, bufId);
+
+    HDDLShim_ReleaseFrameArena (ctx, bufId);
+
+    if (IS_HOST_BUFFER_ID (vaDataTX->bufId) && ctx->idTable != NULL)
+    {
+        HDDLMemoryMgr_RemoveId (ctx->idTable, vaDataTX->bufId);
+    }
 
     // Return message back to host
-    vaDataRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataRX, "nullptr vaDataRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataRX->vaData.vaFunctionID = HDDLVADestroyBuffer;
     vaDataRX->vaData.size = rxSize;
@@ -742,7 +922,77 @@ VAStatus HDDLShim_ExtractandCallVADestroyBuffer (VADisplay vaDpy, void *inPayloa
     return vaStatus;
 }
 
-VAStatus HDDLShim_ExtractandCallVAMapBuffer (VADisplay vaDpy, void *inPayload, void **outPayload)
+// Large replies are built straight in the shared memory write ring in SHM mode, falling back
+// to a heap copy if the reply does not fit in the ring
+static void *HDDLShim_AllocReply (HDDLShimCommContext *ctx, uint32_t rxSize, bool *inPlace)
+{
+    void *reply = NULL;
+
+    *inPlace = false;
+
+    if (IS_SHM_MODE (ctx) && rxSize >= SHM_IN_PLACE_THRESHOLD)
+    {
+        // Other replies are written by concurrent requests, keep the ring to ourselves
+        // until the reply is committed
+        HDDLThreadMgr_LockMutex (&ctx->shmCtx->shmMutex);
+
+        reply = Shm_WriteReserve (ctx->shmCtx, rxSize);
+        *inPlace = (reply != NULL);
+
+        if (!*inPlace)
+        {
+            HDDLThreadMgr_UnlockMutex (&ctx->shmCtx->shmMutex);
+        }
+    }
+
+    if (reply == NULL)
+    {
+        reply = HDDLShim_AllocPayload (rxSize);
+    }
+
+    return reply;
+}
+
+// Publish an in place reply and hand a copy of its header back to the listener, which then
+// skips writing it again
+static void *HDDLShim_CommitReply (HDDLShimCommContext *ctx, void *reply, uint32_t headerSize,
+    uint32_t requestId, bool inPlace)
+{
+    void *header = NULL;
+
+    if (!inPlace)
+    {
+        return reply;
+    }
+
+    ( (HDDLVAData *)reply)->requestId = requestId;
+
+    header = HDDLShim_AllocPayload (headerSize);
+    if (header != NULL)
+    {
+        HDDLMemoryMgr_Memcpy (header, reply, headerSize, headerSize);
+        replyInPlace = true;
+    }
+
+    Shm_WriteCommit (ctx->shmCtx, ( (HDDLVAData *)reply)->size);
+    HDDLThreadMgr_UnlockMutex (&ctx->shmCtx->shmMutex);
+
+    SHIM_CHK_NULL (header, "nullptr reply header", NULL);
+
+    return header;
+}
+
+bool HDDLShim_TakeInPlaceReply ()
+{
+    bool inPlace = replyInPlace;
+
+    replyInPlace = false;
+
+    return inPlace;
+}
+
+VAStatus HDDLShim_ExtractandCallVAMapBuffer (HDDLShimCommContext *ctx, void *inPayload,
+    void **outPayload)
 {
     SHIM_FUNCTION_ENTER ();
     // The current vaMapBuffer call is only performed on target side if
@@ -750,7 +1000,7 @@ VAStatus HDDLShim_ExtractandCallVAMapBuffer (VADisplay vaDpy, void *inPayload, v
     SHIM_CHK_NULL (inPayload, "nullptr input payload", VA_STATUS_ERROR_INVALID_PARAMETER);
 
     HDDLVAMapBufferTX *vaDataTX = (HDDLVAMapBufferTX *)inPayload;
-    VABufferID bufId = vaDataTX->bufId;
+    VABufferID bufId = HDDLShim_TargetBufferId (ctx, vaDataTX->bufId);
     VABufferType bufType = vaDataTX->bufType;
     unsigned int dataSize = vaDataTX->dataSize;
     VACodedBufferSegment *segment = NULL;
@@ -759,6 +1009,8 @@ VAStatus HDDLShim_ExtractandCallVAMapBuffer (VADisplay vaDpy, void *inPayload, v
     unsigned int offset = 0;
     VAStatus vaStatus;
     uint32_t rxSize = 0;
+    VADisplay vaDpy = ctx->vaDpy;
+    bool inPlace = false;
 
     vaStatus = vaMapBuffer (vaDpy, bufId, (void *)&segment);
 
@@ -772,7 +1024,7 @@ VAStatus HDDLShim_ExtractandCallVAMapBuffer (VADisplay vaDpy, void *inPayload, v
         HDDLVADataFullRX *vaDataFullRX;
         rxSize = sizeof (HDDLVADataFullRX);
 
-        vaDataFullRX = HDDLMemoryMgr_AllocMemory (rxSize);
+        vaDataFullRX = HDDLShim_AllocReply (ctx, rxSize, &inPlace);
 	SHIM_CHK_NULL (vaDataFullRX, "nullptr vaDataFullRX", VA_STATUS_ERROR_INVALID_PARAMETER);
         vaDataFullRX->vaDataRX.vaData.vaFunctionID = HDDLVAMapBuffer;
         vaDataFullRX->vaDataRX.vaData.size = rxSize;
@@ -784,7 +1036,8 @@ VAStatus HDDLShim_ExtractandCallVAMapBuffer (VADisplay vaDpy, void *inPayload, v
         vaStatus = vaUnmapBuffer (vaDpy, bufId);
         vaDataFullRX->vaDataRX.ret = vaStatus;
 
-        *outPayload = vaDataFullRX;
+        *outPayload = HDDLShim_CommitReply (ctx, vaDataFullRX, sizeof (HDDLVAMapBufferRX),
+            vaDataTX->vaData.requestId, inPlace);
     }
     else if (bufType == VAEncCodedBufferType)
     {
@@ -810,7 +1063,7 @@ VAStatus HDDLShim_ExtractandCallVAMapBuffer (VADisplay vaDpy, void *inPayload, v
         HDDLVADataFullRX *vaDataFullRX;
         rxSize = sizeof (HDDLVADataFullRX);
 
-        vaDataFullRX = HDDLMemoryMgr_AllocMemory (rxSize);
+        vaDataFullRX = HDDLShim_AllocReply (ctx, rxSize, &inPlace);
 	SHIM_CHK_NULL (vaDataFullRX, "nullptr vaDataFullRX", VA_STATUS_ERROR_INVALID_PARAMETER);
         vaDataFullRX->vaDataRX.vaData.vaFunctionID = HDDLVAMapBuffer;
         vaDataFullRX->vaDataRX.vaData.size = rxSize;
@@ -838,7 +1091,8 @@ VAStatus HDDLShim_ExtractandCallVAMapBuffer (VADisplay vaDpy, void *inPayload, v
         vaStatus = vaUnmapBuffer (vaDpy, bufId);
         vaDataFullRX->vaDataRX.ret = vaStatus;
 
-        *outPayload = vaDataFullRX;
+        *outPayload = HDDLShim_CommitReply (ctx, vaDataFullRX, sizeof (HDDLVAMapBufferRX),
+            vaDataTX->vaData.requestId, inPlace);
     }
 
 
@@ -846,7 +1100,8 @@ VAStatus HDDLShim_ExtractandCallVAMapBuffer (VADisplay vaDpy, void *inPayload, v
     return vaStatus;
 }
 
-VAStatus HDDLShim_ExtractandCallVAUnmapBuffer (VADisplay vaDpy, void *inPayload, void **outPayload)
+VAStatus HDDLShim_ExtractandCallVAUnmapBuffer (HDDLShimCommContext *ctx, void *inPayload,
+    void **outPayload)
 {
     SHIM_FUNCTION_ENTER ();
     SHIM_CHK_NULL (inPayload, "nullptr input payload", VA_STATUS_ERROR_INVALID_PARAMETER);
@@ -855,7 +1110,7 @@ VAStatus HDDLShim_ExtractandCallVAUnmapBuffer (VADisplay vaDpy, void *inPayload,
     unsigned int dataSize = vaDataTX->vaData.size - sizeof (HDDLVAUnmapBufferTX);
     VAStatus vaStatus;
     uint32_t rxSize = sizeof (HDDLVAUnmapBufferRX);
-    HDDLVAUnmapBufferRX *vaDataRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    HDDLVAUnmapBufferRX *vaDataRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataRX, "nullptr vaDataRX", VA_STATUS_ERROR_INVALID_PARAMETER);
 
     typedef struct {
@@ -864,7 +1119,7 @@ VAStatus HDDLShim_ExtractandCallVAUnmapBuffer (VADisplay vaDpy, void *inPayload,
     }VADataFullTX;
 
     VADataFullTX *vaDataFullTX = (VADataFullTX *)inPayload;
-    VABufferID bufId = vaDataFullTX->vaDataTX.bufId;
+    VABufferID bufId = HDDLShim_TargetBufferId (ctx, vaDataFullTX->vaDataTX.bufId);
     void *pBuf = NULL;
 
     // We need to call vaMapBuffer in order to obtain the memory address for updating
@@ -872,7 +1127,7 @@ VAStatus HDDLShim_ExtractandCallVAUnmapBuffer (VADisplay vaDpy, void *inPayload,
     // it is not a driver input buffer but a driver output buffer instead.
     if (vaDataTX->bufType != VAEncCodedBufferType)
     {
-        vaStatus = vaMapBuffer (vaDpy, bufId, &pBuf);
+        vaStatus = HDDLShim_MapUpdateBuffer (ctx, bufId, vaDataTX->bufType, &pBuf);
 
         if (pBuf != NULL)
         {
@@ -949,17 +1204,19 @@ VAStatus HDDLShim_ExtractandCallVAUnmapBuffer (VADisplay vaDpy, void *inPayload,
 		    sizeof (VAProcPipelineParameterBuffer), offset);
 
                 uint32_t numAdditionalOutputs = pipelineParam->num_additional_outputs;
+                HDDLShimArena *frameArena = HDDLShim_RenewFrameArena (ctx, bufId);
+                SHIM_CHK_NULL (frameArena, "nullptr frameArena", VA_STATUS_ERROR_ALLOCATION_FAILED);
 
-                VARectangle *surfaceRegion =
-		    HDDLMemoryMgr_AllocMemory (sizeof (VARectangle) * numAdditionalOutputs);
+                VARectangle *surfaceRegion = HDDLMemoryMgr_ArenaAlloc (frameArena,
+		    sizeof (VARectangle) * numAdditionalOutputs);
                 HDDLMemoryMgr_Memcpy (surfaceRegion, (void *) (vaDataFullTX->data + offset),
 		    sizeof (VARectangle) * numAdditionalOutputs, sizeof (vaDataFullTX->data) -
 		    (sizeof (VASurfaceID) * numAdditionalOutputs) - offset);
                 pipelineParam->surface_region = surfaceRegion;
 
                 offset += (sizeof (VARectangle) * numAdditionalOutputs);
-                VASurfaceID *additionalOutputs =
-	            HDDLMemoryMgr_AllocMemory (sizeof (VASurfaceID) * numAdditionalOutputs);
+                VASurfaceID *additionalOutputs = HDDLMemoryMgr_ArenaAlloc (frameArena,
+	            sizeof (VASurfaceID) * numAdditionalOutputs);
                 HDDLMemoryMgr_Memcpy (additionalOutputs, (void *) (vaDataFullTX->data + offset),
 		    sizeof (VASurfaceID) * numAdditionalOutputs,
 		    sizeof (vaDataFullTX->data) - offset);
@@ -973,13 +1230,12 @@ VAStatus HDDLShim_ExtractandCallVAUnmapBuffer (VADisplay vaDpy, void *inPayload,
         else
         {
             SHIM_ERROR_MESSAGE ("nullptr buffer");
-            HDDLMemoryMgr_FreeMemory (vaDataRX);
             return VA_STATUS_ERROR_INVALID_BUFFER;
         }
     }
 
     // Call VA function
-    vaStatus = vaUnmapBuffer (vaDpy, bufId);
+    vaStatus = HDDLShim_UnmapUpdateBuffer (ctx, bufId);
 
     vaDataRX->vaData.vaFunctionID = HDDLVAUnmapBuffer;
     vaDataRX->vaData.size = rxSize;
@@ -1006,7 +1262,7 @@ VAStatus HDDLShim_ExtractandCallVACreateImage (VADisplay vaDpy, void *inPayload,
     vaStatus = vaCreateImage (vaDpy, &vaDataTX->format, vaDataTX->width, vaDataTX->height, &image);
 
     // Return message back to host
-    vaDataRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataRX, "nullptr vaDataRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataRX->vaData.vaFunctionID = HDDLVACreateImage;
     vaDataRX->vaData.size = rxSize;
@@ -1034,7 +1290,7 @@ VAStatus HDDLShim_ExtractandCallVADeriveImage (VADisplay vaDpy, void *inPayload,
     vaStatus = vaDeriveImage (vaDpy, vaDataTX->surface, &image);
 
     // Return message back to host
-    vaDataRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataRX, "nullptr vaDataRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataRX->vaData.vaFunctionID = HDDLVADeriveImage;
     vaDataRX->vaData.size = rxSize;
@@ -1061,7 +1317,7 @@ VAStatus HDDLShim_ExtractandCallVADestroyImage (VADisplay vaDpy, void *inPayload
     vaStatus = vaDestroyImage (vaDpy, vaDataTX->image);
 
     // Return message back to host
-    vaDataRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataRX, "nullptr vaDataRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataRX->vaData.vaFunctionID = HDDLVADestroyImage;
     vaDataRX->vaData.size = rxSize;
@@ -1087,7 +1343,7 @@ VAStatus HDDLShim_ExtractandCallVABeginPicture (VADisplay vaDpy, void *inPayload
     vaStatus = vaBeginPicture (vaDpy, vaDataTX->context, vaDataTX->renderTarget);
 
     // Return message back to host
-    vaDataRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataRX, "nullptr vaDataRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataRX->vaData.vaFunctionID = HDDLVABeginPicture;
     vaDataRX->vaData.size = rxSize;
@@ -1099,7 +1355,8 @@ VAStatus HDDLShim_ExtractandCallVABeginPicture (VADisplay vaDpy, void *inPayload
     return vaStatus;
 }
 
-VAStatus HDDLShim_ExtractandCallVARenderPicture (VADisplay vaDpy, void *inPayload, void **outPayload)
+VAStatus HDDLShim_ExtractandCallVARenderPicture (HDDLShimCommContext *ctx, void *inPayload,
+    void **outPayload)
 {
     SHIM_FUNCTION_ENTER ();
     SHIM_CHK_NULL (inPayload, "nullptr input payload", VA_STATUS_ERROR_INVALID_PARAMETER);
@@ -1116,13 +1373,20 @@ VAStatus HDDLShim_ExtractandCallVARenderPicture (VADisplay vaDpy, void *inPayloa
     HDDLVARenderPictureRX *vaDataRX;
     VAStatus vaStatus;
     uint32_t rxSize = sizeof (HDDLVARenderPictureRX);
+    VABufferID buffer[numBuffer];
+
+    // A buffer whose creation failed is unknown here and gets rejected by the driver
+    for (int i = 0; i < numBuffer; i++)
+    {
+        buffer[i] = HDDLShim_TargetBufferId (ctx, vaDataFullTX->buffer[i]);
+    }
 
     // Call VA function
-    vaStatus = vaRenderPicture (vaDpy, vaDataFullTX->vaDataTX.context, vaDataFullTX->buffer,
+    vaStatus = vaRenderPicture (ctx->vaDpy, vaDataFullTX->vaDataTX.context, buffer,
         vaDataFullTX->vaDataTX.numBuffer);
 
     // Return message back to host
-    vaDataRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataRX, "nullptr vaDataRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataRX->vaData.vaFunctionID = HDDLVARenderPicture;
     vaDataRX->vaData.size = rxSize;
@@ -1148,7 +1412,7 @@ VAStatus HDDLShim_ExtractandCallVAEndPicture (VADisplay vaDpy, void *inPayload,
     vaStatus = vaEndPicture (vaDpy, vaDataTX->context);
 
     // Return message back to host
-    vaDataRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataRX, "nullptr vaDataRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataRX->vaData.vaFunctionID = HDDLVAEndPicture;
     vaDataRX->vaData.size = rxSize;
@@ -1174,7 +1438,7 @@ VAStatus HDDLShim_ExtractandCallVASyncSurface (VADisplay vaDpy, void *inPayload,
     vaStatus = vaSyncSurface (vaDpy, vaDataTX->renderTarget);
 
     // Return message back to host
-    vaDataRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataRX, "nullptr vaDataRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataRX->vaData.vaFunctionID = HDDLVASyncSurface;
     vaDataRX->vaData.size = rxSize;
@@ -1196,7 +1460,7 @@ VAStatus HDDLShim_ExtractandCallVAQueryConfigProfiles (VADisplay vaDpy, void *in
     int numProfiles = vaDataTX->numProfiles;
     VAStatus vaStatus;
     uint32_t rxSize = 0;
-    VAProfile *profileList = HDDLMemoryMgr_AllocMemory (sizeof (VAProfile) * numProfiles);
+    VAProfile *profileList = HDDLShim_AllocPayload (sizeof (VAProfile) * numProfiles);
     SHIM_CHK_NULL (profileList, "nullptr profileList", VA_STATUS_ERROR_INVALID_PARAMETER);
 
     // Call VA function
@@ -1211,7 +1475,7 @@ VAStatus HDDLShim_ExtractandCallVAQueryConfigProfiles (VADisplay vaDpy, void *in
     rxSize = sizeof (HDDLVADataFullRX);
 
     // Return message back to host
-    vaDataFullRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataFullRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataFullRX, "nullptr vaDataFullRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataFullRX->vaDataRX.vaData.vaFunctionID = HDDLVAQueryConfigProfiles;
     vaDataFullRX->vaDataRX.vaData.size = rxSize;
@@ -1221,7 +1485,6 @@ VAStatus HDDLShim_ExtractandCallVAQueryConfigProfiles (VADisplay vaDpy, void *in
     HDDLMemoryMgr_Memcpy (vaDataFullRX->profileList, profileList,
 	sizeof (vaDataFullRX->profileList), sizeof (VAProfile) * numProfiles);
 
-    HDDLMemoryMgr_FreeMemory (profileList);
 
     *outPayload = vaDataFullRX;
 
@@ -1239,7 +1502,7 @@ VAStatus HDDLShim_ExtractandCallVAQueryConfigEntrypoints (VADisplay vaDpy, void
     int numEntrypoint = vaDataTX->numEntrypoint;
     VAStatus vaStatus;
     uint32_t rxSize = 0;
-    VAEntrypoint *entrypointList = HDDLMemoryMgr_AllocMemory(sizeof (VAEntrypoint) * numEntrypoint);
+    VAEntrypoint *entrypointList = HDDLShim_AllocPayload (sizeof (VAEntrypoint) * numEntrypoint);
     SHIM_CHK_NULL (entrypointList, "nullptr entrypointList", VA_STATUS_ERROR_INVALID_PARAMETER);
 
     // Call VA function
@@ -1255,7 +1518,7 @@ VAStatus HDDLShim_ExtractandCallVAQueryConfigEntrypoints (VADisplay vaDpy, void
     HDDLVADataFullRX *vaDataFullRX;
     rxSize = sizeof (HDDLVADataFullRX);
 
-    vaDataFullRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataFullRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataFullRX, "nullptr vaDataFullRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataFullRX->vaDataRX.vaData.vaFunctionID = HDDLVAQueryConfigEntrypoints;
     vaDataFullRX->vaDataRX.vaData.size = rxSize;
@@ -1265,7 +1528,6 @@ VAStatus HDDLShim_ExtractandCallVAQueryConfigEntrypoints (VADisplay vaDpy, void
     HDDLMemoryMgr_Memcpy (vaDataFullRX->entrypointList, entrypointList,
 	sizeof (vaDataFullRX->entrypointList), sizeof (VAEntrypoint) * numEntrypoint);
 
-    HDDLMemoryMgr_FreeMemory (entrypointList);
 
     *outPayload = vaDataFullRX;
 
@@ -1304,7 +1566,7 @@ VAStatus HDDLShim_ExtractandCallVAGetConfigAttributes (VADisplay vaDpy, void *in
     HDDLVADataFullRX *vaDataFullRX;
     rxSize = sizeof (HDDLVADataFullRX);
 
-    vaDataFullRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataFullRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataFullRX, "nullptr vaDataFullRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataFullRX->vaDataRX.vaData.vaFunctionID = HDDLVAGetConfigAttributes;
     vaDataFullRX->vaDataRX.vaData.size = rxSize;
@@ -1332,7 +1594,7 @@ VAStatus HDDLShim_ExtractandCallVAQueryConfigAttributes (VADisplay vaDpy, void *
     VAEntrypoint entrypoint;
     VAStatus vaStatus;
     uint32_t rxSize = 0;
-    VAConfigAttrib *attribList = HDDLMemoryMgr_AllocMemory (sizeof (VAConfigAttrib) * numAttrib);
+    VAConfigAttrib *attribList = HDDLShim_AllocPayload (sizeof (VAConfigAttrib) * numAttrib);
     SHIM_CHK_NULL (attribList, "nullptr attribList", VA_STATUS_ERROR_INVALID_PARAMETER);
 
 
@@ -1349,7 +1611,7 @@ VAStatus HDDLShim_ExtractandCallVAQueryConfigAttributes (VADisplay vaDpy, void *
     HDDLVADataFullRX *vaDataFullRX;
     rxSize = sizeof (HDDLVADataFullRX);
 
-    vaDataFullRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataFullRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataFullRX, "nullptr vaDataFullRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataFullRX->vaDataRX.vaData.vaFunctionID = HDDLVAQueryConfigAttributes;
     vaDataFullRX->vaDataRX.vaData.size = rxSize;
@@ -1361,7 +1623,6 @@ VAStatus HDDLShim_ExtractandCallVAQueryConfigAttributes (VADisplay vaDpy, void *
     HDDLMemoryMgr_Memcpy (vaDataFullRX->attribList, attribList,
         sizeof (vaDataFullRX->attribList), sizeof (VAConfigAttrib) * (numAttrib));
 
-    HDDLMemoryMgr_FreeMemory (attribList);
 
     *outPayload = vaDataFullRX;
 
@@ -1379,20 +1640,19 @@ VAStatus HDDLShim_ExtractandCallVAQuerySurfaceStatus (VADisplay vaDpy, void *inP
     HDDLVAQuerySurfaceStatusRX *vaDataRX;
     VAStatus vaStatus;
     uint32_t rxSize = sizeof (HDDLVAQuerySurfaceStatusRX);
-    VASurfaceStatus *status = HDDLMemoryMgr_AllocMemory (sizeof (VASurfaceStatus));
+    VASurfaceStatus *status = HDDLShim_AllocPayload (sizeof (VASurfaceStatus));
     SHIM_CHK_NULL (status, "nullptr status", VA_STATUS_ERROR_INVALID_PARAMETER);
 
     // Call VA function
     vaStatus = vaQuerySurfaceStatus (vaDpy, vaDataTX->renderTarget, status);
 
     // Return message back to host
-    vaDataRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataRX, "nullptr vaDataRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataRX->vaData.vaFunctionID = HDDLVAQuerySurfaceStatus;
     vaDataRX->vaData.size = rxSize;
     vaDataRX->ret = vaStatus;
     vaDataRX->status = *status;
-    HDDLMemoryMgr_FreeMemory (status);
 
     *outPayload = vaDataRX;
 
@@ -1410,7 +1670,7 @@ VAStatus HDDLShim_ExtractandCallVAQueryImageFormats (VADisplay vaDpy, void *inPa
     int numFormat = vaDataTX->numFormat;
     VAStatus vaStatus;
     uint32_t rxSize = 0;
-    VAImageFormat *formatList = HDDLMemoryMgr_AllocMemory (sizeof (VAImageFormat) * numFormat);
+    VAImageFormat *formatList = HDDLShim_AllocPayload (sizeof (VAImageFormat) * numFormat);
     SHIM_CHK_NULL (formatList, "nullptr formatList", VA_STATUS_ERROR_INVALID_PARAMETER);
 
     // Call VA function
@@ -1425,7 +1685,7 @@ VAStatus HDDLShim_ExtractandCallVAQueryImageFormats (VADisplay vaDpy, void *inPa
     HDDLVADataFullRX *vaDataFullRX;
     rxSize = sizeof (HDDLVADataFullRX);
 
-    vaDataFullRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataFullRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataFullRX, "nullptr vaDataFullRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataFullRX->vaDataRX.vaData.vaFunctionID = HDDLVAQueryImageFormats;
     vaDataFullRX->vaDataRX.vaData.size = rxSize;
@@ -1434,7 +1694,6 @@ VAStatus HDDLShim_ExtractandCallVAQueryImageFormats (VADisplay vaDpy, void *inPa
 
     HDDLMemoryMgr_Memcpy (vaDataFullRX->formatList, formatList,
 	sizeof (vaDataFullRX->formatList), sizeof (VAImageFormat) * (numFormat));
-    HDDLMemoryMgr_FreeMemory (formatList);
 
     *outPayload = vaDataFullRX;
 
@@ -1456,7 +1715,7 @@ VAStatus HDDLShim_ExtractandCallVAGetImage (VADisplay vaDpy, void *inPayload, vo
     vaStatus = vaGetImage (vaDpy, vaDataTX->surface, vaDataTX->x, vaDataTX->y, vaDataTX->width,
         vaDataTX->height, vaDataTX->image);
 
-    vaDataRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataRX, "nullptr vaDataRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataRX->vaData.vaFunctionID = HDDLVAGetImage;
     vaDataRX->vaData.size = rxSize;
@@ -1495,7 +1754,7 @@ VAStatus HDDLShim_ExtractandCallVAPutImage (VADisplay vaDpy, void *inPayload, vo
     rxSize = sizeof (HDDLVADataFullRX);
 
     //Return info back to host
-    HDDLVADataFullRX *vaDataFullRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    HDDLVADataFullRX *vaDataFullRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataFullRX, "nullptr vaDataFullRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataFullRX->vaDataRX.vaData.vaFunctionID = HDDLVAPutImage;
     vaDataFullRX->vaDataRX.vaData.size = rxSize;
@@ -1520,7 +1779,7 @@ VAStatus HDDLShim_ExtractandCallVAQueryDisplayAttributes (VADisplay vaDpy, void
     int numAttributes = vaDataTX->numAttributes;
     VAStatus vaStatus;
     uint32_t rxSize = 0;
-    VADisplayAttribute *attrList = HDDLMemoryMgr_AllocMemory (sizeof (VADisplayAttribute) * numAttributes);
+    VADisplayAttribute *attrList = HDDLShim_AllocPayload (sizeof (VADisplayAttribute) * numAttributes);
     SHIM_CHK_NULL (attrList, "nullptr attrList", VA_STATUS_ERROR_INVALID_PARAMETER);
 
     //Call VSI function
@@ -1535,7 +1794,7 @@ VAStatus HDDLShim_ExtractandCallVAQueryDisplayAttributes (VADisplay vaDpy, void
     rxSize = sizeof (HDDLVADataFullRX);
     HDDLVADataFullRX *vaDataFullRX;
 
-    vaDataFullRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataFullRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataFullRX, "nullptr vaDataFullRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataFullRX->vaDataRX.vaData.vaFunctionID = HDDLVAQueryDisplayAttributes;
     vaDataFullRX->vaDataRX.vaData.size = rxSize;
@@ -1581,7 +1840,7 @@ VAStatus HDDLShim_ExtractandCallVAGetDisplayAttributes (VADisplay vaDpy, void *i
     rxSize = sizeof (HDDLVADataFullRX);
     HDDLVADataFullRX *vaDataFullRX;
 
-    vaDataFullRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataFullRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataFullRX, "nullptr vaDataFullRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataFullRX->vaDataRX.vaData.vaFunctionID = HDDLVAGetDisplayAttributes;
     vaDataFullRX->vaDataRX.vaData.size = rxSize;
@@ -1620,7 +1879,7 @@ VAStatus HDDLShim_ExtractandCallVASetDisplayAttributes (VADisplay vaDpy, void *i
         vaDataFullTX->vaDataTX.numAttributes);
 
     //Return info back to host
-    vaDataRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataRX, "nullptr vaDataRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataRX->vaData.vaFunctionID = HDDLVASetDisplayAttributes;
     vaDataRX->vaData.size = rxSize;
@@ -1648,7 +1907,7 @@ VAStatus HDDLShim_ExtractandCallVAQuerySurfaceAttributes (VADisplay vaDpy, void
 
     if (numAttribs > 0)
     {
-        attribList = HDDLMemoryMgr_AllocMemory (sizeof (VASurfaceAttrib) * numAttribs);
+        attribList = HDDLShim_AllocPayload (sizeof (VASurfaceAttrib) * numAttribs);
         SHIM_CHK_NULL (attribList, "nullptr attribList", VA_STATUS_ERROR_INVALID_PARAMETER);
         // numAttribs is provide. Expecting return of attribList
         querySize = false;
@@ -1681,7 +1940,7 @@ VAStatus HDDLShim_ExtractandCallVAQuerySurfaceAttributes (VADisplay vaDpy, void
     HDDLVADataFullRX *vaDataFullRX;
     rxSize = sizeof (HDDLVADataFullRX);
 
-    vaDataFullRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataFullRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataFullRX, "nullptr vaDataFullRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataFullRX->vaDataRX.vaData.vaFunctionID = HDDLVAQuerySurfaceAttributes;
     vaDataFullRX->vaDataRX.vaData.size = rxSize;
@@ -1692,7 +1951,6 @@ VAStatus HDDLShim_ExtractandCallVAQuerySurfaceAttributes (VADisplay vaDpy, void
     {
         HDDLMemoryMgr_Memcpy (vaDataFullRX->attribList, attribList,
 	    sizeof (vaDataFullRX->attribList), sizeof (VASurfaceAttrib) * numAttribs);
-        HDDLMemoryMgr_FreeMemory (attribList);
     }
 
     *outPayload = vaDataFullRX;
@@ -1719,7 +1977,7 @@ VAStatus HDDLShim_ExtractandCallVACreateSurfaces2 (VADisplay vaDpy, void *inPayl
     HDDLVADataFullTX *vaDataFullTX = (HDDLVADataFullTX *)inPayload;
     VAStatus vaStatus;
     uint32_t rxSize;
-    VASurfaceID *surfaces = HDDLMemoryMgr_AllocMemory (sizeof (VASurfaceID) * numSurfaces);
+    VASurfaceID *surfaces = HDDLShim_AllocPayload (sizeof (VASurfaceID) * numSurfaces);
     SHIM_CHK_NULL (surfaces, "nullptr surfaces", VA_STATUS_ERROR_INVALID_PARAMETER);
 
     //redirect attribList
@@ -1820,7 +2078,7 @@ VAStatus HDDLShim_ExtractandCallVACreateSurfaces2 (VADisplay vaDpy, void *inPayl
     HDDLVADataFullRX *vaDataFullRX;
     rxSize = sizeof (HDDLVADataFullRX);
 
-    vaDataFullRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataFullRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataFullRX, "nullptr vaDataFullRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataFullRX->vaDataRX.vaData.vaFunctionID = HDDLVACreateSurfaces2;
     vaDataFullRX->vaDataRX.vaData.size = rxSize;
@@ -1828,7 +2086,6 @@ VAStatus HDDLShim_ExtractandCallVACreateSurfaces2 (VADisplay vaDpy, void *inPayl
 
     HDDLMemoryMgr_Memcpy (vaDataFullRX->surfaces, surfaces, sizeof (vaDataFullRX->surfaces),
         sizeof(VASurfaceID) * (numSurfaces));
-    HDDLMemoryMgr_FreeMemory (surfaces);
 
     *outPayload = vaDataFullRX;
 
@@ -1855,7 +2112,7 @@ VAStatus HDDLShim_ExtractandCallVAExportSurfaceHandle (VADisplay vaDpy, void *in
         vaDataTX->flags, &descriptor);
 
     //Return info back to host
-    vaDataRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataRX, "nullptr vaDataRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataRX->vaData.vaFunctionID = HDDLVAExportSurfaceHandle;
     vaDataRX->vaData.size = rxSize;
@@ -1913,7 +2170,7 @@ VAStatus HDDLShim_ExtractandCallVACreateBuffer2 (HDDLShimCommContext *ctx, void
         vaDataTX->height, &unitSize, &pitch, &bufId);
 
     //Return info back to host
-    vaDataRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataRX, "nullptr vaDataRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataRX->vaData.vaFunctionID = HDDLVACreateBuffer2;
     vaDataRX->vaData.size = rxSize;
@@ -1960,7 +2217,7 @@ VAStatus HDDLShim_ExtractandCallVACreateBuffer2 (HDDLShimCommContext *ctx, void
     return vaStatus;
 }
 
-VAStatus HDDLShim_ExtractandCallVAAcquireBufferHandle(VADisplay vaDpy, void *inPayload,
+VAStatus HDDLShim_ExtractandCallVAAcquireBufferHandle(HDDLShimCommContext *ctx, void *inPayload,
     void **outPayload, bool registerFd, uint64_t workloadId, HDDLVABufferNode *vaBufferNodeList)
 {
     SHIM_FUNCTION_ENTER ();
@@ -1975,10 +2232,11 @@ VAStatus HDDLShim_ExtractandCallVAAcquireBufferHandle(VADisplay vaDpy, void *inP
     HDDLMemoryMgr_ZeroMemory (&bufferInfo, sizeof (bufferInfo));
 
     //Call VA function
-    vaStatus = vaAcquireBufferHandle (vaDpy, vaDataTX->bufId, &bufferInfo);
+    vaStatus = vaAcquireBufferHandle (ctx->vaDpy, HDDLShim_TargetBufferId (ctx, vaDataTX->bufId),
+        &bufferInfo);
 
     //Return message back to host
-    vaDataRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataRX, "nullptr vaDataRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataRX->vaData.vaFunctionID = HDDLVAAcquireBufferHandle;
     vaDataRX->vaData.size = rxSize;
@@ -2021,7 +2279,7 @@ VAStatus HDDLShim_ExtractandCallVAAcquireBufferHandle(VADisplay vaDpy, void *inP
     return vaStatus;
 }
 
-VAStatus HDDLShim_ExtractandCallVAReleaseBufferHandle (VADisplay vaDpy, void *inPayload,
+VAStatus HDDLShim_ExtractandCallVAReleaseBufferHandle (HDDLShimCommContext *ctx, void *inPayload,
     void **outPayload, bool unregisterFd, uint64_t workloadId, HDDLVABufferNode *vaBufferNodeList)
 {
     SHIM_FUNCTION_ENTER ();
@@ -2067,10 +2325,10 @@ VAStatus HDDLShim_ExtractandCallVAReleaseBufferHandle (VADisplay vaDpy, void *in
 #endif
 
     //Call VA function
-    vaStatus = vaReleaseBufferHandle (vaDpy, vaDataTX->bufId);
+    vaStatus = vaReleaseBufferHandle (ctx->vaDpy, HDDLShim_TargetBufferId (ctx, vaDataTX->bufId));
 
     //Return message back to host
-    vaDataRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataRX, "nullptr vaDataRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataRX->vaData.vaFunctionID = HDDLVAReleaseBufferHandle;
     vaDataRX->vaData.size = rxSize;
@@ -2096,10 +2354,11 @@ VAStatus HDDLShim_ExtractandCallVASetNumElements (HDDLShimCommContext *ctx, void
     //Extract payload
 
     //Call VSI function
-    vaStatus = vaBufferSetNumElements (ctx->vaDpy, vaDataTX->bufId, vaDataTX->numElement);
+    vaStatus = vaBufferSetNumElements (ctx->vaDpy, HDDLShim_TargetBufferId (ctx, vaDataTX->bufId),
+        vaDataTX->numElement);
 
     //REturn info back to host
-    vaDataRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataRX, "nullptr vaDataRX", VA_STATUS_ERROR_INVALID_PARAMETER);
     vaDataRX->vaData.vaFunctionID = HDDLVABufferSetNumElements;
     vaDataRX->vaData.size = rxSize;
@@ -2118,14 +2377,26 @@ VAStatus HDDLShim_ExtractandCallDynamicChannelID (HDDLShimCommContext *ctx, void
     SHIM_CHK_NULL (inPayload, "nullptr input payload", VA_STATUS_ERROR_INVALID_PARAMETER);
 
     VAStatus vaStatus = VA_STATUS_SUCCESS;
+    HDDLDynamicChannelTX *vaDataTX = (HDDLDynamicChannelTX *)inPayload;
     HDDLDynamicChannelRX *vaDataRX;
     uint32_t rxSize = sizeof (HDDLDynamicChannelRX);
+    uint16_t tx = vaDataTX->channelTX;
+    uint16_t rx = vaDataTX->channelRX;
 
-    vaDataRX = HDDLMemoryMgr_AllocMemory (rxSize);
+    vaDataRX = HDDLShim_AllocPayload (rxSize);
     SHIM_CHK_NULL (vaDataRX, "nullptr vaDataRX", VA_STATUS_ERROR_INVALID_PARAMETER);
+
+    // A new thread opens the target side of the pair, the host connects once it has the reply
+    if (HDDLShim_OpenDynamicChannel (ctx, COMM_MODE (ctx), &tx, &rx) != HDDL_SHIM_STATUS_SUCCESS)
+    {
+        vaStatus = VA_STATUS_ERROR_ALLOCATION_FAILED;
+    }
+
     vaDataRX->vaData.vaFunctionID = HDDLDynamicChannelID;
     vaDataRX->vaData.size = rxSize;
     vaDataRX->ret = vaStatus;
+    vaDataRX->channelTX = tx;
+    vaDataRX->channelRX = rx;
 
     *outPayload = vaDataRX;
 
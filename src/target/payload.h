@@ -53,12 +53,12 @@ void * HDDLShim_MainPayloadExtraction (HDDLVAFunctionID vaFunctionId, HDDLShimCo
     void *inPayload, int inSize);
 
 //!
-//! \brief   Extract individual payload based on functionId
+//! \brief   Extract individual payload based on functionId, inSize bytes of which were received
 //! \return  VAStatus
 //!          Return VA_STATUS_SUCCESS if success, else fail
 //!
 VAStatus HDDLShim_ExtractPayload (HDDLVAFunctionID functionId, HDDLShimCommContext *ctx,
-    void *inPayload, void **outPayload);
+    void *inPayload, uint32_t inSize, void **outPayload);
 
 //!
 //! \brief   Extract & call vaInitialize for KMB Target
@@ -127,7 +127,7 @@ VAStatus HDDLShim_ExtractandCallVADestroySurfaces (VADisplay vaDpy, void *inPayl
 //! \return  VAStatus
 //!          Return VA_STATUS_SUCCESS if success, else fail
 //!
-VAStatus HDDLShim_ExtractandCallVACreateBuffer (VADisplay vaDpy, void *inPayload,
+VAStatus HDDLShim_ExtractandCallVACreateBuffer (HDDLShimCommContext *ctx, void *inPayload,
     void **outPayload);
 
 //!
@@ -135,15 +135,38 @@ VAStatus HDDLShim_ExtractandCallVACreateBuffer (VADisplay vaDpy, void *inPayload
 //! \return  VAStatus
 //!          Return VA_STATUS_SUCCESS if success, else fail
 //!
-VAStatus HDDLShim_ExtractandCallVADestroyBuffer (VADisplay vaDpy, void *inPayload,
+VAStatus HDDLShim_ExtractandCallVADestroyBuffer (HDDLShimCommContext *ctx, void *inPayload,
     void **outPayload);
 
+//!
+//! \brief   Check and clear whether the reply of the last request handled by the calling
+//!          thread has already been written to the shared memory ring
+//! \return  bool
+//!          Return true if the reply must not be written again
+//!
+bool HDDLShim_TakeInPlaceReply ();
+
+//!
+//! \brief   Release the reply and scratch memory of the request the calling thread served,
+//!          once the reply has been written
+//! \return  void
+//!          Return nothing
+//!
+void HDDLShim_ReleasePayload ();
+
+//!
+//! \brief   Free the frame data of every buffer of the display along with its table
+//! \return  void
+//!          Return nothing
+//!
+void HDDLShim_DestroyFrameTable (HDDLShimCommContext *ctx);
+
 //!
 //! \brief   Extract & call vaMapBuffer for KMB Target
 //! \return  VAStatus
 //!          Return VA_STATUS_SUCCESS if success, else fail
 //!
-VAStatus HDDLShim_ExtractandCallVAMapBuffer (VADisplay vaDpy, void *inPayload,
+VAStatus HDDLShim_ExtractandCallVAMapBuffer (HDDLShimCommContext *ctx, void *inPayload,
     void **outPayload);
 
 //!
@@ -151,7 +174,7 @@ VAStatus HDDLShim_ExtractandCallVAMapBuffer (VADisplay vaDpy, void *inPayload,
 //! \return  VAStatus
 //!          Return VA_STATUS_SUCCESS if success, else fail
 //!
-VAStatus HDDLShim_ExtractandCallVAUnmapBuffer (VADisplay vaDpy, void *inPayload,
+VAStatus HDDLShim_ExtractandCallVAUnmapBuffer (HDDLShimCommContext *ctx, void *inPayload,
     void **outPayload);
 
 //!
@@ -191,7 +214,7 @@ VAStatus HDDLShim_ExtractandCallVABeginPicture (VADisplay vaDpy, void *inPayload
 //! \return  VAStatus
 //!          Return VA_STATUS_SUCCESS if success, else fail
 //!
-VAStatus HDDLShim_ExtractandCallVARenderPicture (VADisplay vaDpy, void *inPayload,
+VAStatus HDDLShim_ExtractandCallVARenderPicture (HDDLShimCommContext *ctx, void *inPayload,
     void **outPayload);
 
 //!
@@ -335,7 +358,7 @@ VAStatus HDDLShim_ExtractandCallVACreateBuffer2 (HDDLShimCommContext *ctx, void
 //! \return  VAStatus
 //!          Return VA_STATUS_SUCCESS if success, else fail
 //
-VAStatus HDDLShim_ExtractandCallVAAcquireBufferHandle (VADisplay vaDpy, void *inPayload,
+VAStatus HDDLShim_ExtractandCallVAAcquireBufferHandle (HDDLShimCommContext *ctx, void *inPayload,
     void **outPayload, bool registerFd, uint64_t workloadId, HDDLVABufferNode *vaBufferNodeList);
 
 //!
@@ -343,7 +366,7 @@ VAStatus HDDLShim_ExtractandCallVAAcquireBufferHandle (VADisplay vaDpy, void *in
 //! \return  VAStatus
 //!          Return VA_STATUS_SUCCESS if success, else fail
 //!
-VAStatus HDDLShim_ExtractandCallVAReleaseBufferHandle (VADisplay vaDpy, void *inPayload,
+VAStatus HDDLShim_ExtractandCallVAReleaseBufferHandle (HDDLShimCommContext *ctx, void *inPayload,
     void **outPayload, bool unregisterFd, uint64_t workloadId, HDDLVABufferNode *vaBufferNodeList);
 
 //!
@@ -49,6 +49,10 @@ HDDLVAShimStatus HDDLShim_StartVAAPIShim (HDDLVAShimCommMode vaCommMode)
     {
         commMode = COMM_MODE_TCP;
     }
+    else if (vaCommMode == HDDL_COMM_MODE_SHM)
+    {
+        commMode = COMM_MODE_SHM;
+    }
     else
     {
         printf ("VAAPI Shim: Invalid communciation mode\n");
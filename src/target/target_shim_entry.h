@@ -41,7 +41,8 @@ typedef enum
 {
     HDDL_COMM_MODE_TCP,
     HDDL_COMM_MODE_XLINK,
-    HDDL_COMM_MODE_UNITE
+    HDDL_COMM_MODE_UNITE,
+    HDDL_COMM_MODE_SHM
 }HDDLVAShimCommMode;
 
 //!
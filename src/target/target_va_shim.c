@@ -31,16 +31,190 @@
 
 #include "target_va_shim.h"
 #include <sys/syscall.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 
 pthread_mutex_t gMutex = PTHREAD_MUTEX_INITIALIZER;
 pthread_cond_t gCond = PTHREAD_COND_INITIALIZER;
 
+// XLINK channels handed out to hosts, by the channel ID. Pairs start at an even offset from
+// XLINK_FIRST_AUTO_CHANNEL_ID, so the TX channel tells whether the pair is taken.
+static pthread_mutex_t gChannelMutex = PTHREAD_MUTEX_INITIALIZER;
+static bool gChannelUsed[MAX_XLINK_CHANNEL_ID + 1];
+
+// Channel listeners hold their thread for as long as their session lasts, each gets one of its
+// own. TCP sessions on the event loop only take a worker of gChannelPool per message. The
+// blocking calls a pipelining host sends are served on gRequestPool.
+static HDDLShimThreadPool *gChannelPool = NULL;
+static HDDLShimThreadPool *gRequestPool = NULL;
+static uint32_t gListenerCount = 0;
+static pthread_mutex_t gListenerMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gListenerCond = PTHREAD_COND_INITIALIZER;
+
+// TCP channels wait on one epoll set instead of a listener each, a worker of gChannelPool
+// serves a message once its socket is readable. The socket is armed one shot, so messages
+// of a channel are still served one after the other.
+static int gEventFd = -1;
+static int gEventWakeFd = -1;
+static pthread_t gEventThread;
+
+static HDDLShimStatus HDDLShim_AddSession (HDDLShimCommContext *ctx);
+static void HDDLShim_StartEventLoop (CommMode commMode);
+static void HDDLShim_StopEventLoop ();
+
+static bool HDDLShim_AllocChannelPair (uint16_t *tx, uint16_t *rx)
+{
+    bool found = false;
+
+    HDDLThreadMgr_LockMutex (&gChannelMutex);
+
+    for (uint32_t channel = XLINK_FIRST_AUTO_CHANNEL_ID; channel < MAX_XLINK_CHANNEL_ID;
+        channel += 2)
+    {
+        if (!gChannelUsed[channel])
+        {
+            gChannelUsed[channel] = true;
+            *tx = channel;
+            *rx = channel + 1;
+            found = true;
+            break;
+        }
+    }
+
+    HDDLThreadMgr_UnlockMutex (&gChannelMutex);
+
+    return found;
+}
+
+static void HDDLShim_FreeChannelPair (uint16_t tx)
+{
+    HDDLThreadMgr_LockMutex (&gChannelMutex);
+    gChannelUsed[tx] = false;
+    HDDLThreadMgr_UnlockMutex (&gChannelMutex);
+}
+
+// The thread or worker is done with the channel once the listener returns
+static void *HDDLShim_EndThread (ShimThreadParams *threadParams)
+{
+    if (threadParams->autoChannel)
+    {
+        HDDLShim_FreeChannelPair (threadParams->tx);
+    }
+
+    return NULL;
+}
+
+static char *HDDLShim_GetCpuList (const char *envName)
+{
+    char *cpuEnv = getenv (envName);
+
+    return (cpuEnv != NULL && cpuEnv[0] != '\0') ? cpuEnv : NULL;
+}
+
+static void *HDDLShim_ListenerThread (void *params)
+{
+    HDDLShim_StartNewThread (params);
+
+    HDDLThreadMgr_LockMutex (&gListenerMutex);
+    gListenerCount--;
+    HDDLThreadMgr_CondBroadcastThread (&gListenerCond);
+    HDDLThreadMgr_UnlockMutex (&gListenerMutex);
+
+    return NULL;
+}
+
+static HDDLShimStatus HDDLShim_StartChannelThread (ShimThreadParams *shimThreadParams)
+{
+    // A listener would keep its worker to the end of the session, once the pool is taken up
+    // further channels would never be served
+    if (shimThreadParams->commMode == COMM_MODE_TCP && gEventFd >= 0)
+    {
+        if (HDDLThreadMgr_SubmitPool (gChannelPool, HDDLShim_StartNewThread,
+            (void *)shimThreadParams) != 0)
+        {
+            SHIM_ERROR_MESSAGE ("Failed to queue session for channel %x", shimThreadParams->tx);
+            return HDDL_SHIM_STATUS_FAILED;
+        }
+
+        return HDDL_SHIM_STATUS_SUCCESS;
+    }
+
+    HDDLThreadMgr_LockMutex (&gListenerMutex);
+    gListenerCount++;
+    HDDLThreadMgr_UnlockMutex (&gListenerMutex);
+
+    if (HDDLThreadMgr_CreateDetachedThread (HDDLShim_ListenerThread, (void *)shimThreadParams,
+        HDDLShim_GetCpuList ("BYPASS_CHANNEL_CPUS")) != 0)
+    {
+        SHIM_ERROR_MESSAGE ("Failed to start listener for channel %x", shimThreadParams->tx);
+
+        HDDLThreadMgr_LockMutex (&gListenerMutex);
+        gListenerCount--;
+        HDDLThreadMgr_CondBroadcastThread (&gListenerCond);
+        HDDLThreadMgr_UnlockMutex (&gListenerMutex);
+
+        return HDDL_SHIM_STATUS_FAILED;
+    }
+
+    return HDDL_SHIM_STATUS_SUCCESS;
+}
+
+static uint32_t HDDLShim_GetPoolSize (const char *envName, uint32_t defaultSize)
+{
+    char *sizeEnv = getenv (envName);
+
+    if (sizeEnv != NULL && atoi (sizeEnv) > 0)
+    {
+        return (atoi (sizeEnv) < MAX_POOL_THREADS) ? atoi (sizeEnv) : MAX_POOL_THREADS;
+    }
+
+    return defaultSize;
+}
+
+static HDDLShimStatus HDDLShim_StartPools ()
+{
+    if (HDDLThreadMgr_CreatePool (&gChannelPool,
+        HDDLShim_GetPoolSize ("BYPASS_CHANNEL_THREADS", DEFAULT_CHANNEL_THREADS),
+        HDDLShim_GetCpuList ("BYPASS_CHANNEL_CPUS")) != 0)
+    {
+        SHIM_ERROR_MESSAGE ("Failed to start channel worker pool");
+        return HDDL_SHIM_STATUS_FAILED;
+    }
+
+    // Without it blocking calls are served by the listener, one after the other
+    if (HDDLThreadMgr_CreatePool (&gRequestPool,
+        HDDLShim_GetPoolSize ("BYPASS_WORKER_THREADS", DEFAULT_WORKER_THREADS),
+        HDDLShim_GetCpuList ("BYPASS_WORKER_CPUS")) != 0)
+    {
+        SHIM_ERROR_MESSAGE ("Failed to start request worker pool");
+        gRequestPool = NULL;
+    }
+
+    return HDDL_SHIM_STATUS_SUCCESS;
+}
+
+static void HDDLShim_StopPools ()
+{
+    HDDLShim_StopEventLoop ();
+
+    HDDLThreadMgr_LockMutex (&gListenerMutex);
+    while (gListenerCount > 0)
+    {
+        HDDLThreadMgr_CondWaitThread (&gListenerCond, &gListenerMutex);
+    }
+    HDDLThreadMgr_UnlockMutex (&gListenerMutex);
+
+    HDDLThreadMgr_DestroyPool (gChannelPool);
+    gChannelPool = NULL;
+
+    HDDLThreadMgr_DestroyPool (gRequestPool);
+    gRequestPool = NULL;
+}
+
 #ifdef HDDL_UNITE
 void HDDLShim_NewWorkloadAvailable (uint64_t workloadId, ChannelID* channelId,
     uint32_t channelNum, uint32_t swDeviceID)
 {
-    pthread_attr_t threadAttrib;
-    pthread_t newThread;
     ShimThreadParams *shimThreadParams = HDDLMemoryMgr_AllocAndZeroMemory (
         sizeof (ShimThreadParams));
     SHIM_CHK_NULL (shimThreadParams, "shimThreadParams returned NULL", );
@@ -56,11 +230,10 @@ void HDDLShim_NewWorkloadAvailable (uint64_t workloadId, ChannelID* channelId,
 
     pthread_cond_signal (&gCond);
 
-    pthread_attr_init (&threadAttrib);
-    pthread_attr_setdetachstate (&threadAttrib, PTHREAD_CREATE_DETACHED);
-    pthread_create (&newThread, &threadAttrib, HDDLShim_StartNewThread,
-        (void *)shimThreadParams);
-    pthread_attr_destroy (&threadAttrib);
+    if (HDDLShim_StartChannelThread (shimThreadParams) != HDDL_SHIM_STATUS_SUCCESS)
+    {
+        HDDLMemoryMgr_FreeMemory (shimThreadParams);
+    }
 }
 #endif
 
@@ -70,12 +243,14 @@ void *HDDLShim_StartNewThread (void *params)
     CommStatus commStatus;
     HDDLShimCommContext *ctx;
 
+    HDDLMemoryMgr_FreeMemory (params);
+
     ctx = (HDDLShimCommContext *)HDDLMemoryMgr_AllocAndZeroMemory (
         sizeof (HDDLShimCommContext));
     if (ctx == NULL)
     {
         SHIM_ERROR_MESSAGE ("Failed to allocated comm context");
-        pthread_exit (NULL);
+        return HDDLShim_EndThread (&threadParams);
     }
 
     commStatus = Comm_ContextInit (&ctx, &threadParams);
@@ -83,15 +258,34 @@ void *HDDLShim_StartNewThread (void *params)
     {
         SHIM_ERROR_MESSAGE ("Error to initialize communication context");
         HDDLMemoryMgr_FreeMemory (ctx);
-        pthread_exit (NULL);
+        return HDDLShim_EndThread (&threadParams);
     }
 
     commStatus = Comm_Initialize (ctx, TARGET);
     if (commStatus != COMM_STATUS_SUCCESS)
     {
         SHIM_ERROR_MESSAGE ("Error to initialize communication settings");
+        if (IS_XLINK_MODE (ctx))
+        {
+            XLink_ContextDestroy (ctx->xLinkCtx);
+        }
         HDDLMemoryMgr_FreeMemory (ctx);
-        pthread_exit (NULL);
+        return HDDLShim_EndThread (&threadParams);
+    }
+
+    ctx->autoChannel = threadParams.autoChannel;
+    ctx->vaDpy = threadParams.vaDpy;
+    ctx->vaDrmFd = threadParams.vaDrmFd;
+    ctx->profile = threadParams.profile;
+    ctx->idTable = threadParams.idTable;
+    ctx->mapTable = threadParams.mapTable;
+    ctx->frameTable = threadParams.frameTable;
+
+    // The event loop waits for the host from now on, the worker is free again
+    if (gEventFd >= 0 && Comm_GetPollFd (ctx, true) >= 0 &&
+        HDDLShim_AddSession (ctx) == HDDL_SHIM_STATUS_SUCCESS)
+    {
+        return HDDLShim_EndThread (&threadParams);
     }
 
     commStatus = Comm_Connect (ctx, TARGET);
@@ -100,13 +294,9 @@ void *HDDLShim_StartNewThread (void *params)
         SHIM_ERROR_MESSAGE ("Error to Connect");
         Comm_CloseSocket (ctx, TARGET);
         HDDLMemoryMgr_FreeMemory (ctx);
-        pthread_exit (NULL);
+        return HDDLShim_EndThread (&threadParams);
     }
 
-    ctx->vaDpy = threadParams.vaDpy;
-    ctx->vaDrmFd = threadParams.vaDrmFd;
-    ctx->profile = threadParams.profile;
-
     MainReceiverListener (ctx);
 
     commStatus = Comm_Disconnect (ctx, TARGET);
@@ -114,12 +304,11 @@ void *HDDLShim_StartNewThread (void *params)
     {
         SHIM_ERROR_MESSAGE ("Error to Disconnect");
         HDDLMemoryMgr_FreeMemory (ctx);
-        pthread_exit (NULL);
+        return HDDLShim_EndThread (&threadParams);
     }
 
-    HDDLMemoryMgr_FreeMemory (params);
     HDDLMemoryMgr_FreeMemory (ctx);
-    pthread_exit (NULL);
+    return HDDLShim_EndThread (&threadParams);
 }
 
 int main (int argc, char *argv[])
@@ -143,8 +332,161 @@ int main (int argc, char *argv[])
     return shimStatus;
 }
 
+HDDLShimStatus HDDLShim_OpenDynamicChannel (HDDLShimCommContext *ctx, CommMode commMode,
+    uint16_t *tx, uint16_t *rx)
+{
+    ShimThreadParams *shimThreadParams;
+
+    shimThreadParams = HDDLMemoryMgr_AllocAndZeroMemory (sizeof (ShimThreadParams));
+    SHIM_CHK_NULL (shimThreadParams, "shimThreadParams returned NULL", HDDL_SHIM_STATUS_FAILED);
+
+    if (*tx == 0 && *rx == 0)
+    {
+        if (commMode != COMM_MODE_XLINK || !HDDLShim_AllocChannelPair (tx, rx))
+        {
+            SHIM_ERROR_MESSAGE ("No free channel pair to hand out");
+            HDDLMemoryMgr_FreeMemory (shimThreadParams);
+            return HDDL_SHIM_STATUS_FAILED;
+        }
+
+        shimThreadParams->autoChannel = true;
+    }
+
+    shimThreadParams->commMode = commMode;
+    shimThreadParams->tx = *tx;
+    shimThreadParams->rx = *rx;
+
+    // Channels of the same host process share its display
+    if (ctx != NULL)
+    {
+        shimThreadParams->vaDpy = ctx->vaDpy;
+        shimThreadParams->vaDrmFd = ctx->vaDrmFd;
+        shimThreadParams->profile = ctx->profile;
+        shimThreadParams->idTable = ctx->idTable;
+        shimThreadParams->mapTable = ctx->mapTable;
+        shimThreadParams->frameTable = ctx->frameTable;
+    }
+
+    if (HDDLShim_StartChannelThread (shimThreadParams) != HDDL_SHIM_STATUS_SUCCESS)
+    {
+        if (shimThreadParams->autoChannel)
+        {
+            HDDLShim_FreeChannelPair (*tx);
+        }
+
+        HDDLMemoryMgr_FreeMemory (shimThreadParams);
+        return HDDL_SHIM_STATUS_FAILED;
+    }
+
+    return HDDL_SHIM_STATUS_SUCCESS;
+}
+
+// Hands out a channel pair to each host that connects, one request per connection. The thread
+// of the pair is already opening its side when the host gets the reply.
+static void HDDLShim_ServeControlChannel (CommMode commMode)
+{
+    HDDLShimCommContext *ctx;
+    ShimThreadParams threadParams;
+    HDDLDynamicChannelTX vaDataTX;
+    HDDLDynamicChannelRX vaDataRX;
+    CommStatus commStatus;
+    uint32_t retryCount = 0;
+
+    ctx = (HDDLShimCommContext *)HDDLMemoryMgr_AllocAndZeroMemory (
+        sizeof (HDDLShimCommContext));
+    SHIM_CHK_NULL (ctx, "Failed to allocate control context", );
+
+    HDDLMemoryMgr_ZeroMemory (&threadParams, sizeof (threadParams));
+    threadParams.commMode = commMode;
+    threadParams.tx = XLINK_CONTROL_CHANNEL_RX;
+    threadParams.rx = XLINK_CONTROL_CHANNEL_TX;
+
+    if (Comm_ContextInit (&ctx, &threadParams) != COMM_STATUS_SUCCESS ||
+        Comm_Initialize (ctx, TARGET) != COMM_STATUS_SUCCESS)
+    {
+        SHIM_ERROR_MESSAGE ("Failed to initialize control channel");
+        XLink_ContextDestroy (ctx->xLinkCtx);
+        HDDLMemoryMgr_FreeMemory (ctx);
+        return;
+    }
+
+    SHIM_NORMAL_MESSAGE ("Control channel TX %x RX %x", threadParams.tx, threadParams.rx);
+
+    while (1)
+    {
+        // Waits for the next host to open its side
+        commStatus = Comm_Connect (ctx, TARGET);
+        if (commStatus != COMM_STATUS_SUCCESS)
+        {
+            // The device stays down, give up instead of spinning on it
+            if (++retryCount >= CONTROL_CONNECT_RETRY)
+            {
+                SHIM_ERROR_MESSAGE ("Failed to connect control channel %u times, giving up",
+                    retryCount);
+                break;
+            }
+
+            SHIM_ERROR_MESSAGE ("Failed to connect control channel");
+            usleep (CONTROL_CONNECT_RETRY_INTERVAL);
+            continue;
+        }
+
+        retryCount = 0;
+
+        commStatus = Comm_Read (ctx, sizeof (HDDLDynamicChannelTX), &vaDataTX);
+        if (commStatus == COMM_STATUS_SUCCESS &&
+            vaDataTX.vaData.vaFunctionID == HDDLDynamicChannelID)
+        {
+            uint16_t tx = 0;
+            uint16_t rx = 0;
+
+            vaDataRX.vaData.vaFunctionID = HDDLDynamicChannelID;
+            vaDataRX.vaData.size = sizeof (HDDLDynamicChannelRX);
+            vaDataRX.vaData.requestId = vaDataTX.vaData.requestId;
+            vaDataRX.ret = VA_STATUS_SUCCESS;
+
+            if (HDDLShim_OpenDynamicChannel (NULL, commMode, &tx, &rx) !=
+                HDDL_SHIM_STATUS_SUCCESS)
+            {
+                vaDataRX.ret = VA_STATUS_ERROR_ALLOCATION_FAILED;
+            }
+
+            vaDataRX.channelTX = tx;
+            vaDataRX.channelRX = rx;
+
+            Comm_Write (ctx, sizeof (HDDLDynamicChannelRX), &vaDataRX);
+        }
+        else
+        {
+            SHIM_ERROR_MESSAGE ("Invalid channel request");
+        }
+
+        Comm_Disconnect (ctx, TARGET);
+    }
+
+    // Only a run of failed connects ends the loop, those left no channel open
+    XLink_ContextDestroy (ctx->xLinkCtx);
+    HDDLMemoryMgr_FreeMemory (ctx);
+}
+
 HDDLShimStatus HDDLShim_StartVAAPIShimWithMode (CommMode commMode)
 {
+    char *controlEnv = getenv ("BYPASS_CONTROL_CHANNEL");
+
+    if (HDDLShim_StartPools () != HDDL_SHIM_STATUS_SUCCESS)
+    {
+        return HDDL_SHIM_STATUS_FAILED;
+    }
+
+    HDDLShim_StartEventLoop (commMode);
+
+    // Hosts ask for their channels, no one has to type them in for every session
+    if (commMode == COMM_MODE_XLINK && controlEnv != NULL && atoi (controlEnv) != 0)
+    {
+        HDDLShim_ServeControlChannel (commMode);
+        HDDLShim_StopPools ();
+        return HDDL_SHIM_STATUS_FAILED;
+    }
 
 #ifdef HDDL_UNITE
     if (commMode == COMM_MODE_UNITE)
@@ -161,10 +503,9 @@ HDDLShimStatus HDDLShim_StartVAAPIShimWithMode (CommMode commMode)
             HDDLThreadMgr_CondWaitThread (&gCond, &gMutex);
             HDDLThreadMgr_UnlockMutex (&gMutex);
         }
-        else if (commMode == COMM_MODE_XLINK || commMode == COMM_MODE_TCP)
+        else if (commMode == COMM_MODE_XLINK || commMode == COMM_MODE_TCP ||
+            commMode == COMM_MODE_SHM)
         {
-            pthread_attr_t threadAttrib;
-            pthread_t newThread;
             ShimThreadParams *shimThreadParams = HDDLMemoryMgr_AllocAndZeroMemory (
                 sizeof (ShimThreadParams));
 
@@ -174,11 +515,10 @@ HDDLShimStatus HDDLShim_StartVAAPIShimWithMode (CommMode commMode)
 
                 shimThreadParams->commMode = commMode;
 
-                pthread_attr_init (&threadAttrib);
-                pthread_attr_setdetachstate (&threadAttrib, PTHREAD_CREATE_DETACHED);
-                pthread_create (&newThread, &threadAttrib, HDDLShim_StartNewThread,
-                    (void *)shimThreadParams);
-	        pthread_attr_destroy (&threadAttrib);
+                if (HDDLShim_StartChannelThread (shimThreadParams) != HDDL_SHIM_STATUS_SUCCESS)
+                {
+                    HDDLMemoryMgr_FreeMemory (shimThreadParams);
+                }
 	    }
         }
 	else
@@ -187,18 +527,243 @@ HDDLShimStatus HDDLShim_StartVAAPIShimWithMode (CommMode commMode)
 	}
     }
 
+    // Sessions still open are served to their end first
+    HDDLShim_StopPools ();
+
     return 0;
 }
 
-void MainReceiverListener (HDDLShimCommContext *ctx)
+static CommStatus HDDLShim_WriteReply (HDDLShimCommContext *ctx, void *payload, void *vaDataRX)
+{
+    // Already built straight in the shared memory ring
+    if (HDDLShim_TakeInPlaceReply ())
+    {
+        return COMM_STATUS_SUCCESS;
+    }
+
+    ( (HDDLVAData *)vaDataRX)->requestId = ( (HDDLVAData *)payload)->requestId;
+
+    // Workers of the same channel write their replies concurrently
+    return Comm_WriteSafe (ctx, ( (HDDLVAData *)vaDataRX)->size, vaDataRX);
+}
+
+static void HDDLShim_WaitRequests (HDDLShimRequestTracker *tracker)
+{
+    HDDLThreadMgr_LockMutex (&tracker->mutex);
+
+    while (tracker->inFlight > 0)
+    {
+        HDDLThreadMgr_CondWaitThread (&tracker->cond, &tracker->mutex);
+    }
+
+    HDDLThreadMgr_UnlockMutex (&tracker->mutex);
+}
+
+static void *HDDLShim_AsyncRequestThread (void *params)
+{
+    HDDLShimAsyncRequest *request = (HDDLShimAsyncRequest *)params;
+    HDDLShimRequestTracker *tracker = request->tracker;
+    CommStatus commStatus;
+    void *vaDataRX;
+
+    vaDataRX = HDDLShim_MainPayloadExtraction (request->vaFunctionID, request->ctx,
+        request->message.payload, request->message.size);
+
+    if (vaDataRX == NULL)
+    {
+        SHIM_ERROR_MESSAGE ("vaDataRX returned NULL");
+    }
+    else
+    {
+        commStatus = HDDLShim_WriteReply (request->ctx, request->message.payload, vaDataRX);
+        if (commStatus != COMM_STATUS_SUCCESS)
+        {
+            SHIM_ERROR_MESSAGE ("Error write reply of function %d", request->vaFunctionID);
+        }
+    }
+
+    HDDLShim_ReleasePayload ();
+
+    Comm_ReleaseMessage (request->ctx, &request->message);
+    HDDLMemoryMgr_FreeMemory (request);
+
+    HDDLThreadMgr_LockMutex (&tracker->mutex);
+    tracker->inFlight--;
+    HDDLThreadMgr_CondBroadcastThread (&tracker->cond);
+    HDDLThreadMgr_UnlockMutex (&tracker->mutex);
+
+    return NULL;
+}
+
+// Hand the request over to a worker thread which owns the message from now on. The message
+// may still sit in the receive buffer of a transport that lends out one message at a time,
+// it is copied out first in that case.
+static HDDLShimStatus HDDLShim_StartAsyncRequest (HDDLShimCommContext *ctx,
+    HDDLShimRequestTracker *tracker, HDDLVAFunctionID vaFunctionID,
+    HDDLShimCommMessage *message)
+{
+    HDDLShimAsyncRequest *request;
+
+    if (gRequestPool == NULL)
+    {
+        return HDDL_SHIM_STATUS_FAILED;
+    }
+
+    request = HDDLMemoryMgr_AllocAndZeroMemory (sizeof (HDDLShimAsyncRequest));
+    SHIM_CHK_NULL (request, "request returned NULL", HDDL_SHIM_STATUS_FAILED);
+
+    request->ctx = ctx;
+    request->tracker = tracker;
+    request->vaFunctionID = vaFunctionID;
+    if (Comm_DetachMessage (ctx, message) != COMM_STATUS_SUCCESS)
+    {
+        HDDLMemoryMgr_FreeMemory (request);
+        return HDDL_SHIM_STATUS_FAILED;
+    }
+
+    request->message = *message;
+
+    HDDLThreadMgr_LockMutex (&tracker->mutex);
+    tracker->inFlight++;
+    HDDLThreadMgr_UnlockMutex (&tracker->mutex);
+
+    if (HDDLThreadMgr_SubmitPool (gRequestPool, HDDLShim_AsyncRequestThread,
+        (void *)request) != 0)
+    {
+        SHIM_ERROR_MESSAGE ("Failed to queue function %d on a worker", vaFunctionID);
+
+        HDDLThreadMgr_LockMutex (&tracker->mutex);
+        tracker->inFlight--;
+        HDDLThreadMgr_UnlockMutex (&tracker->mutex);
+
+        HDDLMemoryMgr_FreeMemory (request);
+        return HDDL_SHIM_STATUS_FAILED;
+    }
+
+    return HDDL_SHIM_STATUS_SUCCESS;
+}
+
+// Serve one message of the session and give it back to the transport
+static HDDLShimSessionStatus HDDLShim_ProcessMessage (HDDLShimCommContext *ctx,
+    HDDLShimRequestTracker *tracker, HDDLShimCommMessage *message, uint32_t *writeRetryCount)
 {
-    void *payload = NULL;
+    void *payload = message->payload;
     void *vaDataRX = NULL;
-    HDDLVAData *vaData = NULL;
-    HDDLVAFunctionID vaFunctionID = 0;
+    uint32_t size = message->size;
+    HDDLVAFunctionID vaFunctionID = ( (HDDLVAData *)payload)->vaFunctionID;
+    CommStatus commStatus;
+
+    if (vaFunctionID >= HDDLVAMaxFunctionID)
+    {
+        SHIM_ERROR_MESSAGE ("out of boundary");
+        Comm_ReleaseMessage (ctx, message);
+        return HDDL_SESSION_CONTINUE;
+    }
+
+    if ( (vaFunctionID == HDDLVAMedia_DriverInit) && (ctx->vaDpy == NULL))
+    {
+        char *mapEnv = getenv ("BYPASS_MAP_CACHE");
+
+        va_open_display (&ctx->vaDpy, (int *)&ctx->vaDrmFd);
+
+        // Buffer IDs the host hands out for this display
+        ctx->idTable = HDDLMemoryMgr_CreateIdTable ();
+        ctx->frameTable = HDDLMemoryMgr_CreateIdTable ();
+
+        // Parameter buffers stay mapped from their first update until they are destroyed
+        if (mapEnv != NULL && atoi (mapEnv) != 0)
+        {
+            ctx->mapTable = HDDLMemoryMgr_CreateIdTable ();
+        }
+    }
+
+    // Nothing may still be running on the display once it is closed
+    if (vaFunctionID == HDDLVATerminate)
+    {
+        HDDLShim_WaitRequests (tracker);
+    }
+
+    // A pipelining host keeps other requests in flight meanwhile, the reply of a blocking
+    // call is sent whenever it completes
+    if ( ( (HDDLVAData *)payload)->requestId != 0 && FUNCTION_HAS (vaFunctionID, FUNCTION_ASYNC))
+    {
+        if (HDDLShim_StartAsyncRequest (ctx, tracker, vaFunctionID, message) ==
+            HDDL_SHIM_STATUS_SUCCESS)
+        {
+            return HDDL_SESSION_CONTINUE;
+        }
+
+        payload = message->payload;
+    }
+
+    // Call corresponding function to handle VAFunctionID
+    vaDataRX = HDDLShim_MainPayloadExtraction (vaFunctionID, ctx, payload, size);
+
+    if (vaDataRX == NULL)
+    {
+        SHIM_ERROR_MESSAGE ("vaDataRX returned NULL");
+        HDDLShim_ReleasePayload ();
+        Comm_ReleaseMessage (ctx, message);
+        return HDDL_SESSION_CONTINUE;
+    }
+
+    // Write back processed result
+    commStatus = HDDLShim_WriteReply (ctx, payload, vaDataRX);
+
+    HDDLShim_ReleasePayload ();
+    Comm_ReleaseMessage (ctx, message);
+
+    if (commStatus != COMM_STATUS_SUCCESS)
+    {
+        (*writeRetryCount)++;
+        SHIM_ERROR_MESSAGE ("Error write pcie device for %d time(s)", *writeRetryCount);
+
+        if (*writeRetryCount == MAX_ERROR_RETRY)
+        {
+            SHIM_ERROR_MESSAGE ("Failed to write pcie device for %u consecutive tries. "
+                "Exiting thread", *writeRetryCount);
+            return HDDL_SESSION_FAILED;
+        }
+
+        return HDDL_SESSION_CONTINUE;
+    }
+
+    // Reset retry count upon each success operation
+    *writeRetryCount = 0;
+
+    if (vaFunctionID == HDDLVATerminate)
+    {
+        va_close_display (ctx->vaDpy, ctx->vaDrmFd);
+        ctx->vaDpy = NULL;
+        ctx->vaDrmFd = -1;
+
+        HDDLMemoryMgr_DestroyIdTable (ctx->idTable);
+        ctx->idTable = NULL;
+
+        // vaTerminate released the mappings along with the buffers
+        HDDLMemoryMgr_DestroyIdTable (ctx->mapTable);
+        ctx->mapTable = NULL;
+
+        HDDLShim_DestroyFrameTable (ctx);
+
+        SHIM_PROFILE_TERMINATE ();
+        SHIM_PROFILE_INIT ();
+
+        HDDLThreadMgr_LogPoolStats (gChannelPool, "Channel");
+        HDDLThreadMgr_LogPoolStats (gRequestPool, "Request");
+
+        return HDDL_SESSION_TERMINATED;
+    }
+
+    return HDDL_SESSION_CONTINUE;
+}
+
+static void HDDLShim_ReceiverLoop (HDDLShimCommContext *ctx, HDDLShimRequestTracker *tracker)
+{
+    HDDLShimCommMessage message;
+    HDDLShimSessionStatus sessionStatus;
     CommStatus commStatus;
     bool terminate = false;
-    uint32_t size = 0;
     uint32_t peekRetryCount = 0;
     uint32_t writeRetryCount = 0;
 
@@ -206,199 +771,304 @@ void MainReceiverListener (HDDLShimCommContext *ctx)
 
     while (!terminate)
     {
-        // TODO: We still need to further generalizing Comm_* functions for TCP
-        // and XLINK here after revisiting peek and read functions implementation.
-        if (IS_TCP_MODE (ctx))
+        // The message is handed out in the transport receive buffer wherever possible and
+        // stays there until it has been processed
+        commStatus = Comm_BorrowMessage (ctx, &message);
+
+        if (commStatus == COMM_STATUS_CONNECTION_CLOSED)
         {
-            // Read payload received
-            size = sizeof (HDDLVAData);
-            vaData = HDDLMemoryMgr_AllocMemory (size);
-            commStatus = Comm_Peek (ctx, &size, vaData);
+            // Operations on host side might being killed without properly
+            // shutting down the connection. Reconnecting and waiting for new
+            // connection if the current connection has been shutdown.
+            HDDLShim_WaitRequests (tracker);
+            commStatus = Comm_Reconnect (ctx);
+            SHIM_CHK_EQUAL (commStatus, COMM_STATUS_FAILED, "error connect", );
+            continue;
+        }
 
-            if (commStatus == COMM_STATUS_CONNECTION_CLOSED)
+        if (commStatus != COMM_STATUS_SUCCESS)
+        {
+            // TODO: We still need to further generalizing Comm_* functions for TCP
+            // and XLINK here after revisiting peek and read functions implementation.
+            if (IS_TCP_MODE (ctx) || IS_SHM_MODE (ctx))
             {
-                // Operations on host side might being killed without properly
-                // shutting down the connection. Reconnecting and waiting for new
-                // connection if the current connection has been shutdown.
-                commStatus = Comm_Reconnect (ctx);
-                SHIM_CHK_EQUAL (commStatus, COMM_STATUS_FAILED, "error connect", );
-                continue;
+                SHIM_ERROR_MESSAGE ("error receive socket");
+                return;
             }
-            SHIM_CHK_EQUAL (commStatus, COMM_STATUS_FAILED, "error peek socket", );
-            SHIM_CHK_NULL (vaData, "vaData returned NULL", );
 
-            size = vaData->size;
-            payload = HDDLMemoryMgr_AllocMemory (size);
-	    SHIM_CHK_NULL (payload, "payload returned NULL", );
+            peekRetryCount++;
+            SHIM_ERROR_MESSAGE ("Error peek pcie device for %u time(s)", peekRetryCount);
 
-            commStatus = Comm_Read (ctx, size, payload);
-            SHIM_CHK_EQUAL (commStatus, COMM_STATUS_FAILED, "error read socket", );
+            if (peekRetryCount == MAX_ERROR_RETRY)
+            {
+                SHIM_ERROR_MESSAGE ("Failed to peek pcie device for %u consecutive tries. "
+                    "Exiting thread", peekRetryCount);
+                terminate = true;
+            }
 
-            vaFunctionID = vaData->vaFunctionID;
-            SHIM_CHK_LESS (vaFunctionID, HDDLVAMaxFunctionID, "out of boundary", );
+            continue;
         }
-        else if (IS_XLINK_MODE (ctx) || IS_UNITE_MODE (ctx))
-        {
-            // Read payload receive
-            commStatus = Comm_Peek (ctx, &size, &payload);
 
-	    if (commStatus == COMM_STATUS_FAILED)
-	    {
-                peekRetryCount++;
-                SHIM_ERROR_MESSAGE ("Error peek pcie device for %u time(s)", peekRetryCount);
-                HDDLMemoryMgr_FreeMemory (payload);
+        // Reset retry count upon each success operation
+        peekRetryCount = 0;
 
-                if (peekRetryCount == MAX_ERROR_RETRY)
-                {
-                    SHIM_ERROR_MESSAGE ("Failed to peek pcie device for %u consecutive tries. "
-                        "Exiting thread", peekRetryCount);
-                    terminate = true;
-                }
+        sessionStatus = HDDLShim_ProcessMessage (ctx, tracker, &message, &writeRetryCount);
 
-                continue;
+        if (sessionStatus == HDDL_SESSION_FAILED)
+        {
+            terminate = true;
+        }
+        else if (sessionStatus == HDDL_SESSION_TERMINATED)
+        {
+            // UNITE and the control channel hand out a new channel pair for each vaInitialize
+            // call, the thread ends with the session. Channels typed in at startup are
+            // reconnected for the next session instead.
+            if (IS_UNITE_MODE (ctx) || ctx->autoChannel)
+            {
+                terminate = true;
             }
             else
             {
-                // Reset retry count upon each success operation
-                peekRetryCount = 0;
+                commStatus = Comm_Reconnect (ctx);
+                SHIM_CHK_EQUAL (commStatus, COMM_STATUS_FAILED, "error reconnecting", );
             }
+        }
+    }
+    SHIM_PROFILE_TERMINATE ();
+}
 
-            SHIM_CHK_NULL (payload, "payload returned NULL", );
+// (Re)arm the socket the session waits on next, the connected one or the listening one
+static HDDLShimStatus HDDLShim_ArmSession (HDDLShimSession *session)
+{
+    struct epoll_event event;
+    int fd = Comm_GetPollFd (session->ctx, session->accepting);
 
-            vaFunctionID = ( ( (HDDLVAData *)payload)->vaFunctionID);
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.ptr = session;
 
-	    if (vaFunctionID >= HDDLVAMaxFunctionID)
-            {
-                SHIM_ERROR_MESSAGE ("out of boundary");
-                HDDLMemoryMgr_FreeMemory (payload);
-                continue;
-            }
+    // Closing a socket takes it out of the set already, the error is of no interest then
+    if (session->pollFd >= 0 && session->pollFd != fd)
+    {
+        epoll_ctl (gEventFd, EPOLL_CTL_DEL, session->pollFd, NULL);
+    }
+
+    if (epoll_ctl (gEventFd, EPOLL_CTL_MOD, fd, &event) != 0 &&
+        epoll_ctl (gEventFd, EPOLL_CTL_ADD, fd, &event) != 0)
+    {
+        SHIM_ERROR_MESSAGE ("Failed to watch socket %d with errno %d", fd, errno);
+        session->pollFd = -1;
+        return HDDL_SHIM_STATUS_FAILED;
+    }
 
-            size = ( ( (HDDLVAData *)payload)->size);
+    session->pollFd = fd;
 
-            if (size > DATA_MAX_SEND_SIZE)
-            {
-                payload = HDDLMemoryMgr_ReallocMemory (payload, size);
-		SHIM_CHK_NULL (payload, "nullptr payload", );
-                commStatus = Comm_Read (ctx, size - DATA_MAX_SEND_SIZE,
-                    (void *) (payload + DATA_MAX_SEND_SIZE));
-            }
-        }
-        else
-        {
-            return;
-        }
+    return HDDL_SHIM_STATUS_SUCCESS;
+}
 
-        if (vaFunctionID == HDDLDynamicChannelID)
-        {
-            pthread_attr_t threadAttrib;
-            pthread_t newThread;
-            ShimThreadParams *shimThreadParams = HDDLMemoryMgr_AllocAndZeroMemory (
-                sizeof (ShimThreadParams));
+static void HDDLShim_RemoveSession (HDDLShimSession *session)
+{
+    if (session->pollFd >= 0)
+    {
+        epoll_ctl (gEventFd, EPOLL_CTL_DEL, session->pollFd, NULL);
+    }
 
-	    if (shimThreadParams == NULL)
-	    {
-	        SHIM_ERROR_MESSAGE ("shimThreadParams returned NULL");
-		HDDLMemoryMgr_FreeMemory (payload);
-		continue;
-	    }
+    HDDLShim_WaitRequests (&session->tracker);
+
+    Comm_Disconnect (session->ctx, TARGET);
+
+    HDDLThreadMgr_DestroyCond (&session->tracker.cond);
+    HDDLThreadMgr_DestroyMutex (&session->tracker.mutex);
+    HDDLMemoryMgr_FreeMemory (session->ctx);
+    HDDLMemoryMgr_FreeMemory (session);
+}
+
+static HDDLShimStatus HDDLShim_AddSession (HDDLShimCommContext *ctx)
+{
+    HDDLShimSession *session = HDDLMemoryMgr_AllocAndZeroMemory (sizeof (HDDLShimSession));
+    SHIM_CHK_NULL (session, "Failed to allocate session", HDDL_SHIM_STATUS_FAILED);
+
+    session->ctx = ctx;
+    session->accepting = true;
+    session->pollFd = -1;
+
+    HDDLThreadMgr_InitMutex (&session->tracker.mutex);
+    HDDLThreadMgr_InitCond (&session->tracker.cond);
+    session->tracker.inFlight = 0;
+
+    if (HDDLShim_ArmSession (session) != HDDL_SHIM_STATUS_SUCCESS)
+    {
+        HDDLThreadMgr_DestroyCond (&session->tracker.cond);
+        HDDLThreadMgr_DestroyMutex (&session->tracker.mutex);
+        HDDLMemoryMgr_FreeMemory (session);
+        return HDDL_SHIM_STATUS_FAILED;
+    }
 
-            shimThreadParams->commMode = COMM_MODE (ctx);
-            shimThreadParams->tx = ( (HDDLDynamicChannelTX *)payload)->channelTX;
-            shimThreadParams->rx = ( (HDDLDynamicChannelTX *)payload)->channelRX;
-            shimThreadParams->vaDpy = ctx->vaDpy;
-            shimThreadParams->vaDrmFd = ctx->vaDrmFd;
-            shimThreadParams->profile = ctx->profile;
-
-            pthread_attr_init (&threadAttrib);
-            pthread_attr_setdetachstate (&threadAttrib, PTHREAD_CREATE_DETACHED);
-            pthread_create (&newThread, &threadAttrib, HDDLShim_StartNewThread,
-                (void *)shimThreadParams);
-            pthread_attr_destroy (&threadAttrib);
-
-	    // TODO: Need to implement method to terminate all these new threads
-	    // when the parent thread is being terminated through vaTerminate call
+    return HDDL_SHIM_STATUS_SUCCESS;
+}
+
+// One step of the session once its socket is readable: take the next host or serve the next
+// message. Runs on a worker of gChannelPool.
+static void *HDDLShim_ServeSession (void *params)
+{
+    HDDLShimSession *session = (HDDLShimSession *)params;
+    HDDLShimCommContext *ctx = session->ctx;
+    HDDLShimSessionStatus sessionStatus = HDDL_SESSION_CONTINUE;
+    HDDLShimCommMessage message;
+    CommStatus commStatus;
+
+    if (session->accepting)
+    {
+        // Drops the connection of the last host as well
+        if (Comm_Reconnect (ctx) == COMM_STATUS_SUCCESS)
+        {
+            session->accepting = false;
         }
+    }
+    else
+    {
+        commStatus = Comm_BorrowMessage (ctx, &message);
 
-        if ( (vaFunctionID == HDDLVAMedia_DriverInit) && (ctx->vaDpy == NULL))
+        if (commStatus == COMM_STATUS_CONNECTION_CLOSED)
         {
-            va_open_display (&ctx->vaDpy, (int *)&ctx->vaDrmFd);
+            // Host went away, possibly without vaTerminate
+            HDDLShim_WaitRequests (&session->tracker);
+            session->accepting = true;
         }
+        else if (commStatus != COMM_STATUS_SUCCESS)
+        {
+            SHIM_ERROR_MESSAGE ("error receive socket");
+            sessionStatus = HDDL_SESSION_FAILED;
+        }
+        else
+        {
+            sessionStatus = HDDLShim_ProcessMessage (ctx, &session->tracker, &message,
+                &session->writeRetryCount);
 
-        // Call corresponding function to handle VAFunctionID
-        vaDataRX = HDDLShim_MainPayloadExtraction (vaFunctionID, ctx, payload, size);
+            // Channels typed in at startup wait for the next session
+            if (sessionStatus == HDDL_SESSION_TERMINATED)
+            {
+                session->accepting = true;
+            }
+        }
+    }
 
-	if (vaDataRX == NULL)
-	{
-            SHIM_ERROR_MESSAGE ("vaDataRX returned NULL");
-            HDDLMemoryMgr_FreeMemory (payload);
-            continue;
-	}
+    if (sessionStatus == HDDL_SESSION_FAILED ||
+        HDDLShim_ArmSession (session) != HDDL_SHIM_STATUS_SUCCESS)
+    {
+        HDDLShim_RemoveSession (session);
+    }
 
-        // Write back processed result
-        commStatus = Comm_Write (ctx, ( (HDDLVAData *)vaDataRX)->size, vaDataRX);
-        if (commStatus != COMM_STATUS_SUCCESS)
-        {
-            writeRetryCount++;
-            SHIM_ERROR_MESSAGE ("Error write pcie device for %d time(s)", writeRetryCount);
-            HDDLMemoryMgr_FreeMemory (vaDataRX);
-            HDDLMemoryMgr_FreeMemory (payload);
+    return NULL;
+}
+
+static void *HDDLShim_EventLoop (void *params)
+{
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+    int count;
 
-            if (writeRetryCount == MAX_ERROR_RETRY)
+    while (1)
+    {
+        count = epoll_wait (gEventFd, events, MAX_EPOLL_EVENTS, -1);
+        if (count < 0)
+        {
+            if (errno == EINTR)
             {
-                SHIM_ERROR_MESSAGE ("Failed to write pcie device for %u consecutive tries. "
-                    "Exiting thread", writeRetryCount);
-                terminate = true;
+                continue;
             }
 
-            continue;
-        }
-        else
-        {
-            // Reset retry count upon each success operation
-            writeRetryCount = 0;
+            SHIM_ERROR_MESSAGE ("Failed to wait for sessions with errno %d", errno);
+            return NULL;
         }
 
-        if (IS_TCP_MODE (ctx))
+        for (int i = 0; i < count; i++)
         {
-            if (vaData)
+            // Only the wake up descriptor comes without a session
+            if (events[i].data.ptr == NULL)
             {
-                HDDLMemoryMgr_FreeMemory (vaData);
+                return NULL;
+            }
+
+            // Served right here if no worker can take it, it would be lost otherwise
+            if (HDDLThreadMgr_SubmitPool (gChannelPool, HDDLShim_ServeSession,
+                events[i].data.ptr) != 0)
+            {
+                HDDLShim_ServeSession (events[i].data.ptr);
             }
         }
+    }
+}
+
+static void HDDLShim_StartEventLoop (CommMode commMode)
+{
+    char *eventEnv = getenv ("BYPASS_EVENT_LOOP");
+    struct epoll_event event;
 
-        if (payload)
+    if (commMode != COMM_MODE_TCP || (eventEnv != NULL && atoi (eventEnv) == 0))
+    {
+        return;
+    }
+
+    gEventFd = epoll_create1 (EPOLL_CLOEXEC);
+    gEventWakeFd = eventfd (0, EFD_CLOEXEC);
+
+    event.events = EPOLLIN;
+    event.data.ptr = NULL;
+
+    if (gEventFd < 0 || gEventWakeFd < 0 ||
+        epoll_ctl (gEventFd, EPOLL_CTL_ADD, gEventWakeFd, &event) != 0 ||
+        HDDLThreadMgr_CreateThread (&gEventThread, NULL, HDDLShim_EventLoop, NULL) != 0)
+    {
+        // Every channel gets a listener of its own instead
+        SHIM_ERROR_MESSAGE ("Failed to start event loop with errno %d", errno);
+
+        if (gEventFd >= 0)
         {
-            HDDLMemoryMgr_FreeMemory (payload);
+            close (gEventFd);
+            gEventFd = -1;
         }
 
-        if (vaDataRX)
+        if (gEventWakeFd >= 0)
         {
-            HDDLMemoryMgr_FreeMemory (vaDataRX);
+            close (gEventWakeFd);
+            gEventWakeFd = -1;
         }
+    }
+}
 
-        if (vaFunctionID == HDDLVATerminate)
-        {
-            va_close_display (ctx->vaDpy, ctx->vaDrmFd);
-            ctx->vaDpy = NULL;
-            ctx->vaDrmFd = -1;
-
-            SHIM_PROFILE_TERMINATE ();
-            SHIM_PROFILE_INIT ();
-
-            // TODO: Currently only UNITE mode will terminate the thread for each vaTerminate
-            // call since we will receive new XLink channels pairs for each vaInitialize call.
-            // For XLINK and TCP mode, there's no explicit service similar as HDDLUnite to
-            // provide the new channles/ports pair. We need to figure out a better way to handle
-            // this instead of reconnecting and never exit.
-            commStatus = Comm_Reconnect (ctx);
-            SHIM_CHK_EQUAL (commStatus, COMM_STATUS_FAILED, "error reconnecting", );
+static void HDDLShim_StopEventLoop ()
+{
+    uint64_t wake = 1;
 
-            if (IS_UNITE_MODE (ctx))
-            {
-                terminate = true;
-            }
-        }
+    if (gEventFd < 0)
+    {
+        return;
     }
-    SHIM_PROFILE_TERMINATE ();
+
+    if (write (gEventWakeFd, &wake, sizeof (wake)) == sizeof (wake))
+    {
+        HDDLThreadMgr_JoinThread (gEventThread, NULL);
+    }
+
+    // Sessions still queued on gChannelPool find the set closed and go away
+    close (gEventFd);
+    close (gEventWakeFd);
+    gEventFd = -1;
+    gEventWakeFd = -1;
+}
+
+void MainReceiverListener (HDDLShimCommContext *ctx)
+{
+    HDDLShimRequestTracker tracker;
+
+    HDDLThreadMgr_InitMutex (&tracker.mutex);
+    HDDLThreadMgr_InitCond (&tracker.cond);
+    tracker.inFlight = 0;
+
+    HDDLShim_ReceiverLoop (ctx, &tracker);
+
+    // Workers still use the channel, which goes away once the listener returns
+    HDDLShim_WaitRequests (&tracker);
+
+    HDDLThreadMgr_DestroyCond (&tracker.cond);
+    HDDLThreadMgr_DestroyMutex (&tracker.mutex);
 }
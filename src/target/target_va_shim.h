@@ -42,6 +42,41 @@
 #endif
 
 #define MAX_ERROR_RETRY 5
+#define MAX_EPOLL_EVENTS 64
+
+// Requests of one listener still being served on worker threads
+typedef struct _SHIM_REQUEST_TRACKER
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    uint32_t inFlight;
+}HDDLShimRequestTracker;
+
+// What is left to do for a channel once one of its messages has been served
+typedef enum
+{
+    HDDL_SESSION_CONTINUE,
+    HDDL_SESSION_TERMINATED,        // vaTerminate closed the display
+    HDDL_SESSION_FAILED
+}HDDLShimSessionStatus;
+
+// Channel served from the event loop, no thread waits on it while the host is quiet
+typedef struct _SHIM_SESSION
+{
+    HDDLShimCommContext *ctx;
+    HDDLShimRequestTracker tracker;
+    bool accepting;                 // Waiting for the next host to connect
+    int pollFd;                     // Socket watched for the session, -1 if none yet
+    uint32_t writeRetryCount;
+}HDDLShimSession;
+
+typedef struct _SHIM_ASYNC_REQUEST
+{
+    HDDLShimCommContext *ctx;
+    HDDLShimRequestTracker *tracker;
+    HDDLVAFunctionID vaFunctionID;
+    HDDLShimCommMessage message;
+}HDDLShimAsyncRequest;
 
 //!
 //! \brief   Main program to start VAAPI Shim on accelerator
@@ -57,6 +92,15 @@ int main (int argc, char *argv[]);
 //!
 HDDLShimStatus HDDLShim_StartVAAPIShimWithMode (CommMode commMode);
 
+//!
+//! \brief   Start a thread serving the channel pair tx and rx, which picks a free pair and
+//!          returns it if both are 0
+//! \return  HDDLShimStatus
+//!          Return HDDL_SHIM_STATUS_SUCCESS if success, else fail
+//!
+HDDLShimStatus HDDLShim_OpenDynamicChannel (HDDLShimCommContext *ctx, CommMode commMode,
+    uint16_t *tx, uint16_t *rx);
+
 //!
 //! \brief   Receiver listener for receiving payload
 //! \return  void
@@ -108,15 +108,19 @@ struct timeval commStart, commEnd;
 #define SHIM_PROFILE_START()        \
     gettimeofday (&commStart, NULL)
 
-#define SHIM_PROFILE_END()          \
+// Named after the VA call being timed rather than the function doing the timing
+#define SHIM_PROFILE_END_NAMED(name) \
 {                                   \
     gettimeofday (&commEnd, NULL);  \
-    fprintf (file, "\t\t* %s\t\ttime (us): %ld\n", __func__, \
+    fprintf (file, "\t\t* %s\t\ttime (us): %ld\n", name, \
         ( (commEnd.tv_sec - commStart.tv_sec) * 1000000) + (commEnd.tv_usec - commStart.tv_usec));\
 }
+
+#define SHIM_PROFILE_END() SHIM_PROFILE_END_NAMED (__func__)
 #else
 #define SHIM_PROFILE_START()
 #define SHIM_PROFILE_END()
+#define SHIM_PROFILE_END_NAMED(name)
 #endif
 
 #else /*release*/
@@ -130,6 +134,7 @@ struct timeval commStart, commEnd;
 #define SHIM_PROFILE_TERMINATE()
 #define SHIM_PROFILE_START()
 #define SHIM_PROFILE_END()
+#define SHIM_PROFILE_END_NAMED(name)
 
 #endif
 